@@ -5,14 +5,20 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include <array>
+#include <bit>
+#include <bitset>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include <masm/assembler/debug_info.hpp>
+#include <masm/exceptions.hpp>
 
 
 /**
@@ -21,6 +27,24 @@
 constexpr int32_t TEXT_SEC_END = 0x10000000;
 
 
+/**
+ * The size of a single page of main memory in bytes
+ */
+constexpr uint32_t MEM_PAGE_SIZE = 0x1000;
+
+
+/**
+ * The number of low address bits that index a byte within a page
+ */
+constexpr uint32_t MEM_PAGE_BITS = 12;
+
+
+/**
+ * The number of page tables in the page directory and pages within each page table
+ */
+constexpr uint32_t MEM_TABLE_SIZE = 0x400;
+
+
 /**
  * Class representing valid, named sections of memory
  */
@@ -61,20 +85,101 @@ struct MemLayout {
 };
 
 
+/**
+ * Struct representing a single page of main memory, allocated on first write
+ */
+struct MemPage {
+    /**
+     * The bytes stored within the page, zero if never written
+     */
+    std::array<std::byte, MEM_PAGE_SIZE> bytes = {};
+
+    /**
+     * Which bytes within the page have been initialized
+     */
+    std::bitset<MEM_PAGE_SIZE> valid;
+};
+
+
+/**
+ * A table of pages covering 4MiB of the address space
+ */
+using MemPageTable = std::array<std::shared_ptr<MemPage>, MEM_TABLE_SIZE>;
+
+
+/**
+ * A point-in-time copy of main memory.  Pages are shared with the memory that the snapshot was taken from, and with any
+ * memory it is restored into, until one of them writes to a page and receives its own copy.  Snapshots are never
+ * modified, so one snapshot may be restored into memories on different threads
+ */
+struct MemorySnapshot {
+    /**
+     * The page directory at the time of the snapshot
+     */
+    std::array<std::shared_ptr<const MemPageTable>, MEM_TABLE_SIZE> directory;
+
+    /**
+     * Whether the MMIO output data word had been stored to but not yet written out
+     */
+    bool outputDirty = false;
+};
+
+
 /**
  * Class representing main memory
  */
 class Memory {
     /**
-     * The main memory map between indices and bytes
+     * The page directory, mapping the upper ten bits of an address to its page table.  Pages and
+     * page tables are only allocated once they are written to.  Both may be shared with snapshots, in
+     * which case they are copied before their first write
      */
-    std::unordered_map<uint32_t, std::byte> memory;
+    std::array<std::shared_ptr<MemPageTable>, MEM_TABLE_SIZE> directory;
+
+    /**
+     * For each page table, which of its pages have writes reported to the write watcher
+     */
+    std::array<std::unique_ptr<std::bitset<MEM_TABLE_SIZE>>, MEM_TABLE_SIZE> watchedPages;
 
     /**
      * Whether to use a little endian memory layout
      */
     bool useLittleEndian;
 
+    /**
+     * Whether the program has stored to the MMIO output data word since the flag was last cleared
+     */
+    bool outputDirty = false;
+
+    /**
+     * Called with the address of any write that lands in a watched page
+     */
+    std::function<void(uint32_t)> writeWatcher;
+
+    /**
+     * Gets the page containing the given address
+     * @param index The address to look up
+     * @return The page containing the address or nullptr if it has not been allocated
+     */
+    const MemPage* findPage(uint32_t index) const;
+
+    /**
+     * Gets a page table for writing, allocating it if it does not yet exist and copying it if it is
+     * shared with a snapshot
+     * @param tableNum The index of the page table within the page directory
+     * @return The page table
+     */
+    MemPageTable& ownTable(uint32_t tableNum);
+
+    /**
+     * Gets the page containing the given address for writing, allocating it if it does not yet
+     * exist and copying it if it is shared with a snapshot.  Notifies the write watcher if the page
+     * is watched
+     * @param index The address that will be written to
+     * @return The page containing the address
+     */
+    MemPage& touchPage(uint32_t index);
+
     /**
      * Gets the byte at the given address or zero if not allocated (without triggering side
      * effects). Only to be used for privileged reads
@@ -83,6 +188,21 @@ class Memory {
      */
     std::byte _sysByteAt(uint32_t index) const;
 
+    /**
+     * Sets the byte at the given address and marks it as initialized (without triggering side
+     * effects). Only to be used for privileged writes
+     * @param index The address to write to
+     * @param value The byte to write
+     */
+    void _sysByteTo(uint32_t index, std::byte value);
+
+    /**
+     * Checks if writes to the page containing the given address are reported to the write watcher
+     * @param index An address within the page
+     * @return True if the page is watched, false otherwise
+     */
+    bool isWatched(uint32_t index) const;
+
     /**
      * Processes any side effects from reading from an address, such as updating the MMIO ready bit
      * @param index The address to read from
@@ -110,6 +230,16 @@ public:
      */
     int32_t _sysWordAt(uint32_t index) const;
 
+    /**
+     * Gets the word stored at the given word-aligned memory address in a byte order fixed at compile time (without
+     * triggering side effects).  Only to be used for privileged reads
+     * @tparam Order The byte order of the memory
+     * @param index The word-aligned address to read from
+     * @return The word stored at the given address
+     */
+    template <std::endian Order>
+    int32_t _sysWordAt(uint32_t index) const;
+
     /**
      * Sets the word at the given word-aligned memory address (without triggering side effects).
      * Only to be used for privileged writes
@@ -118,6 +248,16 @@ public:
      */
     void _sysWordTo(uint32_t index, int32_t value);
 
+    /**
+     * Sets the word at the given word-aligned memory address in a byte order fixed at compile time (without
+     * triggering side effects).  Only to be used for privileged writes
+     * @tparam Order The byte order of the memory
+     * @param index The word-aligned address to write to
+     * @param value The word to write
+     */
+    template <std::endian Order>
+    void _sysWordTo(uint32_t index, int32_t value);
+
     /**
      * Gets the word stored at the given word-aligned memory address
      * @param index The word-aligned address to read from
@@ -125,6 +265,15 @@ public:
      */
     int32_t wordAt(uint32_t index);
 
+    /**
+     * Gets the word stored at the given word-aligned memory address in a byte order fixed at compile time
+     * @tparam Order The byte order of the memory
+     * @param index The word-aligned address to read from
+     * @return The word stored at the given address
+     */
+    template <std::endian Order>
+    int32_t wordAt(uint32_t index);
+
     /**
      * Gets the halfword stored at the given halfword-aligned memory address
      * @param index The halfword-aligned address to read from
@@ -132,6 +281,15 @@ public:
      */
     uint16_t halfAt(uint32_t index);
 
+    /**
+     * Gets the halfword stored at the given halfword-aligned memory address in a byte order fixed at compile time
+     * @tparam Order The byte order of the memory
+     * @param index The halfword-aligned address to read from
+     * @return The halfword stored at the given address
+     */
+    template <std::endian Order>
+    uint16_t halfAt(uint32_t index);
+
     /**
      * Gets the byte stored at the given byte-aligned memory address
      * @param index The byte-aligned address to read from
@@ -146,6 +304,15 @@ public:
      */
     void wordTo(uint32_t index, int32_t value);
 
+    /**
+     * Sets the word at the given word-aligned memory address in a byte order fixed at compile time
+     * @tparam Order The byte order of the memory
+     * @param index The word-aligned address to write to
+     * @param value The word to write
+     */
+    template <std::endian Order>
+    void wordTo(uint32_t index, int32_t value);
+
     /**
      * Sets the halfword at the given halfword-aligned memory address
      * @param index The halfword-aligned address to write to
@@ -153,6 +320,15 @@ public:
      */
     void halfTo(uint32_t index, int16_t value);
 
+    /**
+     * Sets the halfword at the given halfword-aligned memory address in a byte order fixed at compile time
+     * @tparam Order The byte order of the memory
+     * @param index The halfword-aligned address to write to
+     * @param value The halfword to write
+     */
+    template <std::endian Order>
+    void halfTo(uint32_t index, int16_t value);
+
     /**
      * Sets the byte at the given byte-aligned memory address
      * @param index The byte-aligned address to write to
@@ -160,6 +336,21 @@ public:
      */
     void byteTo(uint32_t index, int8_t value);
 
+    /**
+     * Copies consecutive bytes out of memory, a page at a time
+     * @param index The address of the first byte to read
+     * @param bytes Filled with the bytes read, zero where memory has not been allocated
+     */
+    void bytesAt(uint32_t index, std::span<std::byte> bytes);
+
+    /**
+     * Copies consecutive bytes into memory, a page at a time.  Bytes bound for MMIO or for pages with watched writes
+     * are stored one by one, so that their side effects still take place
+     * @param index The address of the first byte to write
+     * @param bytes The bytes to write
+     */
+    void bytesTo(uint32_t index, std::span<const std::byte> bytes);
+
     /**
      * Checks if the given index is initialized and valid
      * @param index The index to check
@@ -173,6 +364,67 @@ public:
      */
     bool isLittleEndian() const;
 
+    /**
+     * Checks whether the program has stored to the MMIO output data word since the flag was last cleared
+     * @return True if there is output waiting to be written
+     */
+    [[nodiscard]] bool isOutputDirty() const;
+
+    /**
+     * Clears the MMIO output dirty flag once the pending output has been written
+     */
+    void clearOutputDirty();
+
+    /**
+     * Checks that an access of the given width is aligned to that width
+     * @param index The address of the access
+     * @param width The width of the access in bytes, either 2 or 4
+     * @param isStore Whether the access is a store rather than a load
+     * @return The trap for a misaligned access, or nullopt if the access is aligned
+     */
+    [[nodiscard]] static std::optional<ExecTrap> alignmentTrap(uint32_t index, uint32_t width, bool isStore);
+
+    /**
+     * Marks the page containing the given address as watched, so that any later writes to it are
+     * reported to the write watcher
+     * @param index An address within the page to watch
+     */
+    void watchPage(uint32_t index);
+
+    /**
+     * Sets the function to call with the address of each write into a watched page
+     * @param watcher The function to notify of watched writes
+     */
+    void setWriteWatcher(std::function<void(uint32_t)> watcher);
+
+    /**
+     * Gets the number of pages that have been allocated
+     * @return The number of allocated pages
+     */
+    size_t pageCount() const;
+
+    /**
+     * Takes a copy-on-write snapshot of the contents of memory.  This takes time in proportion to the
+     * number of page tables, as no pages are copied
+     * @return The snapshot of memory
+     */
+    [[nodiscard]] MemorySnapshot snapshot() const;
+
+    /**
+     * Maps the contents of a snapshot over memory, keeping anything that the snapshot does not
+     * initialize.  Pages that memory does not hold yet are shared with the snapshot rather than copied
+     * @param snapshot The snapshot to map
+     */
+    void overlay(const MemorySnapshot& snapshot);
+
+    /**
+     * Restores the contents of memory to a snapshot.  Pages are shared with the snapshot rather than
+     * copied, so the cost of a restore is paid by the pages that are written to afterward.  Watched
+     * pages and the write watcher are kept
+     * @param snapshot The snapshot to restore
+     */
+    void restore(const MemorySnapshot& snapshot);
+
     std::byte operator[](uint32_t index) const;
     std::byte& operator[](uint32_t index);
 };
@@ -7,7 +7,9 @@
 
 #include <cstdint>
 #include <format>
+#include <optional>
 #include <stdexcept>
+#include <string>
 
 
 /**
@@ -133,4 +135,36 @@ public:
     [[nodiscard]] EXCEPT_CODE cause() const { return causeCode; }
 };
 
+
+/**
+ * A recoverable execution error that is returned to the run loop instead of being thrown.  The message is only
+ * formatted if the trap is delivered to the program or reported to the user
+ */
+struct ExecTrap {
+    /**
+     * The cause of the trap
+     */
+    EXCEPT_CODE cause;
+
+    /**
+     * The static description of the trap
+     */
+    const char* message;
+
+    /**
+     * The address involved in the trap, appended to the message if present
+     */
+    std::optional<uint32_t> address = std::nullopt;
+
+    /**
+     * Formats the full message of the trap
+     * @return The formatted message
+     */
+    [[nodiscard]] std::string what() const {
+        if (address)
+            return std::format("{} 0x{:x}", message, *address);
+        return message;
+    }
+};
+
 #endif // EXCEPTIONS_H
@@ -39,7 +39,7 @@ public:
      */
     void enableRawConsoleMode();
     /**
-     * Disable raw mode for terminal input to restore default behavior
+     * Disable raw mode for terminal input to restore default behavior, after writing out any buffered output
      */
     void disableRawConsoleMode();
 
@@ -56,10 +56,17 @@ public:
     [[nodiscard]] char getChar() override;
 
     /**
-     * Outputs a character to the console
-     * @param c The character to output
+     * Waits until a character is typed at the console, then reads it.  The wait sleeps in the operating system
+     * rather than polling, so an idle simulator uses no CPU
+     * @return The character read from the console
+     */
+    [[nodiscard]] char getCharBlocking() override;
+
+    /**
+     * Outputs characters to the console, which are buffered until the console is read from or flushed
+     * @param data The characters to output
      */
-    void putChar(char c) override;
+    void write(std::span<const char> data) override;
 };
 
 #endif // CONSOLEIO_H
@@ -0,0 +1,86 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef PIPEIO_H
+#define PIPEIO_H
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <masm/io/streamio.hpp>
+
+
+/**
+ * A stream handle whose input is fed in memory by other threads while the program runs.  A blocking read sleeps on a
+ * condition variable until input arrives or the pipe is closed, so a simulator waiting for input uses no CPU
+ */
+class PipeStreamHandle final : public StreamHandle {
+
+    /**
+     * Guards the input and the closed flag
+     */
+    std::mutex mutex;
+
+    /**
+     * Signalled whenever input arrives or the pipe is closed
+     */
+    std::condition_variable inputReady;
+
+    /**
+     * The input that has been fed but not yet read
+     */
+    std::string input;
+
+    /**
+     * The position of the next character to read from the input
+     */
+    size_t cursor = 0;
+
+    /**
+     * Whether the pipe has been closed, after which no more input can arrive
+     */
+    bool closed = false;
+
+public:
+    /**
+     * Constructor for the PipeStreamHandle class
+     * @param ostream The output stream for writing characters
+     */
+    explicit PipeStreamHandle(std::ostream& ostream);
+
+    /**
+     * Appends input for the program to read, waking a blocked read.  Safe to call from any thread
+     * @param data The characters to append
+     */
+    void feed(std::string_view data);
+
+    /**
+     * Marks the end of the input, so that reads past the fed input fail instead of waiting.  Safe to call from any
+     * thread
+     */
+    void close();
+
+    /**
+     * Checks if there are fed characters left to read
+     * @return True if there are characters available, false otherwise
+     */
+    bool hasChar() override;
+
+    /**
+     * Gets a fed character without waiting for more input
+     * @return The character read from the pipe
+     */
+    char getChar() override;
+
+    /**
+     * Waits until a character is fed or the pipe is closed, then reads it
+     * @return The character read from the pipe
+     */
+    char getCharBlocking() override;
+};
+
+#endif // PIPEIO_H
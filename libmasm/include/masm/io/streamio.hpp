@@ -6,9 +6,21 @@
 #define STREAMIO_H
 
 #include <iostream>
+#include <span>
+#include <string>
 
 
 class StreamHandle {
+    /**
+     * The number of buffered output characters at which the buffer is written out
+     */
+    static constexpr size_t OUTPUT_BUFFER_SIZE = 8192;
+
+    /**
+     * The characters written since the output was last flushed
+     */
+    std::string outputBuffer;
+
 protected:
     /**
      * The input stream for reading characters
@@ -37,10 +49,11 @@ public:
     virtual char getChar();
 
     /**
-     * Reads (blocking) a character from the input stream
+     * Reads (blocking) a character from the input stream, waiting for input without polling
      * @return The character read from the input stream
+     * @throws std::runtime_error If the input stream ends before a character arrives
      */
-    char getCharBlocking();
+    virtual char getCharBlocking();
 
     /**
      * Reads a sequence of characters from the input stream until a newline character is encountered.
@@ -52,13 +65,25 @@ public:
     std::string getLine();
 
     /**
-     * Sends a character to the output stream
+     * Writes characters to the output.  Output is buffered, and only reaches the output stream when the buffer fills
+     * up or is flushed.  Reading input flushes the buffer first, so prompts always appear before they are answered
+     * @param data The characters to write
+     */
+    virtual void write(std::span<const char> data);
+
+    /**
+     * Writes any buffered output to the output stream and flushes it
+     */
+    virtual void flush();
+
+    /**
+     * Sends a character to the output
      */
-    virtual void putChar(char c);
+    void putChar(char c);
 
     /**
-     * Writes a null-terminated string to the output stream
-     * @param str The string to write to the output stream
+     * Writes a null-terminated string to the output
+     * @param str The string to write to the output
      */
     void putStr(const std::string& str);
 };
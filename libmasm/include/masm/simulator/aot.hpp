@@ -0,0 +1,59 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef AOT_H
+#define AOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include <masm/assembler/memory.hpp>
+#include <masm/simulator/jit.hpp>
+
+
+/**
+ * A block of guest code that was translated ahead of time into a native function
+ */
+struct NativeBlock {
+    /**
+     * The address of the first guest instruction of the block
+     */
+    uint32_t address;
+
+    /**
+     * The most guest instructions that the block can execute in a single call
+     */
+    uint32_t instructionCount;
+
+    /**
+     * The native function for the block, which follows the same contract as a JIT-compiled block
+     */
+    CompiledBlock code;
+};
+
+
+/**
+ * Translates the text section of a program into a self-contained C++ translation unit.  The unit holds one native
+ * function per basic block, an address table that the runtime dispatches jumps through and the serialized program
+ * image, and defines a main function that runs the program through runNativeProgram
+ * @param layout The memory layout of the program to translate
+ * @param useLittleEndian Whether the program was assembled with little-endian byte order
+ * @return The source code of the translation unit
+ */
+std::string translateLayout(const MemLayout& layout, bool useLittleEndian);
+
+
+/**
+ * Runs a translated program with console I/O, executing its native blocks wherever the program counter lands on one
+ * and interpreting everything else
+ * @param image The serialized program image
+ * @param blocks The address table of native blocks, sorted by address
+ * @param useLittleEndian Whether the program was assembled with little-endian byte order
+ * @return The exit code of the program
+ */
+int runNativeProgram(std::span<const std::byte> image, std::span<const NativeBlock> blocks, bool useLittleEndian);
+
+#endif // AOT_H
@@ -0,0 +1,165 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <masm/assembler/memory.hpp>
+#include <masm/simulator/jit.hpp>
+#include <masm/simulator/program_image.hpp>
+#include <masm/simulator/state.hpp>
+
+
+/**
+ * A single run of the batch program against one input
+ */
+struct BatchJob {
+    /**
+     * The name of the job, used in the report
+     */
+    std::string name;
+
+    /**
+     * The text given to the program as input
+     */
+    std::string input;
+
+    /**
+     * The output that the program must produce to pass, or nullopt to pass on a zero exit code
+     */
+    std::optional<std::string> expectedOutput;
+};
+
+
+/**
+ * The outcome of a single batch job
+ */
+struct BatchResult {
+    /**
+     * The name of the job
+     */
+    std::string name;
+
+    /**
+     * Whether the job produced its expected output, or exited with code zero if it had none
+     */
+    bool passed = false;
+
+    /**
+     * The exit code of the program
+     */
+    int exitCode = 0;
+
+    /**
+     * Everything that the program wrote to its output
+     */
+    std::string output;
+
+    /**
+     * The message of the error that stopped the program, if it did not exit normally
+     */
+    std::string error;
+
+    /**
+     * The number of instructions that the program executed
+     */
+    uint64_t instructions = 0;
+
+    /**
+     * The wall-clock time taken by the job
+     */
+    std::chrono::nanoseconds elapsed{0};
+};
+
+
+/**
+ * The settings shared by every job of a batch
+ */
+struct BatchOptions {
+    /**
+     * The I/O mode to simulate the program with
+     */
+    IOMode ioMode = IOMode::SYSCALL;
+
+    /**
+     * Whether the program was assembled with little-endian byte order
+     */
+    bool useLittleEndian = false;
+
+    /**
+     * The engine to execute the program with
+     */
+    ExecEngine engine = ExecEngine::INTERPRETER;
+
+    /**
+     * The instruction budget of each job, or zero for no limit
+     */
+    uint64_t maxInstructions = 0;
+
+    /**
+     * The time limit of each job, or zero for no limit
+     */
+    std::chrono::milliseconds timeout{0};
+
+    /**
+     * The number of worker threads, or zero to use one per hardware thread
+     */
+    unsigned threads = 0;
+};
+
+
+/**
+ * Runs one program against many inputs in parallel.  The program is loaded once into a shared image and every job is
+ * simulated by its own Simulator with in-memory streams, scheduled over a work-stealing thread pool
+ */
+class BatchRunner {
+
+    /**
+     * The program run by every job, built once and shared by all of their simulators
+     */
+    ProgramImage image;
+
+    /**
+     * The settings shared by every job
+     */
+    BatchOptions options;
+
+    /**
+     * Runs a single job to completion
+     * @param job The job to run
+     * @return The outcome of the job
+     */
+    [[nodiscard]] BatchResult runJob(const BatchJob& job) const;
+
+public:
+    /**
+     * Constructor for the BatchRunner class
+     * @param layout The program to run
+     * @param options The settings shared by every job
+     */
+    BatchRunner(const MemLayout& layout, const BatchOptions& options) : image(layout), options(options) {}
+
+    /**
+     * Runs every job and waits for all of them to finish
+     * @param jobs The jobs to run
+     * @return The outcome of each job, in the same order as the jobs
+     */
+    [[nodiscard]] std::vector<BatchResult> run(const std::vector<BatchJob>& jobs) const;
+};
+
+
+/**
+ * Formats the outcomes of a batch as a human-readable summary, with one line per job followed by the totals
+ * @param results The outcomes of the batch jobs
+ * @return The summary report
+ */
+std::string formatBatchReport(const std::vector<BatchResult>& results);
+
+#endif // BATCH_H
@@ -0,0 +1,137 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <masm/assembler/memory.hpp>
+#include <masm/simulator/decoder.hpp>
+
+
+/**
+ * The maximum number of guest instructions translated into a single block
+ */
+constexpr uint32_t MAX_BLOCK_INSTRUCTIONS = 64;
+
+
+/**
+ * The kinds of operation that a translated block is made of
+ */
+enum class BlockOpKind : uint8_t {
+    /**
+     * A single instruction, dispatched normally
+     */
+    SINGLE,
+    /**
+     * A lui followed by an ori of the same register, as emitted for la and load/store pseudo-instructions
+     */
+    LOAD_CONST,
+    /**
+     * An slt into a register followed by a beq or bne of that register against $zero, as emitted for branch
+     * pseudo-instructions
+     */
+    SLT_BRANCH
+};
+
+
+/**
+ * A single operation within a translated block, covering one or two guest instructions
+ */
+struct BlockOp {
+    /**
+     * How the operation is executed
+     */
+    BlockOpKind kind = BlockOpKind::SINGLE;
+
+    /**
+     * The address of the first guest instruction of the operation
+     */
+    uint32_t address = 0;
+
+    /**
+     * The first guest instruction of the operation
+     */
+    DecodedInstruction first;
+
+    /**
+     * The second guest instruction of a fused operation
+     */
+    DecodedInstruction second;
+};
+
+
+/**
+ * A run of guest instructions that ends at the first branch, jump or instruction needing the full step path
+ */
+struct TranslatedBlock {
+    /**
+     * The operations of the block, in program order
+     */
+    std::vector<BlockOp> ops;
+
+    /**
+     * The number of guest instructions covered by the block
+     */
+    uint32_t instructionCount = 0;
+};
+
+
+/**
+ * A cache of translated blocks keyed by their starting address
+ */
+class BlockCache {
+
+    /**
+     * The translated blocks, keyed by starting address.  Blocks with no operations mark addresses that must use the
+     * full step path
+     */
+    std::unordered_map<uint32_t, TranslatedBlock> blocks;
+
+    /**
+     * Whether a write to translated code has made the cached blocks out of date
+     */
+    bool stale = false;
+
+    /**
+     * Translates the block starting at the given address
+     * @param memory The memory to read instructions from
+     * @param decodeCache The decoded instructions to translate from
+     * @param address The address of the first instruction of the block
+     * @return The translated block, which is empty if the first instruction cannot be part of a block
+     */
+    static TranslatedBlock translate(Memory& memory, DecodeCache& decodeCache, uint32_t address);
+
+public:
+    /**
+     * Gets the translated block starting at the given address, translating it if it is not yet cached
+     * @param memory The memory to read instructions from
+     * @param decodeCache The decoded instructions to translate from
+     * @param address The address of the first instruction of the block
+     * @return The translated block, or nullptr if the instruction at the address must use the full step path
+     */
+    const TranslatedBlock* lookup(Memory& memory, DecodeCache& decodeCache, uint32_t address);
+
+    /**
+     * Marks all cached blocks as out of date.  They are discarded on the next lookup, so that a block that is
+     * currently executing stays alive
+     */
+    void invalidate();
+
+    /**
+     * Checks whether the cached blocks have been invalidated since the last lookup
+     * @return True if the cached blocks are out of date
+     */
+    [[nodiscard]] bool isStale() const;
+
+    /**
+     * Discards all cached blocks
+     */
+    void clear();
+};
+
+#endif // BLOCK_CACHE_H
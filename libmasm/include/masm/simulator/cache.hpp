@@ -0,0 +1,379 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <masm/simulator/debug_table.hpp>
+
+
+/**
+ * The policies for choosing which line of a full set to evict
+ */
+enum class ReplacementPolicy {
+    /**
+     * Evicts the least recently used line
+     */
+    LRU,
+    /**
+     * Evicts the line that was filled the earliest
+     */
+    FIFO,
+    /**
+     * Evicts a pseudo-random line, from a fixed seed so that runs are repeatable
+     */
+    RANDOM
+};
+
+
+/**
+ * The policies for handling writes
+ */
+enum class WritePolicy {
+    /**
+     * Writes only mark the line as dirty, and misses allocate a line.  Dirty lines are written to the next level when
+     * evicted
+     */
+    WRITE_BACK,
+    /**
+     * Writes are passed straight to the next level, and misses do not allocate a line
+     */
+    WRITE_THROUGH
+};
+
+
+/**
+ * The shape and policies of a single cache
+ */
+struct CacheConfig {
+    /**
+     * The capacity of the cache in bytes
+     */
+    uint32_t size = 16 * 1024;
+
+    /**
+     * The number of lines in each set
+     */
+    uint32_t associativity = 4;
+
+    /**
+     * The number of bytes in each line
+     */
+    uint32_t lineSize = 32;
+
+    /**
+     * The policy for choosing which line of a full set to evict
+     */
+    ReplacementPolicy replacement = ReplacementPolicy::LRU;
+
+    /**
+     * The policy for handling writes
+     */
+    WritePolicy write = WritePolicy::WRITE_BACK;
+};
+
+
+/**
+ * Parses a cache configuration of the form SIZE:WAYS:LINE[:lru|fifo|random[:wb|wt]], where the size may end in k or m
+ * @param spec The configuration to parse
+ * @return The parsed configuration
+ * @throw invalid_argument When the configuration is malformed or describes an impossible cache
+ */
+CacheConfig parseCacheConfig(const std::string& spec);
+
+
+/**
+ * The number of accesses to a single cache and their outcomes
+ */
+struct CacheStats {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t readMisses = 0;
+    uint64_t writeMisses = 0;
+
+    /**
+     * The number of valid lines that were replaced to make room for another
+     */
+    uint64_t evictions = 0;
+
+    /**
+     * The number of dirty lines that were written to the next level when evicted
+     */
+    uint64_t writebacks = 0;
+
+    [[nodiscard]] uint64_t accesses() const { return reads + writes; }
+    [[nodiscard]] uint64_t misses() const { return readMisses + writeMisses; }
+    [[nodiscard]] uint64_t hits() const { return accesses() - misses(); }
+};
+
+
+/**
+ * A set-associative cache, which passes its misses and writebacks on to the next level if there is one
+ */
+class Cache {
+
+    /**
+     * A single line of the cache
+     */
+    struct Way {
+        uint32_t tag = 0;
+        bool valid = false;
+        bool dirty = false;
+
+        /**
+         * When the line was last used under LRU, or filled under FIFO
+         */
+        uint64_t stamp = 0;
+    };
+
+    /**
+     * The shape and policies of the cache
+     */
+    CacheConfig config;
+
+    /**
+     * The number of sets in the cache
+     */
+    uint32_t setCount;
+
+    /**
+     * The lines of every set, stored one set after another
+     */
+    std::vector<Way> ways;
+
+    /**
+     * The level that misses and writebacks are passed on to, or nullptr for main memory
+     */
+    Cache* next;
+
+    /**
+     * The number of accesses so far, used to order the lines of a set
+     */
+    uint64_t clock = 0;
+
+    /**
+     * Whether the most recent access hit
+     */
+    bool lastHit = false;
+
+    /**
+     * The generator for random replacement
+     */
+    std::minstd_rand rng;
+
+    /**
+     * The number of accesses to the cache and their outcomes
+     */
+    CacheStats cacheStats;
+
+    /**
+     * Chooses the line of a set to fill, preferring an invalid line
+     * @param set The first line of the set
+     * @return The line to fill
+     */
+    Way& victim(Way* set);
+
+public:
+    /**
+     * Constructor for the Cache class
+     * @param config The shape and policies of the cache
+     * @param next The level that misses and writebacks are passed on to, or nullptr for main memory
+     * @throw invalid_argument When the configuration describes an impossible cache
+     */
+    explicit Cache(const CacheConfig& config, Cache* next = nullptr);
+
+    /**
+     * Reads or writes a byte through the cache
+     * @param address The address of the byte
+     * @param write Whether the access is a write
+     * @return True if the access hit in this cache
+     */
+    bool access(uint32_t address, bool write);
+
+    /**
+     * Empties the cache and resets its statistics
+     */
+    void reset();
+
+    /**
+     * Gets the shape and policies of the cache
+     * @return The configuration of the cache
+     */
+    [[nodiscard]] const CacheConfig& configuration() const;
+
+    /**
+     * Gets the number of accesses to the cache and their outcomes
+     * @return The statistics of the cache
+     */
+    [[nodiscard]] const CacheStats& stats() const;
+
+    /**
+     * Checks whether the most recent access hit in this cache
+     * @return True if the most recent access hit
+     */
+    [[nodiscard]] bool lastAccessHit() const;
+};
+
+
+/**
+ * The caches of a simulated machine, with separate first-level instruction and data caches
+ */
+struct CacheHierarchyConfig {
+    CacheConfig l1i;
+    CacheConfig l1d;
+
+    /**
+     * The shared second-level cache, or nullopt for none
+     */
+    std::optional<CacheConfig> l2 = CacheConfig{256 * 1024, 8, 64};
+};
+
+
+/**
+ * The cache accesses made by the instructions of a single source line
+ */
+struct CacheLineReport {
+    std::string filename;
+    size_t lineno = 0;
+    std::string text;
+
+    /**
+     * The number of fetches of the instructions of the line, and how many missed in the instruction cache
+     */
+    uint64_t fetches = 0;
+    uint64_t fetchMisses = 0;
+
+    /**
+     * The number of loads and stores made by the line, and how many missed in the data cache
+     */
+    uint64_t dataAccesses = 0;
+    uint64_t dataMisses = 0;
+
+    /**
+     * The number of accesses made by the line that also missed in the second-level cache
+     */
+    uint64_t l2Misses = 0;
+
+    /**
+     * The number of first-level lines evicted to make room for the accesses of the line
+     */
+    uint64_t evictions = 0;
+
+    [[nodiscard]] uint64_t misses() const { return fetchMisses + dataMisses; }
+};
+
+
+/**
+ * The statistics of a single cache level
+ */
+struct CacheLevelReport {
+    std::string name;
+    CacheConfig config;
+    CacheStats stats;
+};
+
+
+/**
+ * The cache statistics of a program, per level and per source line
+ */
+struct CacheReport {
+    std::vector<CacheLevelReport> levels;
+
+    /**
+     * The source lines that accessed the caches, from the most to the fewest first-level misses
+     */
+    std::vector<CacheLineReport> lines;
+};
+
+
+/**
+ * A model of the caches of a machine, fed with every instruction fetch, load and store of a program
+ */
+class CacheHierarchy {
+
+    /**
+     * The cache accesses made by a single instruction
+     */
+    struct AccessCounts {
+        uint64_t fetches = 0;
+        uint64_t fetchMisses = 0;
+        uint64_t dataAccesses = 0;
+        uint64_t dataMisses = 0;
+        uint64_t l2Misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    std::unique_ptr<Cache> l2;
+    std::unique_ptr<Cache> l1i;
+    std::unique_ptr<Cache> l1d;
+
+    /**
+     * The cache accesses of each instruction, keyed by its address
+     */
+    std::unordered_map<uint32_t, AccessCounts> instructionCounts;
+
+    /**
+     * Passes an access through a first-level cache, counting its outcome against the instruction that made it
+     * @param l1 The first-level cache to access
+     * @param pc The address of the instruction making the access
+     * @param address The address being accessed
+     * @param write Whether the access is a write
+     * @return True if the access hit in the first-level cache
+     */
+    bool access(Cache& l1, uint32_t pc, uint32_t address, bool write);
+
+public:
+    /**
+     * Constructor for the CacheHierarchy class
+     * @param config The caches of the machine
+     * @throw invalid_argument When a configuration describes an impossible cache
+     */
+    explicit CacheHierarchy(const CacheHierarchyConfig& config);
+
+    /**
+     * Fetches an instruction through the instruction cache
+     * @param pc The address of the instruction
+     */
+    void fetch(uint32_t pc);
+
+    /**
+     * Loads or stores a value through the data cache, accessing every line that the value spans
+     * @param pc The address of the instruction making the access
+     * @param address The address of the value
+     * @param size The number of bytes in the value
+     * @param write Whether the access is a store
+     */
+    void data(uint32_t pc, uint32_t address, uint32_t size, bool write);
+
+    /**
+     * Empties every cache and resets all statistics
+     */
+    void reset();
+
+    /**
+     * Maps the statistics of the caches onto the source lines of a program
+     * @param debugTable The debug info of the program
+     * @return The report of the caches
+     */
+    [[nodiscard]] CacheReport report(const DebugTable& debugTable) const;
+};
+
+
+/**
+ * Formats a report as a table of the statistics of each level, followed by the lines with the most misses
+ * @param report The report to format
+ * @param maxLines The most source lines to list, or zero to list them all
+ * @return The formatted table
+ */
+std::string formatCacheReport(const CacheReport& report, size_t maxLines = 0);
+
+#endif // CACHE_H
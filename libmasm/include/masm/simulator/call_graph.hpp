@@ -0,0 +1,210 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef CALL_GRAPH_H
+#define CALL_GRAPH_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <masm/simulator/debug_table.hpp>
+
+
+/**
+ * A shadow call stack of the procedures of a program, which accumulates the instructions executed under each distinct
+ * chain of calls.  It is only updated on calls and returns, so its cost grows with the number of calls rather than
+ * the number of instructions
+ */
+class CallGraphProfile {
+public:
+    /**
+     * A procedure reached through one particular chain of calls
+     */
+    struct Node {
+        /**
+         * The address of the first instruction of the procedure
+         */
+        uint32_t address = 0;
+
+        /**
+         * The index of the node that called this one, or NO_PARENT for the root
+         */
+        uint32_t parent = 0;
+
+        /**
+         * The number of times the procedure was called through this chain
+         */
+        uint64_t calls = 0;
+
+        /**
+         * The number of instructions executed by finished calls, including those of the procedures that they called
+         */
+        uint64_t inclusive = 0;
+    };
+
+    /**
+     * The parent index of the root node
+     */
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+private:
+    /**
+     * A call that has yet to return
+     */
+    struct Frame {
+        /**
+         * The index of the node of the call
+         */
+        uint32_t node = 0;
+
+        /**
+         * The address that the call returns to
+         */
+        uint32_t returnAddress = 0;
+
+        /**
+         * The number of instructions that had been executed when the call was made
+         */
+        uint64_t start = 0;
+    };
+
+    /**
+     * Every chain of calls that has been made, where the first node is the entry point of the program
+     */
+    std::vector<Node> nodes;
+
+    /**
+     * The calls that have yet to return, starting with the entry point
+     */
+    std::vector<Frame> stack;
+
+    /**
+     * The index of each node, keyed by the index of its parent in the upper bits and its address in the lower bits
+     */
+    std::unordered_map<uint64_t, uint32_t> children;
+
+public:
+    /**
+     * Constructor for the CallGraphProfile class
+     * @param entry The address that the program starts at
+     */
+    explicit CallGraphProfile(uint32_t entry);
+
+    /**
+     * Drops every recorded call and starts again from the entry point
+     * @param entry The address that the program starts at
+     */
+    void reset(uint32_t entry);
+
+    /**
+     * Records a call to a procedure
+     * @param target The address of the procedure
+     * @param returnAddress The address that the procedure will return to
+     * @param instruction The number of instructions executed so far, including the call
+     */
+    void call(uint32_t target, uint32_t returnAddress, uint64_t instruction);
+
+    /**
+     * Records a return from a procedure.  Returns to the caller of an outer call also finish every call made since,
+     * while returns that match no call, such as computed jumps through $ra, are ignored
+     * @param target The address being returned to
+     * @param instruction The number of instructions executed so far, including the return
+     */
+    void ret(uint32_t target, uint64_t instruction);
+
+    /**
+     * Gets the number of calls that have yet to return, not counting the entry point
+     * @return The depth of the call stack
+     */
+    [[nodiscard]] size_t depth() const;
+
+    /**
+     * Gets every chain of calls, with the calls that have yet to return counted up to the given instruction
+     * @param instruction The number of instructions executed so far
+     * @return The nodes of the call graph, where parents always come before their children
+     */
+    [[nodiscard]] std::vector<Node> snapshotNodes(uint64_t instruction) const;
+};
+
+
+/**
+ * The instructions executed by a single procedure, over every chain of calls that reached it
+ */
+struct ProcedureProfile {
+    /**
+     * The name of the procedure, taken from its label
+     */
+    std::string name;
+
+    /**
+     * The number of times that the procedure was called
+     */
+    uint64_t calls = 0;
+
+    /**
+     * The number of instructions executed within the procedure, including those of the procedures it called.  The
+     * instructions of recursive calls are only counted once
+     */
+    uint64_t inclusive = 0;
+
+    /**
+     * The number of instructions executed within the procedure itself
+     */
+    uint64_t exclusive = 0;
+};
+
+
+/**
+ * The call graph of a program mapped onto the names of its procedures
+ */
+struct CallGraphReport {
+    /**
+     * The total number of instructions executed
+     */
+    uint64_t total = 0;
+
+    /**
+     * Every procedure that was executed, from the most to the least inclusive instructions
+     */
+    std::vector<ProcedureProfile> procedures;
+
+    /**
+     * The instructions executed by the last procedure of each chain of calls, keyed by the names of the procedures of
+     * the chain joined with semicolons
+     */
+    std::vector<std::pair<std::string, uint64_t>> stacks;
+};
+
+
+/**
+ * Maps a call graph onto the labels of a program
+ * @param profile The call graph of the program
+ * @param debugTable The debug info of the program
+ * @param instructions The number of instructions executed by the program
+ * @return The report of the program
+ */
+CallGraphReport buildCallGraphReport(const CallGraphProfile& profile, const DebugTable& debugTable,
+                                     uint64_t instructions);
+
+
+/**
+ * Formats a report in the folded stack format, with one chain of calls and its instruction count per line, which can
+ * be drawn as a flame graph by tools such as flamegraph.pl and speedscope
+ * @param report The report to format
+ * @return The folded stacks
+ */
+std::string formatFoldedStacks(const CallGraphReport& report);
+
+
+/**
+ * Formats a report as a table of the inclusive and exclusive instructions of each procedure
+ * @param report The report to format
+ * @return The formatted table
+ */
+std::string formatCallGraphReport(const CallGraphReport& report);
+
+#endif // CALL_GRAPH_H
@@ -0,0 +1,69 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+#include <masm/assembler/memory.hpp>
+#include <masm/simulator/simulator.hpp>
+
+
+/**
+ * A saved simulation that can be resumed later, possibly by another process
+ */
+struct Checkpoint {
+    /**
+     * The state of the simulation
+     */
+    SimulatorSnapshot snapshot;
+
+    /**
+     * The number of instructions that had been executed when the snapshot was taken
+     */
+    uint64_t instructions = 0;
+
+    /**
+     * Whether the program was assembled with little-endian byte order
+     */
+    bool useLittleEndian = false;
+
+    /**
+     * The fingerprint of the program that was being simulated, used to refuse resuming with a different program
+     */
+    uint64_t programFingerprint = 0;
+};
+
+
+/**
+ * Computes a fingerprint of a program, which changes whenever any of its sections do
+ * @param layout The memory layout of the program
+ * @return The fingerprint of the program
+ */
+uint64_t programFingerprint(const MemLayout& layout);
+
+
+/**
+ * Writes a checkpoint in a compact binary format.  Memory is written one page at a time straight from the
+ * copy-on-write snapshot, so a checkpoint may be written on another thread while the simulation that it was taken from
+ * keeps running
+ * @param stream The binary stream to write to
+ * @param checkpoint The checkpoint to write
+ * @throw runtime_error When the stream cannot be written to
+ */
+void saveCheckpoint(std::ostream& stream, const Checkpoint& checkpoint);
+
+
+/**
+ * Reads a checkpoint that was written by saveCheckpoint
+ * @param stream The binary stream to read from
+ * @return The checkpoint
+ * @throw runtime_error When the stream does not hold a valid checkpoint
+ */
+Checkpoint loadCheckpoint(std::istream& stream);
+
+#endif // CHECKPOINT_H
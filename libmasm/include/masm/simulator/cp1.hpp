@@ -6,6 +6,7 @@
 #define CP1_H
 #include <array>
 #include <cstdint>
+#include <optional>
 
 #include <masm/simulator/cpu.hpp>
 
@@ -191,9 +192,11 @@ void execCP1RegImmType(Coproc1RegisterFile& cp1, RegisterFile& registers, uint32
  * @param base The base register of the instruction
  * @param ft The first source register
  * @param offset The offset from the base register
+ * @return The trap raised by the instruction, if any
  */
-void execCP1ImmType(Coproc1RegisterFile& cp1, RegisterFile& registers, Memory& memory, uint32_t op, uint32_t base,
-                    uint32_t ft, uint32_t offset);
+[[nodiscard]] std::optional<ExecTrap> execCP1ImmType(Coproc1RegisterFile& cp1, RegisterFile& registers,
+                                                     Memory& memory, uint32_t op, uint32_t base, uint32_t ft,
+                                                     uint32_t offset);
 
 
 /**
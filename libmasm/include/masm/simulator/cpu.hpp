@@ -5,8 +5,10 @@
 #ifndef CPU_H
 #define CPU_H
 #include <array>
+#include <bit>
 #include <cstdint>
 #include <map>
+#include <optional>
 #include <string>
 
 #include <masm/assembler/memory.hpp>
@@ -86,6 +88,15 @@ enum class Register {
 constexpr size_t NUM_CPU_REGISTERS = static_cast<size_t>(Register::LO) + 1;
 
 
+/**
+ * Gets the register that a jalr instruction links into.  The one operand form is encoded with a zero rd and links into
+ * $ra, while the two operand form names its own link register
+ * @param rd The destination register of the instruction
+ * @return The register number written with the return address
+ */
+constexpr uint32_t jalrLinkRegister(const uint32_t rd) { return rd != 0 ? rd : static_cast<uint32_t>(Register::RA); }
+
+
 /**
  * Class representing the state and labels of registers
  */
@@ -96,9 +107,10 @@ class RegisterFile {
     std::array<int32_t, NUM_CPU_REGISTERS> registers = {};
 
     /**
-     * A mapping between the common names of registers and their register numbers
+     * A mapping between the common names of registers and their register numbers.  It is never modified, so it can be
+     * read from any thread
      */
-    static std::map<std::string, Register> nameToIndex;
+    static const std::map<std::string, Register> nameToIndex;
 
 public:
     /**
@@ -121,6 +133,12 @@ public:
 
     int32_t operator[](Register index) const;
     int32_t& operator[](Register index);
+
+    /**
+     * Gets the raw register values, indexed by register number, for use by generated code
+     * @return A pointer to the first register value
+     */
+    int32_t* data();
 };
 
 
@@ -132,20 +150,27 @@ public:
  * @param rt The second source register
  * @param rd The destination register
  * @param shamt The shift amount
+ * @return The trap raised by the instruction, if any
  */
-void execRType(RegisterFile& registers, uint32_t funct, uint32_t rs, uint32_t rt, uint32_t rd, uint32_t shamt);
+[[nodiscard]] std::optional<ExecTrap> execRType(RegisterFile& registers, uint32_t funct, uint32_t rs, uint32_t rt,
+                                                uint32_t rd, uint32_t shamt);
 
 
 /**
- * Executes the given I-Type instruction
+ * Executes the given I-Type instruction.  The byte order of memory is fixed at compile time, so that loads and stores
+ * do not check it on every access
+ * @tparam Order The byte order of the memory
  * @param registers The CPU registers to operate on
  * @param memory The memory state to operate on
  * @param opCode The opcode of the instruction
  * @param rs The first source register
  * @param rt The second source register
  * @param immediate The immediate value
+ * @return The trap raised by the instruction, if any
  */
-void execIType(RegisterFile& registers, Memory& memory, uint32_t opCode, uint32_t rs, uint32_t rt, int32_t immediate);
+template <std::endian Order>
+[[nodiscard]] std::optional<ExecTrap> execIType(RegisterFile& registers, Memory& memory, uint32_t opCode, uint32_t rs,
+                                                uint32_t rt, int32_t immediate);
 
 
 /**
@@ -0,0 +1,98 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef DEBUG_TABLE_H
+#define DEBUG_TABLE_H
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <masm/assembler/debug_info.hpp>
+
+
+/**
+ * The debug info of a loaded program, ordered by address and indexed densely by word for executable sections
+ */
+class DebugTable {
+
+    /**
+     * A dense, word-indexed lookup over a contiguous range of addresses
+     */
+    struct DenseRange {
+        /**
+         * The address of the first word in the range
+         */
+        uint32_t base = 0;
+
+        /**
+         * The index into the entries for each word of the range, or NO_ENTRY if the word has no debug info
+         */
+        std::vector<uint32_t> slots;
+    };
+
+    /**
+     * The slot value for words that have no debug info
+     */
+    static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+    /**
+     * The debug info entries, sorted by address
+     */
+    std::vector<std::pair<uint32_t, DebugInfo>> entries;
+
+    /**
+     * The dense lookups for the text and ktext sections
+     */
+    std::vector<DenseRange> denseRanges;
+
+    /**
+     * Builds a dense lookup over all word-aligned entries between the given bounds
+     * @param lower The lowest address of the section
+     * @param upper The address just past the end of the section
+     */
+    void indexSection(uint32_t lower, uint32_t upper);
+
+public:
+    using const_iterator = std::vector<std::pair<uint32_t, DebugInfo>>::const_iterator;
+
+    DebugTable() = default;
+
+    /**
+     * Constructs a debug table from a map between addresses and debug info
+     * @param debugInfo The debug info of a memory layout
+     */
+    explicit DebugTable(const std::map<uint32_t, DebugInfo>& debugInfo);
+
+    /**
+     * Gets the debug info at the given address
+     * @param addr The address to look up
+     * @return A pointer to the debug info at the address, or nullptr if there is none
+     */
+    [[nodiscard]] const DebugInfo* find(uint32_t addr) const;
+
+    /**
+     * Checks whether the given address has debug info
+     * @param addr The address to check
+     * @return True if the address has debug info, false otherwise
+     */
+    [[nodiscard]] bool contains(uint32_t addr) const;
+
+    /**
+     * Gets the debug info at the given address
+     * @param addr The address to look up
+     * @return The debug info at the address
+     * @throw out_of_range When the address has no debug info
+     */
+    [[nodiscard]] const DebugInfo& at(uint32_t addr) const;
+
+    [[nodiscard]] const_iterator begin() const;
+    [[nodiscard]] const_iterator end() const;
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] bool empty() const;
+};
+
+#endif // DEBUG_TABLE_H
@@ -0,0 +1,151 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <unordered_map>
+
+#include <masm/assembler/memory.hpp>
+
+
+/**
+ * The handler family that a decoded instruction is dispatched to
+ */
+enum class InstrFormat : uint8_t {
+    SYSCALL,
+    ERET,
+    CP0,
+    CP1_COND_IMM,
+    CP1_REG_IMM,
+    CP1_COND,
+    CP1_REG,
+    CP1_IMM,
+    BREAK,
+    R_TYPE,
+    J_TYPE,
+    I_TYPE
+};
+
+
+/**
+ * An instruction word with its handler resolved and its operand fields pre-extracted
+ */
+struct DecodedInstruction {
+    /**
+     * The handler family of the instruction
+     */
+    InstrFormat format = InstrFormat::I_TYPE;
+
+    /**
+     * Bits 26-31 of the instruction
+     */
+    uint8_t opCode = 0;
+
+    /**
+     * Bits 21-25 of the instruction (rs, base, fmt or sub)
+     */
+    uint8_t rs = 0;
+
+    /**
+     * Bits 16-20 of the instruction (rt or ft)
+     */
+    uint8_t rt = 0;
+
+    /**
+     * Bits 11-15 of the instruction (rd or fs)
+     */
+    uint8_t rd = 0;
+
+    /**
+     * Bits 6-10 of the instruction (shamt or fd)
+     */
+    uint8_t shamt = 0;
+
+    /**
+     * Bits 0-5 of the instruction (funct or func)
+     */
+    uint8_t funct = 0;
+
+    /**
+     * Bits 0-15 of the instruction, without sign extension
+     */
+    int32_t immediate = 0;
+
+    /**
+     * Bits 0-25 of the instruction, used as the jump target and break code
+     */
+    uint32_t target = 0;
+};
+
+
+/**
+ * Decodes a raw instruction word into its handler family and operand fields
+ * @param instruction The instruction word to decode
+ * @return The decoded instruction
+ */
+DecodedInstruction decodeInstruction(int32_t instruction);
+
+
+/**
+ * A lazily filled, per-page cache of decoded instructions
+ */
+class DecodeCache {
+
+    /**
+     * The decoded instructions of a single page of memory
+     */
+    struct DecodedPage {
+        /**
+         * The decoded instruction at each word of the page
+         */
+        std::array<DecodedInstruction, MEM_PAGE_SIZE / 4> entries;
+
+        /**
+         * Which entries of the page hold a current decoding
+         */
+        std::bitset<MEM_PAGE_SIZE / 4> decoded;
+    };
+
+    /**
+     * The decoded pages, keyed by page number
+     */
+    std::unordered_map<uint32_t, DecodedPage> pages;
+
+    /**
+     * The page number of the most recently fetched page
+     */
+    uint32_t lastPageNum = 0;
+
+    /**
+     * The most recently fetched page, or nullptr if there is none
+     */
+    DecodedPage* lastPage = nullptr;
+
+public:
+    /**
+     * Gets the decoded instruction at the given address, decoding it from memory if it is not yet cached.  The page
+     * containing the address is watched so that later writes to it invalidate the cached decoding
+     * @param memory The memory to read the instruction from
+     * @param address The address of the instruction
+     * @return The decoded instruction at the address
+     */
+    const DecodedInstruction& fetch(Memory& memory, uint32_t address);
+
+    /**
+     * Discards the decoded instruction containing the given address, if any
+     * @param address The address that was modified
+     */
+    void invalidate(uint32_t address);
+
+    /**
+     * Discards all decoded instructions
+     */
+    void clear();
+};
+
+#endif // DECODER_H
@@ -0,0 +1,138 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef FILE_TABLE_H
+#define FILE_TABLE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+
+
+/**
+ * The flags that a program may open a file with, matching those of MARS
+ */
+enum class FileOpenFlags {
+    READ = 0,
+    WRITE = 1,
+    APPEND = 9
+};
+
+
+/**
+ * The host files that a simulated program has opened, indexed by the descriptors handed to the program.  Programs may
+ * only open files within a sandbox directory, and no files can be opened until the sandbox is set
+ */
+class FileTable {
+
+    /**
+     * A host file opened by the program
+     */
+    struct OpenFile {
+        /**
+         * The stream over the host file
+         */
+        std::fstream stream;
+
+        /**
+         * Whether the file was opened for writing rather than reading
+         */
+        bool writable = false;
+    };
+
+    /**
+     * The descriptor given to the first file that is opened, as 0, 1 and 2 are the console streams
+     */
+    static constexpr int32_t FIRST_FILE_DESCRIPTOR = 3;
+
+    /**
+     * The most files that may be open at once, which bounds the host resources that a program can hold
+     */
+    static constexpr size_t MAX_OPEN_FILES = 256;
+
+    /**
+     * The directory that opened files must lie within, or nullopt if file access is disabled
+     */
+    std::optional<std::filesystem::path> sandbox;
+
+    /**
+     * The open files, indexed by their descriptors
+     */
+    std::map<int32_t, OpenFile> files;
+
+    /**
+     * Resolves a file name given by the program to a path within the sandbox
+     * @param name The file name, relative to the sandbox
+     * @return The resolved path, or nullopt if file access is disabled, the name leads outside of the sandbox or the
+     * path passes through a symbolic link
+     */
+    [[nodiscard]] std::optional<std::filesystem::path> resolve(const std::string& name) const;
+
+public:
+    /**
+     * Sets the directory that programs may open files within, closing any files that are open
+     * @param directory The sandbox directory, or nullopt to disable file access
+     * @throw runtime_error If the directory does not exist
+     */
+    void setSandbox(const std::optional<std::filesystem::path>& directory);
+
+    /**
+     * Gets the directory that programs may open files within
+     * @return The canonical path of the sandbox directory, or nullopt if file access is disabled
+     */
+    [[nodiscard]] const std::optional<std::filesystem::path>& sandboxDirectory() const;
+
+    /**
+     * Opens a file within the sandbox
+     * @param name The name of the file, relative to the sandbox
+     * @param flags The flags to open the file with, as given by the program
+     * @return The descriptor of the opened file, or -1 if it could not be opened
+     */
+    int32_t open(const std::string& name, int32_t flags);
+
+    /**
+     * Reads bytes from an open file
+     * @param descriptor The descriptor of the file
+     * @param buffer Filled with the bytes read
+     * @return The number of bytes read, which is less than the size of the buffer at the end of the file, or -1 if
+     * the descriptor is not open for reading
+     */
+    int32_t read(int32_t descriptor, std::span<char> buffer);
+
+    /**
+     * Writes bytes to an open file
+     * @param descriptor The descriptor of the file
+     * @param data The bytes to write
+     * @return The number of bytes written, or -1 if the descriptor is not open for writing or the write failed
+     */
+    int32_t write(int32_t descriptor, std::span<const char> data);
+
+    /**
+     * Closes an open file.  Closing a descriptor that is not open does nothing
+     * @param descriptor The descriptor of the file
+     */
+    void close(int32_t descriptor);
+
+    /**
+     * Closes every open file
+     */
+    void closeAll();
+
+    /**
+     * Writes out anything buffered for the open files, so that the host sees what the program has written so far
+     */
+    void flush();
+
+    /**
+     * Gets the number of files that are open
+     * @return The number of open files
+     */
+    [[nodiscard]] size_t openCount() const;
+};
+
+#endif // FILE_TABLE_H
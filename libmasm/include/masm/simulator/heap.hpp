@@ -5,23 +5,39 @@
 #ifndef HEAP_H
 #define HEAP_H
 #include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
 
 #include <masm/assembler/memory.hpp>
 
 
 /**
- * Class representing a simple heap allocator
+ * Class representing a heap allocator.  Freed blocks are coalesced with their free neighbours and kept in trees by
+ * address and by size, so that allocations take the smallest free block that fits in logarithmic time, and the heap
+ * only grows towards the stack when no freed block is large enough
  */
 class HeapAllocator {
     /**
-     * The stating addresses of all allocated blocks in the heap
+     * The sizes of all allocated blocks in the heap, keyed by their starting addresses
      */
-    std::vector<uint32_t> blockAddresses;
+    std::map<uint32_t, uint32_t> allocatedBlocks;
 
     /**
-     * The sizes of all blocks in the heap
+     * The sizes of all free blocks below the top of the heap, keyed by their starting addresses
      */
-    std::vector<uint32_t> blockSizes;
+    std::map<uint32_t, uint32_t> freeBlocks;
+
+    /**
+     * The size and starting address of every free block, ordered from the smallest block to the largest
+     */
+    std::set<std::pair<uint32_t, uint32_t>> freeBySize;
+
+    /**
+     * The total number of bytes in allocated blocks
+     */
+    size_t allocatedBytes = 0;
 
     /**
      * A pointer to the current top of heap memory
@@ -29,20 +45,79 @@ class HeapAllocator {
     uint32_t heapPointer = memSectionOffset(MemSection::HEAP);
 
     /**
-     * Finds the first unallocated space in the heap that can accommodate a block of the given size
-     * @param size The size of the block to allocate
-     * @return The first unallocated area that can fit the requested block
+     * Adds a block to the free trees without merging it with its neighbours
+     * @param address The starting address of the block
+     * @param size The size of the block
+     */
+    void addFree(uint32_t address, uint32_t size);
+
+    /**
+     * Removes a block from the free trees
+     * @param it The block to remove
+     */
+    void removeFree(std::map<uint32_t, uint32_t>::iterator it);
+
+    /**
+     * Returns a block to the heap, merging it with the free blocks around it.  A block that ends at the top of the
+     * heap lowers the top instead
+     * @param address The starting address of the block
+     * @param size The size of the block
+     */
+    void release(uint32_t address, uint32_t size);
+
+    /**
+     * Raises the top of the heap
+     * @param top The new top of the heap
+     * @param limit The highest address that the top of the heap may reach
+     * @throw ExecExcept if the heap would grow past the limit
      */
-    [[nodiscard]] uint32_t nextFree(uint32_t size) const;
+    void grow(uint64_t top, uint32_t limit);
 
 public:
+    HeapAllocator() = default;
+
+    /**
+     * Constructs a heap allocator that has already allocated the given blocks.  The gaps between the blocks below the
+     * top of the heap are free
+     * @param blocks The address and size of each allocated block, sorted by address
+     * @param top The pointer to the top of heap memory
+     */
+    HeapAllocator(const std::vector<std::pair<uint32_t, uint32_t>>& blocks, uint32_t top);
+
     /**
-     * Allocates a block of memory of the given size in the heap
+     * Allocates a block of memory of the given size in the heap, reusing the smallest free block that can hold it
      * @param size The size of the block to allocate
+     * @param limit The highest address that the top of the heap may reach, such as the stack pointer
      * @return The address of the allocated block
-     * @throw runtime_error if the allocation fails
+     * @throw ExecExcept if the size is zero or the heap would grow past the limit, in which case nothing is allocated
+     */
+    uint32_t allocate(uint32_t size, uint32_t limit = UINT32_MAX);
+
+    /**
+     * Frees a block of memory that was allocated in the heap
+     * @param address The address of the block to free
+     * @throw ExecExcept if no block is allocated at the address
+     */
+    void free(uint32_t address);
+
+    /**
+     * Resizes a block of memory that was allocated in the heap, in place if the space after it is free.  Otherwise, a
+     * new block is allocated and the old block is freed, and the caller must copy the contents of the old block
+     * @param address The address of the block to resize
+     * @param size The new size of the block
+     * @param limit The highest address that the top of the heap may reach, such as the stack pointer
+     * @return The address of the resized block
+     * @throw ExecExcept if no block is allocated at the address, the size is zero or the heap would grow past the
+     * limit, in which case the block is left as it was
+     */
+    uint32_t reallocate(uint32_t address, uint32_t size, uint32_t limit = UINT32_MAX);
+
+    /**
+     * Gets the size of an allocated block
+     * @param address The address of the block
+     * @return The size of the block, or zero if no block is allocated at the address
      */
-    uint32_t allocate(uint32_t size);
+    [[nodiscard]] uint32_t sizeOf(uint32_t address) const;
 
     /**
      * Gets the total number of bytes allocated on the heap
@@ -53,6 +128,12 @@ public:
      * Gets the pointer to the top of heap memory
      */
     [[nodiscard]] uint32_t top() const;
+
+    /**
+     * Gets the blocks that have been allocated
+     * @return The address and size of each allocated block, sorted by address
+     */
+    [[nodiscard]] std::vector<std::pair<uint32_t, uint32_t>> blocks() const;
 };
 
 #endif // HEAP_H
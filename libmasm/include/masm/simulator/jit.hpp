@@ -0,0 +1,196 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include <masm/assembler/memory.hpp>
+#include <masm/simulator/block_cache.hpp>
+
+
+/**
+ * The execution engines that the simulator can run guest code with
+ */
+enum class ExecEngine {
+    INTERPRETER, // Decode and dispatch each instruction or translated block
+    JIT // Compile hot translated blocks into native code, falling back to the interpreter where needed
+};
+
+
+/**
+ * The number of times a block must be executed before it is compiled
+ */
+constexpr uint32_t JIT_HOT_THRESHOLD = 16;
+
+
+/**
+ * The default size in bytes of the executable code cache
+ */
+constexpr size_t JIT_CODE_CACHE_SIZE = 0x400000;
+
+
+/**
+ * The simulator state that compiled blocks need beyond the register file
+ */
+struct JitContext {
+    /**
+     * The memory that loads and stores operate on
+     */
+    Memory* memory = nullptr;
+
+    /**
+     * The block cache, checked after stores for writes to translated code
+     */
+    const BlockCache* blockCache = nullptr;
+
+    /**
+     * Whether calls and returns are being traced, in which case compiled code exits before a jal, jalr or jr so that
+     * the interpreter records it
+     */
+    bool traceCalls = false;
+};
+
+
+/**
+ * The status returned by a load or store helper to compiled code
+ */
+enum JitAccessStatus : uint32_t {
+    ACCESS_DONE = 0, // The access was performed
+    ACCESS_FALLBACK = 1, // The access was not performed and must be executed by the interpreter
+    ACCESS_STALE = 2 // The access was performed but overwrote translated code
+};
+
+
+/**
+ * Performs a guest load on behalf of compiled code.  Exceptions never escape, so that they cannot unwind through
+ * native frames
+ * @param context The JIT context holding the memory to read
+ * @param address The address to load from
+ * @param dest The register to load into
+ * @param opCode The opcode of the load instruction
+ * @return The status of the access
+ */
+uint32_t jitLoad(JitContext* context, uint32_t address, int32_t* dest, uint32_t opCode);
+
+
+/**
+ * Performs a guest store on behalf of compiled code.  Exceptions never escape, so that they cannot unwind through
+ * native frames
+ * @param context The JIT context holding the memory to write
+ * @param address The address to store to
+ * @param value The value of the source register
+ * @param opCode The opcode of the store instruction
+ * @return The status of the access
+ */
+uint32_t jitStore(JitContext* context, uint32_t address, int32_t value, uint32_t opCode);
+
+
+/**
+ * A compiled block, which executes a prefix of its translated block and returns the number of guest instructions
+ * executed.  The program counter is left at the next instruction to execute
+ */
+using CompiledBlock = uint32_t (*)(int32_t* registers, JitContext* context);
+
+
+/**
+ * Compiles hot translated blocks into native x86-64 code.  Instructions that touch coprocessors, syscalls, MMIO or
+ * raise traps exit the compiled code so that the interpreter executes them
+ */
+class JitCompiler {
+
+    /**
+     * The compilation state of a single block
+     */
+    struct Entry {
+        /**
+         * The number of times the block has been looked up
+         */
+        uint32_t hits = 0;
+
+        /**
+         * The compiled code of the block, or nullptr if it has not been compiled
+         */
+        CompiledBlock code = nullptr;
+
+        /**
+         * Whether the block could not be compiled
+         */
+        bool failed = false;
+    };
+
+    /**
+     * The executable code cache
+     */
+    std::byte* codeCache = nullptr;
+
+    /**
+     * The size in bytes of the code cache
+     */
+    size_t cacheSize;
+
+    /**
+     * The number of bytes of the code cache that are in use
+     */
+    size_t codeUsed = 0;
+
+    /**
+     * The compilation state of each block, keyed by starting address
+     */
+    std::unordered_map<uint32_t, Entry> entries;
+
+    /**
+     * Whether a write to translated code has made the compiled blocks out of date
+     */
+    bool stale = false;
+
+    /**
+     * Compiles a translated block into the code cache
+     * @param block The block to compile
+     * @return The compiled block, or nullptr if no prefix of the block can be compiled
+     */
+    CompiledBlock compile(const TranslatedBlock& block);
+
+public:
+    /**
+     * Constructor for a compiler with its own code cache.  Once the cache is full, it is flushed and the blocks that
+     * are still hot are compiled again
+     * @param codeCacheSize The size in bytes of the code cache
+     */
+    explicit JitCompiler(size_t codeCacheSize = JIT_CODE_CACHE_SIZE);
+    ~JitCompiler();
+
+    JitCompiler(const JitCompiler&) = delete;
+    JitCompiler& operator=(const JitCompiler&) = delete;
+
+    /**
+     * Checks whether native compilation is supported on this host
+     * @return True if blocks can be compiled, false if the JIT always falls back to the interpreter
+     */
+    static bool isAvailable();
+
+    /**
+     * Counts an execution of the given block and gets its compiled code, compiling it once it becomes hot
+     * @param block The translated block about to be executed
+     * @param address The starting address of the block
+     * @return The compiled block, or nullptr if the block should be interpreted
+     */
+    CompiledBlock lookup(const TranslatedBlock& block, uint32_t address);
+
+    /**
+     * Marks all compiled blocks as out of date.  They are discarded on the next lookup, so that a block that is
+     * currently executing stays intact
+     */
+    void invalidate();
+
+    /**
+     * Discards all compiled blocks
+     */
+    void clear();
+};
+
+#endif // JIT_H
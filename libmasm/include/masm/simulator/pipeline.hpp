@@ -0,0 +1,297 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <masm/simulator/debug_table.hpp>
+#include <masm/simulator/decoder.hpp>
+
+
+/**
+ * The latencies of a classic five-stage pipeline.  A latency is the number of cycles after an instruction issues
+ * before its result can be used, so an instruction with a latency of one never stalls the instruction after it
+ */
+struct PipelineConfig {
+    /**
+     * The latency of loads, which delays an instruction using the loaded value right after the load
+     */
+    uint32_t loadLatency = 2;
+
+    /**
+     * The number of cycles lost each time a branch or jump changes the flow of the program
+     */
+    uint32_t branchPenalty = 1;
+
+    /**
+     * The latency of mult and multu, until their results can be read from HI and LO
+     */
+    uint32_t multiplyLatency = 5;
+
+    /**
+     * The latency of div and divu, until their results can be read from HI and LO
+     */
+    uint32_t divideLatency = 35;
+
+    /**
+     * The latency of floating-point additions, subtractions, conversions and comparisons
+     */
+    uint32_t fpAddLatency = 3;
+
+    /**
+     * The latency of floating-point multiplications
+     */
+    uint32_t fpMultiplyLatency = 5;
+
+    /**
+     * The latency of floating-point divisions and square roots
+     */
+    uint32_t fpDivideLatency = 15;
+};
+
+
+/**
+ * The reasons that an instruction can wait before it issues
+ */
+enum class StallReason {
+    /**
+     * The instruction uses a value that is still being loaded
+     */
+    LOAD_USE,
+    /**
+     * The instruction reads HI or LO before a multiplication or division has finished
+     */
+    MULTIPLY_DIVIDE,
+    /**
+     * The instruction uses the result of an unfinished floating-point operation
+     */
+    FLOATING_POINT,
+    /**
+     * The instruction was fetched after a branch or jump changed the flow of the program
+     */
+    BRANCH
+};
+
+
+/**
+ * The number of reasons that an instruction can wait
+ */
+static constexpr size_t STALL_REASON_COUNT = 4;
+
+
+/**
+ * The timing of the instructions of a single source line
+ */
+struct PipelineLineReport {
+    std::string filename;
+    size_t lineno = 0;
+    std::string text;
+    uint64_t instructions = 0;
+    uint64_t cycles = 0;
+
+    [[nodiscard]] double cpi() const {
+        return instructions != 0 ? static_cast<double>(cycles) / static_cast<double>(instructions) : 0.0;
+    }
+};
+
+
+/**
+ * The timing of a single basic block, which runs from an instruction reached by a branch or jump up to the next one
+ */
+struct PipelineBlockReport {
+    /**
+     * The addresses of the first and last instructions of the block
+     */
+    uint32_t start = 0;
+    uint32_t end = 0;
+
+    /**
+     * The label at the start of the block, if any
+     */
+    std::string label;
+
+    /**
+     * The source location of the first instruction of the block
+     */
+    std::string filename;
+    size_t lineno = 0;
+
+    /**
+     * The number of times the block was entered
+     */
+    uint64_t entries = 0;
+
+    uint64_t instructions = 0;
+    uint64_t cycles = 0;
+
+    [[nodiscard]] double cpi() const {
+        return instructions != 0 ? static_cast<double>(cycles) / static_cast<double>(instructions) : 0.0;
+    }
+};
+
+
+/**
+ * The timing of a program, overall and per basic block and source line
+ */
+struct PipelineReport {
+    uint64_t instructions = 0;
+
+    /**
+     * The number of cycles taken by the program, including those taken to fill the pipeline
+     */
+    uint64_t cycles = 0;
+
+    /**
+     * The number of cycles lost to each reason for waiting, indexed by StallReason
+     */
+    std::array<uint64_t, STALL_REASON_COUNT> stalls{};
+
+    /**
+     * The basic blocks and source lines of the program, from the most to the fewest cycles
+     */
+    std::vector<PipelineBlockReport> blocks;
+    std::vector<PipelineLineReport> lines;
+
+    [[nodiscard]] double cpi() const {
+        return instructions != 0 ? static_cast<double>(cycles) / static_cast<double>(instructions) : 0.0;
+    }
+};
+
+
+/**
+ * A cycle-approximate model of a classic five-stage pipeline with full forwarding and perfect memory.  Each
+ * instruction issues one cycle after the one before it, unless it waits for an operand that an earlier instruction
+ * has yet to produce, or the instruction before it redirected the program to another address
+ */
+class PipelineModel {
+
+    /**
+     * The number of cycles taken to fill the pipeline before the first instruction completes
+     */
+    static constexpr uint64_t FILL_CYCLES = 4;
+
+    /**
+     * The timing of a single instruction or basic block
+     */
+    struct Counts {
+        uint64_t instructions = 0;
+        uint64_t cycles = 0;
+    };
+
+    /**
+     * The timing of a basic block, keyed by the address of its first instruction
+     */
+    struct BlockCounts : Counts {
+        uint64_t entries = 0;
+        uint32_t end = 0;
+    };
+
+    /**
+     * The number of registers tracked for dependencies: the general purpose registers, HI and LO, the floating-point
+     * registers and the floating-point condition flag
+     */
+    static constexpr size_t TRACKED_REGISTERS = 32 + 2 + 32 + 1;
+
+    /**
+     * The latencies of the pipeline
+     */
+    PipelineConfig config;
+
+    /**
+     * The cycle at which the most recent instruction issued
+     */
+    uint64_t clock = FILL_CYCLES;
+
+    /**
+     * The cycle from which each register can be read without waiting, and the kind of instruction that last wrote it
+     */
+    std::array<uint64_t, TRACKED_REGISTERS> ready{};
+    std::array<StallReason, TRACKED_REGISTERS> producer{};
+
+    /**
+     * The address expected to be fetched next if the program does not branch
+     */
+    uint32_t nextAddress = 0;
+
+    /**
+     * Whether the most recent instruction could have changed the flow of the program
+     */
+    bool afterControl = true;
+
+    /**
+     * The timing of the most recent instruction and of the basic block that it belongs to
+     */
+    Counts* lastInstruction = nullptr;
+    BlockCounts* currentBlock = nullptr;
+
+    uint64_t instructionCount = 0;
+    std::array<uint64_t, STALL_REASON_COUNT> stalls{};
+
+    /**
+     * The timing of each instruction, keyed by its address
+     */
+    std::unordered_map<uint32_t, Counts> instructionCounts;
+
+    /**
+     * The timing of each basic block, keyed by the address of its first instruction
+     */
+    std::unordered_map<uint32_t, BlockCounts> blockCounts;
+
+public:
+    /**
+     * Constructor for the PipelineModel class
+     * @param config The latencies of the pipeline
+     */
+    explicit PipelineModel(const PipelineConfig& config = {}) : config(config) {}
+
+    /**
+     * Issues the next instruction of the program.  Instructions must be issued before they are executed, in the order
+     * that they are executed
+     * @param address The address of the instruction
+     * @param instruction The instruction to issue
+     */
+    void issue(uint32_t address, const DecodedInstruction& instruction);
+
+    /**
+     * Empties the pipeline and resets all timings
+     */
+    void reset();
+
+    /**
+     * Gets the number of cycles taken so far, including those taken to fill the pipeline
+     * @return The number of cycles
+     */
+    [[nodiscard]] uint64_t cycles() const;
+
+    /**
+     * Gets the number of instructions issued so far
+     * @return The number of instructions
+     */
+    [[nodiscard]] uint64_t instructions() const;
+
+    /**
+     * Maps the timings of the program onto its basic blocks and source lines
+     * @param debugTable The debug info of the program
+     * @return The report of the program
+     */
+    [[nodiscard]] PipelineReport report(const DebugTable& debugTable) const;
+};
+
+
+/**
+ * Formats a report as a summary of the cycles and stalls of the program, followed by the basic blocks and source
+ * lines that took the most cycles
+ * @param report The report to format
+ * @param maxRows The most blocks and lines to list, or zero to list them all
+ * @return The formatted table
+ */
+std::string formatPipelineReport(const PipelineReport& report, size_t maxRows = 0);
+
+#endif // PIPELINE_H
@@ -0,0 +1,178 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <masm/simulator/debug_table.hpp>
+
+
+/**
+ * Dense execution counters for every word of the text and ktext sections, along with sparse counters for code executed
+ * anywhere else
+ */
+class ExecutionProfile {
+
+    /**
+     * The number of times each word of the text section was executed, indexed from the start of the section
+     */
+    std::vector<uint64_t> textCounts;
+
+    /**
+     * The number of times each word of the ktext section was executed, indexed from the start of the section
+     */
+    std::vector<uint64_t> ktextCounts;
+
+    /**
+     * The number of times each address outside the text and ktext sections was executed, such as data that a program
+     * jumped into.  These are kept apart so that a stray address cannot grow the dense counters to its offset
+     */
+    std::map<uint32_t, uint64_t> otherCounts;
+
+    /**
+     * Gets the counter of an address, growing the counters of its section to fit it
+     * @param address The address of the instruction
+     * @return The counter of the instruction
+     */
+    uint64_t& counter(uint32_t address);
+
+public:
+    /**
+     * Counts one execution of the instruction at the given address
+     * @param address The address of the instruction
+     */
+    void record(uint32_t address);
+
+    /**
+     * Gets the number of times the instruction at the given address was executed
+     * @param address The address of the instruction
+     * @return The execution count of the instruction
+     */
+    [[nodiscard]] uint64_t count(uint32_t address) const;
+
+    /**
+     * Gets the total number of instructions executed
+     * @return The sum of every execution count
+     */
+    [[nodiscard]] uint64_t total() const;
+
+    /**
+     * Gets every instruction that was executed along with its count
+     * @return The address and count of each executed instruction, sorted by address
+     */
+    [[nodiscard]] std::vector<std::pair<uint32_t, uint64_t>> counts() const;
+
+    /**
+     * Resets every counter to zero
+     */
+    void clear();
+};
+
+
+/**
+ * The execution count of a single source line
+ */
+struct ProfileLine {
+    /**
+     * The name of the source file of the line
+     */
+    std::string filename;
+
+    /**
+     * The line number of the line in its source file
+     */
+    size_t lineno = 0;
+
+    /**
+     * The text of the source line
+     */
+    std::string text;
+
+    /**
+     * The label that the line falls under, which is the nearest label at or before it in its section
+     */
+    std::string label;
+
+    /**
+     * The number of instructions from the line that were executed
+     */
+    uint64_t count = 0;
+};
+
+
+/**
+ * The execution count of the code under a single label
+ */
+struct ProfileLabel {
+    /**
+     * The name of the label
+     */
+    std::string label;
+
+    /**
+     * The number of instructions under the label that were executed
+     */
+    uint64_t count = 0;
+};
+
+
+/**
+ * The execution counts of a program mapped back onto its source
+ */
+struct ProfileReport {
+    /**
+     * The total number of instructions executed
+     */
+    uint64_t total = 0;
+
+    /**
+     * The number of executed instructions that have no debug info, such as those written by the program itself
+     */
+    uint64_t unattributed = 0;
+
+    /**
+     * The executed source lines, from most to least executed
+     */
+    std::vector<ProfileLine> lines;
+
+    /**
+     * The executed labels, from most to least executed
+     */
+    std::vector<ProfileLabel> labels;
+};
+
+
+/**
+ * Maps execution counts onto the source lines and labels of a program
+ * @param profile The execution counts of the program
+ * @param debugTable The debug info of the program
+ * @return The report of the program
+ */
+ProfileReport buildProfileReport(const ExecutionProfile& profile, const DebugTable& debugTable);
+
+
+/**
+ * Formats a report as a flat table of the labels and lines that executed the most instructions
+ * @param report The report to format
+ * @param maxLines The most source lines to list, or zero to list them all
+ * @return The formatted table
+ */
+std::string formatProfileReport(const ProfileReport& report, size_t maxLines = 0);
+
+
+/**
+ * Formats a report in the callgrind profile format, which can be viewed with tools such as KCachegrind.  Each label
+ * is given as a function and each source line as a line of that function, with the instruction count as its cost
+ * @param report The report to format
+ * @return The profile in callgrind format
+ */
+std::string formatCallgrind(const ProfileReport& report);
+
+#endif // PROFILER_H
@@ -0,0 +1,51 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef PROGRAM_IMAGE_H
+#define PROGRAM_IMAGE_H
+
+#include <memory>
+
+#include <masm/assembler/memory.hpp>
+#include <masm/simulator/debug_table.hpp>
+
+
+/**
+ * A loaded program that is built once and shared by any number of states.  Its memory pages and debug info are
+ * reference counted and never modified, so states map them directly rather than copying them.  A state that writes to
+ * one of the pages, such as a page of the data section, receives its own copy of only that page
+ */
+class ProgramImage {
+
+    /**
+     * The pages holding the text and data of the program
+     */
+    MemorySnapshot memory;
+
+    /**
+     * The debug info of the program
+     */
+    std::shared_ptr<const DebugTable> debugInfo;
+
+public:
+    /**
+     * Builds the image of a program
+     * @param layout The memory layout of the program
+     */
+    explicit ProgramImage(const MemLayout& layout);
+
+    /**
+     * Gets the pages holding the text and data of the program
+     * @return The snapshot of the memory of the program
+     */
+    [[nodiscard]] const MemorySnapshot& pages() const;
+
+    /**
+     * Gets the debug info of the program
+     * @return The shared debug info
+     */
+    [[nodiscard]] const std::shared_ptr<const DebugTable>& debugTable() const;
+};
+
+#endif // PROGRAM_IMAGE_H
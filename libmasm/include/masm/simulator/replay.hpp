@@ -0,0 +1,237 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include <masm/io/streamio.hpp>
+
+
+/**
+ * The kinds of external input that a program can consume
+ */
+enum class InputEventKind : uint8_t {
+    /**
+     * An input poll that found a character waiting
+     */
+    POLL = 1,
+    /**
+     * A character read from the input stream
+     */
+    CHAR = 2,
+    /**
+     * A reading of the system clock
+     */
+    TIME = 3,
+    /**
+     * The seed of a random number generator that the program did not seed itself
+     */
+    SEED = 4,
+    /**
+     * The descriptor returned by opening a host file
+     */
+    FILE_OPEN = 5,
+    /**
+     * The number of bytes read from a host file
+     */
+    FILE_READ = 6,
+    /**
+     * Up to eight bytes read from a host file, packed from the lowest byte up
+     */
+    FILE_DATA = 7,
+    /**
+     * The number of bytes written to a host file
+     */
+    FILE_WRITE = 8
+};
+
+
+/**
+ * A single external input, along with when the program consumed it
+ */
+struct InputEvent {
+    /**
+     * The number of instructions that had been executed when the input was consumed, including the one consuming it
+     */
+    uint64_t instruction = 0;
+
+    /**
+     * The kind of input
+     */
+    InputEventKind kind = InputEventKind::CHAR;
+
+    /**
+     * The value of the input
+     */
+    int64_t value = 0;
+};
+
+
+/**
+ * Whether a journal is logging inputs or feeding them back
+ */
+enum class JournalMode { RECORD, REPLAY };
+
+
+/**
+ * A log of every external input consumed by a simulation.  While recording, each input is taken from its real source
+ * and logged.  While replaying, the logged inputs are fed back in order without touching the real sources, so a
+ * replayed run reproduces the recorded one exactly and never waits on input or sleeps
+ */
+class InputJournal {
+
+    /**
+     * Whether inputs are being recorded or replayed
+     */
+    JournalMode journalMode;
+
+    /**
+     * The logged inputs, in the order that they were consumed
+     */
+    std::vector<InputEvent> inputEvents;
+
+    /**
+     * The index of the next input to replay
+     */
+    size_t cursor = 0;
+
+    /**
+     * Gives the number of instructions executed so far, used to stamp each input
+     */
+    std::function<uint64_t()> clock;
+
+    /**
+     * Gets the current instruction count from the clock
+     * @return The number of instructions executed so far, or zero if there is no clock
+     */
+    [[nodiscard]] uint64_t now() const;
+
+public:
+    /**
+     * Constructor for a journal that records inputs
+     */
+    InputJournal() : journalMode(JournalMode::RECORD) {}
+
+    /**
+     * Constructor for a journal that replays inputs
+     * @param events The inputs to replay
+     */
+    explicit InputJournal(std::vector<InputEvent> events) :
+        journalMode(JournalMode::REPLAY), inputEvents(std::move(events)) {}
+
+    /**
+     * Gets whether inputs are being recorded or replayed
+     * @return The mode of the journal
+     */
+    [[nodiscard]] JournalMode mode() const;
+
+    /**
+     * Gets the inputs that have been recorded, or that are being replayed
+     * @return The logged inputs
+     */
+    [[nodiscard]] const std::vector<InputEvent>& events() const;
+
+    /**
+     * Gets whether every logged input has been replayed
+     * @return True if no inputs remain to be replayed
+     */
+    [[nodiscard]] bool finished() const;
+
+    /**
+     * Sets the function used to stamp each input with the number of instructions executed so far
+     * @param instructionClock The function giving the current instruction count
+     */
+    void setClock(std::function<uint64_t()> instructionClock);
+
+    /**
+     * Consumes an input, either reading it from its source and logging it or replaying the next logged input
+     * @param kind The kind of input
+     * @param source Reads the input from its real source, only called while recording
+     * @return The value of the input
+     * @throw runtime_error When replaying and the next logged input is not of this kind at this instruction
+     */
+    int64_t consume(InputEventKind kind, const std::function<int64_t()>& source);
+
+    /**
+     * Polls for a waiting input character.  Only polls that find a character are logged, so a replayed poll finds one
+     * exactly when the next logged input is a poll at this instruction
+     * @param source Checks the real input stream, only called while recording
+     * @return True if a character is waiting
+     */
+    bool poll(const std::function<bool()>& source);
+
+    /**
+     * Writes the logged inputs in a compact binary format
+     * @param stream The binary stream to write to
+     * @throw runtime_error When the stream cannot be written to
+     */
+    void save(std::ostream& stream) const;
+
+    /**
+     * Reads inputs written by save into a journal that replays them
+     * @param stream The binary stream to read from
+     * @return The journal
+     * @throw runtime_error When the stream does not hold a valid input log
+     */
+    static InputJournal load(std::istream& stream);
+};
+
+
+/**
+ * A stream handle that passes every input through a journal.  Output is written to the wrapped handle as-is, while
+ * input is read from it only when recording
+ */
+class JournalStreamHandle final : public StreamHandle {
+
+    /**
+     * The handle that input is read from and output is written to
+     */
+    StreamHandle& inner;
+
+    /**
+     * The journal that input passes through
+     */
+    InputJournal& journal;
+
+public:
+    JournalStreamHandle(StreamHandle& inner, InputJournal& journal) :
+        StreamHandle(inner), inner(inner), journal(journal) {}
+
+    /**
+     * Checks if there are characters available to read, as logged in the journal
+     * @return True if there are characters available, false otherwise
+     */
+    bool hasChar() override;
+
+    /**
+     * Gets a character from the input, as logged in the journal
+     * @return The character read from the input
+     */
+    char getChar() override;
+
+    /**
+     * Reads (blocking) a character from the input, as logged in the journal.  A replayed read never blocks
+     * @return The character read from the input
+     */
+    char getCharBlocking() override;
+
+    /**
+     * Sends characters to the output of the wrapped handle
+     * @param data The characters to send
+     */
+    void write(std::span<const char> data) override;
+
+    /**
+     * Flushes the output of the wrapped handle
+     */
+    void flush() override;
+};
+
+#endif // REPLAY_H
@@ -5,12 +5,131 @@
 #ifndef SIMULATOR_H
 #define SIMULATOR_H
 
+#include <bit>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
 #include <masm/assembler/memory.hpp>
 #include <masm/io/streamio.hpp>
+#include <masm/simulator/aot.hpp>
+#include <masm/simulator/block_cache.hpp>
+#include <masm/simulator/cache.hpp>
+#include <masm/simulator/call_graph.hpp>
+#include <masm/simulator/decoder.hpp>
+#include <masm/simulator/file_table.hpp>
+#include <masm/simulator/jit.hpp>
+#include <masm/simulator/pipeline.hpp>
+#include <masm/simulator/profiler.hpp>
+#include <masm/simulator/program_image.hpp>
+#include <masm/simulator/replay.hpp>
 #include <masm/simulator/state.hpp>
 #include <masm/simulator/syscalls.hpp>
 
 
+/**
+ * The number of instructions that simulate executes per call to run
+ */
+constexpr uint64_t RUN_QUANTUM = 0x10000;
+
+
+/**
+ * The exit code that simulate returns when the program runs out of its instruction budget, matching a process killed
+ * for exceeding its CPU time limit
+ */
+constexpr int INSTRUCTION_LIMIT_EXIT_CODE = 152;
+
+
+/**
+ * The exit code that simulate returns when the program runs past its deadline, matching the timeout utility
+ */
+constexpr int TIMEOUT_EXIT_CODE = 124;
+
+
+/**
+ * The default number of instructions between polls of the input stream in MMIO mode
+ */
+constexpr uint32_t DEFAULT_INPUT_POLL_INTERVAL = 16;
+
+
+/**
+ * The reason that a call to run returned
+ */
+enum class RunStatus {
+    /**
+     * The step limit was reached and the program can be resumed
+     */
+    STEP_LIMIT,
+    /**
+     * The program exited through an exit syscall
+     */
+    EXITED,
+    /**
+     * The program executed a break instruction
+     */
+    BREAK,
+    /**
+     * The program counter left initialized memory
+     */
+    FAULT
+};
+
+
+/**
+ * The outcome of a call to run
+ */
+struct RunResult {
+    /**
+     * The reason that execution stopped
+     */
+    RunStatus status = RunStatus::STEP_LIMIT;
+
+    /**
+     * The number of steps that were executed
+     */
+    uint64_t steps = 0;
+
+    /**
+     * The exit code of the program, if it stopped
+     */
+    int32_t exitCode = 0;
+
+    /**
+     * The message to display for why the program stopped, if any
+     */
+    std::string message;
+};
+
+
+/**
+ * A point-in-time copy of a simulation, which can be restored to reset the simulator or to fork the simulation into
+ * another simulator of the same program
+ */
+struct SimulatorSnapshot {
+    /**
+     * The copy-on-write snapshot of the registers, memory and heap
+     */
+    StateSnapshot state;
+
+    /**
+     * The system call state, including the random number generators
+     */
+    SystemHandle sysHandle;
+
+    /**
+     * The number of user instructions that remained until the next input poll in MMIO mode
+     */
+    uint32_t inputPollCountdown = DEFAULT_INPUT_POLL_INTERVAL;
+
+    /**
+     * Whether the program text still matched its native blocks
+     */
+    bool nativeBlocksValid = false;
+};
+
+
 /**
  * The simulator class, which is responsible for executing MIPS instructions
  */
@@ -43,10 +162,215 @@ class Simulator {
     void except(uint32_t cause, const std::string& excMsg);
 
     /**
-     * Decodes an instructions and determines how to interpret its value
-     * @param instruction The instruction to execute
+     * Dispatches a decoded instruction to the handler for its format
+     * @tparam Order The byte order of memory
+     * @param instruction The decoded instruction to execute
+     * @return The trap raised by the instruction, if any
      */
-    void execInstruction(int32_t instruction);
+    template <std::endian Order>
+    std::optional<ExecTrap> execInstruction(const DecodedInstruction& instruction);
+
+    /**
+     * Executes a single program instruction, delivering any trap it raises to the exception handler
+     * @tparam Order The byte order of memory
+     * @param result The result to fill in if the program stops, whose steps are counted only if an instruction is
+     * dispatched rather than an interrupt taken or a fault reported
+     * @return True if the program stopped, false if it can continue
+     * @throw ExecExit if a syscall exits the program
+     * @throw ExecExcept if a syscall raises an exception
+     * @throw MasmRuntimeError if an error occurs during execution
+     */
+    template <std::endian Order>
+    bool execStep(RunResult& result);
+
+    /**
+     * Executes a translated block, delivering any trap it raises to the exception handler
+     * @tparam Order The byte order of memory
+     * @param block The block to execute, which must start at the current program counter
+     * @param result The result to count the executed instructions in
+     * @throw ExecExcept if an instruction raises an exception
+     * @throw MasmRuntimeError if an error occurs during execution
+     */
+    template <std::endian Order>
+    void execBlock(const TranslatedBlock& block, RunResult& result);
+
+    /**
+     * Executes program instructions until the program stops or the step limit is reached, with the byte order of
+     * memory fixed at compile time
+     * @tparam Order The byte order of memory
+     * @param maxSteps The maximum number of instructions to execute
+     * @return The reason that execution stopped and the number of steps executed
+     * @throw MasmRuntimeError if an error occurs during execution
+     */
+    template <std::endian Order>
+    RunResult runOrdered(uint64_t maxSteps);
+
+    /**
+     * A run loop specialized for one byte order
+     */
+    using RunLoop = RunResult (Simulator::*)(uint64_t);
+
+    /**
+     * Selects the run loop specialized for the given byte order
+     * @param useLittleEndian Whether memory uses little-endian byte order
+     * @return The specialized run loop
+     */
+    static RunLoop selectRunLoop(bool useLittleEndian);
+
+    /**
+     * The run loop for the byte order of memory, selected once on construction
+     */
+    RunLoop runLoop;
+
+    /**
+     * Finds the native block starting at the given address
+     * @param address The address of the first instruction of the block
+     * @return The native block, or nullptr if there is none or the text has been modified since translation
+     */
+    const NativeBlock* findNativeBlock(uint32_t address) const;
+
+    /**
+     * Drops every cached decoding, translation and compiled block, then watches memory so that they are invalidated
+     * whenever the program writes to its text from here on
+     */
+    void resetCaches();
+
+    /**
+     * Clears the profiles and timing models and closes the files of the previous run, so that a loaded or restored
+     * program starts from nothing
+     */
+    void resetRunState();
+
+    /**
+     * The decoded instructions of any text pages that have been executed
+     */
+    DecodeCache decodeCache;
+
+    /**
+     * The translated blocks of any text that has been executed, used when no per-instruction MMIO polling is needed
+     */
+    BlockCache blockCache;
+
+    /**
+     * The engine used to execute translated blocks
+     */
+    ExecEngine engine = ExecEngine::INTERPRETER;
+
+    /**
+     * The compiler for hot blocks, created when the JIT engine is selected
+     */
+    std::unique_ptr<JitCompiler> jit;
+
+    /**
+     * The most instructions that simulate may execute, or zero for no limit
+     */
+    uint64_t instructionLimit = 0;
+
+    /**
+     * The longest wall-clock time that simulate may run for, or zero for no limit
+     */
+    std::chrono::milliseconds timeout{0};
+
+    /**
+     * The number of instructions executed by the last call to simulate
+     */
+    uint64_t executedInstructions = 0;
+
+    /**
+     * The number of instructions between calls to the checkpoint hook, or zero for none
+     */
+    uint64_t checkpointInterval = 0;
+
+    /**
+     * The function that simulate calls with the simulator every checkpoint interval
+     */
+    std::function<void(Simulator&)> checkpointHook;
+
+    /**
+     * Steps the loaded program until it stops or the instruction budget or deadline is reached, counting on from the
+     * instructions already executed
+     * @return The exit code of the program, or INSTRUCTION_LIMIT_EXIT_CODE or TIMEOUT_EXIT_CODE if it was stopped
+     */
+    int runToCompletion();
+
+    /**
+     * The journal that external inputs pass through, or nullptr if they are read directly
+     */
+    InputJournal* inputJournal = nullptr;
+
+    /**
+     * The host files opened by the program, which are closed whenever a program is initialized
+     */
+    FileTable files;
+
+    /**
+     * The execution counts of each instruction, kept only while profiling
+     */
+    std::unique_ptr<ExecutionProfile> profile;
+
+    /**
+     * The shadow call stack of the program, kept only while profiling calls
+     */
+    std::unique_ptr<CallGraphProfile> callGraph;
+
+    /**
+     * The model of the caches of the machine, kept only while caches are simulated
+     */
+    std::unique_ptr<CacheHierarchy> caches;
+
+    /**
+     * The timing model of the pipeline of the machine, kept only while timing is simulated
+     */
+    std::unique_ptr<PipelineModel> pipeline;
+
+    /**
+     * Whether any model needs to observe each instruction before it is executed
+     */
+    bool instrumented = false;
+
+    /**
+     * Passes an instruction that is about to be executed to the enabled models
+     * @param address The address of the instruction
+     * @param instruction The instruction to observe
+     */
+    void observe(uint32_t address, const DecodedInstruction& instruction);
+
+    /**
+     * Updates the shadow call stack after a jump that may be a call or a return
+     * @param instruction The jump instruction that was just executed
+     */
+    void traceCall(const DecodedInstruction& instruction);
+
+    /**
+     * Gets the number of instructions executed so far, including those of the run in progress
+     * @return The number of executed instructions
+     */
+    [[nodiscard]] uint64_t currentInstruction() const;
+
+    /**
+     * The result of the run in progress, which counts the instructions executed so far by that run
+     */
+    const RunResult* activeRun = nullptr;
+
+    /**
+     * The blocks of the program that were translated ahead of time, sorted by address
+     */
+    std::vector<NativeBlock> nativeBlocks;
+
+    /**
+     * Whether the native blocks still match the program text, which stops being true once text is modified
+     */
+    bool nativeBlocksValid = false;
+
+    /**
+     * The number of user instructions between polls of the input stream in MMIO mode
+     */
+    uint32_t inputPollInterval = DEFAULT_INPUT_POLL_INTERVAL;
+
+    /**
+     * The number of user instructions remaining until the input stream is next polled in MMIO mode
+     */
+    uint32_t inputPollCountdown = DEFAULT_INPUT_POLL_INTERVAL;
 
 protected:
     /**
@@ -70,10 +394,15 @@ protected:
     State state;
 
 public:
-    Simulator(const IOMode ioMode, StreamHandle& streamHandle) : ioMode(ioMode), streamHandle(streamHandle) {}
+    Simulator(const IOMode ioMode, StreamHandle& streamHandle) :
+        runLoop(selectRunLoop(false)), ioMode(ioMode), streamHandle(streamHandle) {
+        sysHandle.setFileTable(&files);
+    }
 
     Simulator(const IOMode ioMode, StreamHandle& streamHandle, const bool useLittleEndian) :
-        ioMode(ioMode), streamHandle(streamHandle), state(useLittleEndian) {}
+        runLoop(selectRunLoop(useLittleEndian)), ioMode(ioMode), streamHandle(streamHandle), state(useLittleEndian) {
+        sysHandle.setFileTable(&files);
+    }
 
     virtual ~Simulator() = default;
 
@@ -83,6 +412,187 @@ public:
      */
     void initProgram(const MemLayout& layout);
 
+    /**
+     * Initializes the program in the simulator from an image shared with other simulators.  The text and data of the
+     * image are mapped rather than copied
+     * @param image The image of the program to load
+     */
+    void initProgram(const ProgramImage& image);
+
+    /**
+     * Sets how often the input stream is polled for MMIO input.  A fixed interval keeps the timing of keyboard
+     * interrupts deterministic for a given input
+     * @param interval The number of user instructions between polls
+     * @throw invalid_argument If the interval is zero
+     */
+    void setInputPollInterval(uint32_t interval);
+
+    /**
+     * Sets the engine used to execute translated blocks.  The JIT engine only compiles blocks on supported hosts and
+     * otherwise behaves like the interpreter
+     * @param execEngine The engine to use
+     */
+    void setEngine(ExecEngine execEngine);
+
+    /**
+     * Sets the most instructions that simulate may execute before it stops the program.  The budget is enforced
+     * exactly, while only being checked between calls to run
+     * @param maxInstructions The instruction budget, or zero for no limit
+     */
+    void setInstructionLimit(uint64_t maxInstructions);
+
+    /**
+     * Sets the longest wall-clock time that simulate may run for before it stops the program.  The deadline is checked
+     * once per run quantum, so it may be overshot by the time taken to execute a quantum or a blocking syscall
+     * @param duration The time limit, or zero for no limit
+     */
+    void setTimeout(std::chrono::milliseconds duration);
+
+    /**
+     * Gets the number of instructions executed by the last call to simulate
+     * @return The number of executed instructions
+     */
+    [[nodiscard]] uint64_t instructionCount() const;
+
+    /**
+     * Sets a function for simulate to call every given number of instructions, such as to save a checkpoint.  It is
+     * called between runs, once the program has executed exactly a multiple of the interval
+     * @param interval The number of instructions between calls
+     * @param hook The function to call with the simulator, or an empty function for none
+     */
+    void setCheckpointHook(uint64_t interval, std::function<void(Simulator&)> hook);
+
+    /**
+     * Sets the journal that every external input passes through, so that a run can be recorded and later replayed
+     * exactly.  The stream handle of the simulator must be a JournalStreamHandle over the same journal for console
+     * and MMIO input to be journaled as well
+     * @param journal The journal, or nullptr to read inputs directly
+     */
+    void setInputJournal(InputJournal* journal);
+
+    /**
+     * Sets the directory that the program may open files within through the file syscalls.  File names are resolved
+     * against the directory, and any that lead outside of it fail to open.  Files the program has open are closed
+     * @param directory The sandbox directory, or nullopt to fail every attempt to open a file
+     * @throw runtime_error If the directory does not exist
+     */
+    void setFileSandbox(const std::optional<std::filesystem::path>& directory);
+
+    /**
+     * Gets the host files opened by the program
+     * @return The file table
+     */
+    [[nodiscard]] const FileTable& fileTable() const;
+
+    /**
+     * Enables or disables counting how many times each instruction is executed.  While profiling, compiled and native
+     * blocks are not used so that every instruction can be counted, and the counts are reset whenever a program is
+     * initialized
+     * @param enabled Whether to profile execution
+     */
+    void setProfiling(bool enabled);
+
+    /**
+     * Gets the execution counts of each instruction
+     * @return The execution counts, or nullptr if profiling is disabled
+     */
+    [[nodiscard]] const ExecutionProfile* executionProfile() const;
+
+    /**
+     * Maps the execution counts of the loaded program onto its source lines and labels
+     * @return The report of the program
+     * @throw runtime_error If profiling is disabled
+     */
+    [[nodiscard]] ProfileReport profileReport() const;
+
+    /**
+     * Enables or disables tracking the calls and returns of the program on a shadow call stack.  Calls are jal and
+     * jalr instructions, and returns are jr instructions.  Compiled and native blocks stay in use, but leave each call
+     * and return to the interpreter while calls are tracked
+     * @param enabled Whether to track calls
+     */
+    void setCallGraphProfiling(bool enabled);
+
+    /**
+     * Gets the shadow call stack of the program
+     * @return The call graph, or nullptr if calls are not tracked
+     */
+    [[nodiscard]] const CallGraphProfile* callGraphProfile() const;
+
+    /**
+     * Maps the call graph of the loaded program onto the labels of its procedures
+     * @return The report of the program
+     * @throw runtime_error If calls are not tracked
+     */
+    [[nodiscard]] CallGraphReport callGraphReport() const;
+
+    /**
+     * Enables or disables simulating the caches of the machine.  Every instruction fetch, load and store of the
+     * program is passed through the caches, while the memory accesses of syscalls bypass them.  As with instruction
+     * profiling, compiled and native blocks are not used while caches are simulated, and the caches are emptied
+     * whenever a program is initialized
+     * @param config The caches to simulate, or nullopt to disable them
+     * @throw invalid_argument When a configuration describes an impossible cache
+     */
+    void setCacheModel(const std::optional<CacheHierarchyConfig>& config);
+
+    /**
+     * Gets the simulated caches of the machine
+     * @return The caches, or nullptr if caches are not simulated
+     */
+    [[nodiscard]] const CacheHierarchy* cacheHierarchy() const;
+
+    /**
+     * Maps the cache statistics of the loaded program onto its source lines
+     * @return The report of the caches
+     * @throw runtime_error If caches are not simulated
+     */
+    [[nodiscard]] CacheReport cacheReport() const;
+
+    /**
+     * Enables or disables timing the program on a model of a five-stage pipeline, which counts the cycles lost to
+     * load-use hazards, multiplication and division, floating-point latencies and taken branches.  As with instruction
+     * profiling, compiled and native blocks are not used while timing is simulated, and the timings are reset
+     * whenever a program is initialized
+     * @param config The latencies of the pipeline, or nullopt to disable timing
+     */
+    void setPipelineModel(const std::optional<PipelineConfig>& config);
+
+    /**
+     * Gets the timing model of the pipeline
+     * @return The pipeline model, or nullptr if timing is not simulated
+     */
+    [[nodiscard]] const PipelineModel* pipelineModel() const;
+
+    /**
+     * Maps the timings of the loaded program onto its basic blocks and source lines
+     * @return The report of the pipeline
+     * @throw runtime_error If timing is not simulated
+     */
+    [[nodiscard]] PipelineReport pipelineReport() const;
+
+    /**
+     * Sets the blocks of the program that were translated ahead of time.  They are run in place of the interpreter
+     * whenever the program counter reaches the start of one in system call mode, until the program modifies its text
+     * @param blocks The native blocks of the program that will be simulated
+     */
+    void setNativeBlocks(std::span<const NativeBlock> blocks);
+
+    /**
+     * Takes a snapshot of the simulation.  Memory pages are shared copy-on-write with the snapshot, so this is cheap
+     * enough to take between every run
+     * @return The snapshot of the simulation
+     */
+    [[nodiscard]] SimulatorSnapshot snapshot() const;
+
+    /**
+     * Restores the simulation to a snapshot, which may have been taken by another simulator of the same program and
+     * byte order.  Only the pages written to after the restore are copied.  The debug info of the program is not part
+     * of a snapshot, so a simulator that never loaded the program reports unknown source locations
+     * @param snapshot The snapshot to restore
+     */
+    void restore(const SimulatorSnapshot& snapshot);
+
     /**
      * Executes a single program instruction at the current program state
      * @throw ExecExit if the program exits normally
@@ -91,11 +601,38 @@ public:
     void step();
 
     /**
-     * Initializes a program and steps until an exit syscall or exception occurs
+     * Executes program instructions until the program stops or the step limit is reached
+     * @param maxSteps The maximum number of instructions to execute
+     * @return The reason that execution stopped and the number of steps executed
+     * @throw MasmRuntimeError if an error occurs during execution
+     */
+    RunResult run(uint64_t maxSteps);
+
+    /**
+     * Initializes a program and steps until an exit syscall or exception occurs, or until the instruction budget or
+     * deadline is reached
      * @param layout The initial memory layout to use for loading in the program and data
-     * @return The exit code of the program
+     * @return The exit code of the program, or INSTRUCTION_LIMIT_EXIT_CODE or TIMEOUT_EXIT_CODE if it was stopped
      */
     virtual int simulate(const MemLayout& layout);
+
+    /**
+     * Initializes a program from an image shared with other simulators and steps until an exit syscall or exception
+     * occurs, or until the instruction budget or deadline is reached
+     * @param image The image of the program to simulate
+     * @return The exit code of the program, or INSTRUCTION_LIMIT_EXIT_CODE or TIMEOUT_EXIT_CODE if it was stopped
+     */
+    int simulate(const ProgramImage& image);
+
+    /**
+     * Resumes a program from a snapshot of an earlier simulation of it, then steps until it stops as simulate does.
+     * The instruction budget covers the instructions executed before the snapshot
+     * @param image The image of the program that the snapshot was taken from
+     * @param snapshot The snapshot to resume from
+     * @param instructions The number of instructions that had been executed when the snapshot was taken
+     * @return The exit code of the program, or INSTRUCTION_LIMIT_EXIT_CODE or TIMEOUT_EXIT_CODE if it was stopped
+     */
+    int resume(const ProgramImage& image, const SimulatorSnapshot& snapshot, uint64_t instructions);
 };
 
 #endif // SIMULATOR_H
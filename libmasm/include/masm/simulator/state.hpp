@@ -5,13 +5,16 @@
 #ifndef STATE_H
 #define STATE_H
 #include <cstdint>
+#include <memory>
 #include <string>
 
 #include <masm/assembler/debug_info.hpp>
 #include <masm/simulator/cp0.hpp>
 #include <masm/simulator/cp1.hpp>
 #include <masm/simulator/cpu.hpp>
+#include <masm/simulator/debug_table.hpp>
 #include <masm/simulator/heap.hpp>
+#include <masm/simulator/program_image.hpp>
 
 
 /**
@@ -37,6 +40,38 @@ enum class IOMode {
 };
 
 
+/**
+ * A point-in-time copy of the state of the simulator.  The debug info of the program is not included, as it never
+ * changes once the program is loaded
+ */
+struct StateSnapshot {
+    /**
+     * The register file at the time of the snapshot
+     */
+    RegisterFile registers;
+
+    /**
+     * The coprocessor 0 register file at the time of the snapshot
+     */
+    Coproc0RegisterFile cp0;
+
+    /**
+     * The coprocessor 1 register file at the time of the snapshot
+     */
+    Coproc1RegisterFile cp1;
+
+    /**
+     * The copy-on-write snapshot of main memory
+     */
+    MemorySnapshot memory;
+
+    /**
+     * The heap allocator at the time of the snapshot
+     */
+    HeapAllocator heapAllocator;
+};
+
+
 /**
  * The state of the simulator, which includes the register file, memory, the heap, and debug info
  */
@@ -67,16 +102,16 @@ struct State {
     HeapAllocator heapAllocator;
 
     /**
-     * The main memory map between indices and the debug info for each instruction or data
+     * The debug info for each instruction or data, indexed by address, which is shared with the program image
      */
-    std::map<uint32_t, DebugInfo> debugInfo;
+    std::shared_ptr<const DebugTable> debugInfo = std::make_shared<const DebugTable>();
 
     /**
      * Gets the debug info for the given executable address
      * @param addr The address to get the source line for
-     * @return The debug info corresponding to the given address
+     * @return The debug info corresponding to the given address, or an unknown locator if there is none
      */
-    DebugInfo getDebugInfo(uint32_t addr) const;
+    [[nodiscard]] const DebugInfo& getDebugInfo(uint32_t addr) const;
 
     /**
      * Loads a program and initial static data into memory, along with source locators for text
@@ -84,6 +119,27 @@ struct State {
      */
     void loadProgram(const MemLayout& layout);
 
+    /**
+     * Loads a program from its shared image.  The pages of the image are mapped rather than copied wherever memory does
+     * not already hold a page, so loading into a new state takes time in proportion to the number of page tables
+     * @param image The image of the program to load
+     */
+    void loadProgram(const ProgramImage& image);
+
+    /**
+     * Takes a snapshot of the registers, memory and heap.  Memory pages are shared with the snapshot rather than
+     * copied, so this takes time in proportion to the number of page tables
+     * @return The snapshot of the state
+     */
+    [[nodiscard]] StateSnapshot snapshot() const;
+
+    /**
+     * Restores the registers, memory and heap to a snapshot, which may have been taken from another state of the same
+     * program.  Memory pages are shared until they are next written to
+     * @param snapshot The snapshot to restore
+     */
+    void restore(const StateSnapshot& snapshot);
+
     /**
      * Constructor for the State class
      * @param useLittleEndian Whether to use little-endian memory layout (default is big-endian)
@@ -6,10 +6,15 @@
 #define SYSCALLS_H
 
 #include <ctime>
+#include <istream>
 #include <map>
+#include <ostream>
 #include <random>
+#include <span>
 
 #include <masm/io/consoleio.hpp>
+#include <masm/simulator/file_table.hpp>
+#include <masm/simulator/replay.hpp>
 #include <masm/simulator/state.hpp>
 
 
@@ -56,6 +61,22 @@ public:
         std::uniform_real_distribution dist(0.0, 1.0);
         return dist(rng);
     }
+
+    /**
+     * Writes the full state of the generator as text, so that it can later resume the same sequence
+     * @param os The stream to write to
+     * @param generator The generator to write
+     * @return The stream
+     */
+    friend std::ostream& operator<<(std::ostream& os, const RandomGenerator& generator) { return os << generator.rng; }
+
+    /**
+     * Reads the state of a generator that was written with operator<<
+     * @param is The stream to read from
+     * @param generator The generator to restore
+     * @return The stream
+     */
+    friend std::istream& operator>>(std::istream& is, RandomGenerator& generator) { return is >> generator.rng; }
 };
 
 
@@ -76,6 +97,10 @@ enum class Syscall {
     EXIT = 10,
     PRINT_CHAR = 11,
     READ_CHAR = 12,
+    OPEN_FILE = 13,
+    READ_FILE = 14,
+    WRITE_FILE = 15,
+    CLOSE_FILE = 16,
     EXIT_VAL = 17,
 
     // MARS Extended Syscalls
@@ -88,7 +113,11 @@ enum class Syscall {
     RAND_INT = 41,
     RAND_INT_RANGE = 42,
     RAND_FLOAT = 43,
-    RAND_DOUBLE = 44
+    RAND_DOUBLE = 44,
+
+    // Heap Extension Syscalls, numbered past those of MARS
+    HEAP_FREE = 60,
+    HEAP_REALLOC = 61
 };
 
 
@@ -102,6 +131,24 @@ class SystemHandle {
      */
     std::map<size_t, RandomGenerator> rngMap = {};
 
+    /**
+     * The journal that the clock, random seeds and host files pass through, or nullptr to read them directly
+     */
+    InputJournal* journal = nullptr;
+
+    /**
+     * The host files opened by the program, or nullptr if the program may not open files
+     */
+    FileTable* files = nullptr;
+
+    /**
+     * Gets the random number generator with the given ID, seeding a new one from the clock if the program has not
+     * seeded it
+     * @param id The ID of the generator
+     * @return The generator
+     */
+    RandomGenerator& generatorFor(int32_t id);
+
     /**
      * Checks if the current I/O mode is SYSCALL mode, and throws an exception if it is not.
      * @param ioMode The current I/O mode of the simulator
@@ -110,6 +157,13 @@ class SystemHandle {
      */
     static void requiresSyscallMode(IOMode ioMode, const std::string& syscallName);
 
+    /**
+     * Passes bytes read from a host file through the journal, which logs them while recording and overwrites them
+     * with the logged bytes while replaying
+     * @param bytes The bytes that were read
+     */
+    void journalBytes(std::span<char> bytes);
+
 public:
     /**
      * Executes the system call based on the value in the $v0 register
@@ -120,6 +174,32 @@ public:
      */
     void exec(IOMode ioMode, State& state, StreamHandle& streamHandle);
 
+    /**
+     * Gets the random number generators that the program has used
+     * @return The generators, indexed by their IDs
+     */
+    [[nodiscard]] const std::map<size_t, RandomGenerator>& randomGenerators() const;
+
+    /**
+     * Replaces the random number generators, such as with those of a saved simulation
+     * @param generators The generators, indexed by their IDs
+     */
+    void setRandomGenerators(std::map<size_t, RandomGenerator> generators);
+
+    /**
+     * Sets the journal that the clock, random seeds and host files pass through, so that they can be recorded or
+     * replayed.  A replay never touches host files, instead taking the result of each file syscall from the journal
+     * @param inputJournal The journal, or nullptr to read the clock and files directly
+     */
+    void setInputJournal(InputJournal* inputJournal);
+
+    /**
+     * Sets the table of host files that the file syscalls use.  The table is not part of the system call state, so it
+     * is kept out of snapshots and must be set again after one is restored
+     * @param fileTable The file table, or nullptr to fail every file syscall
+     */
+    void setFileTable(FileTable* fileTable);
+
     /**
      * Prints the integer stored in the register $a0 to the console
      * @param state The current state of the simulator
@@ -185,6 +265,20 @@ public:
      */
     static void heapAlloc(State& state);
 
+    /**
+     * Frees the heap block at the address in $a0, doing nothing if the address is zero
+     * @param state The current state of the simulator
+     */
+    static void heapFree(State& state);
+
+    /**
+     * Resizes the heap block at the address in $a0 to the size in $a1 and stores its new address in $v0.  The contents
+     * of the block are copied if it moves.  A zero address allocates a new block, while a zero size frees the block
+     * and stores zero in $v0
+     * @param state The current state of the simulator
+     */
+    static void heapRealloc(State& state);
+
     /**
      * Exits the program with the exit code 0
      */
@@ -204,6 +298,37 @@ public:
      */
     static void readChar(State& state, StreamHandle& streamHandle);
 
+    /**
+     * Opens the file named by the null-terminated string at the address in $a0 with the flags in $a1, and stores its
+     * descriptor in $v0, or -1 if it could not be opened.  The flags are 0 to read, 1 to write and 9 to append
+     * @param state The current state of the simulator
+     */
+    void openFile(State& state);
+
+    /**
+     * Reads up to the number of bytes in $a2 from the file with the descriptor in $a0 into the memory at the address in
+     * $a1, and stores the number of bytes read in $v0, or -1 on an error.  Descriptor 0 reads a line of console input
+     * @param ioMode The I/O mode of the simulator, which must be SYSCALL mode to read from the console
+     * @param state The current state of the simulator
+     * @param streamHandle The stream handle for reading from the console
+     */
+    void readFile(IOMode ioMode, State& state, StreamHandle& streamHandle);
+
+    /**
+     * Writes the number of bytes in $a2 from the memory at the address in $a1 to the file with the descriptor in $a0,
+     * and stores the number of bytes written in $v0, or -1 on an error.  Descriptors 1 and 2 write to the console
+     * @param ioMode The I/O mode of the simulator, which must be SYSCALL mode to write to the console
+     * @param state The current state of the simulator
+     * @param streamHandle The stream handle for writing to the console
+     */
+    void writeFile(IOMode ioMode, State& state, StreamHandle& streamHandle);
+
+    /**
+     * Closes the file with the descriptor in $a0
+     * @param state The current state of the simulator
+     */
+    void closeFile(const State& state);
+
     /**
      * Exits the program with the exit code stored in $a0
      * @param state The current state of the simulator
@@ -214,13 +339,14 @@ public:
      * Gets the current system time as a 64-bit integer with low bits in $a0 and high bits in $a1
      * @param state The current state of the simulator
      */
-    static void time(State& state);
+    void time(State& state);
 
     /**
-     * Sleeps for the given number of milliseconds specified in $a0
+     * Sleeps for the given number of milliseconds specified in $a0.  Replayed runs skip the sleep, as the clock
+     * readings that follow it are replayed as well
      * @param state The current state of the simulator
      */
-    static void sleep(State& state);
+    void sleep(State& state);
 
     /**
      * Prints the integer stored in the register $a0 as a hexadecimal value
@@ -14,7 +14,7 @@
 /**
  * A mapping between instruction names and their associated properties
  */
-std::map<std::string, InstructionOp> instructionNameMap = {
+const std::map<std::string, InstructionOp> instructionNameMap = {
         // Arithmetic and Logical Instructions
         {"add", {InstructionType::R_TYPE_D_S_T, InstructionCode::ADD, 4}},
         {"addu", {InstructionType::R_TYPE_D_S_T, InstructionCode::ADDU, 4}},
@@ -181,6 +181,8 @@ const std::vector<std::pair<std::string, InstructionOp>> instructionAliasMap = {
 
         {"div", {InstructionType::R_TYPE_D_S_T, InstructionCode::PSEUDO, 8}},
         {"divu", {InstructionType::R_TYPE_D_S_T, InstructionCode::PSEUDO, 8}},
+
+        {"jalr", {InstructionType::R_TYPE_D_S, InstructionCode::JALR, 4}},
 };
 
 
@@ -197,8 +199,8 @@ InstructionOp nameToInstructionOp(const std::string& name, const std::vector<Tok
         } catch (const std::runtime_error&) {
         }
     }
-    if (instructionNameMap.contains(name))
-        return instructionNameMap[name];
+    if (const auto it = instructionNameMap.find(name); it != instructionNameMap.end())
+        return it->second;
     throw std::runtime_error("Unknown instruction " + name);
 }
 
@@ -231,6 +233,7 @@ void validateInstructionArgs(const InstructionType instructionType, const std::v
             if (!tokenCategoryMatch({TokenCategory::REGISTER, TokenCategory::LABEL_REF}, args))
                 throw std::runtime_error("Invalid format for I-Type instruction");
             break;
+        case InstructionType::R_TYPE_D_S:
         case InstructionType::R_TYPE_S_T:
             if (!tokenCategoryMatch({TokenCategory::REGISTER, TokenCategory::REGISTER}, args))
                 throw std::runtime_error("Invalid format for R-Type instruction");
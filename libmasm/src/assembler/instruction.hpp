@@ -159,6 +159,7 @@ enum class InstructionType {
     R_TYPE_S_T, // R-Type with 2 source registers
     R_TYPE_D_T_S, // R-Type with source registers swapped
     R_TYPE_S, // R-Type with 1 source register
+    R_TYPE_D_S, // R-Type with destination and 1 source register
     I_TYPE_T_S_I, // I-Type
     I_TYPE_T_I, // I-Type with 1 register
     I_TYPE_T_L, // I-Type with 1 register and label
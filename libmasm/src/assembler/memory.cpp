@@ -4,47 +4,140 @@
 
 #include <masm/assembler/memory.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 #include <masm/exceptions.hpp>
 
 #include "util/conversion.hpp"
 
 
+const MemPage* Memory::findPage(const uint32_t index) const {
+    const uint32_t pageNum = index >> MEM_PAGE_BITS;
+    const MemPageTable* table = directory[pageNum / MEM_TABLE_SIZE].get();
+    if (table == nullptr)
+        return nullptr;
+    return (*table)[pageNum % MEM_TABLE_SIZE].get();
+}
+
+
+MemPageTable& Memory::ownTable(const uint32_t tableNum) {
+    std::shared_ptr<MemPageTable>& table = directory[tableNum];
+    if (table == nullptr)
+        table = std::make_shared<MemPageTable>();
+    else if (table.use_count() > 1)
+        // Take a private copy of a table shared with a snapshot, which shares each of its pages in turn
+        table = std::make_shared<MemPageTable>(*table);
+    return *table;
+}
+
+
+MemPage& Memory::touchPage(const uint32_t index) {
+    const uint32_t pageNum = index >> MEM_PAGE_BITS;
+    std::shared_ptr<MemPage>& page = ownTable(pageNum / MEM_TABLE_SIZE)[pageNum % MEM_TABLE_SIZE];
+    if (page == nullptr)
+        page = std::make_shared<MemPage>();
+    else if (page.use_count() > 1)
+        page = std::make_shared<MemPage>(*page);
+
+    if (writeWatcher && isWatched(index))
+        writeWatcher(index);
+    return *page;
+}
+
+
+bool Memory::isWatched(const uint32_t index) const {
+    const uint32_t pageNum = index >> MEM_PAGE_BITS;
+    const std::unique_ptr<std::bitset<MEM_TABLE_SIZE>>& watched = watchedPages[pageNum / MEM_TABLE_SIZE];
+    return watched != nullptr && watched->test(pageNum % MEM_TABLE_SIZE);
+}
+
+
 std::byte Memory::_sysByteAt(const uint32_t index) const {
-    if (!memory.contains(index))
+    const MemPage* page = findPage(index);
+    if (page == nullptr)
         // Default of zero if not found
         return static_cast<std::byte>(0);
-    return memory.at(index);
+    return page->bytes[index % MEM_PAGE_SIZE];
+}
+
+
+void Memory::_sysByteTo(const uint32_t index, const std::byte value) {
+    MemPage& page = touchPage(index);
+    page.bytes[index % MEM_PAGE_SIZE] = value;
+    page.valid.set(index % MEM_PAGE_SIZE);
 }
 
 
+/**
+ * Converts an integer between host byte order and the given byte order, which is its own inverse
+ * @tparam Order The byte order to convert to or from
+ * @tparam T The unsigned integer type to convert
+ * @param value The value to convert
+ * @return The converted value
+ */
+template <std::endian Order, typename T>
+static T convertOrder(const T value) {
+    if constexpr (Order == std::endian::native)
+        return value;
+    else
+        return std::byteswap(value);
+}
+
+
+template <std::endian Order>
 int32_t Memory::_sysWordAt(const uint32_t index) const {
-    if (useLittleEndian)
-        // If little-endian, read bytes in little endian order
-        return static_cast<int32_t>(_sysByteAt(index + 3)) << 24 | static_cast<int32_t>(_sysByteAt(index + 2)) << 16 |
-               static_cast<int32_t>(_sysByteAt(index + 1)) << 8 | static_cast<int32_t>(_sysByteAt(index));
+    const uint32_t offset = index % MEM_PAGE_SIZE;
+    uint32_t word = 0;
+    if (offset <= MEM_PAGE_SIZE - 4) {
+        // Fast path for words that lie within a single page
+        const MemPage* page = findPage(index);
+        if (page == nullptr)
+            return 0;
+        std::memcpy(&word, page->bytes.data() + offset, 4);
+    } else {
+        std::array<std::byte, 4> bytes = {};
+        for (uint32_t i = 0; i < 4; i++)
+            bytes[i] = _sysByteAt(index + i);
+        std::memcpy(&word, bytes.data(), 4);
+    }
+    return static_cast<int32_t>(convertOrder<Order>(word));
+}
 
-    // If big-endian, read bytes in big endian order
-    return static_cast<int32_t>(_sysByteAt(index)) << 24 | static_cast<int32_t>(_sysByteAt(index + 1)) << 16 |
-           static_cast<int32_t>(_sysByteAt(index + 2)) << 8 | static_cast<int32_t>(_sysByteAt(index + 3));
+
+int32_t Memory::_sysWordAt(const uint32_t index) const {
+    return useLittleEndian ? _sysWordAt<std::endian::little>(index) : _sysWordAt<std::endian::big>(index);
 }
 
 
+template <std::endian Order>
 void Memory::_sysWordTo(const uint32_t index, const int32_t value) {
-    if (useLittleEndian) {
-        // If little-endian, write bytes in little endian order
-        memory[index] = static_cast<std::byte>(value);
-        memory[index + 1] = static_cast<std::byte>(value >> 8);
-        memory[index + 2] = static_cast<std::byte>(value >> 16);
-        memory[index + 3] = static_cast<std::byte>(value >> 24);
+    const uint32_t word = convertOrder<Order>(static_cast<uint32_t>(value));
+
+    const uint32_t offset = index % MEM_PAGE_SIZE;
+    if (offset <= MEM_PAGE_SIZE - 4) {
+        // Fast path for words that lie within a single page
+        MemPage& page = touchPage(index);
+        std::memcpy(page.bytes.data() + offset, &word, 4);
+        for (uint32_t i = 0; i < 4; i++)
+            page.valid.set(offset + i);
     } else {
-        memory[index] = static_cast<std::byte>(value >> 24);
-        memory[index + 1] = static_cast<std::byte>(value >> 16);
-        memory[index + 2] = static_cast<std::byte>(value >> 8);
-        memory[index + 3] = static_cast<std::byte>(value);
+        std::array<std::byte, 4> bytes = {};
+        std::memcpy(bytes.data(), &word, 4);
+        for (uint32_t i = 0; i < 4; i++)
+            _sysByteTo(index + i, bytes[i]);
     }
 }
 
 
+void Memory::_sysWordTo(const uint32_t index, const int32_t value) {
+    if (useLittleEndian)
+        _sysWordTo<std::endian::little>(index, value);
+    else
+        _sysWordTo<std::endian::big>(index, value);
+}
+
+
 void Memory::readSideEffect(const uint32_t index) {
     const uint32_t input_ready = memSectionOffset(MemSection::MMIO);
     const uint32_t input_data = input_ready + 4;
@@ -62,37 +155,57 @@ void Memory::writeSideEffect(const uint32_t index) {
     const uint32_t output_ready = input_data + 4;
     const uint32_t output_data = output_ready + 4;
 
+    // Skip the remaining checks for the common case of addresses below MMIO
+    if (index < input_ready)
+        return;
+
     // Check if writing to input or output ready bits or input data word
     if ((index >= output_ready && index < output_ready + 4) || (index >= input_ready && index < input_ready + 4) ||
         (index >= input_data && index < input_data + 4))
         throw std::runtime_error("Invalid write into read-only memory at " + i32ToHexString(index));
 
     // Check if writing to output data word
-    if (index >= output_data && index < output_data + 4)
+    if (index >= output_data && index < output_data + 4) {
         // Reset output ready bit
         _sysWordTo(output_ready, 0);
+        outputDirty = true;
+    }
 }
 
 
+template <std::endian Order>
 int32_t Memory::wordAt(const uint32_t index) {
-    if (index % 4 != 0)
-        throw ExecExcept("Invalid word access at " + i32ToHexString(index), EXCEPT_CODE::ADDRESS_EXCEPTION_LOAD);
+    if (const std::optional<ExecTrap> trap = alignmentTrap(index, 4, false))
+        throw ExecExcept(trap->what(), trap->cause);
 
     readSideEffect(index);
-    return _sysWordAt(index);
+    return _sysWordAt<Order>(index);
+}
+
+
+int32_t Memory::wordAt(const uint32_t index) {
+    return useLittleEndian ? wordAt<std::endian::little>(index) : wordAt<std::endian::big>(index);
 }
 
 
+template <std::endian Order>
 uint16_t Memory::halfAt(const uint32_t index) {
-    if (index % 2 != 0)
-        throw ExecExcept("Invalid half-word access at " + i32ToHexString(index), EXCEPT_CODE::ADDRESS_EXCEPTION_LOAD);
+    if (const std::optional<ExecTrap> trap = alignmentTrap(index, 2, false))
+        throw ExecExcept(trap->what(), trap->cause);
 
     readSideEffect(index);
-    if (useLittleEndian)
-        // If little-endian, read bytes in little endian order
-        return static_cast<uint16_t>(_sysByteAt(index + 1)) << 8 | static_cast<uint16_t>(_sysByteAt(index));
+    // Aligned halfwords never straddle a page
+    const MemPage* page = findPage(index);
+    if (page == nullptr)
+        return 0;
+    uint16_t half = 0;
+    std::memcpy(&half, page->bytes.data() + index % MEM_PAGE_SIZE, 2);
+    return convertOrder<Order>(half);
+}
 
-    return static_cast<uint16_t>(_sysByteAt(index)) << 8 | static_cast<uint16_t>(_sysByteAt(index + 1));
+
+uint16_t Memory::halfAt(const uint32_t index) {
+    return useLittleEndian ? halfAt<std::endian::little>(index) : halfAt<std::endian::big>(index);
 }
 
 
@@ -102,44 +215,203 @@ uint8_t Memory::byteAt(const uint32_t index) {
 }
 
 
+template <std::endian Order>
 void Memory::wordTo(const uint32_t index, const int32_t value) {
-    if (index % 4 != 0)
-        throw ExecExcept("Invalid word access at " + i32ToHexString(index), EXCEPT_CODE::ADDRESS_EXCEPTION_STORE);
+    if (const std::optional<ExecTrap> trap = alignmentTrap(index, 4, true))
+        throw ExecExcept(trap->what(), trap->cause);
 
     writeSideEffect(index);
-    _sysWordTo(index, value);
+    _sysWordTo<Order>(index, value);
 }
 
 
+void Memory::wordTo(const uint32_t index, const int32_t value) {
+    if (useLittleEndian)
+        wordTo<std::endian::little>(index, value);
+    else
+        wordTo<std::endian::big>(index, value);
+}
+
+
+template <std::endian Order>
 void Memory::halfTo(const uint32_t index, const int16_t value) {
-    if (index % 2 != 0)
-        throw ExecExcept("Invalid half-word access at " + i32ToHexString(index), EXCEPT_CODE::ADDRESS_EXCEPTION_STORE);
+    if (const std::optional<ExecTrap> trap = alignmentTrap(index, 2, true))
+        throw ExecExcept(trap->what(), trap->cause);
 
     writeSideEffect(index);
-    if (useLittleEndian) {
-        // If little-endian, write bytes in little endian order
-        memory[index] = static_cast<std::byte>(value);
-        memory[index + 1] = static_cast<std::byte>(value >> 8);
-    } else {
-        // If big-endian, write bytes in big endian order
-        memory[index] = static_cast<std::byte>(value >> 8);
-        memory[index + 1] = static_cast<std::byte>(value);
-    }
+    const uint16_t half = convertOrder<Order>(static_cast<uint16_t>(value));
+    MemPage& page = touchPage(index);
+    const uint32_t offset = index % MEM_PAGE_SIZE;
+    std::memcpy(page.bytes.data() + offset, &half, 2);
+    page.valid.set(offset);
+    page.valid.set(offset + 1);
+}
+
+
+void Memory::halfTo(const uint32_t index, const int16_t value) {
+    if (useLittleEndian)
+        halfTo<std::endian::little>(index, value);
+    else
+        halfTo<std::endian::big>(index, value);
 }
 
 
 void Memory::byteTo(const uint32_t index, const int8_t value) {
     writeSideEffect(index);
-    memory[index] = static_cast<std::byte>(value);
+    _sysByteTo(index, static_cast<std::byte>(value));
+}
+
+void Memory::bytesAt(const uint32_t index, const std::span<std::byte> bytes) {
+    const uint32_t mmio = memSectionOffset(MemSection::MMIO);
+    size_t done = 0;
+    while (done < bytes.size()) {
+        const uint32_t address = index + static_cast<uint32_t>(done);
+        const uint32_t offset = address % MEM_PAGE_SIZE;
+        const size_t chunk = std::min<size_t>(bytes.size() - done, MEM_PAGE_SIZE - offset);
+        if (address + chunk - 1 >= mmio) {
+            // MMIO reads have side effects, so they are made byte by byte
+            for (size_t i = 0; i < chunk; i++)
+                bytes[done + i] = static_cast<std::byte>(byteAt(address + static_cast<uint32_t>(i)));
+        } else if (const MemPage* page = findPage(address); page == nullptr)
+            std::fill_n(bytes.begin() + static_cast<std::ptrdiff_t>(done), chunk, std::byte{0});
+        else
+            std::memcpy(bytes.data() + done, page->bytes.data() + offset, chunk);
+        done += chunk;
+    }
 }
 
-bool Memory::isValid(const uint32_t index) const { return memory.contains(index); }
+
+void Memory::bytesTo(const uint32_t index, const std::span<const std::byte> bytes) {
+    const uint32_t mmio = memSectionOffset(MemSection::MMIO);
+    size_t done = 0;
+    while (done < bytes.size()) {
+        const uint32_t address = index + static_cast<uint32_t>(done);
+        const uint32_t offset = address % MEM_PAGE_SIZE;
+        const size_t chunk = std::min<size_t>(bytes.size() - done, MEM_PAGE_SIZE - offset);
+        if (address + chunk - 1 >= mmio || isWatched(address)) {
+            // The write watcher is told of each address, and MMIO writes have side effects
+            for (size_t i = 0; i < chunk; i++)
+                byteTo(address + static_cast<uint32_t>(i), static_cast<int8_t>(bytes[done + i]));
+        } else {
+            MemPage& page = touchPage(address);
+            std::memcpy(page.bytes.data() + offset, bytes.data() + done, chunk);
+            for (size_t i = 0; i < chunk; i++)
+                page.valid.set(offset + i);
+        }
+        done += chunk;
+    }
+}
+
+
+bool Memory::isValid(const uint32_t index) const {
+    const MemPage* page = findPage(index);
+    return page != nullptr && page->valid.test(index % MEM_PAGE_SIZE);
+}
 
 bool Memory::isLittleEndian() const { return useLittleEndian; }
 
+bool Memory::isOutputDirty() const { return outputDirty; }
+
+void Memory::clearOutputDirty() { outputDirty = false; }
+
+std::optional<ExecTrap> Memory::alignmentTrap(const uint32_t index, const uint32_t width, const bool isStore) {
+    if (index % width == 0)
+        return std::nullopt;
+
+    const char* message = width == 4 ? "Invalid word access at" : "Invalid half-word access at";
+    const EXCEPT_CODE cause = isStore ? EXCEPT_CODE::ADDRESS_EXCEPTION_STORE : EXCEPT_CODE::ADDRESS_EXCEPTION_LOAD;
+    return ExecTrap{cause, message, index};
+}
+
+void Memory::watchPage(const uint32_t index) {
+    const uint32_t pageNum = index >> MEM_PAGE_BITS;
+    std::unique_ptr<std::bitset<MEM_TABLE_SIZE>>& watched = watchedPages[pageNum / MEM_TABLE_SIZE];
+    if (watched == nullptr)
+        watched = std::make_unique<std::bitset<MEM_TABLE_SIZE>>();
+    watched->set(pageNum % MEM_TABLE_SIZE);
+}
+
+void Memory::setWriteWatcher(std::function<void(uint32_t)> watcher) { writeWatcher = std::move(watcher); }
+
+size_t Memory::pageCount() const {
+    size_t count = 0;
+    for (const std::shared_ptr<MemPageTable>& table : directory)
+        if (table != nullptr)
+            count += std::ranges::count_if(*table, [](const std::shared_ptr<MemPage>& page) { return page != nullptr; });
+    return count;
+}
+
+MemorySnapshot Memory::snapshot() const {
+    MemorySnapshot snapshot;
+    std::ranges::copy(directory, snapshot.directory.begin());
+    snapshot.outputDirty = outputDirty;
+    return snapshot;
+}
+
+void Memory::overlay(const MemorySnapshot& snapshot) {
+    for (uint32_t tableNum = 0; tableNum < MEM_TABLE_SIZE; tableNum++) {
+        const std::shared_ptr<const MemPageTable>& source = snapshot.directory[tableNum];
+        if (source == nullptr)
+            continue;
+        if (directory[tableNum] == nullptr) {
+            directory[tableNum] = std::const_pointer_cast<MemPageTable>(source);
+            continue;
+        }
+
+        for (uint32_t i = 0; i < MEM_TABLE_SIZE; i++) {
+            const std::shared_ptr<MemPage>& sourcePage = (*source)[i];
+            if (sourcePage == nullptr)
+                continue;
+
+            const uint32_t pageAddress = (tableNum * MEM_TABLE_SIZE + i) << MEM_PAGE_BITS;
+            if (findPage(pageAddress) == nullptr) {
+                ownTable(tableNum)[i] = sourcePage;
+                continue;
+            }
+            // Merge the initialized bytes of the snapshot into a page that memory already holds
+            MemPage& page = touchPage(pageAddress);
+            for (uint32_t offset = 0; offset < MEM_PAGE_SIZE; offset++)
+                if (sourcePage->valid.test(offset)) {
+                    page.bytes[offset] = sourcePage->bytes[offset];
+                    page.valid.set(offset);
+                }
+        }
+    }
+}
+
+void Memory::restore(const MemorySnapshot& snapshot) {
+    // The tables are shared again, so the first write to each one copies it out of the snapshot
+    for (size_t i = 0; i < MEM_TABLE_SIZE; i++)
+        directory[i] = std::const_pointer_cast<MemPageTable>(snapshot.directory[i]);
+    outputDirty = snapshot.outputDirty;
+}
+
 
-std::byte Memory::operator[](const uint32_t index) const { return memory.at(index); }
-std::byte& Memory::operator[](const uint32_t index) { return memory[index]; }
+// Instantiate the accessors for both byte orders so that the execution core can select one at compile time
+template int32_t Memory::_sysWordAt<std::endian::big>(uint32_t) const;
+template int32_t Memory::_sysWordAt<std::endian::little>(uint32_t) const;
+template void Memory::_sysWordTo<std::endian::big>(uint32_t, int32_t);
+template void Memory::_sysWordTo<std::endian::little>(uint32_t, int32_t);
+template int32_t Memory::wordAt<std::endian::big>(uint32_t);
+template int32_t Memory::wordAt<std::endian::little>(uint32_t);
+template uint16_t Memory::halfAt<std::endian::big>(uint32_t);
+template uint16_t Memory::halfAt<std::endian::little>(uint32_t);
+template void Memory::wordTo<std::endian::big>(uint32_t, int32_t);
+template void Memory::wordTo<std::endian::little>(uint32_t, int32_t);
+template void Memory::halfTo<std::endian::big>(uint32_t, int16_t);
+template void Memory::halfTo<std::endian::little>(uint32_t, int16_t);
+
+
+std::byte Memory::operator[](const uint32_t index) const {
+    if (!isValid(index))
+        throw std::out_of_range("Uninitialized memory access at " + i32ToHexString(index));
+    return _sysByteAt(index);
+}
+std::byte& Memory::operator[](const uint32_t index) {
+    MemPage& page = touchPage(index);
+    page.valid.set(index % MEM_PAGE_SIZE);
+    return page.bytes[index % MEM_PAGE_SIZE];
+}
 
 
 MemSection nameToMemSection(const std::string& name) {
@@ -199,6 +199,8 @@ std::vector<std::byte> Parser::parseInstruction(const uint32_t loc, const Token&
             return parseRTypeInstruction(argCodes[0], 0x00, 0x00, 0x00, opFuncCode);
         case InstructionType::R_TYPE_S:
             return parseRTypeInstruction(0x00, argCodes[0], 0x00, 0x00, opFuncCode);
+        case InstructionType::R_TYPE_D_S:
+            return parseRTypeInstruction(argCodes[0], argCodes[1], 0x00, 0x00, opFuncCode);
         case InstructionType::I_TYPE_T_S_I:
             return parseITypeInstruction(loc, opFuncCode, argCodes[0], argCodes[1], static_cast<int32_t>(argCodes[2]));
         case InstructionType::I_TYPE_S_T_L:
@@ -38,6 +38,7 @@ void ConsoleHandle::enableRawConsoleMode() {
 
 
 void ConsoleHandle::disableRawConsoleMode() {
+    flush();
     if (rawModeEnabled && hStdin != nullptr) {
         // Restore the original console mode
         SetConsoleMode(hStdin, originalConsoleMode);
@@ -47,6 +48,7 @@ void ConsoleHandle::disableRawConsoleMode() {
 
 
 bool ConsoleHandle::hasChar() {
+    flush();
     if (!rawModeEnabled)
         return false;
 
@@ -81,6 +83,7 @@ bool ConsoleHandle::hasChar() {
 
 
 char ConsoleHandle::getChar() {
+    flush();
     if (!rawModeEnabled)
         throw std::runtime_error("Raw console mode not enabled");
 
@@ -124,10 +127,25 @@ char ConsoleHandle::getChar() {
     }
 }
 
+
+char ConsoleHandle::getCharBlocking() {
+    flush();
+    if (!rawModeEnabled)
+        throw std::runtime_error("Raw console mode not enabled");
+
+    // Sleep until input events arrive, as checking for a character discards events that are not key presses
+    while (!hasChar())
+        if (WaitForSingleObject(hStdin, INFINITE) != WAIT_OBJECT_0)
+            throw std::runtime_error("Failed to wait for console input");
+    return getChar();
+}
+
 #else
 // Linux implementation
+#include <cerrno>
 #include <fcntl.h>
 #include <iostream>
+#include <poll.h>
 #include <stdexcept>
 #include <sys/select.h>
 #include <termios.h>
@@ -152,6 +170,7 @@ void ConsoleHandle::enableRawConsoleMode() {
 
 
 void ConsoleHandle::disableRawConsoleMode() {
+    flush();
     termios term{};
     tcgetattr(STDIN_FILENO, &term);
     // Restore canonical mode and echo mode
@@ -166,6 +185,7 @@ void ConsoleHandle::disableRawConsoleMode() {
 
 
 bool ConsoleHandle::hasChar() {
+    flush();
     // Try to read 0 bytes - will return > 0 if data is available
     char buf;
     const size_t bytesRead = read(STDIN_FILENO, &buf, 0);
@@ -189,6 +209,7 @@ bool ConsoleHandle::hasChar() {
 
 
 char ConsoleHandle::getChar() {
+    flush();
     char c;
     const size_t bytesRead = read(STDIN_FILENO, &c, 1);
 
@@ -218,13 +239,23 @@ char ConsoleHandle::getChar() {
     return c;
 }
 
+
+char ConsoleHandle::getCharBlocking() {
+    flush();
+    pollfd stdinPoll{STDIN_FILENO, POLLIN, 0};
+    // Sleep until stdin is readable, waiting again if a signal interrupts the sleep
+    while (poll(&stdinPoll, 1, -1) < 0)
+        if (errno != EINTR)
+            throw std::runtime_error("Failed to wait for console input");
+    return getChar();
+}
+
 #endif
 
 
-void ConsoleHandle::putChar(const char c) {
-    ostream << c;
-    ostream.flush();
+void ConsoleHandle::write(const std::span<const char> data) {
+    StreamHandle::write(data);
 
-    inputBase++;
+    inputBase += static_cast<uint32_t>(data.size());
     inputCursor = inputBase;
 }
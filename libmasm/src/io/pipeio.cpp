@@ -0,0 +1,65 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/io/pipeio.hpp>
+
+#include <stdexcept>
+
+
+/**
+ * The pipe keeps its own input, so the base handle is given a stream without a buffer, which is never read
+ */
+static std::istream unusedInput(nullptr);
+
+
+PipeStreamHandle::PipeStreamHandle(std::ostream& ostream) : StreamHandle(unusedInput, ostream) {}
+
+
+void PipeStreamHandle::feed(const std::string_view data) {
+    {
+        const std::lock_guard lock(mutex);
+        if (closed)
+            throw std::runtime_error("Cannot feed a closed pipe");
+        // Drop the input that has already been read, so that a long-running feed does not grow without bound
+        input.erase(0, cursor);
+        cursor = 0;
+        input += data;
+    }
+    inputReady.notify_all();
+}
+
+
+void PipeStreamHandle::close() {
+    {
+        const std::lock_guard lock(mutex);
+        closed = true;
+    }
+    inputReady.notify_all();
+}
+
+
+bool PipeStreamHandle::hasChar() {
+    flush();
+    const std::lock_guard lock(mutex);
+    return cursor < input.size();
+}
+
+
+char PipeStreamHandle::getChar() {
+    flush();
+    const std::lock_guard lock(mutex);
+    if (cursor == input.size())
+        throw std::runtime_error("End of input stream reached");
+    return input[cursor++];
+}
+
+
+char PipeStreamHandle::getCharBlocking() {
+    flush();
+    std::unique_lock lock(mutex);
+    inputReady.wait(lock, [this] { return cursor < input.size() || closed; });
+    if (cursor == input.size())
+        throw std::runtime_error("End of input stream reached");
+    return input[cursor++];
+}
@@ -4,9 +4,10 @@
 
 #include <masm/io/streamio.hpp>
 
-#include <unistd.h>
+#include <stdexcept>
 
 bool StreamHandle::hasChar() {
+    flush();
     const bool hasChar = istream.peek() != std::istream::traits_type::eof();
     // Clear error flags from peeking when stream is empty
     istream.clear();
@@ -14,6 +15,7 @@ bool StreamHandle::hasChar() {
 }
 
 char StreamHandle::getChar() {
+    flush();
     char c;
     istream.get(c);
     if (istream.eof())
@@ -37,18 +39,34 @@ std::string StreamHandle::getLine() {
 }
 
 char StreamHandle::getCharBlocking() {
-    while (!hasChar())
-        usleep(1000); // Sleep for 1 ms
+    // Reading the stream blocks until input arrives, and a stream that has ended can never receive more
     return getChar();
 }
 
-void StreamHandle::putChar(const char c) {
-    ostream.put(c);
-    if (ostream.fail())
-        throw std::runtime_error("Failed to write character to output stream");
+void StreamHandle::write(const std::span<const char> data) {
+    if (outputBuffer.size() + data.size() > OUTPUT_BUFFER_SIZE) {
+        flush();
+        // Writes too large to buffer go straight to the output stream
+        if (data.size() > OUTPUT_BUFFER_SIZE) {
+            ostream.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (ostream.fail())
+                throw std::runtime_error("Failed to write to output stream");
+            return;
+        }
+    }
+    outputBuffer.append(data.data(), data.size());
 }
 
-void StreamHandle::putStr(const std::string& str) {
-    for (const char c : str)
-        putChar(c);
+void StreamHandle::flush() {
+    if (outputBuffer.empty())
+        return;
+    ostream.write(outputBuffer.data(), static_cast<std::streamsize>(outputBuffer.size()));
+    outputBuffer.clear();
+    ostream.flush();
+    if (ostream.fail())
+        throw std::runtime_error("Failed to write to output stream");
 }
+
+void StreamHandle::putChar(const char c) { write({&c, 1}); }
+
+void StreamHandle::putStr(const std::string& str) { write(str); }
@@ -0,0 +1,364 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/aot.hpp>
+
+#include <algorithm>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <set>
+
+#include <masm/assembler/serialization.hpp>
+#include <masm/io/consoleio.hpp>
+#include <masm/simulator/block_cache.hpp>
+#include <masm/simulator/decoder.hpp>
+#include <masm/simulator/simulator.hpp>
+#include <masm/simulator/state.hpp>
+
+#include "assembler/instruction.hpp"
+
+
+/**
+ * The index of the program counter in the register file
+ */
+static constexpr uint32_t PC_INDEX = static_cast<uint32_t>(Register::PC);
+
+
+/**
+ * Generates the statements that leave a native block early
+ * @param pc The guest address to resume execution at
+ * @param executed The number of guest instructions executed before the exit
+ * @return The exit statements
+ */
+static std::string exitTo(const uint32_t pc, const uint32_t executed) {
+    return std::format("r[{}] = 0x{:08x}u; return {};", PC_INDEX, pc, executed);
+}
+
+
+/**
+ * Checks whether an instruction transfers control and so ends a native block
+ * @param instr The decoded instruction to check
+ * @return True if the instruction is a jump or branch
+ */
+static bool isControlTransfer(const DecodedInstruction& instr) {
+    if (instr.format == InstrFormat::J_TYPE)
+        return true;
+    if (instr.format == InstrFormat::R_TYPE)
+        return instr.funct == InstructionCode::JR || instr.funct == InstructionCode::JALR;
+    if (instr.format == InstrFormat::I_TYPE)
+        return instr.opCode == InstructionCode::BEQ || instr.opCode == InstructionCode::BNE;
+    return false;
+}
+
+
+/**
+ * Translates a register-only R-Type instruction
+ * @param instr The decoded instruction
+ * @param address The address of the instruction
+ * @param executed The number of instructions executed before this one
+ * @return The translated statement, or nullopt if the instruction must be interpreted
+ */
+static std::optional<std::string> translateRType(const DecodedInstruction& instr, const uint32_t address,
+                                                 const uint32_t executed) {
+    const uint32_t rs = instr.rs, rt = instr.rt, rd = instr.rd;
+    switch (static_cast<InstructionCode>(instr.funct)) {
+        case InstructionCode::ADD:
+        case InstructionCode::SUB: {
+            const char op = instr.funct == InstructionCode::ADD ? '+' : '-';
+            // Overflowing instructions are left to the interpreter, which raises the trap
+            return std::format("{{ const int64_t v = int64_t(int32_t(r[{}])) {} int32_t(r[{}]); "
+                               "if (v > INT32_MAX || v < INT32_MIN) {{ {} }} r[{}] = uint32_t(v); }}",
+                               rs, op, rt, exitTo(address, executed), rd);
+        }
+        case InstructionCode::ADDU:
+            return std::format("r[{}] = r[{}] + r[{}];", rd, rs, rt);
+        case InstructionCode::SUBU:
+            return std::format("r[{}] = r[{}] - r[{}];", rd, rs, rt);
+        case InstructionCode::AND:
+            return std::format("r[{}] = r[{}] & r[{}];", rd, rs, rt);
+        case InstructionCode::OR:
+            return std::format("r[{}] = r[{}] | r[{}];", rd, rs, rt);
+        case InstructionCode::XOR:
+            return std::format("r[{}] = r[{}] ^ r[{}];", rd, rs, rt);
+        case InstructionCode::NOR:
+            return std::format("r[{}] = ~(r[{}] | r[{}]);", rd, rs, rt);
+        case InstructionCode::SLT:
+            return std::format("r[{}] = int32_t(r[{}]) < int32_t(r[{}]);", rd, rs, rt);
+        case InstructionCode::SLTU:
+            return std::format("r[{}] = r[{}] < r[{}];", rd, rs, rt);
+        case InstructionCode::SLL:
+            return std::format("r[{}] = r[{}] << {};", rd, rt, instr.shamt);
+        case InstructionCode::SRL:
+        case InstructionCode::SRA:
+            // A zero arithmetic shift is left to the interpreter's sign-extension logic
+            if (instr.funct == InstructionCode::SRA && instr.shamt == 0)
+                return std::nullopt;
+            // Guest registers are signed, so right shifts are arithmetic
+            return std::format("r[{}] = uint32_t(int32_t(r[{}]) >> {});", rd, rt, instr.shamt);
+        case InstructionCode::SLLV:
+            return std::format("r[{}] = r[{}] << (r[{}] & 0x1F);", rd, rt, rs);
+        case InstructionCode::SRLV:
+            return std::format("r[{}] = uint32_t(int32_t(r[{}]) >> (r[{}] & 0x1F));", rd, rt, rs);
+        case InstructionCode::MFHI:
+            return std::format("r[{}] = r[{}];", rd, static_cast<uint32_t>(Register::HI));
+        case InstructionCode::MFLO:
+            return std::format("r[{}] = r[{}];", rd, static_cast<uint32_t>(Register::LO));
+        case InstructionCode::MTHI:
+            return std::format("r[{}] = r[{}];", static_cast<uint32_t>(Register::HI), rs);
+        case InstructionCode::MTLO:
+            return std::format("r[{}] = r[{}];", static_cast<uint32_t>(Register::LO), rs);
+        default:
+            return std::nullopt;
+    }
+}
+
+
+/**
+ * Translates a non-branching I-Type instruction
+ * @param instr The decoded instruction
+ * @param address The address of the instruction
+ * @param executed The number of instructions executed before this one
+ * @return The translated statement, or nullopt if the instruction must be interpreted
+ */
+static std::optional<std::string> translateIType(const DecodedInstruction& instr, const uint32_t address,
+                                                 const uint32_t executed) {
+    const uint32_t rs = instr.rs, rt = instr.rt;
+    const auto immediate = static_cast<uint32_t>(instr.immediate);
+    const auto signExtImm = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(instr.immediate)));
+    switch (static_cast<InstructionCode>(instr.opCode)) {
+        case InstructionCode::ADDI:
+            return std::format("{{ const int64_t v = int64_t(int32_t(r[{}])) + int32_t(0x{:08x}u); "
+                               "if (v > INT32_MAX || v < INT32_MIN) {{ {} }} r[{}] = uint32_t(v); }}",
+                               rs, signExtImm, exitTo(address, executed), rt);
+        case InstructionCode::ADDIU:
+            return std::format("r[{}] = r[{}] + 0x{:08x}u;", rt, rs, signExtImm);
+        case InstructionCode::ANDI:
+            return std::format("r[{}] = r[{}] & 0x{:08x}u;", rt, rs, immediate);
+        case InstructionCode::ORI:
+            return std::format("r[{}] = r[{}] | 0x{:08x}u;", rt, rs, immediate);
+        case InstructionCode::XORI:
+            return std::format("r[{}] = r[{}] ^ 0x{:08x}u;", rt, rs, immediate);
+        case InstructionCode::SLTI:
+            return std::format("r[{}] = int32_t(r[{}]) < int32_t(0x{:08x}u);", rt, rs, signExtImm);
+        case InstructionCode::SLTIU:
+            return std::format("r[{}] = r[{}] < 0x{:08x}u;", rt, rs, signExtImm);
+        case InstructionCode::LUI:
+            return std::format("r[{}] = 0x{:08x}u;", rt, immediate << 16);
+        case InstructionCode::LW:
+        case InstructionCode::LH:
+        case InstructionCode::LHU:
+        case InstructionCode::LB:
+        case InstructionCode::LBU:
+            // The interpreter adds the raw immediate to the base register
+            return std::format("if (jitLoad(context, r[{}] + 0x{:08x}u, registers + {}, {}) != ACCESS_DONE) {{ {} }}",
+                               rs, immediate, rt, instr.opCode, exitTo(address, executed));
+        case InstructionCode::SW:
+        case InstructionCode::SH:
+        case InstructionCode::SB:
+            return std::format("switch (jitStore(context, r[{}] + 0x{:08x}u, registers[{}], {})) {{ "
+                               "case ACCESS_FALLBACK: {} case ACCESS_STALE: {} default: break; }}",
+                               rs, immediate, rt, instr.opCode, exitTo(address, executed),
+                               exitTo(address + 4, executed + 1));
+        default:
+            return std::nullopt;
+    }
+}
+
+
+/**
+ * Translates a conditional branch on two guest registers, which ends the block
+ * @param instr The decoded branch instruction
+ * @param address The address of the branch
+ * @param executed The number of instructions executed including the branch
+ * @return The translated statements
+ */
+static std::string translateBranch(const DecodedInstruction& instr, const uint32_t address, const uint32_t executed) {
+    const uint32_t next = address + 4;
+    const uint32_t target = next + static_cast<uint32_t>(static_cast<int16_t>(instr.immediate) * 4);
+    const char* comparison = instr.opCode == InstructionCode::BNE ? "!=" : "==";
+    return std::format("r[{}] = r[{}] {} r[{}] ? 0x{:08x}u : 0x{:08x}u; return {};", PC_INDEX, instr.rs, comparison,
+                       instr.rt, target, next, executed);
+}
+
+
+/**
+ * Translates a jump, which ends the block
+ * @param instr The decoded jump instruction
+ * @param address The address of the jump
+ * @param executed The number of instructions executed including the jump
+ * @return The translated statements
+ */
+static std::string translateJump(const DecodedInstruction& instr, const uint32_t address, const uint32_t executed) {
+    const uint32_t next = address + 4;
+    const uint32_t ra = static_cast<uint32_t>(Register::RA);
+    // Calls and returns are left to the interpreter while they are traced
+    std::string source;
+    if (instr.format != InstrFormat::J_TYPE || instr.opCode == InstructionCode::JAL)
+        source += std::format("if (context->traceCalls) {{ {} }} ", exitTo(address, executed - 1));
+    if (instr.format == InstrFormat::J_TYPE) {
+        if (instr.opCode == InstructionCode::JAL)
+            source += std::format("r[{}] = 0x{:08x}u; ", ra, next);
+        return source + exitTo((next & 0xF0000000) | instr.target << 2, executed);
+    }
+    // Indirect jumps return to the runtime, which dispatches through the address table.  The link register is
+    // written before the target is read, as in the interpreter
+    if (instr.funct == InstructionCode::JALR)
+        source += std::format("r[{}] = 0x{:08x}u; ", jalrLinkRegister(instr.rd), next);
+    return source + std::format("r[{}] = r[{}]; return {};", PC_INDEX, instr.rs, executed);
+}
+
+
+/**
+ * Translates the longest prefix of a block that can run natively
+ * @param block The translated block to generate code for
+ * @return The body of the native function, or nullopt if not even the first instruction can run natively
+ */
+static std::optional<std::string> translateBlock(const TranslatedBlock& block) {
+    std::string body;
+    uint32_t executed = 0;
+    for (const BlockOp& op : block.ops) {
+        const DecodedInstruction& instr = op.first;
+        std::optional<std::string> statement;
+        if (op.kind == BlockOpKind::LOAD_CONST) {
+            statement = std::format("r[{}] = 0x{:08x}u; r[{}] = r[{}] | 0x{:08x}u;", instr.rt,
+                                    static_cast<uint32_t>(instr.immediate) << 16, op.second.rt, op.second.rs,
+                                    static_cast<uint32_t>(op.second.immediate));
+        } else if (op.kind == BlockOpKind::SLT_BRANCH) {
+            body += std::format("    r[{}] = int32_t(r[{}]) < int32_t(r[{}]);\n", instr.rd, instr.rs, instr.rt);
+            body += std::format("    {}\n", translateBranch(op.second, op.address + 4, executed + 2));
+            return body;
+        } else if (isControlTransfer(instr)) {
+            const bool isBranch = instr.format == InstrFormat::I_TYPE;
+            body += std::format("    {}\n", isBranch ? translateBranch(instr, op.address, executed + 1)
+                                                     : translateJump(instr, op.address, executed + 1));
+            return body;
+        } else if (instr.format == InstrFormat::R_TYPE) {
+            statement = translateRType(instr, op.address, executed);
+        } else if (instr.format == InstrFormat::I_TYPE) {
+            statement = translateIType(instr, op.address, executed);
+        }
+
+        // Hand the rest of the block to the interpreter
+        if (!statement) {
+            if (executed == 0)
+                return std::nullopt;
+            return body + std::format("    {}\n", exitTo(op.address, executed));
+        }
+
+        body += std::format("    {}\n", *statement);
+        executed += op.kind == BlockOpKind::SINGLE ? 1 : 2;
+    }
+
+    const BlockOp& last = block.ops.back();
+    return body + std::format("    {}\n", exitTo(last.address + (last.kind == BlockOpKind::SINGLE ? 4 : 8), executed));
+}
+
+
+/**
+ * Finds the addresses that execution can enter translated code at: the start of text, jump and branch targets, and
+ * the instruction after any jump, branch or instruction that is left to the interpreter
+ * @param memory The memory holding the loaded program
+ * @param decodeCache The decode cache to read instructions through
+ * @param textSize The size of the text section in bytes
+ * @return The entry addresses, in ascending order
+ */
+static std::set<uint32_t> findLeaders(Memory& memory, DecodeCache& decodeCache, const size_t textSize) {
+    const uint32_t textStart = memSectionOffset(MemSection::TEXT);
+    std::set<uint32_t> leaders = {textStart};
+    for (uint32_t address = textStart; address + 4 <= textStart + textSize; address += 4) {
+        const DecodedInstruction& instr = decodeCache.fetch(memory, address);
+        const uint32_t next = address + 4;
+        if (instr.format == InstrFormat::J_TYPE)
+            leaders.insert((next & 0xF0000000) | instr.target << 2);
+        else if (instr.format == InstrFormat::I_TYPE &&
+                 (instr.opCode == InstructionCode::BEQ || instr.opCode == InstructionCode::BNE))
+            leaders.insert(next + static_cast<uint32_t>(static_cast<int16_t>(instr.immediate) * 4));
+
+        if (instr.format != InstrFormat::R_TYPE && instr.format != InstrFormat::I_TYPE &&
+            instr.format != InstrFormat::J_TYPE)
+            leaders.insert(next);
+        else if (isControlTransfer(instr))
+            leaders.insert(next);
+    }
+
+    // Drop targets that lie outside of the program text
+    std::erase_if(leaders, [&](const uint32_t leader) { return leader >= textStart + textSize; });
+    return leaders;
+}
+
+
+std::string translateLayout(const MemLayout& layout, const bool useLittleEndian) {
+    State state(useLittleEndian);
+    state.loadProgram(layout);
+    DecodeCache decodeCache;
+    BlockCache blockCache;
+
+    const auto textIt = layout.data.find(MemSection::TEXT);
+    const size_t textSize = textIt == layout.data.end() ? 0 : textIt->second.size();
+
+    std::string functions;
+    std::string table;
+    size_t blockCount = 0;
+    for (const uint32_t leader : findLeaders(state.memory, decodeCache, textSize)) {
+        const TranslatedBlock* block = blockCache.lookup(state.memory, decodeCache, leader);
+        if (block == nullptr)
+            continue;
+        const std::optional<std::string> body = translateBlock(*block);
+        if (!body)
+            continue;
+
+        functions += std::format("uint32_t block_{:08x}(int32_t* registers, [[maybe_unused]] JitContext* context) {{\n"
+                                 "    uint32_t* r = reinterpret_cast<uint32_t*>(registers);\n"
+                                 "{}}}\n\n",
+                                 leader, *body);
+        table += std::format("        {{0x{:08x}u, {}, &block_{:08x}}},\n", leader, block->instructionCount, leader);
+        blockCount++;
+    }
+
+    const std::vector<std::byte> image = saveLayout(layout, true);
+    std::string imageSource;
+    for (size_t i = 0; i < image.size(); i++)
+        imageSource += std::format("{}0x{:02x},{}", i % 16 == 0 ? "        " : " ", static_cast<uint8_t>(image[i]),
+                                   i % 16 == 15 || i + 1 == image.size() ? "\n" : "");
+
+    return std::format("// Translated by masm.  Compile and link against libmasm to run the program natively\n\n"
+                       "#include <array>\n"
+                       "#include <climits>\n"
+                       "#include <cstdint>\n"
+                       "#include <span>\n\n"
+                       "#include <masm/simulator/aot.hpp>\n\n\n"
+                       "namespace {{\n\n"
+                       "{}"
+                       "const std::array<NativeBlock, {}> nativeBlocks = {{{{\n{}}}}};\n\n"
+                       "const std::array<uint8_t, {}> programImage = {{{{\n{}}}}};\n\n"
+                       "}} // namespace\n\n\n"
+                       "int main() {{\n"
+                       "    return runNativeProgram(std::as_bytes(std::span(programImage)), nativeBlocks, {});\n"
+                       "}}\n",
+                       functions, blockCount, table, image.size(), imageSource, useLittleEndian);
+}
+
+
+int runNativeProgram(const std::span<const std::byte> image, const std::span<const NativeBlock> blocks,
+                     const bool useLittleEndian) {
+    ConsoleHandle conHandle;
+    // Set terminal to raw mode
+    conHandle.enableRawConsoleMode();
+
+    int exitCode = 1;
+    try {
+        const MemLayout layout = loadLayout(std::vector(image.begin(), image.end()));
+        Simulator simulator(IOMode::SYSCALL, conHandle, useLittleEndian);
+        simulator.setNativeBlocks(blocks);
+        exitCode = simulator.simulate(layout);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+
+    // Restore terminal settings
+    conHandle.disableRawConsoleMode();
+
+    return exitCode;
+}
@@ -0,0 +1,151 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/batch.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <format>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <masm/simulator/simulator.hpp>
+
+
+/**
+ * A queue of job indices owned by one worker.  The owner takes jobs from the back while idle workers steal from the
+ * front, so that owners and thieves rarely contend for the same end
+ */
+class WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+
+public:
+    void push(const size_t job) {
+        const std::lock_guard lock(mutex);
+        jobs.push_back(job);
+    }
+
+    /**
+     * Takes the most recently queued job
+     * @param job Set to the index of the job that was taken
+     * @return True if a job was taken, false if the queue is empty
+     */
+    bool pop(size_t& job) {
+        const std::lock_guard lock(mutex);
+        if (jobs.empty())
+            return false;
+        job = jobs.back();
+        jobs.pop_back();
+        return true;
+    }
+
+    /**
+     * Takes the least recently queued job on behalf of another worker
+     * @param job Set to the index of the job that was taken
+     * @return True if a job was taken, false if the queue is empty
+     */
+    bool steal(size_t& job) {
+        const std::lock_guard lock(mutex);
+        if (jobs.empty())
+            return false;
+        job = jobs.front();
+        jobs.pop_front();
+        return true;
+    }
+};
+
+
+BatchResult BatchRunner::runJob(const BatchJob& job) const {
+    BatchResult result;
+    result.name = job.name;
+
+    std::istringstream iss(job.input);
+    std::ostringstream oss;
+    // A blocking read at the end of the input fails, since no more input can arrive
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(options.ioMode, streamHandle, options.useLittleEndian);
+    simulator.setEngine(options.engine);
+    simulator.setInstructionLimit(options.maxInstructions);
+    simulator.setTimeout(options.timeout);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    try {
+        result.exitCode = simulator.simulate(image);
+    } catch (const std::exception& e) {
+        result.exitCode = 1;
+        result.error = e.what();
+    }
+    result.elapsed = std::chrono::steady_clock::now() - start;
+    result.instructions = simulator.instructionCount();
+    result.output = oss.str();
+
+    if (!result.error.empty())
+        result.passed = false;
+    else if (job.expectedOutput)
+        result.passed = result.output == *job.expectedOutput;
+    else
+        result.passed = result.exitCode == 0;
+    return result;
+}
+
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob>& jobs) const {
+    std::vector<BatchResult> results(jobs.size());
+    if (jobs.empty())
+        return results;
+
+    unsigned threadCount = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+    threadCount = std::clamp<unsigned>(threadCount, 1, static_cast<unsigned>(jobs.size()));
+
+    // Deal the jobs out round-robin, after which idle workers steal from the others
+    std::vector<WorkQueue> queues(threadCount);
+    for (size_t i = 0; i < jobs.size(); i++)
+        queues[i % threadCount].push(i);
+
+    auto worker = [&](const unsigned self) {
+        size_t job = 0;
+        while (true) {
+            bool found = queues[self].pop(job);
+            for (unsigned offset = 1; !found && offset < threadCount; offset++)
+                found = queues[(self + offset) % threadCount].steal(job);
+            // No jobs are added once the batch starts, so every queue being empty means the batch is done
+            if (!found)
+                return;
+            results[job] = runJob(jobs[job]);
+        }
+    };
+
+    {
+        // The workers join on leaving this scope, before the results are returned
+        std::vector<std::jthread> workers;
+        workers.reserve(threadCount);
+        for (unsigned i = 0; i < threadCount; i++)
+            workers.emplace_back(worker, i);
+    }
+    return results;
+}
+
+
+std::string formatBatchReport(const std::vector<BatchResult>& results) {
+    std::string report;
+    size_t passed = 0;
+    std::chrono::nanoseconds total{0};
+    for (const BatchResult& result : results) {
+        const double millis = std::chrono::duration<double, std::milli>(result.elapsed).count();
+        report += std::format("{} {} (exit {}, {} instructions, {:.3f} ms)", result.passed ? "PASS" : "FAIL",
+                              result.name, result.exitCode, result.instructions, millis);
+        if (!result.error.empty())
+            report += ": " + result.error;
+        report += "\n";
+
+        passed += result.passed;
+        total += result.elapsed;
+    }
+
+    report += std::format("{} passed, {} failed, {:.3f} ms simulated\n", passed, results.size() - passed,
+                          std::chrono::duration<double, std::milli>(total).count());
+    return report;
+}
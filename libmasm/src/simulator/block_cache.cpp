@@ -0,0 +1,127 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/block_cache.hpp>
+
+#include "assembler/instruction.hpp"
+
+
+/**
+ * Checks whether an instruction can be executed inside a block at all
+ * @param instruction The decoded instruction to check
+ * @return True if the instruction can be part of a block
+ */
+static bool isBlockable(const DecodedInstruction& instruction) {
+    return instruction.format != InstrFormat::SYSCALL && instruction.format != InstrFormat::ERET &&
+           instruction.format != InstrFormat::BREAK;
+}
+
+
+/**
+ * Checks whether an instruction may transfer control, and so must end its block
+ * @param instruction The decoded instruction to check
+ * @return True if the instruction ends a block
+ */
+static bool endsBlock(const DecodedInstruction& instruction) {
+    switch (instruction.format) {
+        case InstrFormat::J_TYPE:
+        case InstrFormat::CP1_COND_IMM:
+            return true;
+        case InstrFormat::R_TYPE:
+            return instruction.funct == InstructionCode::JR || instruction.funct == InstructionCode::JALR;
+        case InstrFormat::I_TYPE:
+            return instruction.opCode == InstructionCode::BEQ || instruction.opCode == InstructionCode::BNE;
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * Determines whether a pair of adjacent instructions forms an idiom that can be fused
+ * @param first The first instruction of the pair
+ * @param second The instruction following the first
+ * @return The fused operation kind, or SINGLE if the pair cannot be fused
+ */
+static BlockOpKind fusedKind(const DecodedInstruction& first, const DecodedInstruction& second) {
+    if (first.format != InstrFormat::I_TYPE && first.format != InstrFormat::R_TYPE)
+        return BlockOpKind::SINGLE;
+    if (second.format != InstrFormat::I_TYPE)
+        return BlockOpKind::SINGLE;
+
+    // lui $at, upper; ori $tx, $at, lower
+    if (first.format == InstrFormat::I_TYPE && first.opCode == InstructionCode::LUI &&
+        second.opCode == InstructionCode::ORI && second.rs == first.rt)
+        return BlockOpKind::LOAD_CONST;
+
+    // slt $at, $tx, $ty; bxx $at, $zero, label
+    if (first.format == InstrFormat::R_TYPE && first.funct == InstructionCode::SLT &&
+        (second.opCode == InstructionCode::BEQ || second.opCode == InstructionCode::BNE) && second.rs == first.rd &&
+        second.rt == 0)
+        return BlockOpKind::SLT_BRANCH;
+
+    return BlockOpKind::SINGLE;
+}
+
+
+TranslatedBlock BlockCache::translate(Memory& memory, DecodeCache& decodeCache, const uint32_t address) {
+    TranslatedBlock block;
+    uint32_t addr = address;
+    while (block.instructionCount < MAX_BLOCK_INSTRUCTIONS) {
+        // Leave anything outside of initialized text to the full step path, which reports the error
+        if (!memory.isValid(addr) || static_cast<int32_t>(addr) >= TEXT_SEC_END || addr % 4 != 0)
+            break;
+
+        const DecodedInstruction& instruction = decodeCache.fetch(memory, addr);
+        if (!isBlockable(instruction))
+            break;
+
+        BlockOp op;
+        op.address = addr;
+        op.first = instruction;
+
+        const uint32_t next = addr + 4;
+        if (!endsBlock(instruction) && block.instructionCount + 2 <= MAX_BLOCK_INSTRUCTIONS && memory.isValid(next) &&
+            static_cast<int32_t>(next) < TEXT_SEC_END) {
+            const DecodedInstruction& nextInstruction = decodeCache.fetch(memory, next);
+            op.kind = fusedKind(instruction, nextInstruction);
+            if (op.kind != BlockOpKind::SINGLE)
+                op.second = nextInstruction;
+        }
+
+        block.ops.push_back(op);
+        const uint32_t count = op.kind == BlockOpKind::SINGLE ? 1 : 2;
+        block.instructionCount += count;
+        addr += 4 * count;
+
+        if (op.kind == BlockOpKind::SLT_BRANCH || endsBlock(instruction))
+            break;
+    }
+    return block;
+}
+
+
+const TranslatedBlock* BlockCache::lookup(Memory& memory, DecodeCache& decodeCache, const uint32_t address) {
+    if (stale) {
+        blocks.clear();
+        stale = false;
+    }
+
+    auto it = blocks.find(address);
+    if (it == blocks.end())
+        it = blocks.emplace(address, translate(memory, decodeCache, address)).first;
+    return it->second.ops.empty() ? nullptr : &it->second;
+}
+
+
+void BlockCache::invalidate() { stale = true; }
+
+
+bool BlockCache::isStale() const { return stale; }
+
+
+void BlockCache::clear() {
+    blocks.clear();
+    stale = false;
+}
@@ -0,0 +1,308 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/cache.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <format>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+
+/**
+ * The seed of the generator for random replacement, fixed so that runs are repeatable
+ */
+static constexpr uint32_t RANDOM_REPLACEMENT_SEED = 0x9e3779b9;
+
+
+/**
+ * Checks whether a number is a non-zero power of two
+ * @param value The number to check
+ * @return True if the number is a power of two
+ */
+static bool isPowerOfTwo(const uint32_t value) { return value != 0 && (value & (value - 1)) == 0; }
+
+
+/**
+ * Parses a single field of a cache configuration as an unsigned number, with an optional k or m suffix if allowed
+ * @param field The field to parse
+ * @param name The name of the field, used in errors
+ * @param allowSuffix Whether the field may end in k or m
+ * @return The parsed number
+ * @throw invalid_argument When the field is not a number
+ */
+static uint32_t parseCacheField(const std::string& field, const std::string& name, const bool allowSuffix) {
+    uint64_t multiplier = 1;
+    std::string_view digits = field;
+    if (allowSuffix && !digits.empty()) {
+        const char suffix = static_cast<char>(std::tolower(static_cast<unsigned char>(digits.back())));
+        if (suffix == 'k' || suffix == 'm') {
+            multiplier = suffix == 'k' ? 1024 : 1024 * 1024;
+            digits.remove_suffix(1);
+        }
+    }
+
+    uint64_t value = 0;
+    const auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    if (digits.empty() || error != std::errc{} || end != digits.data() + digits.size() ||
+        value * multiplier > UINT32_MAX)
+        throw std::invalid_argument(std::format("Invalid cache {} '{}'", name, field));
+    return static_cast<uint32_t>(value * multiplier);
+}
+
+
+CacheConfig parseCacheConfig(const std::string& spec) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        const size_t colon = spec.find(':', start);
+        fields.push_back(spec.substr(start, colon - start));
+        if (colon == std::string::npos)
+            break;
+        start = colon + 1;
+    }
+    if (fields.size() < 3 || fields.size() > 5)
+        throw std::invalid_argument(std::format("Invalid cache configuration '{}', expected SIZE:WAYS:LINE", spec));
+
+    CacheConfig config;
+    config.size = parseCacheField(fields[0], "size", true);
+    config.associativity = parseCacheField(fields[1], "associativity", false);
+    config.lineSize = parseCacheField(fields[2], "line size", false);
+
+    if (fields.size() > 3) {
+        if (fields[3] == "lru")
+            config.replacement = ReplacementPolicy::LRU;
+        else if (fields[3] == "fifo")
+            config.replacement = ReplacementPolicy::FIFO;
+        else if (fields[3] == "random")
+            config.replacement = ReplacementPolicy::RANDOM;
+        else
+            throw std::invalid_argument(std::format("Invalid cache replacement policy '{}'", fields[3]));
+    }
+    if (fields.size() > 4) {
+        if (fields[4] == "wb")
+            config.write = WritePolicy::WRITE_BACK;
+        else if (fields[4] == "wt")
+            config.write = WritePolicy::WRITE_THROUGH;
+        else
+            throw std::invalid_argument(std::format("Invalid cache write policy '{}'", fields[4]));
+    }
+
+    // Constructing a cache checks that the fields describe a cache that can exist
+    Cache{config};
+    return config;
+}
+
+
+Cache::Cache(const CacheConfig& config, Cache* next) : config(config), next(next), rng(RANDOM_REPLACEMENT_SEED) {
+    if (!isPowerOfTwo(config.size) || !isPowerOfTwo(config.associativity) || !isPowerOfTwo(config.lineSize))
+        throw std::invalid_argument("Cache size, associativity and line size must be powers of two");
+    if (config.lineSize < 4)
+        throw std::invalid_argument("Cache lines must hold at least one word");
+    if (static_cast<uint64_t>(config.associativity) * config.lineSize > config.size)
+        throw std::invalid_argument(std::format("A {} byte cache cannot hold {} ways of {} byte lines", config.size,
+                                                config.associativity, config.lineSize));
+
+    setCount = config.size / (config.associativity * config.lineSize);
+    ways.resize(config.size / config.lineSize);
+}
+
+
+Cache::Way& Cache::victim(Way* set) {
+    Way* const end = set + config.associativity;
+    if (Way* empty = std::find_if(set, end, [](const Way& way) { return !way.valid; }); empty != end)
+        return *empty;
+    if (config.replacement == ReplacementPolicy::RANDOM)
+        return set[rng() % config.associativity];
+    // LRU stamps are refreshed on every hit while FIFO stamps are only set on a fill, so both evict the oldest stamp
+    return *std::min_element(set, end, [](const Way& a, const Way& b) { return a.stamp < b.stamp; });
+}
+
+
+bool Cache::access(const uint32_t address, const bool write) {
+    clock++;
+    (write ? cacheStats.writes : cacheStats.reads)++;
+
+    const uint32_t line = address / config.lineSize;
+    const uint32_t tag = line / setCount;
+    Way* const set = &ways[static_cast<size_t>(line % setCount) * config.associativity];
+    for (uint32_t i = 0; i < config.associativity; i++) {
+        Way& way = set[i];
+        if (!way.valid || way.tag != tag)
+            continue;
+        if (config.replacement == ReplacementPolicy::LRU)
+            way.stamp = clock;
+        if (write) {
+            if (config.write == WritePolicy::WRITE_BACK)
+                way.dirty = true;
+            else if (next)
+                next->access(address, true);
+        }
+        return lastHit = true;
+    }
+
+    (write ? cacheStats.writeMisses : cacheStats.readMisses)++;
+    if (write && config.write == WritePolicy::WRITE_THROUGH) {
+        // Without write-allocate, a missing store goes straight to the next level and leaves this cache untouched
+        if (next)
+            next->access(address, true);
+        return lastHit = false;
+    }
+
+    Way& way = victim(set);
+    if (way.valid) {
+        cacheStats.evictions++;
+        if (way.dirty) {
+            cacheStats.writebacks++;
+            if (next)
+                next->access((way.tag * setCount + line % setCount) * config.lineSize, true);
+        }
+    }
+    if (next)
+        next->access(address, false);
+    way = {tag, true, write, clock};
+    return lastHit = false;
+}
+
+
+void Cache::reset() {
+    std::ranges::fill(ways, Way{});
+    clock = 0;
+    lastHit = false;
+    rng.seed(RANDOM_REPLACEMENT_SEED);
+    cacheStats = {};
+}
+
+
+const CacheConfig& Cache::configuration() const { return config; }
+
+
+const CacheStats& Cache::stats() const { return cacheStats; }
+
+
+bool Cache::lastAccessHit() const { return lastHit; }
+
+
+CacheHierarchy::CacheHierarchy(const CacheHierarchyConfig& config) {
+    if (config.l2)
+        l2 = std::make_unique<Cache>(*config.l2);
+    l1i = std::make_unique<Cache>(config.l1i, l2.get());
+    l1d = std::make_unique<Cache>(config.l1d, l2.get());
+}
+
+
+bool CacheHierarchy::access(Cache& l1, const uint32_t pc, const uint32_t address, const bool write) {
+    const uint64_t evictions = l1.stats().evictions;
+    const bool hit = l1.access(address, write);
+
+    AccessCounts& counts = instructionCounts[pc];
+    counts.evictions += l1.stats().evictions - evictions;
+    // A first-level miss reaches the second level last for the line itself, after any writeback of the line it replaced
+    if (!hit && l2 && !l2->lastAccessHit())
+        counts.l2Misses++;
+    return hit;
+}
+
+
+void CacheHierarchy::fetch(const uint32_t pc) {
+    const bool hit = access(*l1i, pc, pc, false);
+    AccessCounts& counts = instructionCounts[pc];
+    counts.fetches++;
+    counts.fetchMisses += !hit;
+}
+
+
+void CacheHierarchy::data(const uint32_t pc, const uint32_t address, const uint32_t size, const bool write) {
+    const uint32_t lineSize = l1d->configuration().lineSize;
+    const uint32_t first = address / lineSize;
+    const uint32_t last = (address + size - 1) / lineSize;
+    for (uint32_t line = first; line <= last; line++) {
+        const bool hit = access(*l1d, pc, line == first ? address : line * lineSize, write);
+        AccessCounts& counts = instructionCounts[pc];
+        counts.dataAccesses++;
+        counts.dataMisses += !hit;
+    }
+}
+
+
+void CacheHierarchy::reset() {
+    l1i->reset();
+    l1d->reset();
+    if (l2)
+        l2->reset();
+    instructionCounts.clear();
+}
+
+
+CacheReport CacheHierarchy::report(const DebugTable& debugTable) const {
+    CacheReport report;
+    report.levels.push_back({"L1I", l1i->configuration(), l1i->stats()});
+    report.levels.push_back({"L1D", l1d->configuration(), l1d->stats()});
+    if (l2)
+        report.levels.push_back({"L2", l2->configuration(), l2->stats()});
+
+    std::map<std::tuple<std::string, size_t>, CacheLineReport> lines;
+    for (const auto& [pc, counts] : instructionCounts) {
+        const DebugInfo* info = debugTable.find(pc);
+        if (!info)
+            continue;
+        CacheLineReport& line = lines[{info->source.filename, info->source.lineno}];
+        if (line.filename.empty()) {
+            line.filename = info->source.filename;
+            line.lineno = info->source.lineno;
+            line.text = info->source.text;
+        }
+        line.fetches += counts.fetches;
+        line.fetchMisses += counts.fetchMisses;
+        line.dataAccesses += counts.dataAccesses;
+        line.dataMisses += counts.dataMisses;
+        line.l2Misses += counts.l2Misses;
+        line.evictions += counts.evictions;
+    }
+
+    for (auto& [location, line] : lines)
+        report.lines.push_back(std::move(line));
+    // Ties keep their source order, so reports of the same run are always identical
+    std::ranges::stable_sort(report.lines, std::greater{}, &CacheLineReport::misses);
+    return report;
+}
+
+
+/**
+ * Formats the misses of an access count as a miss rate
+ * @param misses The number of misses
+ * @param accesses The number of accesses
+ * @return The miss rate with two decimal places
+ */
+static std::string missRate(const uint64_t misses, const uint64_t accesses) {
+    return std::format("{:6.2f}%",
+                       accesses != 0 ? 100.0 * static_cast<double>(misses) / static_cast<double>(accesses) : 0.0);
+}
+
+
+std::string formatCacheReport(const CacheReport& report, const size_t maxLines) {
+    std::string table = std::format("{:<5} {:>14} {:>14} {:>14} {:>8} {:>12} {:>12}\n", "Cache", "Accesses", "Hits",
+                                    "Misses", "Miss", "Evictions", "Writebacks");
+    for (const CacheLevelReport& level : report.levels)
+        table += std::format("{:<5} {:>14} {:>14} {:>14} {} {:>12} {:>12}\n", level.name, level.stats.accesses(),
+                             level.stats.hits(), level.stats.misses(),
+                             missRate(level.stats.misses(), level.stats.accesses()), level.stats.evictions,
+                             level.stats.writebacks);
+
+    table += std::format("\n{:>12} {:>12} {:>12} {:>12} {:>12} {:>12}  {}\n", "Fetches", "I-Misses", "Data",
+                         "D-Misses", "L2-Misses", "Evictions", "Line");
+    size_t listed = 0;
+    for (const CacheLineReport& line : report.lines) {
+        if (line.misses() == 0 || (maxLines != 0 && listed == maxLines))
+            break;
+        table += std::format("{:>12} {:>12} {:>12} {:>12} {:>12} {:>12}  {}:{}  {}\n", line.fetches, line.fetchMisses,
+                             line.dataAccesses, line.dataMisses, line.l2Misses, line.evictions, line.filename,
+                             line.lineno, line.text);
+        listed++;
+    }
+    return table;
+}
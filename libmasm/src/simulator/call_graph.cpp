@@ -0,0 +1,169 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/call_graph.hpp>
+
+#include <algorithm>
+#include <format>
+#include <map>
+
+#include <masm/assembler/memory.hpp>
+
+#include "assembler/postprocessor.hpp"
+#include "util/conversion.hpp"
+
+
+CallGraphProfile::CallGraphProfile(const uint32_t entry) { reset(entry); }
+
+
+void CallGraphProfile::reset(const uint32_t entry) {
+    nodes = {{entry, NO_PARENT, 1, 0}};
+    stack = {{0, 0, 0}};
+    children.clear();
+}
+
+
+void CallGraphProfile::call(const uint32_t target, const uint32_t returnAddress, const uint64_t instruction) {
+    const uint32_t parent = stack.back().node;
+    const auto [it, inserted] =
+            children.try_emplace(static_cast<uint64_t>(parent) << 32 | target, static_cast<uint32_t>(nodes.size()));
+    if (inserted)
+        nodes.push_back({target, parent, 0, 0});
+
+    nodes[it->second].calls++;
+    // The call itself is counted in the caller
+    stack.push_back({it->second, returnAddress, instruction});
+}
+
+
+void CallGraphProfile::ret(const uint32_t target, const uint64_t instruction) {
+    // The innermost call usually matches, so the search rarely goes past the top of the stack
+    for (size_t i = stack.size() - 1; i > 0; i--) {
+        if (stack[i].returnAddress != target)
+            continue;
+
+        while (stack.size() > i) {
+            nodes[stack.back().node].inclusive += instruction - stack.back().start;
+            stack.pop_back();
+        }
+        return;
+    }
+}
+
+
+size_t CallGraphProfile::depth() const { return stack.size() - 1; }
+
+
+std::vector<CallGraphProfile::Node> CallGraphProfile::snapshotNodes(const uint64_t instruction) const {
+    std::vector<Node> snapshot = nodes;
+    for (const Frame& frame : stack)
+        snapshot[frame.node].inclusive += instruction - frame.start;
+    return snapshot;
+}
+
+
+/**
+ * Gets the executable section that holds an address
+ * @param address The address to check
+ * @return The text or ktext section holding the address, or the data section if neither does
+ */
+static MemSection executableSection(const uint32_t address) {
+    if (address >= memSectionOffset(MemSection::TEXT) && address < static_cast<uint32_t>(TEXT_SEC_END))
+        return MemSection::TEXT;
+    if (address >= memSectionOffset(MemSection::KTEXT) && address < memSectionOffset(MemSection::KDATA))
+        return MemSection::KTEXT;
+    return MemSection::DATA;
+}
+
+
+/**
+ * Names the procedure starting at an address after its label, or the nearest label before it in the same section
+ * @param debugTable The debug info of the program
+ * @param address The address of the procedure
+ * @return The name of the procedure, or its address if no label precedes it
+ */
+static std::string procedureName(const DebugTable& debugTable, const uint32_t address) {
+    const MemSection section = executableSection(address);
+    auto it = std::upper_bound(debugTable.begin(), debugTable.end(), address,
+                               [](const uint32_t addr, const auto& entry) { return addr < entry.first; });
+    while (section != MemSection::DATA && it != debugTable.begin()) {
+        --it;
+        if (executableSection(it->first) != section)
+            break;
+        if (!it->second.label.empty())
+            return unmangleLabel(it->second.label);
+    }
+    return i32ToHexString(address);
+}
+
+
+CallGraphReport buildCallGraphReport(const CallGraphProfile& profile, const DebugTable& debugTable,
+                                     const uint64_t instructions) {
+    CallGraphReport report;
+    report.total = instructions;
+    const std::vector<CallGraphProfile::Node> nodes = profile.snapshotNodes(instructions);
+
+    // The exclusive count of a node is what remains of its inclusive count once its callees are taken out
+    std::vector<uint64_t> exclusive(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        exclusive[i] += nodes[i].inclusive;
+        if (nodes[i].parent != CallGraphProfile::NO_PARENT)
+            exclusive[nodes[i].parent] -= nodes[i].inclusive;
+    }
+
+    std::map<uint32_t, std::string> names;
+    auto nameOf = [&](const uint32_t address) -> const std::string& {
+        auto it = names.find(address);
+        if (it == names.end())
+            it = names.emplace(address, procedureName(debugTable, address)).first;
+        return it->second;
+    };
+
+    // Parents come before their children, so each stack extends that of its parent
+    std::vector<std::string> stacks(nodes.size());
+    std::map<std::string, uint64_t> foldedCounts;
+    std::map<std::string, ProcedureProfile> procedures;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const CallGraphProfile::Node& node = nodes[i];
+        const std::string& name = nameOf(node.address);
+        stacks[i] = node.parent != CallGraphProfile::NO_PARENT ? stacks[node.parent] + ";" + name : name;
+        if (exclusive[i] != 0)
+            foldedCounts[stacks[i]] += exclusive[i];
+
+        ProcedureProfile& procedure = procedures[name];
+        procedure.name = name;
+        procedure.calls += node.calls;
+        procedure.exclusive += exclusive[i];
+        // Recursive calls are already included in the count of the outermost call
+        bool recursive = false;
+        for (uint32_t parent = node.parent; parent != CallGraphProfile::NO_PARENT && !recursive;
+             parent = nodes[parent].parent)
+            recursive = nameOf(nodes[parent].address) == name;
+        if (!recursive)
+            procedure.inclusive += node.inclusive;
+    }
+
+    for (auto& [name, procedure] : procedures)
+        report.procedures.push_back(std::move(procedure));
+    std::ranges::stable_sort(report.procedures, std::greater{}, &ProcedureProfile::inclusive);
+    report.stacks.assign(foldedCounts.begin(), foldedCounts.end());
+    return report;
+}
+
+
+std::string formatFoldedStacks(const CallGraphReport& report) {
+    std::string folded;
+    for (const auto& [stack, count] : report.stacks)
+        folded += std::format("{} {}\n", stack, count);
+    return folded;
+}
+
+
+std::string formatCallGraphReport(const CallGraphReport& report) {
+    std::string table = std::format("{:>10} {:>14} {:>14}  {}\n", "Calls", "Inclusive", "Exclusive", "Procedure");
+    for (const ProcedureProfile& procedure : report.procedures)
+        table += std::format("{:>10} {:>14} {:>14}  {}\n", procedure.calls, procedure.inclusive, procedure.exclusive,
+                             procedure.name);
+    return table;
+}
@@ -0,0 +1,267 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/checkpoint.hpp>
+
+#include <array>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * The version of the checkpoint format, raised whenever the layout of a checkpoint changes
+ */
+constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+
+/**
+ * Marks the end of the page records, as page numbers never exceed twenty bits
+ */
+constexpr uint32_t END_OF_PAGES = UINT32_MAX;
+
+
+/**
+ * The longest text state of a random number generator that a checkpoint may hold, well above the few kilobytes that
+ * the state of a Mersenne Twister takes
+ */
+constexpr uint32_t MAX_GENERATOR_STATE_SIZE = 1 << 16;
+
+
+/**
+ * Writes an unsigned integer in little-endian byte order
+ * @tparam T The type of the integer
+ * @param stream The stream to write to
+ * @param value The integer to write
+ */
+template <typename T>
+static void writeInt(std::ostream& stream, const T value) {
+    std::array<char, sizeof(T)> bytes = {};
+    for (size_t i = 0; i < sizeof(T); i++)
+        bytes[i] = static_cast<char>(static_cast<uint64_t>(value) >> (8 * i) & 0xFF);
+    stream.write(bytes.data(), bytes.size());
+}
+
+
+/**
+ * Reads an unsigned integer in little-endian byte order
+ * @tparam T The type of the integer
+ * @param stream The stream to read from
+ * @return The integer that was read
+ * @throw runtime_error When the stream ends early
+ */
+template <typename T>
+static T readInt(std::istream& stream) {
+    std::array<char, sizeof(T)> bytes = {};
+    if (!stream.read(bytes.data(), bytes.size()))
+        throw std::runtime_error("Unexpected end of checkpoint");
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); i++)
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+    return static_cast<T>(value);
+}
+
+
+uint64_t programFingerprint(const MemLayout& layout) {
+    // 64-bit FNV-1a over the index and contents of each section
+    uint64_t hash = 0xcbf29ce484222325;
+    auto mix = [&hash](const uint8_t byte) {
+        hash ^= byte;
+        hash *= 0x100000001b3;
+    };
+    for (const auto& [section, bytes] : layout.data) {
+        mix(static_cast<uint8_t>(section));
+        for (const std::byte byte : bytes)
+            mix(static_cast<uint8_t>(byte));
+    }
+    return hash;
+}
+
+
+/**
+ * Writes every allocated page of a memory snapshot
+ * @param stream The stream to write to
+ * @param memory The snapshot to write
+ */
+static void savePages(std::ostream& stream, const MemorySnapshot& memory) {
+    std::array<char, MEM_PAGE_SIZE / 8> validBytes = {};
+    for (uint32_t tableNum = 0; tableNum < MEM_TABLE_SIZE; tableNum++) {
+        if (memory.directory[tableNum] == nullptr)
+            continue;
+        for (uint32_t i = 0; i < MEM_TABLE_SIZE; i++) {
+            const MemPage* page = (*memory.directory[tableNum])[i].get();
+            if (page == nullptr)
+                continue;
+
+            validBytes.fill(0);
+            for (uint32_t offset = 0; offset < MEM_PAGE_SIZE; offset++)
+                if (page->valid.test(offset))
+                    validBytes[offset / 8] = static_cast<char>(validBytes[offset / 8] | 1 << offset % 8);
+
+            writeInt<uint32_t>(stream, tableNum * MEM_TABLE_SIZE + i);
+            stream.write(validBytes.data(), validBytes.size());
+            stream.write(reinterpret_cast<const char*>(page->bytes.data()), MEM_PAGE_SIZE);
+        }
+    }
+    writeInt<uint32_t>(stream, END_OF_PAGES);
+}
+
+
+/**
+ * Reads the pages written by savePages into a new memory snapshot
+ * @param stream The stream to read from
+ * @return The snapshot holding the pages
+ * @throw runtime_error When the pages are malformed
+ */
+static MemorySnapshot loadPages(std::istream& stream) {
+    std::array<std::shared_ptr<MemPageTable>, MEM_TABLE_SIZE> tables;
+    std::array<char, MEM_PAGE_SIZE / 8> validBytes = {};
+    while (true) {
+        const uint32_t pageNum = readInt<uint32_t>(stream);
+        if (pageNum == END_OF_PAGES)
+            break;
+        if (pageNum >= MEM_TABLE_SIZE * MEM_TABLE_SIZE)
+            throw std::runtime_error("Invalid page number in checkpoint");
+
+        std::shared_ptr<MemPage> page = std::make_shared<MemPage>();
+        if (!stream.read(validBytes.data(), validBytes.size()) ||
+            !stream.read(reinterpret_cast<char*>(page->bytes.data()), MEM_PAGE_SIZE))
+            throw std::runtime_error("Unexpected end of checkpoint");
+        for (uint32_t offset = 0; offset < MEM_PAGE_SIZE; offset++)
+            page->valid[offset] = validBytes[offset / 8] >> offset % 8 & 1;
+
+        std::shared_ptr<MemPageTable>& table = tables[pageNum / MEM_TABLE_SIZE];
+        if (table == nullptr)
+            table = std::make_shared<MemPageTable>();
+        (*table)[pageNum % MEM_TABLE_SIZE] = std::move(page);
+    }
+
+    MemorySnapshot memory;
+    std::ranges::copy(tables, memory.directory.begin());
+    return memory;
+}
+
+
+void saveCheckpoint(std::ostream& stream, const Checkpoint& checkpoint) {
+    const SimulatorSnapshot& snapshot = checkpoint.snapshot;
+    const StateSnapshot& state = snapshot.state;
+
+    stream.write("MCKP", 4);
+    writeInt<uint32_t>(stream, CHECKPOINT_VERSION);
+    writeInt<uint8_t>(stream, checkpoint.useLittleEndian | state.memory.outputDirty << 1 |
+                                      snapshot.nativeBlocksValid << 2);
+    writeInt<uint64_t>(stream, checkpoint.programFingerprint);
+    writeInt<uint64_t>(stream, checkpoint.instructions);
+    writeInt<uint32_t>(stream, snapshot.inputPollCountdown);
+
+    // Registers
+    for (uint32_t i = 0; i < NUM_CPU_REGISTERS; i++)
+        writeInt<uint32_t>(stream, state.registers[i]);
+    for (uint32_t i = 0; i < NUM_CP0_REGISTERS; i++)
+        writeInt<uint32_t>(stream, state.cp0[i]);
+    for (uint32_t i = 0; i < NUM_CP1_REGISTERS; i++)
+        writeInt<uint32_t>(stream, state.cp1[i]);
+    for (uint32_t i = 0; i < 8; i++)
+        writeInt<uint8_t>(stream, state.cp1.getFlag(i));
+
+    // Heap blocks
+    const std::vector<std::pair<uint32_t, uint32_t>> blocks = state.heapAllocator.blocks();
+    writeInt<uint32_t>(stream, state.heapAllocator.top());
+    writeInt<uint32_t>(stream, blocks.size());
+    for (const auto& [address, size] : blocks) {
+        writeInt<uint32_t>(stream, address);
+        writeInt<uint32_t>(stream, size);
+    }
+
+    // Random number generators, in the text form defined by the standard library
+    const std::map<size_t, RandomGenerator>& generators = snapshot.sysHandle.randomGenerators();
+    writeInt<uint32_t>(stream, generators.size());
+    for (const auto& [id, generator] : generators) {
+        std::ostringstream oss;
+        oss << generator;
+        writeInt<uint64_t>(stream, id);
+        writeInt<uint32_t>(stream, oss.str().size());
+        stream.write(oss.str().data(), static_cast<std::streamsize>(oss.str().size()));
+    }
+
+    savePages(stream, state.memory);
+    if (!stream)
+        throw std::runtime_error("Failed to write checkpoint");
+}
+
+
+Checkpoint loadCheckpoint(std::istream& stream) {
+    std::array<char, 4> magic = {};
+    if (!stream.read(magic.data(), magic.size()) || std::string(magic.data(), magic.size()) != "MCKP")
+        throw std::runtime_error("Invalid checkpoint format");
+    if (const uint32_t version = readInt<uint32_t>(stream); version != CHECKPOINT_VERSION)
+        throw std::runtime_error("Unsupported checkpoint version " + std::to_string(version));
+
+    Checkpoint checkpoint;
+    SimulatorSnapshot& snapshot = checkpoint.snapshot;
+    StateSnapshot& state = snapshot.state;
+
+    const uint8_t flags = readInt<uint8_t>(stream);
+    checkpoint.useLittleEndian = flags & 1;
+    snapshot.nativeBlocksValid = flags >> 2 & 1;
+    checkpoint.programFingerprint = readInt<uint64_t>(stream);
+    checkpoint.instructions = readInt<uint64_t>(stream);
+    snapshot.inputPollCountdown = readInt<uint32_t>(stream);
+
+    // Registers
+    for (uint32_t i = 0; i < NUM_CPU_REGISTERS; i++)
+        state.registers[i] = static_cast<int32_t>(readInt<uint32_t>(stream));
+    for (uint32_t i = 0; i < NUM_CP0_REGISTERS; i++)
+        state.cp0[i] = static_cast<int32_t>(readInt<uint32_t>(stream));
+    for (uint32_t i = 0; i < NUM_CP1_REGISTERS; i++)
+        state.cp1[i] = static_cast<int32_t>(readInt<uint32_t>(stream));
+    for (uint32_t i = 0; i < 8; i++)
+        state.cp1.setFlag(i, readInt<uint8_t>(stream) != 0);
+
+    // Heap blocks, which must be sorted and lie between the base and the top of the heap without overlapping
+    const uint32_t heapBase = memSectionOffset(MemSection::HEAP);
+    const uint32_t heapTop = readInt<uint32_t>(stream);
+    if (heapTop < heapBase)
+        throw std::runtime_error("Invalid heap in checkpoint");
+    const uint32_t blockCount = readInt<uint32_t>(stream);
+    if (blockCount > heapTop - heapBase)
+        throw std::runtime_error("Invalid heap in checkpoint");
+
+    std::vector<std::pair<uint32_t, uint32_t>> blocks;
+    uint64_t blockEnd = heapBase;
+    for (uint32_t i = 0; i < blockCount; i++) {
+        const uint32_t address = readInt<uint32_t>(stream);
+        const uint32_t size = readInt<uint32_t>(stream);
+        if (size == 0 || address < blockEnd || static_cast<uint64_t>(address) + size > heapTop)
+            throw std::runtime_error("Invalid heap in checkpoint");
+        blocks.emplace_back(address, size);
+        blockEnd = static_cast<uint64_t>(address) + size;
+    }
+    state.heapAllocator = HeapAllocator(blocks, heapTop);
+
+    // Random number generators
+    std::map<size_t, RandomGenerator> generators;
+    const uint32_t generatorCount = readInt<uint32_t>(stream);
+    for (uint32_t i = 0; i < generatorCount; i++) {
+        const uint64_t id = readInt<uint64_t>(stream);
+        const uint32_t length = readInt<uint32_t>(stream);
+        if (length > MAX_GENERATOR_STATE_SIZE)
+            throw std::runtime_error("Invalid random number generator state in checkpoint");
+        std::string text(length, '\0');
+        if (!stream.read(text.data(), static_cast<std::streamsize>(text.size())))
+            throw std::runtime_error("Unexpected end of checkpoint");
+        std::istringstream iss(text);
+        if (!(iss >> generators[id]))
+            throw std::runtime_error("Invalid random number generator state in checkpoint");
+    }
+    snapshot.sysHandle.setRandomGenerators(std::move(generators));
+
+    state.memory = loadPages(stream);
+    state.memory.outputDirty = flags >> 1 & 1;
+    return checkpoint;
+}
@@ -203,9 +203,15 @@ void execCP1RegImmType(Coproc1RegisterFile& cp1, RegisterFile& registers, const
 }
 
 
-void execCP1ImmType(Coproc1RegisterFile& cp1, RegisterFile& registers, Memory& memory, const uint32_t op,
-                    const uint32_t base, const uint32_t ft, const uint32_t offset) {
+std::optional<ExecTrap> execCP1ImmType(Coproc1RegisterFile& cp1, RegisterFile& registers, Memory& memory,
+                                       const uint32_t op, const uint32_t base, const uint32_t ft,
+                                       const uint32_t offset) {
     const uint32_t address = registers[base] + offset;
+    const bool isStore = op == InstructionCode::FP_SDC1 || op == InstructionCode::FP_SWC1;
+    // Every variant accesses whole words starting at the address
+    if (std::optional<ExecTrap> trap = Memory::alignmentTrap(address, 4, isStore))
+        return trap;
+
     switch (static_cast<InstructionCode>(op)) {
         case InstructionCode::FP_LDC1: {
             if (ft % 2 != 0)
@@ -234,6 +240,7 @@ void execCP1ImmType(Coproc1RegisterFile& cp1, RegisterFile& registers, Memory& m
         default:
             throw std::runtime_error("Unknown Co-Processor 1 immediate type instruction " + std::to_string(op));
     }
+    return std::nullopt;
 }
 
 
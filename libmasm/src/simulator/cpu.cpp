@@ -11,7 +11,7 @@
 #include "assembler/instruction.hpp"
 
 
-std::map<std::string, Register> RegisterFile::nameToIndex = {
+const std::map<std::string, Register> RegisterFile::nameToIndex = {
         {"zero", Register::ZERO}, {"at", Register::AT}, {"v0", Register::V0}, {"v1", Register::V1},
         {"a0", Register::A0},     {"a1", Register::A1}, {"a2", Register::A2}, {"a3", Register::A3},
         {"t0", Register::T0},     {"t1", Register::T1}, {"t2", Register::T2}, {"t3", Register::T3},
@@ -23,10 +23,11 @@ std::map<std::string, Register> RegisterFile::nameToIndex = {
 
 
 int RegisterFile::indexFromName(const std::string& name) {
-    if (!nameToIndex.contains(name))
+    const auto it = nameToIndex.find(name);
+    if (it == nameToIndex.end())
         throw std::runtime_error("Unknown register " + name);
 
-    return static_cast<int>(nameToIndex[name]);
+    return static_cast<int>(it->second);
 }
 
 
@@ -56,14 +57,16 @@ int32_t& RegisterFile::operator[](const uint32_t index) { return registers.at(in
 int32_t RegisterFile::operator[](const Register index) const { return registers.at(static_cast<uint32_t>(index)); }
 int32_t& RegisterFile::operator[](const Register index) { return registers.at(static_cast<uint32_t>(index)); }
 
+int32_t* RegisterFile::data() { return registers.data(); }
 
-void execRType(RegisterFile& registers, const uint32_t funct, const uint32_t rs, const uint32_t rt, const uint32_t rd,
-               const uint32_t shamt) {
+
+std::optional<ExecTrap> execRType(RegisterFile& registers, const uint32_t funct, const uint32_t rs, const uint32_t rt,
+                                  const uint32_t rd, const uint32_t shamt) {
     switch (static_cast<InstructionCode>(funct)) {
         case InstructionCode::ADD: {
             const int64_t extResult = static_cast<int64_t>(registers[rs]) + static_cast<int64_t>(registers[rt]);
             if (extResult > INT32_MAX || extResult < INT32_MIN)
-                throw ExecExcept("Integer overflow in ADD instruction", EXCEPT_CODE::ARITHMETIC_OVERFLOW_EXCEPTION);
+                return ExecTrap{EXCEPT_CODE::ARITHMETIC_OVERFLOW_EXCEPTION, "Integer overflow in ADD instruction"};
             registers[rd] = registers[rs] + registers[rt];
             break;
         }
@@ -75,14 +78,14 @@ void execRType(RegisterFile& registers, const uint32_t funct, const uint32_t rs,
             break;
         case InstructionCode::DIV: {
             if (registers[rt] == 0)
-                throw ExecExcept("Division by zero in DIV instruction", EXCEPT_CODE::DIVIDE_BY_ZERO_EXCEPTION);
+                return ExecTrap{EXCEPT_CODE::DIVIDE_BY_ZERO_EXCEPTION, "Division by zero in DIV instruction"};
             registers[Register::LO] = registers[rs] / registers[rt];
             registers[Register::HI] = registers[rs] % registers[rt];
             break;
         }
         case InstructionCode::DIVU: {
             if (registers[rt] == 0)
-                throw ExecExcept("Division by zero in DIVU instruction", EXCEPT_CODE::DIVIDE_BY_ZERO_EXCEPTION);
+                return ExecTrap{EXCEPT_CODE::DIVIDE_BY_ZERO_EXCEPTION, "Division by zero in DIVU instruction"};
             const uint32_t rsVal = registers[rs];
             const uint32_t rtVal = registers[rt];
             registers[Register::LO] = static_cast<int32_t>(rsVal / rtVal);
@@ -160,7 +163,7 @@ void execRType(RegisterFile& registers, const uint32_t funct, const uint32_t rs,
         case InstructionCode::SUB: {
             const int64_t extResult = static_cast<int64_t>(registers[rs]) - static_cast<int64_t>(registers[rt]);
             if (extResult > INT32_MAX || extResult < INT32_MIN)
-                throw ExecExcept("Integer overflow in SUB instruction", EXCEPT_CODE::ARITHMETIC_OVERFLOW_EXCEPTION);
+                return ExecTrap{EXCEPT_CODE::ARITHMETIC_OVERFLOW_EXCEPTION, "Integer overflow in SUB instruction"};
             registers[rd] = registers[rs] - registers[rt];
             break;
         }
@@ -184,8 +187,8 @@ void execRType(RegisterFile& registers, const uint32_t funct, const uint32_t rs,
             registers[Register::PC] = registers[rs];
             break;
         case InstructionCode::JALR: {
-            // Link current PC to RA register
-            registers[Register::RA] = registers[Register::PC]; // Already incremented
+            // Link current PC to the link register
+            registers[jalrLinkRegister(rd)] = registers[Register::PC]; // Already incremented
             // Jump to the address in rs
             registers[Register::PC] = registers[rs];
             break;
@@ -194,11 +197,13 @@ void execRType(RegisterFile& registers, const uint32_t funct, const uint32_t rs,
             // Should never be reached
             throw std::runtime_error("Unknown R-Type instruction " + std::to_string(funct));
     }
+    return std::nullopt;
 }
 
 
-void execIType(RegisterFile& registers, Memory& memory, const uint32_t opCode, const uint32_t rs, const uint32_t rt,
-               const int32_t immediate) {
+template <std::endian Order>
+std::optional<ExecTrap> execIType(RegisterFile& registers, Memory& memory, const uint32_t opCode, const uint32_t rs,
+                                  const uint32_t rt, const int32_t immediate) {
     int32_t signExtImm = immediate;
     // Sign-extend immediate value
     if (signExtImm & 0x8000)
@@ -208,7 +213,7 @@ void execIType(RegisterFile& registers, Memory& memory, const uint32_t opCode, c
         case InstructionCode::ADDI: {
             const int64_t extResult = static_cast<int64_t>(registers[rs]) + signExtImm;
             if (extResult > INT32_MAX || extResult < INT32_MIN)
-                throw ExecExcept("Integer overflow in ADDI instruction", EXCEPT_CODE::ARITHMETIC_OVERFLOW_EXCEPTION);
+                return ExecTrap{EXCEPT_CODE::ARITHMETIC_OVERFLOW_EXCEPTION, "Integer overflow in ADDI instruction"};
             registers[rt] = registers[rs] + signExtImm;
             break;
         }
@@ -240,20 +245,31 @@ void execIType(RegisterFile& registers, Memory& memory, const uint32_t opCode, c
             break;
         }
         case InstructionCode::LH: {
+            const uint32_t address = registers[rs] + immediate;
+            if (std::optional<ExecTrap> trap = Memory::alignmentTrap(address, 2, false))
+                return trap;
             // Convert to signed for sign extension
-            const int16_t result = memory.halfAt(registers[rs] + immediate);
+            const int16_t result = memory.halfAt<Order>(address);
             registers[rt] = result;
             break;
         }
-        case InstructionCode::LW:
-            registers[rt] = memory.wordAt(registers[rs] + immediate);
+        case InstructionCode::LW: {
+            const uint32_t address = registers[rs] + immediate;
+            if (std::optional<ExecTrap> trap = Memory::alignmentTrap(address, 4, false))
+                return trap;
+            registers[rt] = memory.wordAt<Order>(address);
             break;
+        }
         case InstructionCode::LBU:
             registers[rt] = memory.byteAt(registers[rs] + immediate);
             break;
-        case InstructionCode::LHU:
-            registers[rt] = memory.halfAt(registers[rs] + immediate);
+        case InstructionCode::LHU: {
+            const uint32_t address = registers[rs] + immediate;
+            if (std::optional<ExecTrap> trap = Memory::alignmentTrap(address, 2, false))
+                return trap;
+            registers[rt] = memory.halfAt<Order>(address);
             break;
+        }
         case InstructionCode::LUI:
             // Load upper immediate
             registers[rt] = signExtImm << 16;
@@ -261,12 +277,20 @@ void execIType(RegisterFile& registers, Memory& memory, const uint32_t opCode, c
         case InstructionCode::SB:
             memory.byteTo(registers[rs] + immediate, static_cast<int8_t>(registers[rt]));
             break;
-        case InstructionCode::SH:
-            memory.halfTo(registers[rs] + immediate, static_cast<int16_t>(registers[rt]));
+        case InstructionCode::SH: {
+            const uint32_t address = registers[rs] + immediate;
+            if (std::optional<ExecTrap> trap = Memory::alignmentTrap(address, 2, true))
+                return trap;
+            memory.halfTo<Order>(address, static_cast<int16_t>(registers[rt]));
             break;
-        case InstructionCode::SW:
-            memory.wordTo(registers[rs] + immediate, registers[rt]);
+        }
+        case InstructionCode::SW: {
+            const uint32_t address = registers[rs] + immediate;
+            if (std::optional<ExecTrap> trap = Memory::alignmentTrap(address, 4, true))
+                return trap;
+            memory.wordTo<Order>(address, registers[rt]);
             break;
+        }
         case InstructionCode::BEQ:
             if (registers[rs] == registers[rt])
                 registers[Register::PC] += signExtImm << 2; // Offset is word-aligned, so shift by 2
@@ -279,8 +303,14 @@ void execIType(RegisterFile& registers, Memory& memory, const uint32_t opCode, c
             // Should never be reached
             throw std::runtime_error("Unknown I-Type instruction " + std::to_string(opCode));
     }
+    return std::nullopt;
 }
 
+template std::optional<ExecTrap> execIType<std::endian::big>(RegisterFile&, Memory&, uint32_t, uint32_t, uint32_t,
+                                                            int32_t);
+template std::optional<ExecTrap> execIType<std::endian::little>(RegisterFile&, Memory&, uint32_t, uint32_t, uint32_t,
+                                                               int32_t);
+
 
 void execJType(RegisterFile& registers, const uint32_t opCode, const uint32_t address) {
     if (opCode == InstructionCode::JAL) {
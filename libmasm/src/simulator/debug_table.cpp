@@ -0,0 +1,71 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/debug_table.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <masm/assembler/memory.hpp>
+
+#include "util/conversion.hpp"
+
+
+DebugTable::DebugTable(const std::map<uint32_t, DebugInfo>& debugInfo) : entries(debugInfo.begin(), debugInfo.end()) {
+    indexSection(memSectionOffset(MemSection::TEXT), TEXT_SEC_END);
+    indexSection(memSectionOffset(MemSection::KTEXT), memSectionOffset(MemSection::KDATA));
+}
+
+
+void DebugTable::indexSection(const uint32_t lower, const uint32_t upper) {
+    const auto first = std::ranges::lower_bound(entries, lower, {}, &std::pair<uint32_t, DebugInfo>::first);
+    const auto last = std::ranges::lower_bound(entries, upper, {}, &std::pair<uint32_t, DebugInfo>::first);
+    if (first == last)
+        return;
+
+    DenseRange range;
+    range.base = first->first & ~0x3u;
+    range.slots.assign(((last - 1)->first - range.base) / 4 + 1, NO_ENTRY);
+    for (auto it = first; it != last; ++it)
+        // Only instructions are looked up by PC, which is always word-aligned
+        if (it->first % 4 == 0)
+            range.slots[(it->first - range.base) / 4] = static_cast<uint32_t>(it - entries.begin());
+    denseRanges.push_back(std::move(range));
+}
+
+
+const DebugInfo* DebugTable::find(const uint32_t addr) const {
+    for (const DenseRange& range : denseRanges) {
+        if (addr < range.base || addr % 4 != 0)
+            continue;
+        const uint32_t slot = (addr - range.base) / 4;
+        if (slot >= range.slots.size())
+            continue;
+        return range.slots[slot] == NO_ENTRY ? nullptr : &entries[range.slots[slot]].second;
+    }
+
+    // Fall back to a binary search for data and unaligned addresses
+    const auto it = std::ranges::lower_bound(entries, addr, {}, &std::pair<uint32_t, DebugInfo>::first);
+    if (it == entries.end() || it->first != addr)
+        return nullptr;
+    return &it->second;
+}
+
+
+bool DebugTable::contains(const uint32_t addr) const { return find(addr) != nullptr; }
+
+
+const DebugInfo& DebugTable::at(const uint32_t addr) const {
+    const DebugInfo* info = find(addr);
+    if (info == nullptr)
+        throw std::out_of_range("No debug info at " + i32ToHexString(addr));
+    return *info;
+}
+
+
+DebugTable::const_iterator DebugTable::begin() const { return entries.begin(); }
+DebugTable::const_iterator DebugTable::end() const { return entries.end(); }
+
+size_t DebugTable::size() const { return entries.size(); }
+bool DebugTable::empty() const { return entries.empty(); }
@@ -0,0 +1,83 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/decoder.hpp>
+
+
+DecodedInstruction decodeInstruction(const int32_t instruction) {
+    DecodedInstruction decoded;
+    decoded.opCode = static_cast<uint8_t>(instruction >> 26 & 0x3F);
+    decoded.rs = static_cast<uint8_t>(instruction >> 21 & 0x1F);
+    decoded.rt = static_cast<uint8_t>(instruction >> 16 & 0x1F);
+    decoded.rd = static_cast<uint8_t>(instruction >> 11 & 0x1F);
+    decoded.shamt = static_cast<uint8_t>(instruction >> 6 & 0x1F);
+    decoded.funct = static_cast<uint8_t>(instruction & 0x3F);
+    decoded.immediate = instruction & 0xFFFF;
+    decoded.target = instruction & 0x3FFFFFF;
+
+    const uint32_t opCode = decoded.opCode;
+    if (instruction == 0x0000000C)
+        decoded.format = InstrFormat::SYSCALL;
+    else if (instruction == 0x42000018)
+        decoded.format = InstrFormat::ERET;
+    else if (opCode == 0x10)
+        decoded.format = InstrFormat::CP0;
+    else if (opCode == 0x11) {
+        // Used to distinguish Co-Processor 1 instruction types
+        const uint32_t nextFive = decoded.rs;
+        if (nextFive == 0x08)
+            decoded.format = InstrFormat::CP1_COND_IMM;
+        else if (nextFive == 0x00 || nextFive == 0x04)
+            decoded.format = InstrFormat::CP1_REG_IMM;
+        else if ((decoded.funct >> 4 & 0x03) == 0x03)
+            decoded.format = InstrFormat::CP1_COND;
+        else
+            decoded.format = InstrFormat::CP1_REG;
+    } else if (opCode == 0x35 || opCode == 0x31 || opCode == 0x3D || opCode == 0x39)
+        decoded.format = InstrFormat::CP1_IMM;
+    else if (opCode == 0x00 && decoded.funct == 0x0D)
+        decoded.format = InstrFormat::BREAK;
+    else if (opCode == 0x00)
+        decoded.format = InstrFormat::R_TYPE;
+    else if (opCode == 0x02 || opCode == 0x03)
+        decoded.format = InstrFormat::J_TYPE;
+    else
+        decoded.format = InstrFormat::I_TYPE;
+
+    return decoded;
+}
+
+
+const DecodedInstruction& DecodeCache::fetch(Memory& memory, const uint32_t address) {
+    const uint32_t pageNum = address >> MEM_PAGE_BITS;
+    if (lastPage == nullptr || lastPageNum != pageNum) {
+        const auto [it, inserted] = pages.try_emplace(pageNum);
+        // Have any writes to a newly decoded page reported back for invalidation
+        if (inserted)
+            memory.watchPage(address);
+        lastPageNum = pageNum;
+        lastPage = &it->second;
+    }
+
+    const uint32_t slot = (address & (MEM_PAGE_SIZE - 1)) >> 2;
+    DecodedInstruction& entry = lastPage->entries[slot];
+    if (!lastPage->decoded.test(slot)) {
+        entry = decodeInstruction(memory.wordAt(address));
+        lastPage->decoded.set(slot);
+    }
+    return entry;
+}
+
+
+void DecodeCache::invalidate(const uint32_t address) {
+    const auto it = pages.find(address >> MEM_PAGE_BITS);
+    if (it != pages.end())
+        it->second.decoded.reset((address & (MEM_PAGE_SIZE - 1)) >> 2);
+}
+
+
+void DecodeCache::clear() {
+    pages.clear();
+    lastPage = nullptr;
+}
@@ -0,0 +1,136 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/file_table.hpp>
+
+#include <ranges>
+#include <stdexcept>
+
+
+std::optional<std::filesystem::path> FileTable::resolve(const std::string& name) const {
+    if (!sandbox || name.empty())
+        return std::nullopt;
+    const std::filesystem::path relative(name);
+    if (relative.has_root_path())
+        return std::nullopt;
+
+    // Parent references are resolved by name, which is only sound because no symbolic link is followed below
+    const std::filesystem::path normal = relative.lexically_normal();
+    if (normal.empty() || *normal.begin() == ".." || normal == ".")
+        return std::nullopt;
+
+    // A symbolic link may point outside of the sandbox, even one that does not yet lead to a file, so every existing
+    // component of the path must be a real file or directory
+    std::filesystem::path resolved = *sandbox;
+    for (const std::filesystem::path& component : normal) {
+        resolved /= component;
+        std::error_code error;
+        const std::filesystem::file_status status = std::filesystem::symlink_status(resolved, error);
+        if (status.type() == std::filesystem::file_type::not_found)
+            continue;
+        if (error || std::filesystem::is_symlink(status))
+            return std::nullopt;
+    }
+    return resolved;
+}
+
+
+void FileTable::setSandbox(const std::optional<std::filesystem::path>& directory) {
+    closeAll();
+    if (!directory) {
+        sandbox.reset();
+        return;
+    }
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(*directory, error))
+        throw std::runtime_error("Sandbox directory does not exist: " + directory->string());
+    sandbox = std::filesystem::canonical(*directory);
+}
+
+
+const std::optional<std::filesystem::path>& FileTable::sandboxDirectory() const { return sandbox; }
+
+
+int32_t FileTable::open(const std::string& name, const int32_t flags) {
+    std::ios::openmode mode = std::ios::binary;
+    switch (static_cast<FileOpenFlags>(flags)) {
+        case FileOpenFlags::READ:
+            mode |= std::ios::in;
+            break;
+        case FileOpenFlags::WRITE:
+            mode |= std::ios::out | std::ios::trunc;
+            break;
+        case FileOpenFlags::APPEND:
+            mode |= std::ios::out | std::ios::app;
+            break;
+        default:
+            return -1;
+    }
+
+    const std::optional<std::filesystem::path> path = resolve(name);
+    std::error_code error;
+    if (!path || files.size() >= MAX_OPEN_FILES || std::filesystem::is_directory(*path, error))
+        return -1;
+
+    OpenFile file;
+    file.stream.open(*path, mode);
+    if (!file.stream.is_open())
+        return -1;
+    file.writable = (mode & std::ios::out) != 0;
+
+    // Hand out the lowest descriptor that is not in use
+    int32_t descriptor = FIRST_FILE_DESCRIPTOR;
+    for (const int32_t open : files | std::views::keys) {
+        if (open != descriptor)
+            break;
+        descriptor++;
+    }
+    files.emplace(descriptor, std::move(file));
+    return descriptor;
+}
+
+
+int32_t FileTable::read(const int32_t descriptor, const std::span<char> buffer) {
+    const auto it = files.find(descriptor);
+    if (it == files.end() || it->second.writable)
+        return -1;
+
+    std::fstream& stream = it->second.stream;
+    // Reaching the end of the file leaves the stream failed, but later reads are still answered
+    stream.clear();
+    stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<int32_t>(stream.gcount());
+}
+
+
+int32_t FileTable::write(const int32_t descriptor, const std::span<const char> data) {
+    const auto it = files.find(descriptor);
+    if (it == files.end() || !it->second.writable)
+        return -1;
+
+    std::fstream& stream = it->second.stream;
+    stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (stream.fail()) {
+        stream.clear();
+        return -1;
+    }
+    return static_cast<int32_t>(data.size());
+}
+
+
+void FileTable::close(const int32_t descriptor) { files.erase(descriptor); }
+
+
+void FileTable::closeAll() { files.clear(); }
+
+
+void FileTable::flush() {
+    for (OpenFile& file : files | std::views::values)
+        if (file.writable)
+            file.stream.flush();
+}
+
+
+size_t FileTable::openCount() const { return files.size(); }
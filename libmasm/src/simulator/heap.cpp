@@ -5,58 +5,156 @@
 #include <masm/simulator/heap.hpp>
 
 #include <masm/exceptions.hpp>
-#include <numeric>
 
 
 const uint32_t HEAP_BASE = memSectionOffset(MemSection::HEAP);
 
 
-uint32_t HeapAllocator::nextFree(const uint32_t size) const {
+HeapAllocator::HeapAllocator(const std::vector<std::pair<uint32_t, uint32_t>>& blocks, const uint32_t top) :
+    heapPointer(top) {
     uint32_t ptr = HEAP_BASE;
+    for (const auto& [address, size] : blocks) {
+        if (address > ptr)
+            addFree(ptr, address - ptr);
+        allocatedBlocks.emplace_hint(allocatedBlocks.end(), address, size);
+        allocatedBytes += size;
+        ptr = address + size;
+    }
+    if (top > ptr)
+        addFree(ptr, top - ptr);
+}
 
-    // Walk up through all allocated blocks to find a large enough free gap
-    // If no gap exists, the heap grows up towards the stack
-    for (size_t i = 0; i < blockAddresses.size(); i++) {
-        const uint32_t blkAddr = blockAddresses[i];
-        const uint32_t blkSize = blockSizes[i];
 
-        // Check if there is enough space between the pointer and the next block
-        if (blkAddr - ptr >= size)
-            return ptr;
+void HeapAllocator::addFree(const uint32_t address, const uint32_t size) {
+    freeBlocks.emplace(address, size);
+    freeBySize.emplace(size, address);
+}
 
-        // Move pointer immediately after this block
-        ptr = blkAddr + blkSize;
+
+void HeapAllocator::removeFree(const std::map<uint32_t, uint32_t>::iterator it) {
+    freeBySize.erase({it->second, it->first});
+    freeBlocks.erase(it);
+}
+
+
+void HeapAllocator::release(uint32_t address, uint32_t size) {
+    // Merge with the free block directly after this one
+    if (const auto next = freeBlocks.find(address + size); next != freeBlocks.end()) {
+        size += next->second;
+        removeFree(next);
+    }
+    // Merge with the free block directly before this one
+    if (auto prev = freeBlocks.lower_bound(address); prev != freeBlocks.begin()) {
+        --prev;
+        if (prev->first + prev->second == address) {
+            address = prev->first;
+            size += prev->second;
+            removeFree(prev);
+        }
     }
 
-    return ptr;
+    // Free space at the top of the heap is given back, so the heap never holds a free block at its top
+    if (address + size == heapPointer)
+        heapPointer = address;
+    else
+        addFree(address, size);
 }
 
 
-uint32_t HeapAllocator::allocate(const uint32_t size) {
+void HeapAllocator::grow(const uint64_t top, const uint32_t limit) {
+    if (top > limit)
+        throw ExecExcept("Out of Memory", EXCEPT_CODE::SYSCALL_EXCEPTION);
+    heapPointer = static_cast<uint32_t>(top);
+}
+
+
+uint32_t HeapAllocator::allocate(const uint32_t size, const uint32_t limit) {
     if (size == 0)
         throw ExecExcept("Cannot allocate zero bytes", EXCEPT_CODE::SYSCALL_EXCEPTION);
 
-    const uint32_t address = nextFree(size);
-    // Grow heap pointer if more memory is needed
-    if (address + size > heapPointer)
-        heapPointer = address + size;
-
-    // Insert new block sequentially before the block with the next greatest address
-    for (size_t i = 0; i < blockAddresses.size(); i++) {
-        if (blockAddresses[i] > address) {
-            blockAddresses.insert(blockAddresses.begin() + static_cast<int32_t>(i), address);
-            blockSizes.insert(blockSizes.begin() + static_cast<int32_t>(i), size);
-            return address;
-        }
+    uint32_t address;
+    // Take the smallest free block that fits, preferring the lowest address among blocks of the same size
+    if (const auto fit = freeBySize.lower_bound({size, 0}); fit != freeBySize.end()) {
+        const auto [blockSize, blockAddress] = *fit;
+        removeFree(freeBlocks.find(blockAddress));
+        if (blockSize > size)
+            addFree(blockAddress + size, blockSize - size);
+        address = blockAddress;
+    } else {
+        // The heap grows up towards the stack if no free block is large enough
+        address = heapPointer;
+        grow(static_cast<uint64_t>(heapPointer) + size, limit);
     }
 
-    // Push first block to the heap if it is empty
-    blockAddresses.push_back(address);
-    blockSizes.push_back(size);
+    allocatedBlocks.emplace(address, size);
+    allocatedBytes += size;
     return address;
 }
 
 
-size_t HeapAllocator::allocated() const { return std::accumulate(blockSizes.begin(), blockSizes.end(), 0U); }
+void HeapAllocator::free(const uint32_t address) {
+    const auto it = allocatedBlocks.find(address);
+    if (it == allocatedBlocks.end())
+        throw ExecExcept("Cannot free unallocated address", EXCEPT_CODE::SYSCALL_EXCEPTION);
+
+    const uint32_t size = it->second;
+    allocatedBlocks.erase(it);
+    allocatedBytes -= size;
+    release(address, size);
+}
+
+
+uint32_t HeapAllocator::reallocate(const uint32_t address, const uint32_t size, const uint32_t limit) {
+    const auto it = allocatedBlocks.find(address);
+    if (it == allocatedBlocks.end())
+        throw ExecExcept("Cannot reallocate unallocated address", EXCEPT_CODE::SYSCALL_EXCEPTION);
+    if (size == 0)
+        throw ExecExcept("Cannot allocate zero bytes", EXCEPT_CODE::SYSCALL_EXCEPTION);
+
+    const uint32_t oldSize = it->second;
+    const uint32_t end = address + oldSize;
+    if (size <= oldSize) {
+        // Shrink in place, returning the tail of the block
+        it->second = size;
+        allocatedBytes -= oldSize - size;
+        if (size < oldSize)
+            release(address + size, oldSize - size);
+        return address;
+    }
+
+    const uint32_t extra = size - oldSize;
+    if (end == heapPointer) {
+        // Grow in place at the top of the heap
+        grow(static_cast<uint64_t>(address) + size, limit);
+    } else if (const auto next = freeBlocks.find(end); next != freeBlocks.end() && next->second >= extra) {
+        // Grow in place into the free block that follows
+        const uint32_t nextSize = next->second;
+        removeFree(next);
+        if (nextSize > extra)
+            addFree(end + extra, nextSize - extra);
+    } else {
+        // Move the block, which stays allocated until the new block is chosen so that the two never overlap
+        const uint32_t moved = allocate(size, limit);
+        free(address);
+        return moved;
+    }
+
+    it->second = size;
+    allocatedBytes += extra;
+    return address;
+}
+
+
+uint32_t HeapAllocator::sizeOf(const uint32_t address) const {
+    const auto it = allocatedBlocks.find(address);
+    return it != allocatedBlocks.end() ? it->second : 0;
+}
+
+
+size_t HeapAllocator::allocated() const { return allocatedBytes; }
 
 uint32_t HeapAllocator::top() const { return heapPointer; }
+
+std::vector<std::pair<uint32_t, uint32_t>> HeapAllocator::blocks() const {
+    return {allocatedBlocks.begin(), allocatedBlocks.end()};
+}
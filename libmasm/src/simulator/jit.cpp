@@ -0,0 +1,614 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/jit.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include <masm/simulator/cpu.hpp>
+
+#include "assembler/instruction.hpp"
+
+#if defined(__x86_64__) && defined(__unix__)
+#define MASM_JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+
+/**
+ * Checks whether a guest access must be left to the interpreter
+ * @param address The address of the access
+ * @param width The width of the access in bytes
+ * @return True if the access is misaligned or touches MMIO
+ */
+static bool needsInterpreter(const uint32_t address, const uint32_t width) {
+    return address % width != 0 || address >= memSectionOffset(MemSection::MMIO);
+}
+
+
+uint32_t jitLoad(JitContext* context, const uint32_t address, int32_t* dest, const uint32_t opCode) {
+    Memory& memory = *context->memory;
+    try {
+        switch (static_cast<InstructionCode>(opCode)) {
+            case InstructionCode::LW:
+                if (needsInterpreter(address, 4))
+                    return ACCESS_FALLBACK;
+                *dest = memory.wordAt(address);
+                break;
+            case InstructionCode::LH:
+                if (needsInterpreter(address, 2))
+                    return ACCESS_FALLBACK;
+                *dest = static_cast<int16_t>(memory.halfAt(address));
+                break;
+            case InstructionCode::LHU:
+                if (needsInterpreter(address, 2))
+                    return ACCESS_FALLBACK;
+                *dest = memory.halfAt(address);
+                break;
+            case InstructionCode::LB:
+                if (needsInterpreter(address, 1))
+                    return ACCESS_FALLBACK;
+                *dest = static_cast<int8_t>(memory.byteAt(address));
+                break;
+            case InstructionCode::LBU:
+                if (needsInterpreter(address, 1))
+                    return ACCESS_FALLBACK;
+                *dest = memory.byteAt(address);
+                break;
+            default:
+                return ACCESS_FALLBACK;
+        }
+    } catch (...) {
+        // Exceptions cannot unwind through compiled code, so let the interpreter raise them
+        return ACCESS_FALLBACK;
+    }
+    return ACCESS_DONE;
+}
+
+
+uint32_t jitStore(JitContext* context, const uint32_t address, const int32_t value, const uint32_t opCode) {
+    Memory& memory = *context->memory;
+    try {
+        switch (static_cast<InstructionCode>(opCode)) {
+            case InstructionCode::SW:
+                if (needsInterpreter(address, 4))
+                    return ACCESS_FALLBACK;
+                memory.wordTo(address, value);
+                break;
+            case InstructionCode::SH:
+                if (needsInterpreter(address, 2))
+                    return ACCESS_FALLBACK;
+                memory.halfTo(address, static_cast<int16_t>(value));
+                break;
+            case InstructionCode::SB:
+                if (needsInterpreter(address, 1))
+                    return ACCESS_FALLBACK;
+                memory.byteTo(address, static_cast<int8_t>(value));
+                break;
+            default:
+                return ACCESS_FALLBACK;
+        }
+    } catch (...) {
+        return ACCESS_FALLBACK;
+    }
+    return context->blockCache->isStale() ? ACCESS_STALE : ACCESS_DONE;
+}
+
+
+#ifdef MASM_JIT_SUPPORTED
+
+/**
+ * A minimal x86-64 encoder for the instructions used by compiled blocks.  Guest registers live in memory addressed
+ * by rbx, and the JIT context is kept in r12
+ */
+class Emitter {
+    std::vector<uint8_t> bytes;
+
+    void imm32(const uint32_t value) {
+        for (int i = 0; i < 4; i++)
+            bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    /**
+     * Emits an opcode with a [rbx + disp32] memory operand
+     * @param opcode The opcode bytes
+     * @param reg The register field of the ModRM byte
+     * @param guestReg The guest register to address
+     */
+    void rbxOperand(const std::initializer_list<uint8_t> opcode, const uint8_t reg, const uint32_t guestReg) {
+        bytes.insert(bytes.end(), opcode);
+        bytes.push_back(static_cast<uint8_t>(0x83 | reg << 3));
+        imm32(guestReg * 4);
+    }
+
+public:
+    static constexpr uint8_t EAX = 0;
+    static constexpr uint8_t ECX = 1;
+    static constexpr uint8_t EDX = 2;
+    static constexpr uint8_t ESI = 6;
+
+    [[nodiscard]] const std::vector<uint8_t>& code() const { return bytes; }
+    [[nodiscard]] size_t size() const { return bytes.size(); }
+
+    void raw(const std::initializer_list<uint8_t> code) { bytes.insert(bytes.end(), code); }
+
+    void loadGuest(const uint8_t reg, const uint32_t guestReg) { rbxOperand({0x8B}, reg, guestReg); }
+    void storeGuest(const uint32_t guestReg) { rbxOperand({0x89}, EAX, guestReg); }
+    void storeGuestImm(const uint32_t guestReg, const uint32_t value) {
+        rbxOperand({0xC7}, 0, guestReg);
+        imm32(value);
+    }
+    void cmpGuest(const uint32_t guestReg) { rbxOperand({0x3B}, EAX, guestReg); }
+    void leaGuest(const uint8_t reg, const uint32_t guestReg) { rbxOperand({0x48, 0x8D}, reg, guestReg); }
+
+    /**
+     * Emits an ALU operation of eax with a 32-bit immediate, using the short eax encoding
+     * @param opcode The one byte opcode of the eax, imm32 form
+     * @param value The immediate value
+     */
+    void aluEaxImm(const uint8_t opcode, const uint32_t value) {
+        bytes.push_back(opcode);
+        imm32(value);
+    }
+
+    void movEaxImm(const uint32_t value) { aluEaxImm(0xB8, value); }
+
+    void addEsiImm(const uint32_t value) {
+        raw({0x81, 0xC6});
+        imm32(value);
+    }
+
+    void callAbsolute(const uint64_t address) {
+        // mov rax, imm64; call rax
+        raw({0x48, 0xB8});
+        imm32(static_cast<uint32_t>(address));
+        imm32(static_cast<uint32_t>(address >> 32));
+        raw({0xFF, 0xD0});
+    }
+
+    /**
+     * Emits a jump with a 32-bit displacement to be patched later
+     * @param opcode The opcode bytes of the jump
+     * @return The position of the displacement
+     */
+    size_t jumpRel32(const std::initializer_list<uint8_t> opcode) {
+        raw(opcode);
+        const size_t position = bytes.size();
+        imm32(0);
+        return position;
+    }
+
+    /**
+     * Points a previously emitted jump at the current position
+     * @param position The position of the jump displacement
+     */
+    void patchHere(const size_t position) { patch(position, bytes.size()); }
+
+    void patch(const size_t position, const size_t target) {
+        const auto displacement = static_cast<uint32_t>(static_cast<int64_t>(target) - (position + 4));
+        std::memcpy(bytes.data() + position, &displacement, 4);
+    }
+};
+
+
+/**
+ * A point where compiled code returns to the interpreter early
+ */
+struct SideExit {
+    /**
+     * The position of the jump displacement that leads to the exit
+     */
+    size_t jump;
+
+    /**
+     * The guest address to resume execution at
+     */
+    uint32_t pc;
+
+    /**
+     * The number of guest instructions executed before the exit
+     */
+    uint32_t executed;
+};
+
+
+/**
+ * Emits a register-only R-Type instruction
+ * @param emit The emitter to write to
+ * @param instr The decoded instruction
+ * @param exits The side exits to add an overflow exit to
+ * @param address The address of the instruction
+ * @param executed The number of instructions executed before this one
+ * @return True if the instruction was emitted, false if it is not supported
+ */
+static bool emitRType(Emitter& emit, const DecodedInstruction& instr, std::vector<SideExit>& exits,
+                      const uint32_t address, const uint32_t executed) {
+    using E = Emitter;
+    switch (static_cast<InstructionCode>(instr.funct)) {
+        case InstructionCode::ADD:
+        case InstructionCode::SUB:
+            emit.loadGuest(E::EAX, instr.rs);
+            emit.loadGuest(E::ECX, instr.rt);
+            emit.raw({instr.funct == InstructionCode::ADD ? uint8_t{0x01} : uint8_t{0x29}, 0xC8});
+            // Leave overflowing instructions to the interpreter, which raises the trap
+            exits.push_back({emit.jumpRel32({0x0F, 0x80}), address, executed});
+            break;
+        case InstructionCode::ADDU:
+        case InstructionCode::SUBU:
+        case InstructionCode::AND:
+        case InstructionCode::OR:
+        case InstructionCode::XOR:
+        case InstructionCode::NOR: {
+            emit.loadGuest(E::EAX, instr.rs);
+            emit.loadGuest(E::ECX, instr.rt);
+            uint8_t opcode = 0x09;
+            if (instr.funct == InstructionCode::ADDU)
+                opcode = 0x01;
+            else if (instr.funct == InstructionCode::SUBU)
+                opcode = 0x29;
+            else if (instr.funct == InstructionCode::AND)
+                opcode = 0x21;
+            else if (instr.funct == InstructionCode::XOR)
+                opcode = 0x31;
+            emit.raw({opcode, 0xC8});
+            if (instr.funct == InstructionCode::NOR)
+                emit.raw({0xF7, 0xD0});
+            break;
+        }
+        case InstructionCode::SLT:
+        case InstructionCode::SLTU:
+            emit.loadGuest(E::EAX, instr.rs);
+            emit.loadGuest(E::ECX, instr.rt);
+            emit.raw({0x39, 0xC8});
+            emit.raw({0x0F, instr.funct == InstructionCode::SLT ? uint8_t{0x9C} : uint8_t{0x92}, 0xC0});
+            emit.raw({0x0F, 0xB6, 0xC0});
+            break;
+        case InstructionCode::SLL:
+        case InstructionCode::SRL:
+        case InstructionCode::SRA:
+            // A zero arithmetic shift is left to the interpreter's sign-extension logic
+            if (instr.funct == InstructionCode::SRA && instr.shamt == 0)
+                return false;
+            emit.loadGuest(E::EAX, instr.rt);
+            // Guest registers are signed, so right shifts are arithmetic
+            emit.raw({0xC1, instr.funct == InstructionCode::SLL ? uint8_t{0xE0} : uint8_t{0xF8}, instr.shamt});
+            break;
+        case InstructionCode::SLLV:
+        case InstructionCode::SRLV:
+            emit.loadGuest(E::ECX, instr.rs);
+            emit.loadGuest(E::EAX, instr.rt);
+            emit.raw({0xD3, instr.funct == InstructionCode::SLLV ? uint8_t{0xE0} : uint8_t{0xF8}});
+            break;
+        case InstructionCode::MFHI:
+        case InstructionCode::MFLO:
+            emit.loadGuest(E::EAX, static_cast<uint32_t>(instr.funct == InstructionCode::MFHI ? Register::HI
+                                                                                             : Register::LO));
+            break;
+        case InstructionCode::MTHI:
+        case InstructionCode::MTLO:
+            emit.loadGuest(E::EAX, instr.rs);
+            emit.storeGuest(static_cast<uint32_t>(instr.funct == InstructionCode::MTHI ? Register::HI : Register::LO));
+            return true;
+        default:
+            return false;
+    }
+    emit.storeGuest(instr.rd);
+    return true;
+}
+
+
+/**
+ * Emits a non-branching I-Type instruction
+ * @param emit The emitter to write to
+ * @param instr The decoded instruction
+ * @param exits The side exits to add fallback exits to
+ * @param address The address of the instruction
+ * @param executed The number of instructions executed before this one
+ * @return True if the instruction was emitted, false if it is not supported
+ */
+static bool emitIType(Emitter& emit, const DecodedInstruction& instr, std::vector<SideExit>& exits,
+                      const uint32_t address, const uint32_t executed) {
+    using E = Emitter;
+    const auto immediate = static_cast<uint32_t>(instr.immediate);
+    const auto signExtImm = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(instr.immediate)));
+    switch (static_cast<InstructionCode>(instr.opCode)) {
+        case InstructionCode::ADDI:
+            emit.loadGuest(E::EAX, instr.rs);
+            emit.aluEaxImm(0x05, signExtImm);
+            exits.push_back({emit.jumpRel32({0x0F, 0x80}), address, executed});
+            break;
+        case InstructionCode::ADDIU:
+            emit.loadGuest(E::EAX, instr.rs);
+            emit.aluEaxImm(0x05, signExtImm);
+            break;
+        case InstructionCode::ANDI:
+            emit.loadGuest(E::EAX, instr.rs);
+            emit.aluEaxImm(0x25, immediate);
+            break;
+        case InstructionCode::ORI:
+            emit.loadGuest(E::EAX, instr.rs);
+            emit.aluEaxImm(0x0D, immediate);
+            break;
+        case InstructionCode::XORI:
+            emit.loadGuest(E::EAX, instr.rs);
+            emit.aluEaxImm(0x35, immediate);
+            break;
+        case InstructionCode::SLTI:
+        case InstructionCode::SLTIU:
+            emit.loadGuest(E::EAX, instr.rs);
+            emit.aluEaxImm(0x3D, signExtImm);
+            emit.raw({0x0F, instr.opCode == InstructionCode::SLTI ? uint8_t{0x9C} : uint8_t{0x92}, 0xC0});
+            emit.raw({0x0F, 0xB6, 0xC0});
+            break;
+        case InstructionCode::LUI:
+            emit.storeGuestImm(instr.rt, immediate << 16);
+            return true;
+        case InstructionCode::LW:
+        case InstructionCode::LH:
+        case InstructionCode::LHU:
+        case InstructionCode::LB:
+        case InstructionCode::LBU:
+        case InstructionCode::SW:
+        case InstructionCode::SH:
+        case InstructionCode::SB: {
+            const bool isStore = instr.opCode == InstructionCode::SW || instr.opCode == InstructionCode::SH ||
+                                 instr.opCode == InstructionCode::SB;
+            // Helper arguments: rdi = context, esi = address, rdx = destination or value, ecx = opcode
+            emit.raw({0x4C, 0x89, 0xE7});
+            emit.loadGuest(E::ESI, instr.rs);
+            // The interpreter adds the raw immediate to the base register
+            emit.addEsiImm(immediate);
+            if (isStore)
+                emit.loadGuest(E::EDX, instr.rt);
+            else
+                emit.leaGuest(E::EDX, instr.rt);
+            emit.raw({0xB9});
+            emit.raw({instr.opCode, 0, 0, 0});
+            emit.callAbsolute(isStore ? reinterpret_cast<uint64_t>(&jitStore) : reinterpret_cast<uint64_t>(&jitLoad));
+            // cmp eax, ACCESS_FALLBACK
+            emit.raw({0x83, 0xF8, ACCESS_FALLBACK});
+            exits.push_back({emit.jumpRel32({0x0F, 0x84}), address, executed});
+            if (isStore) {
+                emit.raw({0x83, 0xF8, ACCESS_STALE});
+                exits.push_back({emit.jumpRel32({0x0F, 0x84}), address + 4, executed + 1});
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+    emit.storeGuest(instr.rt);
+    return true;
+}
+
+
+/**
+ * Emits a conditional branch on eax against a guest register, setting the program counter for both outcomes
+ * @param emit The emitter to write to
+ * @param rt The guest register to compare eax against
+ * @param isBne Whether the branch is taken on inequality rather than equality
+ * @param fallthrough The address after the branch
+ * @param target The address of the branch target
+ */
+static void emitBranch(Emitter& emit, const uint32_t rt, const bool isBne, const uint32_t fallthrough,
+                       const uint32_t target) {
+    const auto pc = static_cast<uint32_t>(Register::PC);
+    emit.storeGuestImm(pc, fallthrough);
+    emit.cmpGuest(rt);
+    // Skip setting the target when the branch is not taken
+    const size_t skip = emit.jumpRel32({0x0F, isBne ? uint8_t{0x84} : uint8_t{0x85}});
+    emit.storeGuestImm(pc, target);
+    emit.patchHere(skip);
+}
+
+
+/**
+ * Emits a block-ending jump or branch instruction
+ * @param emit The emitter to write to
+ * @param instr The decoded instruction
+ * @param address The address of the instruction
+ * @return True if the instruction was emitted, false if it is not supported
+ */
+static bool emitTerminator(Emitter& emit, const DecodedInstruction& instr, const uint32_t address) {
+    using E = Emitter;
+    const auto pc = static_cast<uint32_t>(Register::PC);
+    const auto ra = static_cast<uint32_t>(Register::RA);
+    const uint32_t next = address + 4;
+    if (instr.format == InstrFormat::J_TYPE) {
+        if (instr.opCode == InstructionCode::JAL)
+            emit.storeGuestImm(ra, next);
+        emit.storeGuestImm(pc, (next & 0xF0000000) | instr.target << 2);
+        return true;
+    }
+    if (instr.format == InstrFormat::R_TYPE) {
+        // The link register is written before the target is read, as in the interpreter
+        if (instr.funct == InstructionCode::JALR)
+            emit.storeGuestImm(jalrLinkRegister(instr.rd), next);
+        emit.loadGuest(E::EAX, instr.rs);
+        emit.storeGuest(pc);
+        return true;
+    }
+    if (instr.format == InstrFormat::I_TYPE) {
+        const auto offset = static_cast<uint32_t>(static_cast<int16_t>(instr.immediate) * 4);
+        emit.loadGuest(E::EAX, instr.rs);
+        emitBranch(emit, instr.rt, instr.opCode == InstructionCode::BNE, next, next + offset);
+        return true;
+    }
+    return false;
+}
+
+#endif
+
+
+JitCompiler::JitCompiler(const size_t codeCacheSize) : cacheSize(codeCacheSize) {
+#ifdef MASM_JIT_SUPPORTED
+    void* mapping = mmap(nullptr, cacheSize, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping != MAP_FAILED)
+        codeCache = static_cast<std::byte*>(mapping);
+#endif
+}
+
+
+JitCompiler::~JitCompiler() {
+#ifdef MASM_JIT_SUPPORTED
+    if (codeCache != nullptr)
+        munmap(codeCache, cacheSize);
+#endif
+}
+
+
+bool JitCompiler::isAvailable() {
+#ifdef MASM_JIT_SUPPORTED
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+CompiledBlock JitCompiler::lookup(const TranslatedBlock& block, const uint32_t address) {
+    if (codeCache == nullptr)
+        return nullptr;
+    if (stale)
+        clear();
+
+    Entry& entry = entries[address];
+    if (entry.code != nullptr || entry.failed)
+        return entry.code;
+    if (++entry.hits < JIT_HOT_THRESHOLD)
+        return nullptr;
+
+    // Compiling may flush the cache along with every entry, so the entry is looked up again
+    const CompiledBlock code = compile(block);
+    Entry& compiled = entries[address];
+    compiled.code = code;
+    compiled.failed = code == nullptr;
+    return code;
+}
+
+
+CompiledBlock JitCompiler::compile([[maybe_unused]] const TranslatedBlock& block) {
+#ifdef MASM_JIT_SUPPORTED
+    Emitter emit;
+    std::vector<SideExit> exits;
+    const auto pc = static_cast<uint32_t>(Register::PC);
+
+    // push rbx; push r12; sub rsp, 8; mov rbx, rdi; mov r12, rsi
+    emit.raw({0x53, 0x41, 0x54, 0x48, 0x83, 0xEC, 0x08, 0x48, 0x89, 0xFB, 0x49, 0x89, 0xF4});
+
+    uint32_t executed = 0;
+    uint32_t nextPc = block.ops.front().address;
+    bool terminated = false;
+    for (const BlockOp& op : block.ops) {
+        bool emitted = false;
+        const size_t before = emit.size();
+        switch (op.kind) {
+            case BlockOpKind::LOAD_CONST:
+                emit.storeGuestImm(op.first.rt, static_cast<uint32_t>(op.first.immediate) << 16);
+                emit.loadGuest(Emitter::EAX, op.second.rs);
+                emit.aluEaxImm(0x0D, static_cast<uint32_t>(op.second.immediate));
+                emit.storeGuest(op.second.rt);
+                emitted = true;
+                break;
+            case BlockOpKind::SLT_BRANCH: {
+                emit.loadGuest(Emitter::EAX, op.first.rs);
+                emit.loadGuest(Emitter::ECX, op.first.rt);
+                emit.raw({0x39, 0xC8, 0x0F, 0x9C, 0xC0, 0x0F, 0xB6, 0xC0});
+                emit.storeGuest(op.first.rd);
+                const uint32_t next = op.address + 8;
+                const auto offset = static_cast<uint32_t>(static_cast<int16_t>(op.second.immediate) * 4);
+                emit.loadGuest(Emitter::EAX, op.second.rs);
+                emitBranch(emit, op.second.rt, op.second.opCode == InstructionCode::BNE, next, next + offset);
+                emitted = terminated = true;
+                break;
+            }
+            case BlockOpKind::SINGLE: {
+                const DecodedInstruction& instr = op.first;
+                const bool isBranch = instr.format == InstrFormat::I_TYPE &&
+                                      (instr.opCode == InstructionCode::BEQ || instr.opCode == InstructionCode::BNE);
+                const bool isJumpRegister = instr.format == InstrFormat::R_TYPE &&
+                                            (instr.funct == InstructionCode::JR || instr.funct == InstructionCode::JALR);
+                const bool isCall = instr.format == InstrFormat::J_TYPE && instr.opCode == InstructionCode::JAL;
+                if (isCall || isJumpRegister) {
+                    // Leave calls and returns to the interpreter while they are traced: cmp byte [r12 + traceCalls], 0
+                    emit.raw({0x41, 0x80, 0x7C, 0x24, static_cast<uint8_t>(offsetof(JitContext, traceCalls)), 0x00});
+                    exits.push_back({emit.jumpRel32({0x0F, 0x85}), op.address, executed});
+                }
+                if (instr.format == InstrFormat::J_TYPE || isBranch || isJumpRegister)
+                    emitted = terminated = emitTerminator(emit, instr, op.address);
+                else if (instr.format == InstrFormat::R_TYPE)
+                    emitted = emitRType(emit, instr, exits, op.address, executed);
+                else if (instr.format == InstrFormat::I_TYPE)
+                    emitted = emitIType(emit, instr, exits, op.address, executed);
+                break;
+            }
+        }
+
+        if (!emitted) {
+            // Drop any partial encoding and hand the rest of the block to the interpreter
+            if (emit.size() != before)
+                return nullptr;
+            break;
+        }
+        executed += op.kind == BlockOpKind::SINGLE ? 1 : 2;
+        nextPc = op.address + 4 * (op.kind == BlockOpKind::SINGLE ? 1 : 2);
+        if (terminated)
+            break;
+    }
+
+    if (executed == 0)
+        return nullptr;
+
+    if (!terminated)
+        emit.storeGuestImm(pc, nextPc);
+    emit.movEaxImm(executed);
+    const size_t toEpilogue = emit.jumpRel32({0xE9});
+
+    std::vector<size_t> exitJumps;
+    for (const SideExit& exit : exits) {
+        emit.patchHere(exit.jump);
+        emit.storeGuestImm(pc, exit.pc);
+        emit.movEaxImm(exit.executed);
+        exitJumps.push_back(emit.jumpRel32({0xE9}));
+    }
+
+    // add rsp, 8; pop r12; pop rbx; ret
+    emit.patchHere(toEpilogue);
+    for (const size_t jump : exitJumps)
+        emit.patchHere(jump);
+    emit.raw({0x48, 0x83, 0xC4, 0x08, 0x41, 0x5C, 0x5B, 0xC3});
+
+    // A full cache is flushed rather than left full, as the program may have moved on to other hot blocks.  Nothing
+    // compiled is running while a block is compiled, so none of the flushed code can still be in use
+    if (codeUsed + emit.size() > cacheSize)
+        clear();
+    if (emit.size() > cacheSize)
+        return nullptr;
+
+    // Keep the cache executable everywhere except while new code is being copied in
+    if (mprotect(codeCache, cacheSize, PROT_READ | PROT_WRITE) != 0)
+        return nullptr;
+    std::byte* start = codeCache + codeUsed;
+    std::memcpy(start, emit.code().data(), emit.size());
+    codeUsed += emit.size();
+    if (mprotect(codeCache, cacheSize, PROT_READ | PROT_EXEC) != 0)
+        return nullptr;
+
+    return reinterpret_cast<CompiledBlock>(start);
+#else
+    return nullptr;
+#endif
+}
+
+
+void JitCompiler::invalidate() { stale = true; }
+
+
+void JitCompiler::clear() {
+    entries.clear();
+    codeUsed = 0;
+    stale = false;
+}
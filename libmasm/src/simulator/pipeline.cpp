@@ -0,0 +1,349 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/pipeline.hpp>
+
+#include <algorithm>
+#include <format>
+#include <map>
+#include <optional>
+#include <tuple>
+
+#include <masm/simulator/cpu.hpp>
+
+#include "assembler/instruction.hpp"
+#include "assembler/postprocessor.hpp"
+
+
+/**
+ * The indices of the registers tracked for dependencies beyond the general purpose registers
+ */
+static constexpr uint8_t HI_INDEX = 32;
+static constexpr uint8_t LO_INDEX = 33;
+static constexpr uint8_t FPR_INDEX = 34;
+static constexpr uint8_t FCC_INDEX = 66;
+
+
+/**
+ * The registers read and written by an instruction, and how long its results take to produce
+ */
+struct Dependencies {
+    std::array<uint8_t, 2> sources{};
+    uint8_t sourceCount = 0;
+    std::array<uint8_t, 2> destinations{};
+    uint8_t destinationCount = 0;
+
+    /**
+     * The number of cycles after the instruction issues before its results can be used
+     */
+    uint32_t latency = 1;
+
+    /**
+     * The stall reason of an instruction waiting on the results
+     */
+    StallReason reason = StallReason::LOAD_USE;
+
+    /**
+     * Whether the instruction can change the flow of the program
+     */
+    bool control = false;
+
+    void read(const uint8_t reg) { sources[sourceCount++] = reg; }
+
+    void write(const uint8_t reg) {
+        // Nothing waits on the zero register
+        if (reg != 0)
+            destinations[destinationCount++] = reg;
+    }
+};
+
+
+/**
+ * Finds the registers read and written by an instruction
+ * @param instruction The instruction to check
+ * @param config The latencies of the pipeline
+ * @return The dependencies of the instruction
+ */
+static Dependencies dependenciesOf(const DecodedInstruction& instruction, const PipelineConfig& config) {
+    Dependencies deps;
+    switch (instruction.format) {
+        case InstrFormat::R_TYPE:
+            switch (static_cast<InstructionCode>(instruction.funct)) {
+                case InstructionCode::MULT:
+                case InstructionCode::MULTU:
+                case InstructionCode::DIV:
+                case InstructionCode::DIVU: {
+                    const bool multiply = instruction.funct == InstructionCode::MULT ||
+                                          instruction.funct == InstructionCode::MULTU;
+                    deps.read(instruction.rs);
+                    deps.read(instruction.rt);
+                    deps.write(HI_INDEX);
+                    deps.write(LO_INDEX);
+                    deps.latency = multiply ? config.multiplyLatency : config.divideLatency;
+                    deps.reason = StallReason::MULTIPLY_DIVIDE;
+                    break;
+                }
+                case InstructionCode::MFHI:
+                case InstructionCode::MFLO:
+                    deps.read(instruction.funct == InstructionCode::MFHI ? HI_INDEX : LO_INDEX);
+                    deps.write(instruction.rd);
+                    break;
+                case InstructionCode::MTHI:
+                case InstructionCode::MTLO:
+                    deps.read(instruction.rs);
+                    deps.write(instruction.funct == InstructionCode::MTHI ? HI_INDEX : LO_INDEX);
+                    break;
+                case InstructionCode::JR:
+                    deps.read(instruction.rs);
+                    deps.control = true;
+                    break;
+                case InstructionCode::JALR:
+                    deps.read(instruction.rs);
+                    deps.write(jalrLinkRegister(instruction.rd));
+                    deps.control = true;
+                    break;
+                default:
+                    deps.read(instruction.rs);
+                    deps.read(instruction.rt);
+                    deps.write(instruction.rd);
+                    break;
+            }
+            break;
+        case InstrFormat::I_TYPE:
+            deps.read(instruction.rs);
+            switch (static_cast<InstructionCode>(instruction.opCode)) {
+                case InstructionCode::LB:
+                case InstructionCode::LBU:
+                case InstructionCode::LH:
+                case InstructionCode::LHU:
+                case InstructionCode::LW:
+                    deps.write(instruction.rt);
+                    deps.latency = config.loadLatency;
+                    break;
+                case InstructionCode::SB:
+                case InstructionCode::SH:
+                case InstructionCode::SW:
+                    deps.read(instruction.rt);
+                    break;
+                case InstructionCode::BEQ:
+                case InstructionCode::BNE:
+                    deps.read(instruction.rt);
+                    deps.control = true;
+                    break;
+                default:
+                    deps.write(instruction.rt);
+                    break;
+            }
+            break;
+        case InstrFormat::J_TYPE:
+            if (instruction.opCode == InstructionCode::JAL)
+                deps.write(static_cast<uint8_t>(Register::RA));
+            deps.control = true;
+            break;
+        case InstrFormat::CP1_REG: {
+            deps.read(FPR_INDEX + instruction.rd);
+            deps.read(FPR_INDEX + instruction.rt);
+            deps.write(FPR_INDEX + instruction.shamt);
+            deps.reason = StallReason::FLOATING_POINT;
+            switch (static_cast<InstructionCode>(instruction.funct)) {
+                case InstructionCode::FP_MUL:
+                    deps.latency = config.fpMultiplyLatency;
+                    break;
+                case InstructionCode::FP_DIV:
+                case InstructionCode::FP_SQRT:
+                    deps.latency = config.fpDivideLatency;
+                    break;
+                case InstructionCode::FP_ABS:
+                case InstructionCode::FP_MOV:
+                case InstructionCode::FP_NEG:
+                    break;
+                default:
+                    deps.latency = config.fpAddLatency;
+                    break;
+            }
+            break;
+        }
+        case InstrFormat::CP1_COND:
+            deps.read(FPR_INDEX + instruction.rd);
+            deps.read(FPR_INDEX + instruction.rt);
+            deps.write(FCC_INDEX);
+            deps.latency = config.fpAddLatency;
+            deps.reason = StallReason::FLOATING_POINT;
+            break;
+        case InstrFormat::CP1_COND_IMM:
+            deps.read(FCC_INDEX);
+            deps.control = true;
+            break;
+        case InstrFormat::CP1_REG_IMM:
+            if (instruction.rs == InstructionCode::FP_MFC1) {
+                deps.read(FPR_INDEX + instruction.rd);
+                deps.write(instruction.rt);
+            } else {
+                deps.read(instruction.rt);
+                deps.write(FPR_INDEX + instruction.rd);
+            }
+            break;
+        case InstrFormat::CP1_IMM:
+            deps.read(instruction.rs);
+            if (instruction.opCode == InstructionCode::FP_LWC1 || instruction.opCode == InstructionCode::FP_LDC1) {
+                deps.write(FPR_INDEX + instruction.rt);
+                deps.latency = config.loadLatency;
+            } else
+                deps.read(FPR_INDEX + instruction.rt);
+            break;
+        case InstrFormat::SYSCALL:
+            deps.read(static_cast<uint8_t>(Register::V0));
+            deps.read(static_cast<uint8_t>(Register::A0));
+            deps.control = true;
+            break;
+        case InstrFormat::ERET:
+            deps.control = true;
+            break;
+        case InstrFormat::CP0:
+        case InstrFormat::BREAK:
+            break;
+    }
+    return deps;
+}
+
+
+void PipelineModel::issue(const uint32_t address, const DecodedInstruction& instruction) {
+    const Dependencies deps = dependenciesOf(instruction, config);
+
+    // The instruction before this one is charged for redirecting the program here, as it is the one to tune
+    if (address != nextAddress && lastInstruction != nullptr) {
+        clock += config.branchPenalty;
+        lastInstruction->cycles += config.branchPenalty;
+        currentBlock->cycles += config.branchPenalty;
+        stalls[static_cast<size_t>(StallReason::BRANCH)] += config.branchPenalty;
+    }
+    if (address != nextAddress || afterControl) {
+        currentBlock = &blockCounts[address];
+        currentBlock->entries++;
+    }
+
+    uint64_t issueCycle = clock + 1;
+    for (uint8_t i = 0; i < deps.sourceCount; i++) {
+        const uint8_t reg = deps.sources[i];
+        if (ready[reg] > issueCycle) {
+            stalls[static_cast<size_t>(producer[reg])] += ready[reg] - issueCycle;
+            issueCycle = ready[reg];
+        }
+    }
+    for (uint8_t i = 0; i < deps.destinationCount; i++) {
+        ready[deps.destinations[i]] = issueCycle + deps.latency;
+        producer[deps.destinations[i]] = deps.reason;
+    }
+
+    Counts& counts = instructionCounts[address];
+    counts.instructions++;
+    counts.cycles += issueCycle - clock;
+    currentBlock->instructions++;
+    currentBlock->cycles += issueCycle - clock;
+    currentBlock->end = std::max(currentBlock->end, address);
+    lastInstruction = &counts;
+    instructionCount++;
+
+    clock = issueCycle;
+    nextAddress = address + 4;
+    afterControl = deps.control;
+}
+
+
+void PipelineModel::reset() {
+    clock = FILL_CYCLES;
+    ready.fill(0);
+    nextAddress = 0;
+    afterControl = true;
+    lastInstruction = nullptr;
+    currentBlock = nullptr;
+    instructionCount = 0;
+    stalls.fill(0);
+    instructionCounts.clear();
+    blockCounts.clear();
+}
+
+
+uint64_t PipelineModel::cycles() const { return instructionCount != 0 ? clock : 0; }
+
+
+uint64_t PipelineModel::instructions() const { return instructionCount; }
+
+
+PipelineReport PipelineModel::report(const DebugTable& debugTable) const {
+    PipelineReport report;
+    report.instructions = instructionCount;
+    report.cycles = cycles();
+    report.stalls = stalls;
+
+    std::map<std::tuple<std::string, size_t>, PipelineLineReport> lines;
+    for (const auto& [address, counts] : instructionCounts) {
+        const DebugInfo* info = debugTable.find(address);
+        if (!info)
+            continue;
+        PipelineLineReport& line = lines[{info->source.filename, info->source.lineno}];
+        if (line.instructions == 0) {
+            line.filename = info->source.filename;
+            line.lineno = info->source.lineno;
+            line.text = info->source.text;
+        }
+        line.instructions += counts.instructions;
+        line.cycles += counts.cycles;
+    }
+    for (auto& [location, line] : lines)
+        report.lines.push_back(std::move(line));
+
+    for (const auto& [start, counts] : blockCounts) {
+        PipelineBlockReport& block = report.blocks.emplace_back();
+        block.start = start;
+        block.end = counts.end;
+        block.entries = counts.entries;
+        block.instructions = counts.instructions;
+        block.cycles = counts.cycles;
+        if (const DebugInfo* info = debugTable.find(start)) {
+            block.label = info->label.empty() ? "" : unmangleLabel(info->label);
+            block.filename = info->source.filename;
+            block.lineno = info->source.lineno;
+        }
+    }
+
+    // Blocks are ordered by address first, so that ties keep the same order in every report of the same run
+    std::ranges::sort(report.blocks, {}, &PipelineBlockReport::start);
+    std::ranges::stable_sort(report.blocks, std::greater{}, &PipelineBlockReport::cycles);
+    std::ranges::stable_sort(report.lines, std::greater{}, &PipelineLineReport::cycles);
+    return report;
+}
+
+
+std::string formatPipelineReport(const PipelineReport& report, const size_t maxRows) {
+    std::string table = std::format("{} instructions in {} cycles, CPI {:.3f}\n", report.instructions, report.cycles,
+                                    report.cpi());
+    table += std::format("Stall cycles: {} load-use, {} multiply/divide, {} floating-point, {} branch\n",
+                         report.stalls[static_cast<size_t>(StallReason::LOAD_USE)],
+                         report.stalls[static_cast<size_t>(StallReason::MULTIPLY_DIVIDE)],
+                         report.stalls[static_cast<size_t>(StallReason::FLOATING_POINT)],
+                         report.stalls[static_cast<size_t>(StallReason::BRANCH)]);
+
+    table += std::format("\n{:>14} {:>14} {:>7} {:>10}  {}\n", "Cycles", "Instructions", "CPI", "Entries", "Block");
+    const size_t blockCount = maxRows != 0 ? std::min(maxRows, report.blocks.size()) : report.blocks.size();
+    for (size_t i = 0; i < blockCount; i++) {
+        const PipelineBlockReport& block = report.blocks[i];
+        std::string name = std::format("0x{:08x}-0x{:08x}", block.start, block.end);
+        if (!block.filename.empty())
+            name += std::format("  {}:{}", block.filename, block.lineno);
+        if (!block.label.empty())
+            name += "  " + block.label;
+        table += std::format("{:>14} {:>14} {:>7.3f} {:>10}  {}\n", block.cycles, block.instructions, block.cpi(),
+                             block.entries, name);
+    }
+
+    table += std::format("\n{:>14} {:>14} {:>7}  {}\n", "Cycles", "Instructions", "CPI", "Line");
+    const size_t lineCount = maxRows != 0 ? std::min(maxRows, report.lines.size()) : report.lines.size();
+    for (size_t i = 0; i < lineCount; i++) {
+        const PipelineLineReport& line = report.lines[i];
+        table += std::format("{:>14} {:>14} {:>7.3f}  {}:{}  {}\n", line.cycles, line.instructions, line.cpi(),
+                             line.filename, line.lineno, line.text);
+    }
+    return table;
+}
@@ -0,0 +1,203 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/profiler.hpp>
+
+#include <algorithm>
+#include <format>
+#include <map>
+#include <numeric>
+#include <ranges>
+#include <tuple>
+
+#include <masm/assembler/memory.hpp>
+
+#include "assembler/postprocessor.hpp"
+
+
+/**
+ * The label given to code that comes before the first label of its section
+ */
+static const std::string NO_LABEL = "<unlabeled>";
+
+
+/**
+ * Checks whether an address is in the text section, rather than the ktext section
+ * @param address The address to check
+ * @return True if the address is below the ktext section
+ */
+static bool isUserText(const uint32_t address) { return address < memSectionOffset(MemSection::KTEXT); }
+
+
+/**
+ * Checks whether an address is in the text or ktext section
+ * @param address The address to check
+ * @return True if the address holds executable code
+ */
+static bool isExecutable(const uint32_t address) {
+    const uint32_t text = memSectionOffset(MemSection::TEXT);
+    const uint32_t ktext = memSectionOffset(MemSection::KTEXT);
+    return (address >= text && address < static_cast<uint32_t>(TEXT_SEC_END)) ||
+           (address >= ktext && address < memSectionOffset(MemSection::KDATA));
+}
+
+
+uint64_t& ExecutionProfile::counter(const uint32_t address) {
+    if (!isExecutable(address))
+        return otherCounts[address];
+
+    const bool user = isUserText(address);
+    std::vector<uint64_t>& counts = user ? textCounts : ktextCounts;
+    const uint32_t index = (address - memSectionOffset(user ? MemSection::TEXT : MemSection::KTEXT)) >> 2;
+    if (index >= counts.size())
+        // Grow geometrically so that a program running further into its text rarely reallocates
+        counts.resize(std::max<size_t>(index + 1, counts.size() * 2));
+    return counts[index];
+}
+
+
+void ExecutionProfile::record(const uint32_t address) { counter(address)++; }
+
+
+uint64_t ExecutionProfile::count(const uint32_t address) const {
+    if (!isExecutable(address)) {
+        const auto it = otherCounts.find(address);
+        return it != otherCounts.end() ? it->second : 0;
+    }
+
+    const bool user = isUserText(address);
+    const std::vector<uint64_t>& counts = user ? textCounts : ktextCounts;
+    const uint32_t index = (address - memSectionOffset(user ? MemSection::TEXT : MemSection::KTEXT)) >> 2;
+    return index < counts.size() ? counts[index] : 0;
+}
+
+
+uint64_t ExecutionProfile::total() const {
+    uint64_t total = std::accumulate(textCounts.begin(), textCounts.end(), uint64_t{0}) +
+                     std::accumulate(ktextCounts.begin(), ktextCounts.end(), uint64_t{0});
+    for (const uint64_t count : otherCounts | std::views::values)
+        total += count;
+    return total;
+}
+
+
+std::vector<std::pair<uint32_t, uint64_t>> ExecutionProfile::counts() const {
+    std::vector<std::pair<uint32_t, uint64_t>> executed;
+    for (const auto& [counts, section] : {std::pair{&textCounts, MemSection::TEXT}, {&ktextCounts, MemSection::KTEXT}})
+        for (size_t i = 0; i < counts->size(); i++)
+            if ((*counts)[i] != 0)
+                executed.emplace_back(memSectionOffset(section) + static_cast<uint32_t>(i * 4), (*counts)[i]);
+    if (!otherCounts.empty()) {
+        executed.insert(executed.end(), otherCounts.begin(), otherCounts.end());
+        std::ranges::sort(executed);
+    }
+    return executed;
+}
+
+
+void ExecutionProfile::clear() {
+    textCounts.clear();
+    ktextCounts.clear();
+    otherCounts.clear();
+}
+
+
+ProfileReport buildProfileReport(const ExecutionProfile& profile, const DebugTable& debugTable) {
+    ProfileReport report;
+    report.total = profile.total();
+
+    // Lines are keyed by their location, while the label of a line is that of its first executed instruction
+    std::map<std::tuple<std::string, size_t>, ProfileLine> lines;
+    std::map<std::string, uint64_t> labels;
+    std::string currentLabel = NO_LABEL;
+    bool currentUser = true;
+    uint64_t attributed = 0;
+    for (const auto& [address, info] : debugTable) {
+        if (!isExecutable(address))
+            continue;
+        // Labels do not carry over from the text section into the ktext section
+        if (isUserText(address) != currentUser) {
+            currentUser = isUserText(address);
+            currentLabel = NO_LABEL;
+        }
+        if (!info.label.empty())
+            currentLabel = info.label;
+
+        const uint64_t count = profile.count(address);
+        if (count == 0)
+            continue;
+
+        ProfileLine& line = lines[{info.source.filename, info.source.lineno}];
+        if (line.count == 0)
+            line = {info.source.filename, info.source.lineno, info.source.text, unmangleLabel(currentLabel), 0};
+        line.count += count;
+        labels[currentLabel] += count;
+        attributed += count;
+    }
+    report.unattributed = report.total - attributed;
+
+    for (auto& [location, line] : lines)
+        report.lines.push_back(std::move(line));
+    // Labels are kept apart by their mangled names, as files may each have their own label of the same name
+    for (const auto& [label, count] : labels)
+        report.labels.push_back({unmangleLabel(label), count});
+
+    // Ties keep their source order, so reports of the same run are always identical
+    std::ranges::stable_sort(report.lines, std::greater{}, &ProfileLine::count);
+    std::ranges::stable_sort(report.labels, std::greater{}, &ProfileLabel::count);
+    return report;
+}
+
+
+/**
+ * Formats a count as a percentage of a total
+ * @param count The count to format
+ * @param total The total that the count is part of
+ * @return The percentage with two decimal places
+ */
+static std::string percentOf(const uint64_t count, const uint64_t total) {
+    return std::format("{:6.2f}%", total != 0 ? 100.0 * static_cast<double>(count) / static_cast<double>(total) : 0.0);
+}
+
+
+std::string formatProfileReport(const ProfileReport& report, const size_t maxLines) {
+    std::string table = std::format("{} instructions executed\n\n", report.total);
+
+    table += std::format("{:>14} {:>7}  {}\n", "Instructions", "Percent", "Label");
+    for (const ProfileLabel& label : report.labels)
+        table += std::format("{:>14} {}  {}\n", label.count, percentOf(label.count, report.total), label.label);
+    if (report.unattributed != 0)
+        table += std::format("{:>14} {}  {}\n", report.unattributed, percentOf(report.unattributed, report.total),
+                             "<no debug info>");
+
+    table += std::format("\n{:>14} {:>7}  {}\n", "Instructions", "Percent", "Line");
+    const size_t lineCount = maxLines != 0 ? std::min(maxLines, report.lines.size()) : report.lines.size();
+    for (size_t i = 0; i < lineCount; i++) {
+        const ProfileLine& line = report.lines[i];
+        table += std::format("{:>14} {}  {}:{}  {}\n", line.count, percentOf(line.count, report.total), line.filename,
+                             line.lineno, line.text);
+    }
+    return table;
+}
+
+
+std::string formatCallgrind(const ProfileReport& report) {
+    std::string profile = "# callgrind format\nversion: 1\ncreator: masm\npositions: line\nevents: Instructions\n";
+
+    // Group the lines of each label by file, as callgrind attributes costs to a function within a file
+    std::map<std::tuple<std::string, std::string>, std::vector<const ProfileLine*>> functions;
+    for (const ProfileLine& line : report.lines)
+        functions[{line.filename, line.label}].push_back(&line);
+
+    for (auto& [key, lines] : functions) {
+        const auto& [filename, label] = key;
+        std::ranges::sort(lines, {}, &ProfileLine::lineno);
+        profile += std::format("\nfl={}\nfn={}\n", filename, label);
+        for (const ProfileLine* line : lines)
+            profile += std::format("{} {}\n", line->lineno, line->count);
+    }
+
+    profile += std::format("\ntotals: {}\n", report.total);
+    return profile;
+}
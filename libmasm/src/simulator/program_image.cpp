@@ -0,0 +1,22 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/program_image.hpp>
+
+
+ProgramImage::ProgramImage(const MemLayout& layout) :
+    debugInfo(std::make_shared<const DebugTable>(layout.debugInfo)) {
+    // The bytes of each section are already in the byte order of the program, so the memory's own order is unused
+    Memory image;
+    for (const auto& [section, bytes] : layout.data)
+        for (size_t i = 0; i < bytes.size(); i++)
+            image[memSectionOffset(section) + i] = bytes[i];
+    memory = image.snapshot();
+}
+
+
+const MemorySnapshot& ProgramImage::pages() const { return memory; }
+
+
+const std::shared_ptr<const DebugTable>& ProgramImage::debugTable() const { return debugInfo; }
@@ -0,0 +1,201 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <masm/simulator/replay.hpp>
+
+#include <array>
+#include <format>
+#include <stdexcept>
+#include <string>
+
+
+/**
+ * The version of the input log format, raised whenever the layout of a log changes
+ */
+constexpr uint32_t INPUT_LOG_VERSION = 1;
+
+
+/**
+ * Gets the name of a kind of input for error messages
+ * @param kind The kind of input
+ * @return The name of the kind
+ */
+static std::string eventKindName(const InputEventKind kind) {
+    switch (kind) {
+        case InputEventKind::POLL:
+            return "input poll";
+        case InputEventKind::CHAR:
+            return "input character";
+        case InputEventKind::TIME:
+            return "clock reading";
+        case InputEventKind::SEED:
+            return "random seed";
+        case InputEventKind::FILE_OPEN:
+            return "file open";
+        case InputEventKind::FILE_READ:
+            return "file read";
+        case InputEventKind::FILE_DATA:
+            return "file contents";
+        case InputEventKind::FILE_WRITE:
+            return "file write";
+    }
+    return "unknown input";
+}
+
+
+/**
+ * Writes an unsigned integer as a LEB128 variable-length integer, which takes a single byte for small values
+ * @param stream The stream to write to
+ * @param value The integer to write
+ */
+static void writeVarint(std::ostream& stream, uint64_t value) {
+    while (value >= 0x80) {
+        stream.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    stream.put(static_cast<char>(value));
+}
+
+
+/**
+ * Reads an unsigned LEB128 variable-length integer
+ * @param stream The stream to read from
+ * @return The integer that was read
+ * @throw runtime_error When the stream ends early or the integer is too long
+ */
+static uint64_t readVarint(std::istream& stream) {
+    uint64_t value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        char c;
+        if (!stream.get(c))
+            throw std::runtime_error("Unexpected end of input log");
+        value |= static_cast<uint64_t>(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+            return value;
+    }
+    throw std::runtime_error("Invalid integer in input log");
+}
+
+
+uint64_t InputJournal::now() const { return clock ? clock() : 0; }
+
+
+JournalMode InputJournal::mode() const { return journalMode; }
+
+
+const std::vector<InputEvent>& InputJournal::events() const { return inputEvents; }
+
+
+bool InputJournal::finished() const { return cursor >= inputEvents.size(); }
+
+
+void InputJournal::setClock(std::function<uint64_t()> instructionClock) { clock = std::move(instructionClock); }
+
+
+int64_t InputJournal::consume(const InputEventKind kind, const std::function<int64_t()>& source) {
+    const uint64_t instruction = now();
+    if (journalMode == JournalMode::RECORD) {
+        const int64_t value = source();
+        inputEvents.push_back({instruction, kind, value});
+        return value;
+    }
+
+    if (finished())
+        throw std::runtime_error(
+                std::format("Replay ended before the {} at instruction {}", eventKindName(kind), instruction));
+    const InputEvent& event = inputEvents[cursor];
+    if (event.kind != kind || event.instruction != instruction)
+        throw std::runtime_error(std::format("Replay diverged at instruction {}: expected a {} at instruction {}",
+                                             instruction, eventKindName(event.kind), event.instruction));
+    cursor++;
+    return event.value;
+}
+
+
+bool InputJournal::poll(const std::function<bool()>& source) {
+    const uint64_t instruction = now();
+    if (journalMode == JournalMode::RECORD) {
+        const bool ready = source();
+        if (ready)
+            inputEvents.push_back({instruction, InputEventKind::POLL, 1});
+        return ready;
+    }
+
+    if (finished() || inputEvents[cursor].kind != InputEventKind::POLL || inputEvents[cursor].instruction != instruction)
+        return false;
+    cursor++;
+    return true;
+}
+
+
+void InputJournal::save(std::ostream& stream) const {
+    stream.write("MRPL", 4);
+    writeVarint(stream, INPUT_LOG_VERSION);
+    writeVarint(stream, inputEvents.size());
+
+    // Instructions are stored as the distance from the previous input and values in zigzag form, as both are small
+    uint64_t lastInstruction = 0;
+    for (const InputEvent& event : inputEvents) {
+        writeVarint(stream, event.instruction - lastInstruction);
+        stream.put(static_cast<char>(event.kind));
+        writeVarint(stream, static_cast<uint64_t>(event.value) << 1 ^ static_cast<uint64_t>(event.value >> 63));
+        lastInstruction = event.instruction;
+    }
+
+    if (!stream)
+        throw std::runtime_error("Failed to write input log");
+}
+
+
+InputJournal InputJournal::load(std::istream& stream) {
+    std::array<char, 4> magic = {};
+    if (!stream.read(magic.data(), magic.size()) || std::string(magic.data(), magic.size()) != "MRPL")
+        throw std::runtime_error("Invalid input log format");
+    if (const uint64_t version = readVarint(stream); version != INPUT_LOG_VERSION)
+        throw std::runtime_error("Unsupported input log version " + std::to_string(version));
+
+    const uint64_t count = readVarint(stream);
+    std::vector<InputEvent> events;
+    uint64_t lastInstruction = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        InputEvent event;
+        event.instruction = lastInstruction + readVarint(stream);
+        char kind;
+        if (!stream.get(kind))
+            throw std::runtime_error("Unexpected end of input log");
+        if (kind < static_cast<char>(InputEventKind::POLL) || kind > static_cast<char>(InputEventKind::FILE_WRITE))
+            throw std::runtime_error("Invalid input kind in input log");
+        event.kind = static_cast<InputEventKind>(kind);
+        const uint64_t zigzag = readVarint(stream);
+        event.value = static_cast<int64_t>(zigzag >> 1 ^ -(zigzag & 1));
+        events.push_back(event);
+        lastInstruction = event.instruction;
+    }
+    return InputJournal(std::move(events));
+}
+
+
+bool JournalStreamHandle::hasChar() {
+    // Replayed reads never reach the wrapped handle, which would otherwise flush its output
+    inner.flush();
+    return journal.poll([this] { return inner.hasChar(); });
+}
+
+
+char JournalStreamHandle::getChar() {
+    inner.flush();
+    return static_cast<char>(journal.consume(InputEventKind::CHAR, [this] { return inner.getChar(); }));
+}
+
+
+char JournalStreamHandle::getCharBlocking() {
+    inner.flush();
+    return static_cast<char>(journal.consume(InputEventKind::CHAR, [this] { return inner.getCharBlocking(); }));
+}
+
+
+void JournalStreamHandle::write(const std::span<const char> data) { inner.write(data); }
+
+
+void JournalStreamHandle::flush() { inner.flush(); }
@@ -4,15 +4,55 @@
 
 #include <masm/simulator/simulator.hpp>
 
+#include <algorithm>
+#include <format>
 #include <stdexcept>
 
 #include <masm/exceptions.hpp>
 #include <masm/simulator/syscalls.hpp>
 
+#include "assembler/instruction.hpp"
+
+
+void Simulator::resetCaches() {
+    decodeCache.clear();
+    blockCache.clear();
+    if (jit)
+        jit->clear();
+    state.memory.setWriteWatcher([this](const uint32_t address) {
+        decodeCache.invalidate(address);
+        blockCache.invalidate();
+        if (jit)
+            jit->invalidate();
+        nativeBlocksValid = false;
+    });
+}
+
+
+void Simulator::resetRunState() {
+    if (profile)
+        profile->clear();
+    if (callGraph)
+        callGraph->reset(memSectionOffset(MemSection::TEXT));
+    if (caches)
+        caches->reset();
+    if (pipeline)
+        pipeline->reset();
+    files.closeAll();
+}
+
 
-void Simulator::initProgram(const MemLayout& layout) {
-    // Load the program into memory
-    state.loadProgram(layout);
+void Simulator::initProgram(const MemLayout& layout) { initProgram(ProgramImage(layout)); }
+
+
+void Simulator::initProgram(const ProgramImage& image) {
+    // Drop decodings of any previous program and invalidate them on writes to text pages from here on
+    resetCaches();
+    // Map the program into memory
+    state.loadProgram(image);
+    nativeBlocksValid = !nativeBlocks.empty();
+    inputPollCountdown = inputPollInterval;
+    resetRunState();
     // Initialize PC to the start of the text section
     state.registers[Register::PC] = static_cast<int32_t>(memSectionOffset(MemSection::TEXT));
     // Initialize the stack registers
@@ -29,19 +69,64 @@ void Simulator::initProgram(const MemLayout& layout) {
 }
 
 
-int Simulator::simulate(const MemLayout& layout) {
-    initProgram(layout);
+int Simulator::simulate(const MemLayout& layout) { return simulate(ProgramImage(layout)); }
+
+
+int Simulator::simulate(const ProgramImage& image) {
+    initProgram(image);
+    executedInstructions = 0;
+    return runToCompletion();
+}
+
+
+int Simulator::resume(const ProgramImage& image, const SimulatorSnapshot& snapshot, const uint64_t instructions) {
+    // Loading the image first gives the restored program its debug info
+    initProgram(image);
+    restore(snapshot);
+    executedInstructions = instructions;
+    return runToCompletion();
+}
+
+
+int Simulator::runToCompletion() {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t nextCheckpoint = checkpointInterval != 0 ? executedInstructions + checkpointInterval : UINT64_MAX;
 
     while (true) {
-        try {
-            step();
-        } catch (ExecExit& e) {
-            const std::string what = e.what();
-            if (!what.empty())
-                streamHandle.putStr(what);
-            streamHandle.putStr("\n");
-            return e.code();
+        uint64_t quantum = RUN_QUANTUM;
+        if (instructionLimit != 0) {
+            if (executedInstructions >= instructionLimit) {
+                streamHandle.putStr(
+                        std::format("Execution terminated (Instruction limit reached after {} instructions)\n",
+                                    executedInstructions));
+                streamHandle.flush();
+                return INSTRUCTION_LIMIT_EXIT_CODE;
+            }
+            quantum = std::min(quantum, instructionLimit - executedInstructions);
         }
+        quantum = std::min(quantum, nextCheckpoint - executedInstructions);
+
+        const RunResult result = run(quantum);
+        executedInstructions += result.steps;
+        if (result.status == RunStatus::STEP_LIMIT && executedInstructions >= nextCheckpoint) {
+            checkpointHook(*this);
+            nextCheckpoint += checkpointInterval;
+        }
+        if (result.status == RunStatus::STEP_LIMIT) {
+            if (timeout.count() != 0 && std::chrono::steady_clock::now() - start >= timeout) {
+                streamHandle.putStr(std::format("Execution terminated (Timed out after {} instructions)\n",
+                                                executedInstructions));
+                streamHandle.flush();
+                return TIMEOUT_EXIT_CODE;
+            }
+            continue;
+        }
+
+        if (!result.message.empty())
+            streamHandle.putStr(result.message);
+        streamHandle.putStr("\n");
+        streamHandle.flush();
+        return result.exitCode;
     }
 }
 
@@ -88,6 +173,7 @@ bool Simulator::writeMMIO() {
     const char c = static_cast<char>(state.memory.wordAt(output_data));
 
     streamHandle.putChar(c);
+    state.memory.clearOutputDirty();
 
     // Reset ready bit
     state.memory._sysWordTo(output_ready, 1);
@@ -106,7 +192,7 @@ void Simulator::except(const uint32_t cause, const std::string& excMsg) {
     const uint32_t handlerAddress = memSectionOffset(MemSection::KTEXT);
     const int32_t pc = state.registers[Register::PC] - 4;
     if (!state.memory.isValid(handlerAddress)) {
-        const SourceLocator pcSrc = state.getDebugInfo(pc).source;
+        const SourceLocator& pcSrc = state.getDebugInfo(pc).source;
         const std::string what = std::format("{}: {} (unhandled)", causeToString(cause), excMsg);
         throw MasmRuntimeError(what, pc, pcSrc.filename, pcSrc.lineno);
     }
@@ -118,134 +204,494 @@ void Simulator::except(const uint32_t cause, const std::string& excMsg) {
 }
 
 
+void Simulator::setInputPollInterval(const uint32_t interval) {
+    if (interval == 0)
+        throw std::invalid_argument("Input poll interval must be positive");
+
+    inputPollInterval = interval;
+    inputPollCountdown = interval;
+}
+
+
+void Simulator::setEngine(const ExecEngine execEngine) {
+    engine = execEngine;
+    if (engine == ExecEngine::JIT && !jit)
+        jit = std::make_unique<JitCompiler>();
+}
+
+
+void Simulator::setInstructionLimit(const uint64_t maxInstructions) { instructionLimit = maxInstructions; }
+
+
+void Simulator::setTimeout(const std::chrono::milliseconds duration) { timeout = duration; }
+
+
+uint64_t Simulator::instructionCount() const { return executedInstructions; }
+
+
+void Simulator::setCheckpointHook(const uint64_t interval, std::function<void(Simulator&)> hook) {
+    checkpointInterval = hook ? interval : 0;
+    checkpointHook = std::move(hook);
+}
+
+
+void Simulator::setInputJournal(InputJournal* journal) {
+    inputJournal = journal;
+    sysHandle.setInputJournal(journal);
+    if (journal != nullptr)
+        // Inputs are stamped with the instruction consuming them, counting the steps of the run in progress
+        journal->setClock([this] { return currentInstruction(); });
+}
+
+
+void Simulator::setProfiling(const bool enabled) {
+    if (!enabled)
+        profile.reset();
+    else if (!profile)
+        profile = std::make_unique<ExecutionProfile>();
+    instrumented = profile || caches || pipeline;
+}
+
+
+const ExecutionProfile* Simulator::executionProfile() const { return profile.get(); }
+
+
+ProfileReport Simulator::profileReport() const {
+    if (!profile)
+        throw std::runtime_error("Profiling is not enabled");
+    return buildProfileReport(*profile, *state.debugInfo);
+}
+
+
+void Simulator::setCallGraphProfiling(const bool enabled) {
+    if (!enabled)
+        callGraph.reset();
+    else if (!callGraph)
+        callGraph = std::make_unique<CallGraphProfile>(memSectionOffset(MemSection::TEXT));
+}
+
+
+const CallGraphProfile* Simulator::callGraphProfile() const { return callGraph.get(); }
+
+
+CallGraphReport Simulator::callGraphReport() const {
+    if (!callGraph)
+        throw std::runtime_error("Call graph profiling is not enabled");
+    return buildCallGraphReport(*callGraph, *state.debugInfo, executedInstructions);
+}
+
+
+void Simulator::setCacheModel(const std::optional<CacheHierarchyConfig>& config) {
+    caches = config ? std::make_unique<CacheHierarchy>(*config) : nullptr;
+    instrumented = profile || caches || pipeline;
+}
+
+
+const CacheHierarchy* Simulator::cacheHierarchy() const { return caches.get(); }
+
+
+CacheReport Simulator::cacheReport() const {
+    if (!caches)
+        throw std::runtime_error("Cache simulation is not enabled");
+    return caches->report(*state.debugInfo);
+}
+
+
+void Simulator::setPipelineModel(const std::optional<PipelineConfig>& config) {
+    pipeline = config ? std::make_unique<PipelineModel>(*config) : nullptr;
+    instrumented = profile || caches || pipeline;
+}
+
+
+const PipelineModel* Simulator::pipelineModel() const { return pipeline.get(); }
+
+
+PipelineReport Simulator::pipelineReport() const {
+    if (!pipeline)
+        throw std::runtime_error("Pipeline timing is not enabled");
+    return pipeline->report(*state.debugInfo);
+}
+
+
+/**
+ * The data memory access made by a load or store instruction
+ */
+struct DataAccess {
+    uint32_t size;
+    bool write;
+};
+
+
+/**
+ * Finds the data memory access made by an instruction, if any.  The memory accesses of syscalls are not included
+ * @param instruction The instruction to check
+ * @return The access made by the instruction, or nullopt if it does not access data memory
+ */
+static std::optional<DataAccess> dataAccess(const DecodedInstruction& instruction) {
+    if (instruction.format == InstrFormat::I_TYPE) {
+        switch (static_cast<InstructionCode>(instruction.opCode)) {
+            case InstructionCode::LB:
+            case InstructionCode::LBU:
+                return DataAccess{1, false};
+            case InstructionCode::LH:
+            case InstructionCode::LHU:
+                return DataAccess{2, false};
+            case InstructionCode::LW:
+                return DataAccess{4, false};
+            case InstructionCode::SB:
+                return DataAccess{1, true};
+            case InstructionCode::SH:
+                return DataAccess{2, true};
+            case InstructionCode::SW:
+                return DataAccess{4, true};
+            default:
+                return std::nullopt;
+        }
+    }
+    if (instruction.format == InstrFormat::CP1_IMM) {
+        switch (static_cast<InstructionCode>(instruction.opCode)) {
+            case InstructionCode::FP_LWC1:
+                return DataAccess{4, false};
+            case InstructionCode::FP_LDC1:
+                return DataAccess{8, false};
+            case InstructionCode::FP_SWC1:
+                return DataAccess{4, true};
+            case InstructionCode::FP_SDC1:
+                return DataAccess{8, true};
+            default:
+                return std::nullopt;
+        }
+    }
+    return std::nullopt;
+}
+
+
+void Simulator::observe(const uint32_t address, const DecodedInstruction& instruction) {
+    if (profile)
+        profile->record(address);
+    if (caches) {
+        caches->fetch(address);
+        // The registers still hold their values from before the instruction, from which its address is computed
+        if (const std::optional<DataAccess> access = dataAccess(instruction))
+            caches->data(address, state.registers[instruction.rs] + instruction.immediate, access->size,
+                          access->write);
+    }
+    if (pipeline)
+        pipeline->issue(address, instruction);
+}
+
+
+uint64_t Simulator::currentInstruction() const {
+    return executedInstructions + (activeRun != nullptr ? activeRun->steps : 0);
+}
+
+
+void Simulator::traceCall(const DecodedInstruction& instruction) {
+    const uint32_t pc = state.registers[Register::PC];
+    if (instruction.format == InstrFormat::J_TYPE) {
+        if (instruction.opCode == InstructionCode::JAL)
+            callGraph->call(pc, state.registers[Register::RA], currentInstruction());
+    } else if (instruction.funct == InstructionCode::JALR)
+        callGraph->call(pc, state.registers[jalrLinkRegister(instruction.rd)], currentInstruction());
+    else if (instruction.funct == InstructionCode::JR)
+        // A jr only returns when it targets the return address of a frame, so the link register does not matter
+        callGraph->ret(pc, currentInstruction());
+}
+
+
+void Simulator::setFileSandbox(const std::optional<std::filesystem::path>& directory) { files.setSandbox(directory); }
+
+
+const FileTable& Simulator::fileTable() const { return files; }
+
+
+void Simulator::setNativeBlocks(const std::span<const NativeBlock> blocks) {
+    nativeBlocks.assign(blocks.begin(), blocks.end());
+    std::ranges::sort(nativeBlocks, {}, &NativeBlock::address);
+    nativeBlocksValid = !nativeBlocks.empty();
+}
+
+
+SimulatorSnapshot Simulator::snapshot() const {
+    return {state.snapshot(), sysHandle, inputPollCountdown, nativeBlocksValid};
+}
+
+
+void Simulator::restore(const SimulatorSnapshot& snapshot) {
+    // The restored text may differ from the text that was decoded, so every cached decoding is dropped
+    resetCaches();
+    state.restore(snapshot.state);
+    sysHandle = snapshot.sysHandle;
+    sysHandle.setInputJournal(inputJournal);
+    sysHandle.setFileTable(&files);
+    // Neither counters nor files are part of a snapshot, so those of the run being replaced are dropped
+    resetRunState();
+    inputPollCountdown = snapshot.inputPollCountdown;
+    nativeBlocksValid = snapshot.nativeBlocksValid && !nativeBlocks.empty();
+}
+
+
+const NativeBlock* Simulator::findNativeBlock(const uint32_t address) const {
+    if (!nativeBlocksValid)
+        return nullptr;
+
+    const auto it = std::ranges::lower_bound(nativeBlocks, address, {}, &NativeBlock::address);
+    return it != nativeBlocks.end() && it->address == address ? &*it : nullptr;
+}
+
+
 void Simulator::step() {
+    const RunResult result = run(1);
+    if (result.status != RunStatus::STEP_LIMIT)
+        throw ExecExit(result.message, result.exitCode);
+}
+
+
+template <std::endian Order>
+RunResult Simulator::runOrdered(const uint64_t maxSteps) {
+    RunResult result;
+    activeRun = &result;
+    // Syscalls still report exits and errors by throwing, so resume the inner loop after handling them
+    while (result.steps < maxSteps) {
+        try {
+            while (result.steps < maxSteps) {
+                // Run whole blocks when no MMIO device needs to be polled between instructions
+                if (ioMode == IOMode::SYSCALL) {
+                    const uint32_t pc = state.registers[Register::PC];
+                    // Prefer code translated ahead of time, which dispatches indirect jumps back through here.  Neither
+                    // native nor compiled code is observed, so instrumented runs use neither.  Both leave calls and
+                    // returns to the interpreter while the call graph is recorded
+                    JitContext context{&state.memory, &blockCache, callGraph != nullptr};
+                    if (const NativeBlock* native = instrumented ? nullptr : findNativeBlock(pc);
+                        native != nullptr && native->instructionCount <= maxSteps - result.steps) {
+                        const uint32_t executed = native->code(state.registers.data(), &context);
+                        result.steps += executed;
+                        if (executed != 0)
+                            continue;
+                    }
+
+                    const TranslatedBlock* block = blockCache.lookup(state.memory, decodeCache, pc);
+                    if (block != nullptr && block->instructionCount <= maxSteps - result.steps) {
+                        const CompiledBlock code =
+                                engine == ExecEngine::JIT && !instrumented ? jit->lookup(*block, pc) : nullptr;
+                        if (code == nullptr) {
+                            execBlock<Order>(*block, result);
+                            continue;
+                        }
+                        // Compiled code exits early at anything it cannot handle, which is then stepped below
+                        const uint32_t executed = code(state.registers.data(), &context);
+                        result.steps += executed;
+                        if (executed != 0)
+                            continue;
+                    }
+                }
+
+                if (execStep<Order>(result))
+                    return result;
+            }
+        } catch (ExecExit& e) {
+            result.status = RunStatus::EXITED;
+            result.exitCode = e.code();
+            result.message = e.what();
+            return result;
+        } catch (ExecExcept& e) {
+            except(static_cast<uint32_t>(e.cause()), e.what());
+        } catch (MasmRuntimeError&) {
+            throw;
+        } catch (std::runtime_error& e) {
+            const int32_t pc = state.registers[Register::PC] - 4;
+            const SourceLocator& pcSrc = state.getDebugInfo(pc).source;
+            throw MasmRuntimeError(e.what(), pc, pcSrc.filename, pcSrc.lineno);
+        }
+    }
+    return result;
+}
+
+
+template <std::endian Order>
+bool Simulator::execStep(RunResult& result) {
     uint32_t cause = 0;
     int32_t& pc = state.registers[Register::PC];
     // Update MMIO registers if in MMIO mode and the PC is not in the KTEXT section
     if (ioMode == IOMode::MMIO && static_cast<uint32_t>(pc) < memSectionOffset(MemSection::KTEXT)) {
-        // Bit 0 is the interrupt enable bit
-        const uint32_t interpEnabled = state.cp0[Coproc0Register::STATUS] & 0x1;
-        const uint32_t keyboardEnabled =
-                state.cp0[Coproc0Register::STATUS] & static_cast<uint32_t>(INTERP_CODE::KEYBOARD_INTERP);
-        const uint32_t displayEnabled =
-                state.cp0[Coproc0Register::STATUS] & static_cast<uint32_t>(INTERP_CODE::DISPLAY_INTERP);
-        // Read and right unconditionally to allow for polling without interrupts
-        if (writeMMIO() && interpEnabled && displayEnabled)
-            cause |= static_cast<uint32_t>(INTERP_CODE::DISPLAY_INTERP);
-        else if (readMMIO() && interpEnabled && keyboardEnabled)
-            cause |= static_cast<uint32_t>(INTERP_CODE::KEYBOARD_INTERP);
+        // Output is only pending after a store to the output data word, while input is polled on a fixed interval.  A
+        // poll stays due until the input is actually read, so a display interrupt only defers it by a step
+        const bool outputDirty = state.memory.isOutputDirty();
+        if (inputPollCountdown > 0)
+            inputPollCountdown--;
+        const bool pollInput = inputPollCountdown == 0;
+
+        if (outputDirty || pollInput) {
+            // Bit 0 is the interrupt enable bit
+            const uint32_t interpEnabled = state.cp0[Coproc0Register::STATUS] & 0x1;
+            const uint32_t keyboardEnabled =
+                    state.cp0[Coproc0Register::STATUS] & static_cast<uint32_t>(INTERP_CODE::KEYBOARD_INTERP);
+            const uint32_t displayEnabled =
+                    state.cp0[Coproc0Register::STATUS] & static_cast<uint32_t>(INTERP_CODE::DISPLAY_INTERP);
+            // Read and right unconditionally to allow for polling without interrupts
+            if (outputDirty && writeMMIO() && interpEnabled && displayEnabled)
+                cause |= static_cast<uint32_t>(INTERP_CODE::DISPLAY_INTERP);
+            else if (pollInput) {
+                inputPollCountdown = inputPollInterval;
+                if (readMMIO() && interpEnabled && keyboardEnabled)
+                    cause |= static_cast<uint32_t>(INTERP_CODE::KEYBOARD_INTERP);
+            }
+        }
     }
 
-    if (!state.memory.isValid(pc))
-        throw ExecExit("Execution terminated (Address boundary error)", 139);
+    if (!state.memory.isValid(pc)) {
+        result.status = RunStatus::FAULT;
+        result.exitCode = 139;
+        result.message = "Execution terminated (Address boundary error)";
+        return true;
+    }
 
-    const SourceLocator pcSrc = state.getDebugInfo(pc).source;
-    if (pc >= TEXT_SEC_END)
+    if (pc >= TEXT_SEC_END) {
+        const SourceLocator& pcSrc = state.getDebugInfo(pc).source;
         throw MasmRuntimeError("Out of bounds read access", pc, pcSrc.filename, pcSrc.lineno);
-    const int32_t instruction = state.memory.wordAt(pc);
+    }
+    const DecodedInstruction& instruction = decodeCache.fetch(state.memory, pc);
     // Increment program counter
     pc += 4;
 
     if (cause) {
         interrupt(cause);
-        return;
+        return false;
     }
-
-    try {
-        execInstruction(instruction);
-    } catch (ExecExit&) {
-        throw;
-    } catch (ExecExcept& e) {
-        cause = static_cast<uint32_t>(e.cause());
-        except(cause, e.what());
-    } catch (std::runtime_error& e) {
-        throw MasmRuntimeError(e.what(), pc - 4, pcSrc.filename, pcSrc.lineno);
+    // Only an instruction that is actually dispatched counts as a step
+    result.steps++;
+    if (instrumented)
+        observe(pc - 4, instruction);
+
+    if (instruction.format == InstrFormat::BREAK) {
+        result.status = RunStatus::BREAK;
+        result.exitCode = static_cast<int32_t>(instruction.target >> 6);
+        result.message = "Break instruction executed";
+        return true;
     }
+
+    if (const std::optional<ExecTrap> trap = execInstruction<Order>(instruction))
+        except(static_cast<uint32_t>(trap->cause), trap->what());
+    return false;
 }
 
 
-void Simulator::execInstruction(const int32_t instruction) {
-    if (instruction == 0x0000000C) {
-        // Syscall instruction
-        sysHandle.exec(ioMode, state, streamHandle);
-        return;
-    }
-    if (instruction == 0x42000018) {
-        // Eret instruction
-        execEret(state.cp0, state.registers);
-        return;
+template <std::endian Order>
+void Simulator::execBlock(const TranslatedBlock& block, RunResult& result) {
+    int32_t& pc = state.registers[Register::PC];
+    RegisterFile& registers = state.registers;
+    for (const BlockOp& op : block.ops) {
+        pc = static_cast<int32_t>(op.address + 4);
+        if (instrumented) {
+            observe(op.address, op.first);
+            if (op.kind != BlockOpKind::SINGLE)
+                observe(op.address + 4, op.second);
+        }
+        switch (op.kind) {
+            case BlockOpKind::SINGLE: {
+                result.steps++;
+                if (const std::optional<ExecTrap> trap = execInstruction<Order>(op.first)) {
+                    except(static_cast<uint32_t>(trap->cause), trap->what());
+                    return;
+                }
+                break;
+            }
+            case BlockOpKind::LOAD_CONST: {
+                result.steps += 2;
+                pc += 4;
+                registers[op.first.rt] = op.first.immediate << 16;
+                registers[op.second.rt] = registers[op.second.rs] | op.second.immediate;
+                break;
+            }
+            case BlockOpKind::SLT_BRANCH: {
+                result.steps += 2;
+                pc += 4;
+                registers[op.first.rd] = registers[op.first.rs] < registers[op.first.rt] ? 1 : 0;
+                const bool isSet = registers[op.second.rs] != 0;
+                if (isSet == (op.second.opCode == InstructionCode::BNE))
+                    // Sign-extend the word offset
+                    pc += static_cast<int16_t>(op.second.immediate) * 4;
+                break;
+            }
+        }
+
+        // Stop if this block overwrote translated code, which may include the rest of this block
+        if (blockCache.isStale())
+            return;
     }
+}
 
-    const uint32_t opCode = instruction >> 26 & 0x3F;
-    const uint32_t funct = instruction & 0x3F; // Not always applicable to a single section
-    if (opCode == 0x10) {
-        // Co-Processor 0 instruction
-        const uint32_t rs = instruction >> 21 & 0x1F;
-        const uint32_t rt = instruction >> 16 & 0x1F;
-        const uint32_t rd = instruction >> 11 & 0x1F;
-
-        // Execute Co-Processor 0 instruction
-        execCP0Type(state.cp0, state.registers, rs, rt, rd);
-    } else if (opCode == 0x11) {
-        // Used to distinguish Co-Processor 1 instruction types
-        const uint32_t nextFive = instruction >> 21 & 0x1F;
-        // Co-Processor 1 instruction
-        if (nextFive == 0x08) {
-            const uint32_t tf = instruction >> 16 & 0x01;
-            const int32_t offset = instruction & 0xFFFF;
-            // Execute Co-Processor 1 cond immediate instruction
-            execCP1CondImmType(state.cp1, state.registers, tf, offset);
-        } else if (nextFive == 0x00 || nextFive == 0x04) {
-            const uint32_t sub = instruction >> 21 & 0x1F;
-            const uint32_t rt = instruction >> 16 & 0x1F;
-            const uint32_t fs = instruction >> 11 & 0x1F;
-            // Execute Co-Processor 1 reg immediate instruction
-            execCP1RegImmType(state.cp1, state.registers, sub, rt, fs);
-        } else {
-            const uint32_t fmt = instruction >> 21 & 0x1F;
-            const uint32_t ft = instruction >> 16 & 0x1F;
-            const uint32_t fs = instruction >> 11 & 0x1F;
-            const uint32_t fd = instruction >> 6 & 0x1F;
-            const uint32_t func = instruction & 0x3F;
-
-            if ((func >> 4 & 0x03) == 0x03)
-                // Co-Processor 1 cond type instruction
-                execCP1CondType(state.cp1, fmt, ft, fs, func & 0x0F);
-            else
-                // Co-Processor 1 reg type instruction
-                execCP1RegType(state.cp1, fmt, ft, fs, fd, func);
+
+template <std::endian Order>
+std::optional<ExecTrap> Simulator::execInstruction(const DecodedInstruction& instruction) {
+    switch (instruction.format) {
+        case InstrFormat::SYSCALL:
+            sysHandle.exec(ioMode, state, streamHandle);
+            break;
+        case InstrFormat::ERET:
+            execEret(state.cp0, state.registers);
+            break;
+        case InstrFormat::CP0:
+            execCP0Type(state.cp0, state.registers, instruction.rs, instruction.rt, instruction.rd);
+            break;
+        case InstrFormat::CP1_COND_IMM:
+            execCP1CondImmType(state.cp1, state.registers, instruction.rt & 0x01, instruction.immediate);
+            break;
+        case InstrFormat::CP1_REG_IMM:
+            execCP1RegImmType(state.cp1, state.registers, instruction.rs, instruction.rt, instruction.rd);
+            break;
+        case InstrFormat::CP1_COND:
+            execCP1CondType(state.cp1, instruction.rs, instruction.rt, instruction.rd, instruction.funct & 0x0F);
+            break;
+        case InstrFormat::CP1_REG:
+            execCP1RegType(state.cp1, instruction.rs, instruction.rt, instruction.rd, instruction.shamt,
+                           instruction.funct);
+            break;
+        case InstrFormat::CP1_IMM:
+            return execCP1ImmType(state.cp1, state.registers, state.memory, instruction.opCode, instruction.rs,
+                                  instruction.rt, instruction.immediate);
+        case InstrFormat::BREAK:
+            // Handled by the run loop before dispatch
+            break;
+        case InstrFormat::R_TYPE: {
+            const std::optional<ExecTrap> trap = execRType(state.registers, instruction.funct, instruction.rs,
+                                                           instruction.rt, instruction.rd, instruction.shamt);
+            if (callGraph)
+                traceCall(instruction);
+            return trap;
         }
-    } else if (opCode == 0x35 || opCode == 0x31 || opCode == 0x3D || opCode == 0x39) {
-        // Co-Processor 1 immediate instructions
-        const uint32_t base = instruction >> 21 & 0x1F;
-        const uint32_t ft = instruction >> 16 & 0x1F;
-        const uint32_t offset = instruction & 0xFFFF;
-
-        // Execute Co-Processor 1 immediate instruction
-        execCP1ImmType(state.cp1, state.registers, state.memory, opCode, base, ft, offset);
-    } else if (opCode == 0x00 && funct == 0x0D) {
-        // Break instruction
-        const int32_t breakCode = instruction >> 6 & 0xFFFFF;
-        throw ExecExit("Break instruction executed", breakCode);
-    } else if (opCode == 0x00) {
-        // R-Type instruction
-        const uint32_t rs = instruction >> 21 & 0x1F;
-        const uint32_t rt = instruction >> 16 & 0x1F;
-        const uint32_t rd = instruction >> 11 & 0x1F;
-        const uint32_t shamt = instruction >> 6 & 0x1F;
-
-        // Execute R-Type instruction
-        execRType(state.registers, funct, rs, rt, rd, shamt);
-    } else if (opCode == 0x02 || opCode == 0x03) {
-        // J-Type instruction
-        execJType(state.registers, opCode, instruction & 0x3FFFFFF);
-    } else {
-        // I-Type instruction
-        const uint32_t rs = instruction >> 21 & 0x1F;
-        const uint32_t rt = instruction >> 16 & 0x1F;
-        const int32_t immediate = instruction & 0xFFFF;
-
-        // Execute I-Type instruction
-        execIType(state.registers, state.memory, opCode, rs, rt, immediate);
+        case InstrFormat::J_TYPE:
+            execJType(state.registers, instruction.opCode, instruction.target);
+            if (callGraph)
+                traceCall(instruction);
+            break;
+        case InstrFormat::I_TYPE:
+            return execIType<Order>(state.registers, state.memory, instruction.opCode, instruction.rs, instruction.rt,
+                             instruction.immediate);
     }
+    return std::nullopt;
+}
+
+
+RunResult Simulator::run(const uint64_t maxSteps) {
+    // The run loop points activeRun at its result, which must not outlive the loop.  Output buffered by the run is
+    // written out once it stops, so that it is seen before the caller inspects the run or reports its error, and
+    // likewise for the files that the program has written
+    try {
+        const RunResult result = (this->*runLoop)(maxSteps);
+        activeRun = nullptr;
+        streamHandle.flush();
+        files.flush();
+        return result;
+    } catch (...) {
+        activeRun = nullptr;
+        streamHandle.flush();
+        files.flush();
+        throw;
+    }
+}
+
+
+Simulator::RunLoop Simulator::selectRunLoop(const bool useLittleEndian) {
+    return useLittleEndian ? &Simulator::runOrdered<std::endian::little> : &Simulator::runOrdered<std::endian::big>;
 }
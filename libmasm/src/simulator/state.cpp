@@ -39,18 +39,29 @@ std::string causeToString(const uint32_t cause) {
 }
 
 
-DebugInfo State::getDebugInfo(const uint32_t addr) const {
-    if (debugInfo.contains(addr))
-        return debugInfo.at(addr);
-    return {{"<unknown>", 0, "<unknown>"}, ""};
+const DebugInfo& State::getDebugInfo(const uint32_t addr) const {
+    static const DebugInfo unknownInfo = {{"<unknown>", 0, "<unknown>"}, ""};
+    const DebugInfo* info = debugInfo->find(addr);
+    return info != nullptr ? *info : unknownInfo;
 }
 
 
-void State::loadProgram(const MemLayout& layout) {
-    for (const std::pair<MemSection, std::vector<std::byte>> pair : layout.data)
-        for (size_t i = 0; i < pair.second.size(); i++) {
-            const uint32_t memOffset = memSectionOffset(pair.first) + i;
-            memory[memOffset] = pair.second[i];
-        }
-    debugInfo = layout.debugInfo;
+void State::loadProgram(const MemLayout& layout) { loadProgram(ProgramImage(layout)); }
+
+
+void State::loadProgram(const ProgramImage& image) {
+    memory.overlay(image.pages());
+    debugInfo = image.debugTable();
+}
+
+
+StateSnapshot State::snapshot() const { return {registers, cp0, cp1, memory.snapshot(), heapAllocator}; }
+
+
+void State::restore(const StateSnapshot& snapshot) {
+    registers = snapshot.registers;
+    cp0 = snapshot.cp0;
+    cp1 = snapshot.cp1;
+    memory.restore(snapshot.memory);
+    heapAllocator = snapshot.heapAllocator;
 }
@@ -4,8 +4,14 @@
 
 #include <masm/simulator/syscalls.hpp>
 
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <chrono>
-#include <iomanip>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
 #include <unistd.h>
 
 #include <masm/exceptions.hpp>
@@ -13,11 +19,98 @@
 #include <masm/simulator/cpu.hpp>
 
 
+/**
+ * The size of the stack buffer that numbers are formatted into, which fits any 32-bit integer in binary and any
+ * float or double printed with six significant digits
+ */
+static constexpr size_t NUMBER_BUFFER_SIZE = 40;
+
+
+/**
+ * Reads a null-terminated string out of memory
+ * @param state The state holding the string
+ * @param address The address of the first character
+ * @return The string, without its terminator
+ */
+static std::string stringAt(State& state, uint32_t address) {
+    std::string str;
+    while (true) {
+        const unsigned char c = state.memory.byteAt(address);
+        if (c == '\0')
+            return str;
+        str += static_cast<char>(c);
+        address++;
+    }
+}
+
+
+/**
+ * Formats a floating-point value the same way as an ostream with a precision of 6, and writes it to the output
+ * @param value The value to print
+ * @param streamHandle The stream to write to
+ */
+template<typename T>
+static void printFloating(const T value, StreamHandle& streamHandle) {
+    char buffer[NUMBER_BUFFER_SIZE];
+    const char* end = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6).ptr;
+    streamHandle.write({buffer, end});
+}
+
+
+/**
+ * Parses a number from a line of input with the leniency of the std::sto* functions.  Leading whitespace and a plus
+ * sign are skipped, hexadecimal floats are accepted and anything after the number is ignored
+ * @param input The line of input to parse
+ * @param value Set to the parsed number if parsing succeeded
+ * @return The error code of the parse, which is empty on success
+ */
+template<typename T>
+static std::errc parseNumber(const std::string_view input, T& value) {
+    const char* first = input.data() + std::min(input.find_first_not_of(" \t\n\v\f\r"), input.size());
+    const char* last = input.data() + input.size();
+    if (first != last && *first == '+') {
+        first++;
+        // A second sign is not part of a number
+        if (first != last && (*first == '+' || *first == '-'))
+            return std::errc::invalid_argument;
+    }
+
+    if constexpr (std::is_floating_point_v<T>) {
+        const bool negative = first != last && *first == '-';
+        const char* digits = first + negative;
+        if (last - digits > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+            // from_chars takes hexadecimal floats without their prefix
+            const std::from_chars_result result = std::from_chars(digits + 2, last, value, std::chars_format::hex);
+            if (result.ec == std::errc{} && negative)
+                value = -value;
+            return result.ec;
+        }
+    }
+    return std::from_chars(first, last, value).ec;
+}
+
+
 void SystemHandle::requiresSyscallMode(const IOMode ioMode, const std::string& syscallName) {
     if (ioMode != IOMode::SYSCALL)
         throw ExecExcept(syscallName + " syscall not supported in MMIO mode", EXCEPT_CODE::SYSCALL_EXCEPTION);
 }
 
+void SystemHandle::journalBytes(const std::span<char> bytes) {
+    // Bytes are packed eight to an event
+    for (size_t i = 0; i < bytes.size(); i += 8) {
+        const size_t count = std::min<size_t>(8, bytes.size() - i);
+        auto packBytes = [&] {
+            uint64_t packed = 0;
+            for (size_t j = 0; j < count; j++)
+                packed |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i + j])) << 8 * j;
+            return static_cast<int64_t>(packed);
+        };
+        const auto packed = static_cast<uint64_t>(journal->consume(InputEventKind::FILE_DATA, packBytes));
+        for (size_t j = 0; j < count; j++)
+            bytes[i + j] = static_cast<char>(packed >> 8 * j & 0xFF);
+    }
+}
+
 void SystemHandle::exec(const IOMode ioMode, State& state, StreamHandle& streamHandle) {
     int32_t syscallCode = state.registers[Register::V0];
 
@@ -57,6 +150,12 @@ void SystemHandle::exec(const IOMode ioMode, State& state, StreamHandle& streamH
         case Syscall::HEAP_ALLOC:
             heapAlloc(state);
             break;
+        case Syscall::HEAP_FREE:
+            heapFree(state);
+            break;
+        case Syscall::HEAP_REALLOC:
+            heapRealloc(state);
+            break;
         case Syscall::EXIT:
             exit();
             break;
@@ -68,6 +167,18 @@ void SystemHandle::exec(const IOMode ioMode, State& state, StreamHandle& streamH
             requiresSyscallMode(ioMode, "READ_CHAR");
             readChar(state, streamHandle);
             break;
+        case Syscall::OPEN_FILE:
+            openFile(state);
+            break;
+        case Syscall::READ_FILE:
+            readFile(ioMode, state, streamHandle);
+            break;
+        case Syscall::WRITE_FILE:
+            writeFile(ioMode, state, streamHandle);
+            break;
+        case Syscall::CLOSE_FILE:
+            closeFile(state);
+            break;
         case Syscall::EXIT_VAL:
             exitVal(state);
             break;
@@ -75,6 +186,8 @@ void SystemHandle::exec(const IOMode ioMode, State& state, StreamHandle& streamH
             time(state);
             break;
         case Syscall::SLEEP:
+            // Output written before a pause is shown during it
+            streamHandle.flush();
             sleep(state);
             break;
         case Syscall::PRINT_INT_HEX:
@@ -109,67 +222,74 @@ void SystemHandle::exec(const IOMode ioMode, State& state, StreamHandle& streamH
     }
 }
 
+const std::map<size_t, RandomGenerator>& SystemHandle::randomGenerators() const { return rngMap; }
+
+void SystemHandle::setRandomGenerators(std::map<size_t, RandomGenerator> generators) { rngMap = std::move(generators); }
+
+void SystemHandle::setInputJournal(InputJournal* inputJournal) { journal = inputJournal; }
+
+void SystemHandle::setFileTable(FileTable* fileTable) { files = fileTable; }
+
+RandomGenerator& SystemHandle::generatorFor(const int32_t id) {
+    auto it = rngMap.find(id);
+    if (it == rngMap.end()) {
+        auto readSeed = [] { return static_cast<int64_t>(std::time(nullptr)); };
+        const int64_t seed = journal != nullptr ? journal->consume(InputEventKind::SEED, readSeed) : readSeed();
+        it = rngMap.emplace(id, RandomGenerator(static_cast<unsigned int>(seed))).first;
+    }
+    return it->second;
+}
+
 void SystemHandle::printInt(const State& state, StreamHandle& streamHandle) {
     const int32_t value = state.registers[Register::A0];
-    streamHandle.putStr(std::to_string(value));
+    char buffer[NUMBER_BUFFER_SIZE];
+    streamHandle.write({buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr});
 }
 
 void SystemHandle::printFloat(const State& state, StreamHandle& streamHandle) {
-    const float value = state.cp1.getFloat(Coproc1Register::F12);
-    std::ostringstream oss;
-    oss << std::setprecision(6) << value; // Set precision for float output
-    streamHandle.putStr(oss.str());
+    printFloating(state.cp1.getFloat(Coproc1Register::F12), streamHandle);
 }
 
 void SystemHandle::printDouble(const State& state, StreamHandle& streamHandle) {
-    const double value = state.cp1.getDouble(Coproc1Register::F12);
-    std::ostringstream oss;
-    oss << std::setprecision(6) << value; // Set precision for double output
-    streamHandle.putStr(oss.str());
+    printFloating(state.cp1.getDouble(Coproc1Register::F12), streamHandle);
 }
 
 void SystemHandle::printString(State& state, StreamHandle& streamHandle) {
-    int32_t address = state.registers[Register::A0];
-    while (true) {
-        const unsigned char c = state.memory.byteAt(address);
-        if (c == '\0')
-            break;
-        streamHandle.putChar(static_cast<char>(c));
-        address++;
-    }
+    // Gather the whole string so that it is written in one piece
+    streamHandle.putStr(stringAt(state, state.registers[Register::A0]));
 }
 
 void SystemHandle::readInt(State& state, StreamHandle& streamHandle) {
     const std::string input = streamHandle.getLine();
-    try {
-        state.registers[Register::V0] = std::stoi(input);
-    } catch (const std::invalid_argument&) {
-        throw ExecExcept("Invalid input: " + input, EXCEPT_CODE::SYSCALL_EXCEPTION);
-    } catch (const std::out_of_range&) {
+    int32_t value = 0;
+    const std::errc error = parseNumber(input, value);
+    if (error == std::errc::result_out_of_range)
         throw ExecExcept("Input out of range: " + input, EXCEPT_CODE::SYSCALL_EXCEPTION);
-    }
+    if (error != std::errc{})
+        throw ExecExcept("Invalid input: " + input, EXCEPT_CODE::SYSCALL_EXCEPTION);
+    state.registers[Register::V0] = value;
 }
 
 void SystemHandle::readFloat(State& state, StreamHandle& streamHandle) {
     const std::string input = streamHandle.getLine();
-    try {
-        state.cp1.setFloat(Coproc1Register::F0, std::stof(input));
-    } catch (const std::invalid_argument&) {
-        throw ExecExcept("Invalid float input: " + input, EXCEPT_CODE::SYSCALL_EXCEPTION);
-    } catch (const std::out_of_range&) {
+    float value = 0;
+    const std::errc error = parseNumber(input, value);
+    if (error == std::errc::result_out_of_range)
         throw ExecExcept("Float input out of range: " + input, EXCEPT_CODE::SYSCALL_EXCEPTION);
-    }
+    if (error != std::errc{})
+        throw ExecExcept("Invalid float input: " + input, EXCEPT_CODE::SYSCALL_EXCEPTION);
+    state.cp1.setFloat(Coproc1Register::F0, value);
 }
 
 void SystemHandle::readDouble(State& state, StreamHandle& streamHandle) {
     const std::string input = streamHandle.getLine();
-    try {
-        state.cp1.setDouble(Coproc1Register::F0, std::stod(input));
-    } catch (const std::invalid_argument&) {
-        throw ExecExcept("Invalid double input: " + input, EXCEPT_CODE::SYSCALL_EXCEPTION);
-    } catch (const std::out_of_range&) {
+    double value = 0;
+    const std::errc error = parseNumber(input, value);
+    if (error == std::errc::result_out_of_range)
         throw ExecExcept("Double input out of range: " + input, EXCEPT_CODE::SYSCALL_EXCEPTION);
-    }
+    if (error != std::errc{})
+        throw ExecExcept("Invalid double input: " + input, EXCEPT_CODE::SYSCALL_EXCEPTION);
+    state.cp1.setDouble(Coproc1Register::F0, value);
 }
 
 
@@ -192,13 +312,39 @@ void SystemHandle::readString(State& state, StreamHandle& streamHandle) {
 
 void SystemHandle::heapAlloc(State& state) {
     const int32_t size = state.registers[Register::A0];
-    const int32_t ptr = static_cast<int32_t>(state.heapAllocator.allocate(size));
+    // The heap may not grow past the stack
+    const auto stackPointer = static_cast<uint32_t>(state.registers[Register::SP]);
+    state.registers[Register::V0] = static_cast<int32_t>(state.heapAllocator.allocate(size, stackPointer));
+}
 
-    // Throw if the heap has overflowed past the stack
-    if (static_cast<int32_t>(state.heapAllocator.top()) > state.registers[Register::SP])
-        throw ExecExcept("Out of Memory", EXCEPT_CODE::SYSCALL_EXCEPTION);
+void SystemHandle::heapFree(State& state) {
+    const uint32_t address = state.registers[Register::A0];
+    if (address != 0)
+        state.heapAllocator.free(address);
+}
 
-    state.registers[Register::V0] = ptr;
+void SystemHandle::heapRealloc(State& state) {
+    const uint32_t address = state.registers[Register::A0];
+    const uint32_t size = state.registers[Register::A1];
+    if (size == 0 && address != 0) {
+        state.heapAllocator.free(address);
+        state.registers[Register::V0] = 0;
+        return;
+    }
+
+    const uint32_t oldSize = address != 0 ? state.heapAllocator.sizeOf(address) : 0;
+    // The heap may not grow past the stack, which is checked before the block is moved or resized
+    const auto stackPointer = static_cast<uint32_t>(state.registers[Register::SP]);
+    const uint32_t ptr = address != 0 ? state.heapAllocator.reallocate(address, size, stackPointer)
+                                      : state.heapAllocator.allocate(size, stackPointer);
+
+    // Freeing a block leaves its bytes in place, so a moved block can be copied after the old one is freed
+    if (ptr != address && oldSize != 0) {
+        std::vector<std::byte> contents(std::min(oldSize, size));
+        state.memory.bytesAt(address, contents);
+        state.memory.bytesTo(ptr, contents);
+    }
+    state.registers[Register::V0] = static_cast<int32_t>(ptr);
 }
 
 void SystemHandle::exit() { throw ExecExit(0); }
@@ -213,6 +359,112 @@ void SystemHandle::readChar(State& state, StreamHandle& streamHandle) {
     state.registers[Register::V0] = 0xFF & static_cast<int32_t>(c);
 }
 
+void SystemHandle::openFile(State& state) {
+    const std::string name = stringAt(state, state.registers[Register::A0]);
+    const int32_t flags = state.registers[Register::A1];
+    auto openHostFile = [&] { return static_cast<int64_t>(files != nullptr ? files->open(name, flags) : -1); };
+    state.registers[Register::V0] = static_cast<int32_t>(
+            journal != nullptr ? journal->consume(InputEventKind::FILE_OPEN, openHostFile) : openHostFile());
+}
+
+void SystemHandle::readFile(const IOMode ioMode, State& state, StreamHandle& streamHandle) {
+    const int32_t descriptor = state.registers[Register::A0];
+    const uint32_t address = state.registers[Register::A1];
+    const int32_t length = state.registers[Register::A2];
+    if (length < 0) {
+        state.registers[Register::V0] = -1;
+        return;
+    }
+
+    // Bytes are staged a guest page at a time and copied into memory in bulk
+    std::array<char, MEM_PAGE_SIZE> buffer;
+    int32_t total = 0;
+    if (descriptor == STDIN_FILENO) {
+        requiresSyscallMode(ioMode, "READ_FILE");
+        // Console input is read up to the end of the line, as it would be from a terminal
+        while (total < length) {
+            const size_t chunk = std::min<size_t>(length - total, buffer.size());
+            size_t count = 0;
+            char c = 0;
+            while (count < chunk && c != '\n')
+                buffer[count++] = c = streamHandle.getCharBlocking();
+            state.memory.bytesTo(address + total, std::as_bytes(std::span(buffer.data(), count)));
+            total += static_cast<int32_t>(count);
+            if (c == '\n')
+                break;
+        }
+        state.registers[Register::V0] = total;
+        return;
+    }
+
+    // Host files are read through the journal, so that a replay takes the bytes from the log instead of the host
+    while (total < length) {
+        const uint32_t offset = (address + total) % MEM_PAGE_SIZE;
+        const size_t chunk = std::min<size_t>(length - total, MEM_PAGE_SIZE - offset);
+        auto readHostFile = [&] {
+            const std::span data(buffer.data(), chunk);
+            return static_cast<int64_t>(files != nullptr ? files->read(descriptor, data) : -1);
+        };
+        const auto count = static_cast<int32_t>(
+                journal != nullptr ? journal->consume(InputEventKind::FILE_READ, readHostFile) : readHostFile());
+        if (count < 0) {
+            state.registers[Register::V0] = -1;
+            return;
+        }
+        if (static_cast<size_t>(count) > chunk)
+            throw std::runtime_error("Replayed file read is longer than the read requested");
+        if (journal != nullptr)
+            journalBytes(std::span(buffer.data(), count));
+        state.memory.bytesTo(address + total, std::as_bytes(std::span(buffer.data(), count)));
+        total += count;
+        if (static_cast<size_t>(count) < chunk)
+            break;
+    }
+    state.registers[Register::V0] = total;
+}
+
+void SystemHandle::writeFile(const IOMode ioMode, State& state, StreamHandle& streamHandle) {
+    const int32_t descriptor = state.registers[Register::A0];
+    const uint32_t address = state.registers[Register::A1];
+    const int32_t length = state.registers[Register::A2];
+    const bool console = descriptor == STDOUT_FILENO || descriptor == STDERR_FILENO;
+    if (console)
+        requiresSyscallMode(ioMode, "WRITE_FILE");
+    if (length < 0) {
+        state.registers[Register::V0] = -1;
+        return;
+    }
+
+    // Bytes are copied out of memory in bulk a guest page at a time
+    std::array<char, MEM_PAGE_SIZE> buffer;
+    int32_t total = 0;
+    while (total < length) {
+        const uint32_t offset = (address + total) % MEM_PAGE_SIZE;
+        const size_t chunk = std::min<size_t>(length - total, MEM_PAGE_SIZE - offset);
+        state.memory.bytesAt(address + total, std::as_writable_bytes(std::span(buffer.data(), chunk)));
+        if (console)
+            streamHandle.write({buffer.data(), chunk});
+        else {
+            auto writeHostFile = [&] {
+                return static_cast<int64_t>(files != nullptr ? files->write(descriptor, {buffer.data(), chunk}) : -1);
+            };
+            const int64_t written =
+                    journal != nullptr ? journal->consume(InputEventKind::FILE_WRITE, writeHostFile) : writeHostFile();
+            if (written < 0) {
+                state.registers[Register::V0] = -1;
+                return;
+            }
+        }
+        total += static_cast<int32_t>(chunk);
+    }
+    state.registers[Register::V0] = total;
+}
+
+void SystemHandle::closeFile(const State& state) {
+    if (files != nullptr)
+        files->close(state.registers[Register::A0]);
+}
+
 void SystemHandle::exitVal(const State& state) {
     const int32_t exitCode = state.registers[Register::A0];
     throw ExecExit(exitCode);
@@ -220,9 +472,12 @@ void SystemHandle::exitVal(const State& state) {
 
 void SystemHandle::time(State& state) {
     // Get the current time in milliseconds since the epoch
-    const auto now = std::chrono::system_clock::now();
-    const auto duration = now.time_since_epoch();
-    const int64_t milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    auto readClock = [] {
+        const auto now = std::chrono::system_clock::now();
+        const auto duration = now.time_since_epoch();
+        return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+    };
+    const int64_t milliseconds = journal != nullptr ? journal->consume(InputEventKind::TIME, readClock) : readClock();
 
     // Store high bits in $a1 and low bits in $a0
     state.registers[Register::A0] = static_cast<int32_t>(milliseconds & 0xFFFFFFFF);
@@ -234,25 +489,32 @@ void SystemHandle::sleep(State& state) {
     if (milliseconds < 0)
         throw ExecExcept("Negative sleep time: " + std::to_string(milliseconds), EXCEPT_CODE::SYSCALL_EXCEPTION);
 
-    usleep(milliseconds * 1000);
+    if (journal == nullptr || journal->mode() != JournalMode::REPLAY)
+        usleep(milliseconds * 1000);
 }
 
 void SystemHandle::printIntHex(const State& state, StreamHandle& streamHandle) {
-    const int32_t value = state.registers[Register::A0];
-    std::ostringstream oss;
-    oss << std::hex << std::setw(8) << std::setfill('0') << value;
-    streamHandle.putStr(oss.str());
+    const uint32_t value = state.registers[Register::A0];
+    char digits[8];
+    char* end = std::to_chars(digits, digits + sizeof(digits), value, 16).ptr;
+    // Right-align the digits in eight characters padded with zeros
+    char buffer[8];
+    std::fill(buffer, std::copy_backward(digits, end, buffer + sizeof(buffer)), '0');
+    streamHandle.write(buffer);
 }
 
 void SystemHandle::printIntBin(const State& state, StreamHandle& streamHandle) {
     const int32_t value = state.registers[Register::A0];
+    char buffer[32];
     for (int i = 31; i >= 0; --i)
-        streamHandle.putStr(std::to_string(value >> i & 1));
+        buffer[31 - i] = static_cast<char>('0' + (value >> i & 1));
+    streamHandle.write(buffer);
 }
 
 void SystemHandle::printUInt(const State& state, StreamHandle& streamHandle) {
     const uint32_t value = state.registers[Register::A0];
-    streamHandle.putStr(std::to_string(value));
+    char buffer[NUMBER_BUFFER_SIZE];
+    streamHandle.write({buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr});
 }
 
 void SystemHandle::setRandSeed(State& state) {
@@ -263,29 +525,21 @@ void SystemHandle::setRandSeed(State& state) {
 
 void SystemHandle::randInt(State& state) {
     const int32_t id = state.registers[Register::A0];
-    if (!rngMap.contains(id))
-        rngMap[id] = RandomGenerator();
-    state.registers[Register::A0] = static_cast<int32_t>(rngMap[id].getRandomInt());
+    state.registers[Register::A0] = static_cast<int32_t>(generatorFor(id).getRandomInt());
 }
 
 void SystemHandle::randIntRange(State& state) {
     const int32_t id = state.registers[Register::A0];
     const int32_t max = state.registers[Register::A1];
-    if (!rngMap.contains(id))
-        rngMap[id] = RandomGenerator();
-    state.registers[Register::A0] = static_cast<int32_t>(rngMap[id].getRandomInt(max));
+    state.registers[Register::A0] = static_cast<int32_t>(generatorFor(id).getRandomInt(max));
 }
 
 void SystemHandle::randFloat(State& state) {
     const int32_t id = state.registers[Register::A0];
-    if (!rngMap.contains(id))
-        rngMap[id] = RandomGenerator();
-    state.cp1.setFloat(Coproc1Register::F0, rngMap[id].getRandomFloat());
+    state.cp1.setFloat(Coproc1Register::F0, generatorFor(id).getRandomFloat());
 }
 
 void SystemHandle::randDouble(State& state) {
     const int32_t id = state.registers[Register::A0];
-    if (!rngMap.contains(id))
-        rngMap[id] = RandomGenerator();
-    state.cp1.setDouble(Coproc1Register::F0, rngMap[id].getRandomDouble());
+    state.cp1.setDouble(Coproc1Register::F0, generatorFor(id).getRandomDouble());
 }
@@ -7,6 +7,7 @@
 #include <masm/assembler/parser.hpp>
 #include <masm/assembler/serialization.hpp>
 #include <masm/io/consoleio.hpp>
+#include <masm/simulator/aot.hpp>
 
 #include "fileio.hpp"
 #include "load_layout.hpp"
@@ -22,6 +23,7 @@ int main(const int argc, char* argv[]) {
     bool useLittleEndian = false;
     bool debugBuild = false;
     bool saveTemps = false;
+    bool emitCpp = false;
     std::string outputFileName;
 
     CLI::App app{version + " - MIPS Assembler", name};
@@ -30,6 +32,8 @@ int main(const int argc, char* argv[]) {
                  "Use little-endian byte order for memory layout (default is big-endian)");
     app.add_flag("-g", debugBuild, "Whether to generate a debug build");
     app.add_flag("--save-temps", saveTemps, "Write intermediate files to the current working directory");
+    app.add_flag("--emit-cpp", emitCpp,
+                 "Write a C++ translation of the program that runs natively when linked against libmasm");
     app.add_option("-o", outputFileName, "The name of the output file");
     app.set_version_flag("--version", version);
 
@@ -80,8 +84,12 @@ int main(const int argc, char* argv[]) {
             writeFile(outputFileName + ".i", preprocessed);
         }
 
-        const std::vector<std::byte> binary = saveLayout(layout, debugBuild);
-        writeFileBytes(outputFileName + ".o", binary);
+        if (emitCpp)
+            writeFile(outputFileName + ".cpp", translateLayout(layout, useLittleEndian));
+        else {
+            const std::vector<std::byte> binary = saveLayout(layout, debugBuild);
+            writeFileBytes(outputFileName + ".o", binary);
+        }
 
         exitCode = 0;
     } catch (const std::exception& e) {
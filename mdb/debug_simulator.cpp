@@ -130,6 +130,7 @@ void DebugSimulator::interactiveStep(const MemLayout& layout) {
 
 int DebugSimulator::simulate(const MemLayout& layout) {
     initProgram(layout);
+    initialSnapshot = snapshot();
     // Set initial breakpoint at start of program
     breakpoints[state.registers[Register::PC]] = 0;
     isRunning = true;
@@ -147,10 +148,13 @@ int DebugSimulator::simulate(const MemLayout& layout) {
             } else
                 step();
         } catch (DebuggerExit& e) {
+            streamHandle.flush();
             return e.code();
         } catch (MasmRuntimeError& e) {
-            if (!isInteractive)
+            if (!isInteractive) {
+                streamHandle.flush();
                 throw;
+            }
 
             streamHandle.putStr(std::format("{}", e.what()));
             isRunning = false;
@@ -159,8 +163,10 @@ int DebugSimulator::simulate(const MemLayout& layout) {
         } catch (ExecExit& e) {
             streamHandle.putStr(std::format("{}", e.what()));
             isRunning = false;
-            if (!isInteractive)
+            if (!isInteractive) {
+                streamHandle.flush();
                 return e.code();
+            }
 
             // Decrement PC
             state.registers[Register::PC] -= 4;
@@ -373,12 +379,17 @@ bool DebugSimulator::execCommand(const std::string& cmdStr, const MemLayout& lay
 }
 
 void DebugSimulator::resetSimulator(const MemLayout& layout) {
-    // Clear state
-    state = State(state.memory.isLittleEndian());
-    // Clear Syscall State
-    sysHandle = SystemHandle();
-    // Reinitialize program with the current memory layout
-    initProgram(layout);
+    if (initialSnapshot)
+        // Only the pages written to since the program was loaded need to be reset
+        restore(*initialSnapshot);
+    else {
+        // Clear state
+        state = State(state.memory.isLittleEndian());
+        // Clear Syscall State
+        sysHandle = SystemHandle();
+        // Reinitialize program with the current memory layout
+        initProgram(layout);
+    }
     // Set initial breakpoint at start of program
     breakpoints[state.registers[Register::PC]] = 0;
     isRunning = true;
@@ -416,10 +427,10 @@ void DebugSimulator::getFrame() {
 
 size_t DebugSimulator::locateLabelInFile(const std::string& label, const std::string& filename) {
     // Find debug info that matches the given label in the current file
-    const auto it = std::ranges::find_if(state.debugInfo, [label, filename](const auto& pair) {
+    const auto it = std::ranges::find_if(*state.debugInfo, [label, filename](const auto& pair) {
         return unmangleDebugLabel(pair.second.label) == label && pair.second.source.filename == filename;
     });
-    if (it == state.debugInfo.end())
+    if (it == state.debugInfo->end())
         throw std::invalid_argument("Cannot find label: '" + label + "' in file " + filename);
     // Get the line for the label
     return it->second.source.lineno;
@@ -460,11 +471,11 @@ uint32_t DebugSimulator::addrFromStr(const std::string& ref) {
     }
 
     // Find debug info that matches file and line
-    const auto it = std::ranges::find_if(state.debugInfo, [refLine, refFile](const auto& pair) {
+    const auto it = std::ranges::find_if(*state.debugInfo, [refLine, refFile](const auto& pair) {
         const SourceLocator src = pair.second.source;
         return src.filename == refFile && src.lineno == refLine;
     });
-    if (it == state.debugInfo.end())
+    if (it == state.debugInfo->end())
         throw std::invalid_argument("Cannot find memory at " + refFile + ":" + std::to_string(refLine));
     return it->first;
 }
@@ -533,7 +544,7 @@ void DebugSimulator::listBreakpoints() {
 
 void DebugSimulator::listLabels() {
     bool foundLabel = false;
-    for (const auto& [addr, debugInfo] : state.debugInfo)
+    for (const auto& [addr, debugInfo] : *state.debugInfo)
         if (!debugInfo.label.empty()) {
             const SourceLocator src = debugInfo.source;
             streamHandle.putStr(std::format("{} -> 0x{:08x} ({}:{})\n", unmangleDebugLabel(debugInfo.label), addr,
@@ -624,8 +635,8 @@ void DebugSimulator::printRegister(const std::string& arg) {
 void DebugSimulator::printRef(const std::string& arg) {
     const uint32_t addr = addrFromStr(arg);
 
-    if (state.debugInfo.contains(addr)) {
-        const DebugInfo debugInfo = state.debugInfo[addr];
+    if (state.debugInfo->contains(addr)) {
+        const DebugInfo& debugInfo = state.debugInfo->at(addr);
         streamHandle.putStr(
                 std::format("({}:{}) -> \"{}\" \n", debugInfo.source.filename, debugInfo.source.lineno, strAt(addr)));
     } else
@@ -5,6 +5,8 @@
 #ifndef DEBUG_SIMULATOR_H
 #define DEBUG_SIMULATOR_H
 
+#include <optional>
+
 #include <masm/simulator/simulator.hpp>
 
 
@@ -58,6 +60,11 @@ class DebugSimulator final : public Simulator {
      */
     std::map<uint32_t, size_t> breakpoints;
 
+    /**
+     * The state of the program just after it was first loaded, restored whenever the debugger is reset
+     */
+    std::optional<SimulatorSnapshot> initialSnapshot;
+
     /**
      * Detects if the debugger must pause execution due to a breakpoint and gather user input
      * @param layout The initial memory layout to use for resetting the debugger
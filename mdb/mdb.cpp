@@ -22,12 +22,16 @@ int main(const int argc, char* argv[]) {
     std::vector<std::string> inputFileNames;
     bool useMMIO = false;
     bool useLittleEndian = false;
+    std::string sandboxDirectory;
 
     CLI::App app{version + " - Masm Debugger", name};
     app.add_option("file", inputFileNames, "A MIPS binary object file")->required();
     app.add_flag("-m,--mmio", useMMIO, "Use memory-mapped I/O instead of system calls for input/output operations");
     app.add_flag("-l,--little-endian", useLittleEndian,
                  "Use little-endian byte order for memory layout (default is big-endian)");
+    app.add_option("--sandbox", sandboxDirectory,
+                   "Directory that the program may open files within (default is none, so no file can be opened)")
+            ->check(CLI::ExistingDirectory);
     app.set_version_flag("--version", version);
 
     // Set up help message
@@ -57,6 +61,8 @@ int main(const int argc, char* argv[]) {
         const IOMode ioMode = useMMIO ? IOMode::MMIO : IOMode::SYSCALL;
         DebugSimulator simulator(ioMode, conHandle, useLittleEndian);
         simulator.setInteractive(true);
+        if (!sandboxDirectory.empty())
+            simulator.setFileSandbox(expandTilde(sandboxDirectory));
         exitCode = simulator.simulate(layout);
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -1,10 +1,18 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <CLI/CLI.hpp>
 
 #include <masm/io/consoleio.hpp>
+#include <masm/simulator/batch.hpp>
+#include <masm/simulator/checkpoint.hpp>
 #include <masm/simulator/simulator.hpp>
 
 #include "fileio.hpp"
@@ -12,6 +20,119 @@
 #include "version.h"
 
 
+/**
+ * Collects a batch job for every input file in a directory.  Each file named <name>.in.txt is given to the program as
+ * input, and a neighbouring <name>.txt, if present, holds the output that the program is expected to produce
+ * @param directory The directory to collect jobs from
+ * @return The jobs, sorted by name
+ * @throw runtime_error When the directory cannot be read or holds no input files
+ */
+std::vector<BatchJob> loadBatchJobs(const std::string& directory) {
+    const std::string inputSuffix = ".in.txt";
+    std::vector<BatchJob> jobs;
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(expandTilde(directory), ec)) {
+        const std::string fileName = entry.path().filename().string();
+        if (!entry.is_regular_file() || !fileName.ends_with(inputSuffix))
+            continue;
+
+        BatchJob job;
+        job.name = fileName.substr(0, fileName.size() - inputSuffix.size());
+        job.input = readFile(entry.path().string());
+        const std::filesystem::path expectedPath = entry.path().parent_path() / (job.name + ".txt");
+        if (std::filesystem::is_regular_file(expectedPath))
+            job.expectedOutput = readFile(expectedPath.string());
+        jobs.push_back(job);
+    }
+
+    if (ec)
+        throw std::runtime_error("Could not read batch directory " + directory);
+    if (jobs.empty())
+        throw std::runtime_error("No input files found in batch directory " + directory);
+
+    std::ranges::sort(jobs, {}, &BatchJob::name);
+    return jobs;
+}
+
+
+/**
+ * Writes a checkpoint to a file.  The checkpoint is first written beside the file and then renamed over it, so an
+ * interrupted write never replaces the last complete checkpoint
+ * @param fileName The name of the file to write the checkpoint to
+ * @param checkpoint The checkpoint to write
+ * @throw runtime_error When the checkpoint cannot be written
+ */
+void writeCheckpointFile(const std::string& fileName, const Checkpoint& checkpoint) {
+    const std::string tempFileName = fileName + ".tmp";
+    {
+        std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+        if (!file)
+            throw std::runtime_error("Could not open checkpoint file " + tempFileName);
+        saveCheckpoint(file, checkpoint);
+    }
+    std::filesystem::rename(tempFileName, fileName);
+}
+
+
+/**
+ * Reads a checkpoint from a file and checks that it was taken from the given program
+ * @param fileName The name of the file to read the checkpoint from
+ * @param layout The program that will be resumed
+ * @param useLittleEndian Whether the program was assembled with little-endian byte order
+ * @return The checkpoint
+ * @throw runtime_error When the checkpoint cannot be read or was taken from a different program
+ */
+Checkpoint readCheckpointFile(const std::string& fileName, const MemLayout& layout, const bool useLittleEndian) {
+    std::ifstream file(expandTilde(fileName), std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Could not open checkpoint file " + fileName);
+
+    Checkpoint checkpoint = loadCheckpoint(file);
+    if (checkpoint.programFingerprint != programFingerprint(layout))
+        throw std::runtime_error("Checkpoint " + fileName + " was taken from a different program");
+    if (checkpoint.useLittleEndian != useLittleEndian)
+        throw std::runtime_error("Checkpoint " + fileName + " was taken with a different byte order");
+    return checkpoint;
+}
+
+
+/**
+ * Writes the profile of a run in callgrind format and prints a summary of it
+ * @param fileName The name of the file to write the profile to
+ * @param report The profile of the run
+ * @throw runtime_error When the profile cannot be written
+ */
+void writeProfileFile(const std::string& fileName, const ProfileReport& report) {
+    std::ofstream file(expandTilde(fileName), std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Could not open profile file " + fileName);
+    file << formatCallgrind(report);
+    if (!file)
+        throw std::runtime_error("Failed to write profile file " + fileName);
+
+    std::cerr << formatProfileReport(report, 20);
+}
+
+
+/**
+ * Writes the call graph of a run as folded stacks and prints a summary of it
+ * @param fileName The name of the file to write the folded stacks to
+ * @param report The call graph of the run
+ * @throw runtime_error When the folded stacks cannot be written
+ */
+void writeCallGraphFile(const std::string& fileName, const CallGraphReport& report) {
+    std::ofstream file(expandTilde(fileName), std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Could not open call graph file " + fileName);
+    file << formatFoldedStacks(report);
+    if (!file)
+        throw std::runtime_error("Failed to write call graph file " + fileName);
+
+    std::cerr << formatCallGraphReport(report);
+}
+
+
 int main(const int argc, char* argv[]) {
     std::string name = "msim";
     const std::string _computedVersionString(Version::VERSION);
@@ -20,12 +141,77 @@ int main(const int argc, char* argv[]) {
     std::vector<std::string> inputFileNames;
     bool useMMIO = false;
     bool useLittleEndian = false;
+    uint32_t pollInterval = DEFAULT_INPUT_POLL_INTERVAL;
+    std::string engineName = "interpreter";
+    uint64_t maxInstructions = 0;
+    double timeoutSeconds = 0;
+    std::string batchDirectory;
+    unsigned jobCount = 0;
+    uint64_t checkpointInterval = 0;
+    std::string checkpointFileName;
+    std::string resumeFileName;
+    std::string recordFileName;
+    std::string replayFileName;
+    std::string profileFileName;
+    std::string callGraphFileName;
+    bool simulateCaches = false;
+    std::string l1iSpec;
+    std::string l1dSpec;
+    std::string l2Spec;
+    bool timePipeline = false;
+    std::string sandboxDirectory;
 
     CLI::App app{version + " - MIPS Simulator", name};
     app.add_option("file", inputFileNames, "A MIPS binary object file")->required();
     app.add_flag("-m,--mmio", useMMIO, "Use memory-mapped I/O instead of system calls for input/output operations");
     app.add_flag("-l,--little-endian", useLittleEndian,
                  "Use little-endian byte order for memory layout (default is big-endian)");
+    app.add_option("--poll-interval", pollInterval, "Number of instructions between polls for MMIO input")
+            ->check(CLI::PositiveNumber);
+    app.add_option("--engine", engineName, "Execution engine to run the program with (default is interpreter)")
+            ->check(CLI::IsMember({"interpreter", "jit"}));
+    app.add_option("--max-instructions", maxInstructions,
+                   "Stop the program after executing this many instructions (default is no limit)")
+            ->check(CLI::PositiveNumber);
+    app.add_option("--timeout", timeoutSeconds,
+                   "Stop the program after running for this many seconds (default is no limit)")
+            ->check(CLI::PositiveNumber);
+    app.add_option("--batch", batchDirectory,
+                   "Run the program once for each <name>.in.txt input in this directory, comparing against <name>.txt")
+            ->check(CLI::ExistingDirectory);
+    app.add_option("-j,--jobs", jobCount, "Number of programs to run at once in batch mode (default is one per core)")
+            ->check(CLI::PositiveNumber);
+    CLI::Option* checkpointFileOption =
+            app.add_option("--checkpoint-file", checkpointFileName, "File to periodically save the simulation to");
+    CLI::Option* checkpointEveryOption =
+            app.add_option("--checkpoint-every", checkpointInterval,
+                           "Number of instructions between checkpoints written to the checkpoint file")
+                    ->check(CLI::PositiveNumber)
+                    ->needs(checkpointFileOption);
+    // Either option alone would silently write no checkpoints
+    checkpointFileOption->needs(checkpointEveryOption);
+    app.add_option("--resume", resumeFileName, "Resume the program from a checkpoint file written by a previous run")
+            ->check(CLI::ExistingFile);
+    CLI::Option* recordOption = app.add_option(
+            "--record", recordFileName, "Log every input, clock reading and random seed of the run to this file");
+    app.add_option("--replay", replayFileName, "Feed the program the inputs logged to this file by --record")
+            ->check(CLI::ExistingFile)
+            ->excludes(recordOption);
+    app.add_option("--profile", profileFileName,
+                   "Count the instructions executed by each source line, writing them to this file in callgrind format");
+    app.add_option("--call-graph", callGraphFileName,
+                   "Track the calls of each procedure, writing them to this file as folded stacks for flame graphs");
+    app.add_flag("--cache", simulateCaches,
+                 "Simulate the caches of the machine and print their hits, misses and evictions (default is "
+                 "16k:4:32 L1I and L1D caches with a 256k:8:64 L2 cache)");
+    app.add_option("--l1i", l1iSpec, "Shape of the L1 instruction cache as SIZE:WAYS:LINE[:lru|fifo|random[:wb|wt]]");
+    app.add_option("--l1d", l1dSpec, "Shape of the L1 data cache as SIZE:WAYS:LINE[:lru|fifo|random[:wb|wt]]");
+    app.add_option("--l2", l2Spec, "Shape of the shared L2 cache as SIZE:WAYS:LINE[:lru|fifo|random[:wb|wt]], or none");
+    app.add_flag("--pipeline", timePipeline,
+                 "Time the program on a five-stage pipeline model and print the cycles and CPI of its blocks and lines");
+    app.add_option("--sandbox", sandboxDirectory,
+                   "Directory that the program may open files within (default is none, so no file can be opened)")
+            ->check(CLI::ExistingDirectory);
     app.set_version_flag("--version", version);
 
     // Set up help message
@@ -39,20 +225,123 @@ int main(const int argc, char* argv[]) {
         return app.exit(e);
     }
 
+    // resolve wildcards in path names to real paths
+    inputFileNames = resolveWildcards(inputFileNames);
+
+    const IOMode ioMode = useMMIO ? IOMode::MMIO : IOMode::SYSCALL;
+    const ExecEngine engine = engineName == "jit" ? ExecEngine::JIT : ExecEngine::INTERPRETER;
+    // Rounded up, as a timeout under a millisecond would otherwise become zero, which means no limit
+    const std::chrono::milliseconds timeout =
+            std::chrono::ceil<std::chrono::milliseconds>(std::chrono::duration<double>(timeoutSeconds));
+
+    // Batch runs read their input from files, so the terminal is left untouched
+    if (!batchDirectory.empty()) {
+        try {
+            const MemLayout layout = loadLayoutFromBinary(inputFileNames);
+            const BatchOptions options{ioMode, useLittleEndian, engine, maxInstructions, timeout, jobCount};
+            const std::vector<BatchResult> results = BatchRunner(layout, options).run(loadBatchJobs(batchDirectory));
+            std::cout << formatBatchReport(results);
+            return std::ranges::all_of(results, &BatchResult::passed) ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Inputs are journaled by wrapping the console, which is then only read from when recording
+    std::optional<InputJournal> journal;
+    try {
+        if (!replayFileName.empty()) {
+            std::ifstream file(expandTilde(replayFileName), std::ios::binary);
+            journal = InputJournal::load(file);
+        } else if (!recordFileName.empty())
+            journal.emplace();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // Giving the shape of any cache enables cache simulation
+    std::optional<CacheHierarchyConfig> cacheConfig;
+    try {
+        if (simulateCaches || !l1iSpec.empty() || !l1dSpec.empty() || !l2Spec.empty()) {
+            cacheConfig.emplace();
+            if (!l1iSpec.empty())
+                cacheConfig->l1i = parseCacheConfig(l1iSpec);
+            if (!l1dSpec.empty())
+                cacheConfig->l1d = parseCacheConfig(l1dSpec);
+            if (l2Spec == "none")
+                cacheConfig->l2.reset();
+            else if (!l2Spec.empty())
+                cacheConfig->l2 = parseCacheConfig(l2Spec);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
     ConsoleHandle conHandle;
     // Set terminal to raw mode
     conHandle.enableRawConsoleMode();
 
-    // resolve wildcards in path names to real paths
-    inputFileNames = resolveWildcards(inputFileNames);
+    std::optional<JournalStreamHandle> journalHandle;
+    if (journal)
+        journalHandle.emplace(conHandle, *journal);
+    StreamHandle& streamHandle = journalHandle ? static_cast<StreamHandle&>(*journalHandle) : conHandle;
 
     int exitCode = 1;
+    // The checkpoint being written is owned here and outlives its writer, which joins first on leaving this scope
+    std::optional<Checkpoint> pendingCheckpoint;
+    std::jthread checkpointWriter;
     try {
         const MemLayout layout = loadLayoutFromBinary(inputFileNames);
+        const ProgramImage image(layout);
+        const uint64_t fingerprint = programFingerprint(layout);
+
+        Simulator simulator(ioMode, streamHandle, useLittleEndian);
+        if (journal)
+            simulator.setInputJournal(&*journal);
+        simulator.setInputPollInterval(pollInterval);
+        simulator.setEngine(engine);
+        simulator.setInstructionLimit(maxInstructions);
+        simulator.setTimeout(timeout);
+        simulator.setProfiling(!profileFileName.empty());
+        simulator.setCallGraphProfiling(!callGraphFileName.empty());
+        simulator.setCacheModel(cacheConfig);
+        simulator.setPipelineModel(timePipeline ? std::optional<PipelineConfig>(PipelineConfig{}) : std::nullopt);
+        if (!sandboxDirectory.empty())
+            simulator.setFileSandbox(expandTilde(sandboxDirectory));
+        if (checkpointInterval != 0) {
+            const std::string fileName = expandTilde(checkpointFileName);
+            simulator.setCheckpointHook(checkpointInterval, [&, fileName](const Simulator& sim) {
+                // Only one checkpoint is written at a time, and the simulation continues while it is
+                if (checkpointWriter.joinable())
+                    checkpointWriter.join();
+                pendingCheckpoint = Checkpoint{sim.snapshot(), sim.instructionCount(), useLittleEndian, fingerprint};
+                checkpointWriter = std::jthread([fileName, &checkpoint = *pendingCheckpoint] {
+                    try {
+                        writeCheckpointFile(fileName, checkpoint);
+                    } catch (const std::exception& e) {
+                        std::cerr << e.what() << std::endl;
+                    }
+                });
+            });
+        }
+
+        if (!resumeFileName.empty()) {
+            const Checkpoint checkpoint = readCheckpointFile(resumeFileName, layout, useLittleEndian);
+            exitCode = simulator.resume(image, checkpoint.snapshot, checkpoint.instructions);
+        } else
+            exitCode = simulator.simulate(image);
 
-        const IOMode ioMode = useMMIO ? IOMode::MMIO : IOMode::SYSCALL;
-        Simulator simulator(ioMode, conHandle, useLittleEndian);
-        exitCode = simulator.simulate(layout);
+        if (!profileFileName.empty())
+            writeProfileFile(profileFileName, simulator.profileReport());
+        if (!callGraphFileName.empty())
+            writeCallGraphFile(callGraphFileName, simulator.callGraphReport());
+        if (cacheConfig)
+            std::cerr << formatCacheReport(simulator.cacheReport(), 20);
+        if (timePipeline)
+            std::cerr << formatPipelineReport(simulator.pipelineReport(), 20);
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
@@ -60,5 +349,18 @@ int main(const int argc, char* argv[]) {
     // Restore terminal settings
     conHandle.disableRawConsoleMode();
 
+    // The inputs consumed before an error are saved too, so that the error can be replayed
+    if (!recordFileName.empty()) {
+        std::ofstream file(expandTilde(recordFileName), std::ios::binary | std::ios::trunc);
+        try {
+            if (!file)
+                throw std::runtime_error("Could not open input log " + recordFileName);
+            journal->save(file);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     return exitCode;
 }
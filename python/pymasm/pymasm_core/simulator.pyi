@@ -1,11 +1,15 @@
 """Masm Simulator"""
 
 from enum import Enum
-from typing import Any, IO
+from typing import Any, IO, List, Tuple
 
 from .parser import MemLayout
 
 
+INSTRUCTION_LIMIT_EXIT_CODE: int  # Returned by simulate when the instruction budget runs out
+TIMEOUT_EXIT_CODE: int  # Returned by simulate when the deadline passes
+
+
 class IOMode(Enum):
     """Enumeration of the I/O modes for the simulator"""
 
@@ -13,10 +17,18 @@ class IOMode(Enum):
     MMIO = ...  # Memory-mapped I/O mode for reading/writing MMIO registers
 
 
+class ExecEngine(Enum):
+    """Enumeration of the execution engines for the simulator"""
+
+    INTERPRETER = ...  # Interprets each instruction or translated block
+    JIT = ...  # Compiles hot blocks into native code where the host supports it
+
+
 class Simulator:
     """Simulator for MIPS assembly programs"""
 
-    def __init__(self, ioMode: IOMode, istream: IO[Any], ostream: IO[Any]) -> None: ...
+    def __init__(self, io_mode: IOMode, istream: IO[Any], ostream: IO[Any],
+                 engine: ExecEngine = ExecEngine.INTERPRETER) -> None: ...
 
     def init_program(self, layout: MemLayout) -> None:
         """Initializes the program with the given memory layout
@@ -33,11 +45,58 @@ class Simulator:
             MasmRuntimeError: If a runtime error occurs during execution"""
         ...
 
-    def simulate(self, layout: MemLayout) -> int:
+    def simulate(self, layout: MemLayout, *, max_instructions: int = 0, timeout: float = 0.0) -> int:
         """Interprets the given memory layout and returns an exit code
 
         Args:
             layout (MemLayout): The memory layout to interpret
+            max_instructions (int): The most instructions to execute before stopping the program, or 0 for no limit
+            timeout (float): The most seconds to run for before stopping the program, or 0 for no limit
         Returns:
-            int: The exit code of the program"""
+            int: The exit code of the program, or INSTRUCTION_LIMIT_EXIT_CODE or TIMEOUT_EXIT_CODE if it was
+            stopped by a limit"""
+        ...
+
+    def instruction_count(self) -> int:
+        """Returns the number of instructions executed by the last simulation
+
+        Returns:
+            int: The number of executed instructions"""
+        ...
+
+    def set_profiling(self, enabled: bool) -> None:
+        """Enables or disables counting how many times each instruction is executed.  Counts are reset whenever a
+        program is initialized
+
+        Args:
+            enabled (bool): Whether to profile execution"""
+        ...
+
+    def profile_report(self, max_lines: int = 0) -> str:
+        """Returns a table of the labels and source lines that executed the most instructions
+
+        Args:
+            max_lines (int): The most source lines to list, or 0 to list them all
+        Returns:
+            str: The profile table
+        Raises:
+            RuntimeError: If profiling is not enabled"""
+        ...
+
+    def profile_callgrind(self) -> str:
+        """Returns the execution counts of each source line in callgrind format, for tools such as KCachegrind
+
+        Returns:
+            str: The profile in callgrind format
+        Raises:
+            RuntimeError: If profiling is not enabled"""
+        ...
+
+    def profile_lines(self) -> List[Tuple[str, int, str, int]]:
+        """Returns the executed source lines, from most to least executed
+
+        Returns:
+            List[Tuple[str, int, str, int]]: The filename, line number, label and instruction count of each line
+        Raises:
+            RuntimeError: If profiling is not enabled"""
         ...
@@ -3,6 +3,9 @@
 //
 
 
+#include <chrono>
+#include <tuple>
+
 #include <pybind11/operators.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
@@ -12,6 +15,7 @@
 #include <masm/assembler/parser.hpp>
 #include <masm/assembler/tokenizer.hpp>
 #include <masm/exceptions.hpp>
+#include <masm/simulator/profiler.hpp>
 #include <masm/simulator/simulator.hpp>
 
 #include "pybind_buffer.hpp"
@@ -32,15 +36,35 @@ class SimulatorWrapper {
     std::unique_ptr<Simulator> obj_;
 
 public:
-    SimulatorWrapper(const IOMode ioMode, const py::object& istream, const py::object& ostream) :
+    SimulatorWrapper(const IOMode ioMode, const py::object& istream, const py::object& ostream,
+                     const ExecEngine engine = ExecEngine::INTERPRETER) :
         ibuf_(std::make_unique<PyBytesIOBuf>(istream)), obuf_(std::make_unique<PyBytesIOBuf>(ostream)),
         istream_(std::make_shared<std::istream>(ibuf_.get())), ostream_(std::make_unique<std::ostream>(obuf_.get())),
         streamHandle_(std::make_unique<StreamHandle>(*istream_, *ostream_)),
-        obj_(std::make_unique<Simulator>(ioMode, *streamHandle_)) {}
+        obj_(std::make_unique<Simulator>(ioMode, *streamHandle_)) {
+        obj_->setEngine(engine);
+    }
 
     void initProgram(const MemLayout& layout) const { obj_->initProgram(layout); }
     void step() const { obj_->step(); }
-    [[nodiscard]] int simulate(const MemLayout& layout) const { return obj_->simulate(layout); }
+    [[nodiscard]] int simulate(const MemLayout& layout, const uint64_t maxInstructions, const double timeout) const {
+        obj_->setInstructionLimit(maxInstructions);
+        // Rounded up, so that a timeout under a millisecond does not become zero, which means no limit
+        obj_->setTimeout(std::chrono::ceil<std::chrono::milliseconds>(std::chrono::duration<double>(timeout)));
+        return obj_->simulate(layout);
+    }
+    [[nodiscard]] uint64_t instructionCount() const { return obj_->instructionCount(); }
+    void setProfiling(const bool enabled) const { obj_->setProfiling(enabled); }
+    [[nodiscard]] std::string profileReport(const size_t maxLines) const {
+        return formatProfileReport(obj_->profileReport(), maxLines);
+    }
+    [[nodiscard]] std::string profileCallgrind() const { return formatCallgrind(obj_->profileReport()); }
+    [[nodiscard]] std::vector<std::tuple<std::string, size_t, std::string, uint64_t>> profileLines() const {
+        std::vector<std::tuple<std::string, size_t, std::string, uint64_t>> lines;
+        for (const ProfileLine& line : obj_->profileReport().lines)
+            lines.emplace_back(line.filename, line.lineno, line.label, line.count);
+        return lines;
+    }
 };
 
 
@@ -155,15 +179,36 @@ PYBIND11_MODULE(pymasm_core, m) {
     // Binding for the IO Mode enum
     py::enum_<IOMode>(simulator_module, "IOMode").value("SYSCALL", IOMode::SYSCALL).value("MMIO", IOMode::MMIO);
 
+    // Exit codes returned when a simulation is stopped by its limits
+    simulator_module.attr("INSTRUCTION_LIMIT_EXIT_CODE") = INSTRUCTION_LIMIT_EXIT_CODE;
+    simulator_module.attr("TIMEOUT_EXIT_CODE") = TIMEOUT_EXIT_CODE;
+
+    // Binding for the execution engine enum
+    py::enum_<ExecEngine>(simulator_module, "ExecEngine")
+            .value("INTERPRETER", ExecEngine::INTERPRETER)
+            .value("JIT", ExecEngine::JIT);
+
     // Bindings for the Simulator class
     py::class_<SimulatorWrapper>(simulator_module, "Simulator")
             // Constructor that accepts Python file-like objects
-            .def(py::init<IOMode, py::object, py::object>())
+            .def(py::init<IOMode, py::object, py::object, ExecEngine>(), py::arg("io_mode"), py::arg("istream"),
+                 py::arg("ostream"), py::arg("engine") = ExecEngine::INTERPRETER)
             .def("step", &SimulatorWrapper::step, "Executes a single instruction")
             .def("init_program", &SimulatorWrapper::initProgram, py::arg("layout"),
                  "Initializes the simulator with the given memory layout")
-            .def("simulate", &SimulatorWrapper::simulate, py::arg("layout"),
-                 "Simulates the given memory layout and returns an exit code");
+            .def("simulate", &SimulatorWrapper::simulate, py::arg("layout"), py::kw_only(),
+                 py::arg("max_instructions") = 0, py::arg("timeout") = 0.0,
+                 "Simulates the given memory layout and returns an exit code")
+            .def("instruction_count", &SimulatorWrapper::instructionCount,
+                 "Returns the number of instructions executed by the last simulation")
+            .def("set_profiling", &SimulatorWrapper::setProfiling, py::arg("enabled"),
+                 "Enables or disables counting how many times each instruction is executed")
+            .def("profile_report", &SimulatorWrapper::profileReport, py::arg("max_lines") = 0,
+                 "Returns a table of the labels and source lines that executed the most instructions")
+            .def("profile_callgrind", &SimulatorWrapper::profileCallgrind,
+                 "Returns the execution counts of each source line in callgrind format")
+            .def("profile_lines", &SimulatorWrapper::profileLines,
+                 "Returns the filename, line number, label and instruction count of each executed source line");
 
     // Exceptions Bindings //
 
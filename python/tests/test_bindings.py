@@ -95,3 +95,23 @@ class TestBindings:
                 break
 
         assert ostream.getvalue() == b'abcd'
+
+    def test_profiling(self, syscall_io_asm: str):
+        raw_file = pymasm.tokenizer.SourceFile("input_output.asm", syscall_io_asm)
+        program = pymasm.tokenizer.Tokenizer.tokenize([raw_file])
+
+        parser = pymasm.parser.Parser()
+        layout = parser.parse(program)
+
+        istream = BytesIO("5\n".encode())
+        ostream = BytesIO()
+        simulator = pymasm.simulator.Simulator(pymasm.simulator.IOMode.SYSCALL, istream, ostream)
+        simulator.set_profiling(True)
+        assert simulator.simulate(layout) == 0
+
+        lines = simulator.profile_lines()
+        assert lines
+        assert all(filename == "input_output.asm" for filename, _, _, _ in lines)
+        assert sum(count for _, _, _, count in lines) == simulator.instruction_count()
+        assert simulator.profile_report().startswith(f"{simulator.instruction_count()} instructions executed")
+        assert "fl=input_output.asm" in simulator.profile_callgrind()
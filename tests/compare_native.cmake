@@ -0,0 +1,29 @@
+# Runs a translated program and the interpreter on the same input and fails if their output or exit code differ
+#
+# NATIVE - The translated program
+# MSIM - The simulator to run the object file with
+# OBJECT - The object file of the program
+# INPUT - The console input of the program, which may not exist
+
+set(inputFile /dev/null)
+if (EXISTS "${INPUT}")
+    set(inputFile "${INPUT}")
+endif ()
+
+execute_process(COMMAND "${MSIM}" "${OBJECT}"
+        INPUT_FILE "${inputFile}"
+        OUTPUT_VARIABLE expectedOutput
+        RESULT_VARIABLE expectedResult
+)
+execute_process(COMMAND "${NATIVE}"
+        INPUT_FILE "${inputFile}"
+        OUTPUT_VARIABLE actualOutput
+        RESULT_VARIABLE actualResult
+)
+
+if (NOT actualResult STREQUAL expectedResult)
+    message(FATAL_ERROR "Native program exited with ${actualResult}, but the interpreter exited with ${expectedResult}")
+endif ()
+if (NOT actualOutput STREQUAL expectedOutput)
+    message(FATAL_ERROR "Native program printed:\n${actualOutput}\nbut the interpreter printed:\n${expectedOutput}")
+endif ()
@@ -0,0 +1,102 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+#include <masm/simulator/batch.hpp>
+#include <masm/simulator/simulator.hpp>
+
+#include "shared/fileio.hpp"
+#include "tests/testing_utilities.hpp"
+
+
+TEST_CASE("Test Batch Runner") {
+    // Reads an integer and prints double its value
+    const MemLayout doubler = parseSource("doubler.asm", "main: li $v0, 5\n"
+                                                         "syscall\n"
+                                                         "add $a0, $v0, $v0\n"
+                                                         "li $v0, 1\n"
+                                                         "syscall\n"
+                                                         "li $v0, 10\n"
+                                                         "syscall");
+
+    SECTION("Test Expected Outputs") {
+        std::vector<BatchJob> jobs;
+        for (int i = 0; i < 64; i++)
+            jobs.push_back({"job" + std::to_string(i), std::to_string(i) + "\n", std::to_string(2 * i) + "\n"});
+        jobs[17].expectedOutput = "0\n";
+
+        for (const unsigned threads : {1u, 4u}) {
+            BatchOptions options;
+            options.threads = threads;
+            const std::vector<BatchResult> results = BatchRunner(doubler, options).run(jobs);
+
+            REQUIRE(results.size() == jobs.size());
+            for (size_t i = 0; i < results.size(); i++) {
+                REQUIRE(results[i].name == jobs[i].name);
+                REQUIRE(results[i].output == std::to_string(2 * i) + "\n");
+                REQUIRE(results[i].exitCode == 0);
+                REQUIRE(results[i].error.empty());
+                REQUIRE(results[i].instructions > 0);
+                REQUIRE(results[i].passed == (i != 17));
+            }
+
+            const std::string report = formatBatchReport(results);
+            REQUIRE(report.starts_with("PASS job0 (exit 0, "));
+            REQUIRE(report.find("FAIL job17 (exit 0, ") != std::string::npos);
+            REQUIRE(report.find("63 passed, 1 failed, ") != std::string::npos);
+        }
+    }
+
+    SECTION("Test Fixture Jobs") {
+        const std::string fixture = "tests/fixtures/input_output/input_output";
+        const MemLayout layout = parseSource("input_output.asm", readFile(fixture + ".asm"));
+        const std::vector<BatchJob> jobs = {{"input_output", readFile(fixture + ".in.txt"), readFile(fixture + ".txt")},
+                                            {"unchecked", "3\n", std::nullopt}};
+
+        const std::vector<BatchResult> results = BatchRunner(layout, {}).run(jobs);
+        REQUIRE(results[0].passed);
+        REQUIRE(results[1].passed);
+        REQUIRE(results[1].output.ends_with("The factorial is: 6\n"));
+    }
+
+    SECTION("Test Failing Jobs") {
+        const std::vector<BatchJob> jobs = {{"eof", "", std::nullopt}, {"exit", "1\n", std::nullopt}};
+        const std::vector<BatchResult> results = BatchRunner(doubler, {}).run(jobs);
+
+        // Reading past the end of the input fails the job instead of waiting for more input
+        REQUIRE_FALSE(results[0].passed);
+        REQUIRE(results[0].exitCode == 1);
+        REQUIRE(results[0].error.find("End of input stream reached") != std::string::npos);
+        REQUIRE(results[1].passed);
+
+        const MemLayout exitThree = parseSource("exit.asm", "main: li $a0, 3\nli $v0, 17\nsyscall");
+        const std::vector<BatchResult> exitResults = BatchRunner(exitThree, {}).run({{"three", "", std::nullopt}});
+        REQUIRE_FALSE(exitResults[0].passed);
+        REQUIRE(exitResults[0].exitCode == 3);
+    }
+
+    SECTION("Test Job Limits") {
+        const MemLayout infiniteLoop = parseSource("loop.asm", "main:\nloop: addi $t0, $t0, 1\nj loop");
+        BatchOptions options;
+        options.maxInstructions = 5000;
+
+        const std::vector<BatchResult> results =
+                BatchRunner(infiniteLoop, options).run({{"a", "", std::nullopt}, {"b", "", std::nullopt}});
+        for (const BatchResult& result : results) {
+            REQUIRE_FALSE(result.passed);
+            REQUIRE(result.exitCode == INSTRUCTION_LIMIT_EXIT_CODE);
+            REQUIRE(result.instructions == 5000);
+        }
+    }
+
+    SECTION("Test Empty Batch") {
+        const std::vector<BatchResult> results = BatchRunner(doubler, {}).run({});
+        REQUIRE(results.empty());
+        REQUIRE(formatBatchReport(results) == "0 passed, 0 failed, 0.000 ms simulated\n");
+    }
+}
@@ -0,0 +1,198 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <masm/simulator/cache.hpp>
+#include <masm/simulator/simulator.hpp>
+
+#include "tests/testing_utilities.hpp"
+
+
+/**
+ * Finds the cache statistics of a source line
+ * @param report The report to search
+ * @param lineno The line number of the line
+ * @return The statistics of the line
+ */
+const CacheLineReport& findLine(const CacheReport& report, const size_t lineno) {
+    const auto it = std::ranges::find(report.lines, lineno, &CacheLineReport::lineno);
+    REQUIRE(it != report.lines.end());
+    return *it;
+}
+
+
+TEST_CASE("Test Cache") {
+    SECTION("Test Sequential Walk") {
+        // Four sets of one 16 byte line each
+        Cache cache({64, 1, 16});
+        for (uint32_t address = 0; address < 256; address++)
+            cache.access(address, false);
+
+        REQUIRE(cache.stats().reads == 256);
+        REQUIRE(cache.stats().readMisses == 16);
+        REQUIRE(cache.stats().hits() == 240);
+        REQUIRE(cache.stats().evictions == 12);
+        REQUIRE(cache.stats().writebacks == 0);
+    }
+
+    SECTION("Test Replacement Policies") {
+        // A single set of two lines, which is full after lines A and B, so that filling C must evict one of them
+        constexpr uint32_t a = 0x000, b = 0x100, c = 0x200;
+        Cache lru({32, 2, 16, ReplacementPolicy::LRU});
+        Cache fifo({32, 2, 16, ReplacementPolicy::FIFO});
+        for (Cache* cache : {&lru, &fifo})
+            for (const uint32_t address : {a, b, a, c})
+                cache->access(address, false);
+
+        // Using A again keeps it under LRU, while FIFO evicts it for being filled first
+        REQUIRE(lru.access(a, false));
+        REQUIRE_FALSE(lru.access(b, false));
+        REQUIRE_FALSE(fifo.access(a, false));
+
+        // Random replacement is seeded identically for every cache, so that runs are repeatable
+        Cache first({256, 4, 16, ReplacementPolicy::RANDOM});
+        Cache second({256, 4, 16, ReplacementPolicy::RANDOM});
+        for (uint32_t i = 0; i < 1000; i++) {
+            const uint32_t address = (i * 2654435761u) % 4096;
+            REQUIRE(first.access(address, false) == second.access(address, false));
+        }
+        REQUIRE(first.stats().evictions > 0);
+    }
+
+    SECTION("Test Write Policies") {
+        Cache backL2({1024, 4, 16});
+        Cache back({16, 1, 16, ReplacementPolicy::LRU, WritePolicy::WRITE_BACK}, &backL2);
+        REQUIRE_FALSE(back.access(0x00, true));
+        REQUIRE(back.access(0x04, true));
+        // Only evicting the dirty line writes it to the next level
+        REQUIRE(backL2.stats().writes == 0);
+        REQUIRE_FALSE(back.access(0x40, false));
+        REQUIRE(back.stats().evictions == 1);
+        REQUIRE(back.stats().writebacks == 1);
+        REQUIRE(backL2.stats().writes == 1);
+        REQUIRE(backL2.stats().reads == 2);
+
+        Cache throughL2({1024, 4, 16});
+        Cache through({16, 1, 16, ReplacementPolicy::LRU, WritePolicy::WRITE_THROUGH}, &throughL2);
+        // A missing store is not allocated, so the load after it misses as well
+        REQUIRE_FALSE(through.access(0x00, true));
+        REQUIRE_FALSE(through.access(0x00, false));
+        REQUIRE(through.access(0x04, true));
+        REQUIRE(through.stats().writeMisses == 1);
+        REQUIRE(through.stats().writebacks == 0);
+        REQUIRE(throughL2.stats().writes == 2);
+    }
+
+    SECTION("Test Configuration Parsing") {
+        const CacheConfig config = parseCacheConfig("32k:8:64:fifo:wt");
+        REQUIRE(config.size == 32 * 1024);
+        REQUIRE(config.associativity == 8);
+        REQUIRE(config.lineSize == 64);
+        REQUIRE(config.replacement == ReplacementPolicy::FIFO);
+        REQUIRE(config.write == WritePolicy::WRITE_THROUGH);
+
+        REQUIRE(parseCacheConfig("1m:1:16").size == 1024 * 1024);
+        REQUIRE(parseCacheConfig("1m:1:16").replacement == ReplacementPolicy::LRU);
+
+        for (const std::string spec : {"", "32k", "32k:8", "3k:4:64", "32k:3:64", "16:8:4", "16:1:2", "32k:4:64:mru",
+                                       "32k:4:64:lru:wa", "32x:4:64", "32k:4:64:lru:wb:x", "8m8:1:16"})
+            REQUIRE_THROWS_AS(parseCacheConfig(spec), std::invalid_argument);
+    }
+}
+
+
+TEST_CASE("Test Cache Simulation") {
+    // Loads each of the 256 words of an array in turn
+    const MemLayout layout = parseSource("walk.asm", ".data\n"
+                                                     "array: .space 1024\n"
+                                                     ".text\n"
+                                                     "main: la $t0, array\n"
+                                                     "li $t1, 256\n"
+                                                     "loop: lw $t2, 0($t0)\n"
+                                                     "addi $t0, $t0, 4\n"
+                                                     "addi $t1, $t1, -1\n"
+                                                     "bnez $t1, loop\n"
+                                                     "li $v0, 10\n"
+                                                     "syscall");
+
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(IOMode::SYSCALL, streamHandle);
+
+    SECTION("Test Disabled") {
+        simulator.simulate(layout);
+        REQUIRE(simulator.cacheHierarchy() == nullptr);
+        REQUIRE_THROWS_AS(simulator.cacheReport(), std::runtime_error);
+    }
+
+    SECTION("Test Level Statistics") {
+        for (const ExecEngine engine : {ExecEngine::INTERPRETER, ExecEngine::JIT}) {
+            simulator.setEngine(engine);
+            simulator.setCacheModel(CacheHierarchyConfig{});
+            REQUIRE(simulator.simulate(layout) == 0);
+
+            const CacheReport report = simulator.cacheReport();
+            REQUIRE(report.levels.size() == 3);
+            const CacheStats& l1i = report.levels[0].stats;
+            const CacheStats& l1d = report.levels[1].stats;
+            const CacheStats& l2 = report.levels[2].stats;
+
+            // Every instruction is fetched once, and the text of the program spans two lines of the instruction cache
+            REQUIRE(l1i.reads == simulator.instructionCount());
+            REQUIRE(l1i.misses() == 2);
+            // Each 32 byte line of the array misses once, then serves the next seven loads
+            REQUIRE(l1d.reads == 256);
+            REQUIRE(l1d.readMisses == 32);
+            REQUIRE(l1d.writes == 0);
+            REQUIRE(l1d.evictions == 0);
+            // The second level sees only the misses of the first, and its 64 byte lines hold two lines of the first
+            REQUIRE(l2.reads == l1i.misses() + l1d.misses());
+            REQUIRE(l2.readMisses == 1 + 16);
+
+            const CacheLineReport& load = findLine(report, 6);
+            REQUIRE(load.fetches == 256);
+            REQUIRE(load.dataAccesses == 256);
+            REQUIRE(load.dataMisses == 32);
+            REQUIRE(load.l2Misses == 16);
+            REQUIRE(report.lines.front().lineno == 6);
+            REQUIRE(findLine(report, 7).dataAccesses == 0);
+
+            const std::string table = formatCacheReport(report, 1);
+            REQUIRE(table.find("L1D") != std::string::npos);
+            REQUIRE(table.find("walk.asm:6") != std::string::npos);
+            REQUIRE(table.find("walk.asm:7") == std::string::npos);
+        }
+    }
+
+    SECTION("Test Small Caches") {
+        // A direct-mapped data cache of two lines and no second level, through which stores are written
+        CacheHierarchyConfig config;
+        config.l1d = {64, 1, 32, ReplacementPolicy::LRU, WritePolicy::WRITE_THROUGH};
+        config.l2.reset();
+        simulator.setCacheModel(config);
+        simulator.simulate(layout);
+
+        const CacheReport report = simulator.cacheReport();
+        REQUIRE(report.levels.size() == 2);
+        REQUIRE(report.levels[1].stats.readMisses == 32);
+        REQUIRE(report.levels[1].stats.evictions == 30);
+        REQUIRE(findLine(report, 6).evictions == 30);
+        REQUIRE(findLine(report, 6).l2Misses == 0);
+
+        // Caches are cold again for each program
+        simulator.simulate(layout);
+        REQUIRE(simulator.cacheReport().levels[1].stats.readMisses == 32);
+
+        simulator.setCacheModel(std::nullopt);
+        REQUIRE(simulator.cacheHierarchy() == nullptr);
+    }
+}
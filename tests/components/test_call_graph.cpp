@@ -0,0 +1,192 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <masm/simulator/call_graph.hpp>
+#include <masm/simulator/simulator.hpp>
+
+#include "tests/testing_utilities.hpp"
+
+
+/**
+ * Finds the profile of a procedure
+ * @param report The report to search
+ * @param name The name of the procedure
+ * @return The profile of the procedure
+ */
+const ProcedureProfile& findProcedure(const CallGraphReport& report, const std::string& name) {
+    const auto it = std::ranges::find(report.procedures, name, &ProcedureProfile::name);
+    REQUIRE(it != report.procedures.end());
+    return *it;
+}
+
+
+TEST_CASE("Test Call Graph") {
+    // Computes 5! recursively, then calls a leaf procedure twice
+    const MemLayout layout = parseSource("fact.asm", "main: li $a0, 5\n"
+                                                     "jal fact\n"
+                                                     "move $a0, $v0\n"
+                                                     "li $v0, 1\n"
+                                                     "syscall\n"
+                                                     "jal leaf\n"
+                                                     "la $t9, leaf\n"
+                                                     "jalr $t9\n"
+                                                     "li $v0, 10\n"
+                                                     "syscall\n"
+                                                     "fact: addi $sp, $sp, -8\n"
+                                                     "sw $ra, 4($sp)\n"
+                                                     "sw $a0, 0($sp)\n"
+                                                     "li $t0, 2\n"
+                                                     "blt $a0, $t0, base\n"
+                                                     "addi $a0, $a0, -1\n"
+                                                     "jal fact\n"
+                                                     "lw $a0, 0($sp)\n"
+                                                     "mul $v0, $a0, $v0\n"
+                                                     "j done\n"
+                                                     "base: li $v0, 1\n"
+                                                     "done: lw $ra, 4($sp)\n"
+                                                     "addi $sp, $sp, 8\n"
+                                                     "jr $ra\n"
+                                                     "leaf: addi $t1, $t1, 1\n"
+                                                     "jr $ra");
+
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(IOMode::SYSCALL, streamHandle);
+
+    SECTION("Test Disabled") {
+        simulator.simulate(layout);
+        REQUIRE(simulator.callGraphProfile() == nullptr);
+        REQUIRE_THROWS_AS(simulator.callGraphReport(), std::runtime_error);
+    }
+
+    SECTION("Test Procedures") {
+        for (const ExecEngine engine : {ExecEngine::INTERPRETER, ExecEngine::JIT}) {
+            simulator.setEngine(engine);
+            simulator.setCallGraphProfiling(true);
+            REQUIRE(simulator.simulate(layout) == 0);
+            REQUIRE(oss.str().starts_with("120"));
+            oss.str("");
+            REQUIRE(simulator.callGraphProfile()->depth() == 0);
+
+            const CallGraphReport report = simulator.callGraphReport();
+            REQUIRE(report.total == simulator.instructionCount());
+
+            // The entry point encloses every instruction of the program
+            const ProcedureProfile& entry = findProcedure(report, "_start");
+            REQUIRE(entry.inclusive == report.total);
+            REQUIRE(entry.calls == 1);
+
+            // Recursive calls are counted once each, but their instructions only once in total
+            const ProcedureProfile& fact = findProcedure(report, "fact");
+            REQUIRE(fact.calls == 5);
+            REQUIRE(fact.inclusive == fact.exclusive);
+            REQUIRE(fact.inclusive < report.total);
+
+            const ProcedureProfile& leaf = findProcedure(report, "leaf");
+            REQUIRE(leaf.calls == 2);
+            REQUIRE(leaf.inclusive == 4);
+            REQUIRE(leaf.exclusive == 4);
+
+            uint64_t exclusiveTotal = 0;
+            for (const ProcedureProfile& procedure : report.procedures)
+                exclusiveTotal += procedure.exclusive;
+            REQUIRE(exclusiveTotal == report.total);
+            REQUIRE(report.procedures.front().name == "_start");
+        }
+    }
+
+    SECTION("Test Folded Stacks") {
+        simulator.setCallGraphProfiling(true);
+        simulator.simulate(layout);
+        const CallGraphReport report = simulator.callGraphReport();
+
+        uint64_t stackTotal = 0;
+        for (const auto& [stack, count] : report.stacks)
+            stackTotal += count;
+        REQUIRE(stackTotal == report.total);
+
+        const std::string folded = formatFoldedStacks(report);
+        REQUIRE(folded.find("_start;fact;fact;fact;fact;fact ") != std::string::npos);
+        REQUIRE(folded.find("_start;fact;fact;fact;fact;fact;") == std::string::npos);
+        REQUIRE(folded.find("_start;leaf 4\n") != std::string::npos);
+
+        const std::string table = formatCallGraphReport(report);
+        REQUIRE(table.find("fact\n") != std::string::npos);
+    }
+
+    SECTION("Test Link Register") {
+        // The callee is linked through $t1 rather than $ra, and returns through it
+        const MemLayout linkLayout = parseSource("link.asm", "main: la $t9, helper\n"
+                                                             "jalr $t1, $t9\n"
+                                                             "li $v0, 10\n"
+                                                             "syscall\n"
+                                                             "helper: addi $t2, $t2, 1\n"
+                                                             "jr $t1");
+
+        for (const ExecEngine engine : {ExecEngine::INTERPRETER, ExecEngine::JIT}) {
+            simulator.setEngine(engine);
+            simulator.setCallGraphProfiling(true);
+            REQUIRE(simulator.simulate(linkLayout) == 0);
+            REQUIRE(simulator.callGraphProfile()->depth() == 0);
+
+            const CallGraphReport report = simulator.callGraphReport();
+            const ProcedureProfile& helper = findProcedure(report, "helper");
+            REQUIRE(helper.calls == 1);
+            REQUIRE(helper.inclusive == 2);
+            REQUIRE(formatFoldedStacks(report).find("_start;helper 2\n") != std::string::npos);
+        }
+    }
+
+    SECTION("Test Hot Calls") {
+        // The loop and the callee run often enough to be compiled, which must still trace every call and return
+        const MemLayout hotLayout = parseSource("hot.asm", "main: li $s0, 100\n"
+                                                           "loop: jal leaf\n"
+                                                           "addi $s0, $s0, -1\n"
+                                                           "bne $s0, $zero, loop\n"
+                                                           "li $v0, 10\n"
+                                                           "syscall\n"
+                                                           "leaf: addi $t1, $t1, 1\n"
+                                                           "jr $ra");
+
+        for (const ExecEngine engine : {ExecEngine::INTERPRETER, ExecEngine::JIT}) {
+            simulator.setEngine(engine);
+            simulator.setCallGraphProfiling(true);
+            REQUIRE(simulator.simulate(hotLayout) == 0);
+            REQUIRE(simulator.callGraphProfile()->depth() == 0);
+
+            const CallGraphReport report = simulator.callGraphReport();
+            const ProcedureProfile& leaf = findProcedure(report, "leaf");
+            REQUIRE(leaf.calls == 100);
+            REQUIRE(leaf.inclusive == 200);
+            REQUIRE(findProcedure(report, "_start").inclusive == report.total);
+        }
+    }
+
+    SECTION("Test Unmatched Returns") {
+        CallGraphProfile profile(0x00400000);
+        // A return with no matching call is ignored
+        profile.ret(0x00400010, 3);
+        REQUIRE(profile.depth() == 0);
+
+        profile.call(0x00400100, 0x00400008, 5);
+        profile.call(0x00400200, 0x00400108, 10);
+        // Returning straight to the outer caller finishes both calls
+        profile.ret(0x00400008, 20);
+        REQUIRE(profile.depth() == 0);
+
+        const std::vector<CallGraphProfile::Node> nodes = profile.snapshotNodes(30);
+        REQUIRE(nodes.size() == 3);
+        REQUIRE(nodes[0].inclusive == 30);
+        REQUIRE(nodes[1].inclusive == 15);
+        REQUIRE(nodes[2].inclusive == 10);
+    }
+}
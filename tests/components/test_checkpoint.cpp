@@ -0,0 +1,165 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+
+#include <catch2/catch_test_macros.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <masm/simulator/checkpoint.hpp>
+#include <masm/simulator/program_image.hpp>
+#include <masm/simulator/simulator.hpp>
+
+#include "tests/testing_utilities.hpp"
+
+
+TEST_CASE("Test Checkpoints") {
+    // Prints seeded random numbers after passing them through a heap block
+    const MemLayout layout = parseSource("checkpoint.asm", "main: li $a0, 64\n"
+                                                           "li $v0, 9\n"
+                                                           "syscall\n"
+                                                           "move $s0, $v0\n"
+                                                           "li $a0, 1\n"
+                                                           "li $a1, 42\n"
+                                                           "li $v0, 40\n"
+                                                           "syscall\n"
+                                                           "li $s1, 0\n"
+                                                           "li $s2, 20\n"
+                                                           "loop: li $a0, 1\n"
+                                                           "li $a1, 1000\n"
+                                                           "li $v0, 42\n"
+                                                           "syscall\n"
+                                                           "sw $a0, 0($s0)\n"
+                                                           "lw $a0, 0($s0)\n"
+                                                           "li $v0, 1\n"
+                                                           "syscall\n"
+                                                           "li $a0, 32\n"
+                                                           "li $v0, 11\n"
+                                                           "syscall\n"
+                                                           "addi $s1, $s1, 1\n"
+                                                           "blt $s1, $s2, loop\n"
+                                                           "li $v0, 10\n"
+                                                           "syscall");
+    const ProgramImage image(layout);
+
+    std::string expected;
+    {
+        std::istringstream iss;
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        Simulator simulator(IOMode::SYSCALL, streamHandle);
+        REQUIRE(simulator.simulate(image) == 0);
+        expected = oss.str();
+    }
+
+    SECTION("Test Resume") {
+        // Each checkpoint is saved alongside the output written before it
+        std::vector<std::pair<std::string, size_t>> checkpoints;
+        std::istringstream iss;
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        Simulator simulator(IOMode::SYSCALL, streamHandle);
+        simulator.setCheckpointHook(50, [&](const Simulator& sim) {
+            REQUIRE(sim.instructionCount() == 50 * (checkpoints.size() + 1));
+            std::ostringstream checkpointStream;
+            saveCheckpoint(checkpointStream,
+                           {sim.snapshot(), sim.instructionCount(), false, programFingerprint(layout)});
+            checkpoints.emplace_back(checkpointStream.str(), oss.str().size());
+        });
+        REQUIRE(simulator.simulate(image) == 0);
+        REQUIRE(oss.str() == expected);
+        REQUIRE(checkpoints.size() == simulator.instructionCount() / 50);
+
+        for (const auto& [data, outputSize] : checkpoints) {
+            std::istringstream checkpointStream(data);
+            const Checkpoint checkpoint = loadCheckpoint(checkpointStream);
+            REQUIRE(checkpoint.programFingerprint == programFingerprint(layout));
+            REQUIRE_FALSE(checkpoint.useLittleEndian);
+
+            // A fresh simulator picks up exactly where the checkpointed one was
+            std::istringstream resumedIss;
+            std::ostringstream resumedOss;
+            StreamHandle resumedHandle(resumedIss, resumedOss);
+            Simulator resumed(IOMode::SYSCALL, resumedHandle);
+            REQUIRE(resumed.resume(image, checkpoint.snapshot, checkpoint.instructions) == 0);
+            REQUIRE(resumedOss.str() == expected.substr(outputSize));
+            REQUIRE(resumed.instructionCount() == simulator.instructionCount());
+        }
+    }
+
+    SECTION("Test Resume Budget") {
+        std::istringstream iss;
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        Simulator simulator(IOMode::SYSCALL, streamHandle);
+        simulator.setInstructionLimit(30);
+        REQUIRE(simulator.simulate(image) == INSTRUCTION_LIMIT_EXIT_CODE);
+
+        // The budget covers the instructions executed before the checkpoint
+        std::stringstream checkpointStream;
+        saveCheckpoint(checkpointStream, {simulator.snapshot(), simulator.instructionCount(), false, 0});
+        const Checkpoint checkpoint = loadCheckpoint(checkpointStream);
+        Simulator resumed(IOMode::SYSCALL, streamHandle);
+        resumed.setInstructionLimit(60);
+        REQUIRE(resumed.resume(image, checkpoint.snapshot, checkpoint.instructions) == INSTRUCTION_LIMIT_EXIT_CODE);
+        REQUIRE(resumed.instructionCount() == 60);
+    }
+
+    SECTION("Test Invalid Checkpoints") {
+        std::istringstream badMagic("XCKP");
+        REQUIRE_THROWS_AS(loadCheckpoint(badMagic), std::runtime_error);
+
+        std::istringstream iss;
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        Simulator simulator(IOMode::SYSCALL, streamHandle);
+        simulator.simulate(image);
+        std::ostringstream checkpointStream;
+        saveCheckpoint(checkpointStream, {simulator.snapshot(), simulator.instructionCount(), false, 0});
+
+        const std::string data = checkpointStream.str();
+        std::istringstream truncated(data.substr(0, data.size() - 100));
+        REQUIRE_THROWS_AS(loadCheckpoint(truncated), std::runtime_error);
+        std::istringstream badVersion(data.substr(0, 4) + '\x02' + data.substr(5));
+        REQUIRE_THROWS_AS(loadCheckpoint(badVersion), std::runtime_error);
+
+        // Corrupt counts and heap blocks are rejected before anything is allocated for them
+        auto corrupt = [&data](const size_t offset, const uint32_t value) {
+            std::string corrupted = data;
+            for (size_t i = 0; i < 4; i++)
+                corrupted[offset + i] = static_cast<char>(value >> (8 * i) & 0xFF);
+            return std::istringstream(corrupted);
+        };
+        const size_t heapOffset = 29 + 4 * (NUM_CPU_REGISTERS + NUM_CP0_REGISTERS + NUM_CP1_REGISTERS) + 8;
+        const size_t blockOffset = heapOffset + 8;
+        const size_t generatorOffset = blockOffset + 8;
+        auto readAt = [&data](const size_t offset) {
+            uint32_t value = 0;
+            for (size_t i = 0; i < 4; i++)
+                value |= static_cast<uint32_t>(static_cast<uint8_t>(data[offset + i])) << (8 * i);
+            return value;
+        };
+        const std::vector<std::pair<uint32_t, uint32_t>> blocks = simulator.snapshot().state.heapAllocator.blocks();
+        REQUIRE(blocks.size() == 1);
+        REQUIRE(readAt(heapOffset + 4) == 1);
+        REQUIRE(readAt(blockOffset) == blocks[0].first);
+        REQUIRE(readAt(generatorOffset) == 1);
+
+        std::istringstream hugeBlockCount = corrupt(heapOffset + 4, UINT32_MAX);
+        REQUIRE_THROWS_AS(loadCheckpoint(hugeBlockCount), std::runtime_error);
+        std::istringstream blockBelowHeap = corrupt(blockOffset, 0);
+        REQUIRE_THROWS_AS(loadCheckpoint(blockBelowHeap), std::runtime_error);
+        std::istringstream blockAboveTop = corrupt(blockOffset + 4, UINT32_MAX);
+        REQUIRE_THROWS_AS(loadCheckpoint(blockAboveTop), std::runtime_error);
+        std::istringstream hugeGeneratorState = corrupt(generatorOffset + 12, UINT32_MAX);
+        REQUIRE_THROWS_AS(loadCheckpoint(hugeGeneratorState), std::runtime_error);
+    }
+
+    SECTION("Test Program Fingerprint") {
+        REQUIRE(programFingerprint(layout) == programFingerprint(layout));
+        const MemLayout other = parseSource("checkpoint.asm", "main: li $v0, 10\nsyscall");
+        REQUIRE(programFingerprint(layout) != programFingerprint(other));
+    }
+}
@@ -0,0 +1,44 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <catch2/catch_test_macros.hpp>
+#include <map>
+
+#include <masm/simulator/debug_table.hpp>
+
+
+TEST_CASE("Test Debug Table") {
+    const std::map<uint32_t, DebugInfo> debugInfo = {
+            {0x00400000, {{"test.asm", 1, "j main"}, ""}},
+            {0x00400004, {{"test.asm", 3, "li $t0, 1"}, "main"}},
+            {0x0040000c, {{"test.asm", 4, "syscall"}, ""}},
+            {0x10010000, {{"test.asm", 7, ""}, "value"}},
+            {0x80000000, {{"test.asm", 10, "eret"}, "handler"}}};
+    const DebugTable table(debugInfo);
+
+    SECTION("Test Text Lookup") {
+        REQUIRE(table.at(0x00400004).source.lineno == 3);
+        REQUIRE(table.at(0x0040000c).source.text == "syscall");
+        REQUIRE_FALSE(table.contains(0x00400008));
+        REQUIRE_FALSE(table.contains(0x00400010));
+        REQUIRE_FALSE(table.contains(0x00400002));
+        REQUIRE(table.at(0x80000000).label == "handler");
+    }
+
+    SECTION("Test Data Lookup") {
+        REQUIRE(table.at(0x10010000).label == "value");
+        REQUIRE(table.find(0x10010004) == nullptr);
+        REQUIRE_THROWS_AS(table.at(0x10010004), std::out_of_range);
+    }
+
+    SECTION("Test Ordered Iteration") {
+        REQUIRE(table.size() == debugInfo.size());
+        auto expected = debugInfo.begin();
+        for (const auto& [addr, info] : table) {
+            REQUIRE(addr == expected->first);
+            REQUIRE(info.source.lineno == expected->second.source.lineno);
+            ++expected;
+        }
+    }
+}
@@ -9,6 +9,7 @@
 
 #include <masm/assembler/memory.hpp>
 #include <masm/assembler/serialization.hpp>
+#include <masm/simulator/aot.hpp>
 
 #include "shared/fileio.hpp"
 #include "shared/load_layout.hpp"
@@ -28,6 +29,24 @@ TEST_CASE("Test Stringify Layout") {
 }
 
 
+TEST_CASE("Test Translate Layout") {
+    const std::string fixturePath = "tests/fixtures/loops/loops.asm";
+    Parser parser;
+    const MemLayout layout = loadLayoutFromSource({fixturePath}, parser);
+    const std::string source = translateLayout(layout, false);
+
+    // The jump to main and the first block of main are translated and listed in the address table
+    REQUIRE_THAT(source, Catch::Matchers::ContainsSubstring("uint32_t block_00400000("));
+    REQUIRE_THAT(source, Catch::Matchers::ContainsSubstring("{0x00400000u, 1, &block_00400000},"));
+    REQUIRE_THAT(source, Catch::Matchers::ContainsSubstring("r[32] = 0x00400004u; return 1;"));
+    REQUIRE_THAT(source, Catch::Matchers::ContainsSubstring("uint32_t block_00400004("));
+    // The program image starts with the binary identifier
+    REQUIRE_THAT(source, Catch::Matchers::ContainsSubstring("        0x4d, 0x41, 0x53, 0x4d,"));
+    REQUIRE_THAT(source, Catch::Matchers::EndsWith("    return runNativeProgram(std::as_bytes(std::span(programImage)), "
+                                                   "nativeBlocks, false);\n}\n"));
+}
+
+
 TEST_CASE("Test Save Layout") {
     const MemLayout layout = {{{MemSection::TEXT, iV2bV({0x01, 0x02, 0x03})},
                                {MemSection::DATA, iV2bV({0x04, 0x05})},
@@ -0,0 +1,188 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers.hpp>
+#include <catch2/matchers/catch_matchers_exception.hpp>
+#include <vector>
+
+#include <masm/assembler/memory.hpp>
+#include <masm/exceptions.hpp>
+
+
+TEST_CASE("Test Memory Pages") {
+    Memory memory;
+
+    SECTION("Test Unallocated Reads") {
+        REQUIRE(memory.wordAt(0x10010000) == 0);
+        REQUIRE(memory.byteAt(0x7fffeffc) == 0);
+        REQUIRE_FALSE(memory.isValid(0x10010000));
+        REQUIRE(memory.pageCount() == 0);
+    }
+
+    SECTION("Test Allocate On Write") {
+        memory.byteTo(0x10010001, 0x12);
+        REQUIRE(memory.pageCount() == 1);
+        REQUIRE(memory.isValid(0x10010001));
+        REQUIRE_FALSE(memory.isValid(0x10010000));
+        REQUIRE_FALSE(memory.isValid(0x10010002));
+
+        memory.wordTo(0x10010ffc, 0x01020304);
+        REQUIRE(memory.pageCount() == 1);
+        memory.wordTo(0x10011000, 0x05060708);
+        REQUIRE(memory.pageCount() == 2);
+    }
+
+    SECTION("Test Cross Page Access") {
+        memory._sysWordTo(0x10010ffe, 0x11223344);
+        REQUIRE(memory.pageCount() == 2);
+        REQUIRE(memory._sysWordAt(0x10010ffe) == 0x11223344);
+        REQUIRE(memory.byteAt(0x10010fff) == 0x22);
+        REQUIRE(memory.byteAt(0x10011000) == 0x33);
+        REQUIRE(memory.isValid(0x10011001));
+    }
+
+    SECTION("Test Unaligned Access") {
+        REQUIRE_THROWS_MATCHES(memory.wordAt(0x10010002), ExecExcept,
+                               Catch::Matchers::Message("Invalid word access at 0x10010002"));
+        REQUIRE_THROWS_MATCHES(memory.halfTo(0x10010001, 0), ExecExcept,
+                               Catch::Matchers::Message("Invalid half-word access at 0x10010001"));
+    }
+
+    SECTION("Test Bulk Copies") {
+        std::vector<std::byte> data(0x1800);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = static_cast<std::byte>(i * 7);
+        memory.bytesTo(0x10010ffa, data);
+        REQUIRE(memory.pageCount() == 3);
+        REQUIRE(memory.byteAt(0x10010ffa) == 0);
+        REQUIRE(memory.byteAt(0x10011000) == 42);
+        REQUIRE(memory.isValid(0x100127f9));
+        REQUIRE_FALSE(memory.isValid(0x100127fa));
+
+        // Unallocated bytes read as zero alongside the copied ones
+        std::vector<std::byte> read(data.size() + 8, std::byte{0xff});
+        memory.bytesAt(0x10010ff2, read);
+        REQUIRE(std::all_of(read.begin(), read.begin() + 8, [](const std::byte b) { return b == std::byte{0}; }));
+        REQUIRE(std::equal(data.begin(), data.end(), read.begin() + 8));
+    }
+
+    SECTION("Test Bulk Copies Into Watched Pages") {
+        std::vector<uint32_t> watchedWrites;
+        memory.setWriteWatcher([&watchedWrites](const uint32_t address) { watchedWrites.push_back(address); });
+        memory.watchPage(0x00400000);
+        const std::vector<std::byte> data(6, std::byte{0x24});
+        memory.bytesTo(0x00400ffd, data);
+
+        // Each byte in a watched page is reported, while the unwatched page is copied in one piece
+        REQUIRE(watchedWrites == std::vector<uint32_t>{0x00400ffd, 0x00400ffe, 0x00400fff});
+        REQUIRE(memory._sysWordAt(0x00401000) == 0x24242400);
+    }
+
+    SECTION("Test Uninitialized Const Access") {
+        const Memory& constMemory = memory;
+        REQUIRE_THROWS_AS(constMemory[0x10010000], std::out_of_range);
+        memory[0x10010000] = static_cast<std::byte>(0x7f);
+        REQUIRE(constMemory[0x10010000] == static_cast<std::byte>(0x7f));
+    }
+}
+
+
+TEST_CASE("Test Memory Snapshots") {
+    Memory memory;
+    memory.wordTo(0x10010000, 0x11111111);
+    memory.wordTo(0x10011000, 0x22222222);
+    const MemorySnapshot snapshot = memory.snapshot();
+
+    SECTION("Test Copy On Write") {
+        memory.wordTo(0x10010000, 0x33333333);
+        memory.wordTo(0x10020000, 0x44444444);
+        REQUIRE(memory.wordAt(0x10010000) == 0x33333333);
+        REQUIRE(memory.pageCount() == 3);
+
+        memory.restore(snapshot);
+        REQUIRE(memory.wordAt(0x10010000) == 0x11111111);
+        REQUIRE(memory.wordAt(0x10011000) == 0x22222222);
+        REQUIRE(memory.wordAt(0x10020000) == 0);
+        REQUIRE_FALSE(memory.isValid(0x10020000));
+        REQUIRE(memory.pageCount() == 2);
+    }
+
+    SECTION("Test Forked Memories") {
+        Memory fork;
+        fork.restore(snapshot);
+        fork.byteTo(0x10011000, 0x55);
+        memory.byteTo(0x10011000, 0x66);
+
+        REQUIRE(fork.byteAt(0x10011000) == 0x55);
+        REQUIRE(memory.byteAt(0x10011000) == 0x66);
+        REQUIRE(fork.wordAt(0x10010000) == 0x11111111);
+
+        // Neither write reaches the snapshot
+        Memory other;
+        other.restore(snapshot);
+        REQUIRE(other.byteAt(0x10011000) == 0x22);
+    }
+
+    SECTION("Test Overlay") {
+        Memory other;
+        other.byteTo(0x10011003, 0x77);
+        other.wordTo(0x7fffeffc, 0x12345678);
+        other.overlay(snapshot);
+
+        // Bytes that the snapshot never initialized are kept
+        REQUIRE(other.wordAt(0x10010000) == 0x11111111);
+        REQUIRE(other.wordAt(0x10011000) == 0x22222222);
+        REQUIRE(other.wordAt(0x7fffeffc) == 0x12345678);
+        REQUIRE(other.pageCount() == 3);
+
+        memory.byteTo(0x10010000, 0x00);
+        REQUIRE(other.byteAt(0x10010000) == 0x11);
+    }
+
+    SECTION("Test Watched Pages After Restore") {
+        std::vector<uint32_t> watchedWrites;
+        memory.setWriteWatcher([&watchedWrites](const uint32_t address) { watchedWrites.push_back(address); });
+        memory.watchPage(0x10010000);
+        memory.restore(snapshot);
+
+        memory.wordTo(0x10010004, 1);
+        memory.wordTo(0x10011004, 1);
+        REQUIRE(watchedWrites == std::vector<uint32_t>{0x10010004});
+    }
+}
+
+
+TEST_CASE("Test Memory Endianness") {
+    SECTION("Test Big Endian") {
+        Memory memory;
+        memory.wordTo(0x10010000, 0x11223344);
+        REQUIRE(memory.byteAt(0x10010000) == 0x11);
+        REQUIRE(memory.byteAt(0x10010003) == 0x44);
+        REQUIRE(memory.halfAt(0x10010002) == 0x3344);
+    }
+
+    SECTION("Test Little Endian") {
+        Memory memory(true);
+        memory.wordTo(0x10010000, 0x11223344);
+        REQUIRE(memory.byteAt(0x10010000) == 0x44);
+        REQUIRE(memory.byteAt(0x10010003) == 0x11);
+        REQUIRE(memory.halfAt(0x10010002) == 0x1122);
+    }
+
+    SECTION("Test Compile Time Byte Order") {
+        Memory memory;
+        memory.wordTo<std::endian::big>(0x10010000, 0x11223344);
+        memory.halfTo<std::endian::little>(0x10010004, 0x5566);
+        REQUIRE(memory.byteAt(0x10010000) == 0x11);
+        REQUIRE(memory.byteAt(0x10010004) == 0x66);
+        REQUIRE(memory.wordAt<std::endian::little>(0x10010000) == 0x44332211);
+        REQUIRE(memory.halfAt<std::endian::big>(0x10010004) == 0x6655);
+        REQUIRE(memory.halfAt(0x10010002) == memory.halfAt<std::endian::big>(0x10010002));
+        memory._sysWordTo<std::endian::little>(0x10010ffe, 0x11223344);
+        REQUIRE(memory.byteAt(0x10010ffe) == 0x44);
+        REQUIRE(memory._sysWordAt<std::endian::big>(0x10010ffe) == 0x44332211);
+    }
+}
@@ -0,0 +1,184 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <masm/simulator/pipeline.hpp>
+#include <masm/simulator/simulator.hpp>
+
+#include "tests/testing_utilities.hpp"
+
+
+/**
+ * Times a program on the pipeline model
+ * @param source The source of the program
+ * @param config The latencies of the pipeline
+ * @param engine The engine to execute the program with
+ * @return The report of the pipeline
+ */
+PipelineReport timeProgram(const std::string& source, const PipelineConfig& config = {},
+                           const ExecEngine engine = ExecEngine::INTERPRETER) {
+    const MemLayout layout = parseSource("timed.asm", source);
+
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(IOMode::SYSCALL, streamHandle);
+    simulator.setEngine(engine);
+    simulator.setPipelineModel(config);
+    simulator.simulate(layout);
+
+    const PipelineReport report = simulator.pipelineReport();
+    REQUIRE(report.instructions == simulator.instructionCount());
+    // Every cycle beyond filling the pipeline and issuing each instruction is a stall
+    REQUIRE(report.cycles == 4 + report.instructions + std::reduce(report.stalls.begin(), report.stalls.end()));
+    return report;
+}
+
+
+/**
+ * Finds the timing of a source line
+ * @param report The report to search
+ * @param lineno The line number of the line
+ * @return The timing of the line
+ */
+const PipelineLineReport& findLine(const PipelineReport& report, const size_t lineno) {
+    const auto it = std::ranges::find(report.lines, lineno, &PipelineLineReport::lineno);
+    REQUIRE(it != report.lines.end());
+    return *it;
+}
+
+
+/**
+ * Gets the cycles lost to a reason for waiting
+ * @param report The report to check
+ * @param reason The reason for waiting
+ * @return The number of stall cycles
+ */
+uint64_t stallsOf(const PipelineReport& report, const StallReason reason) {
+    return report.stalls[static_cast<size_t>(reason)];
+}
+
+
+TEST_CASE("Test Pipeline") {
+    SECTION("Test Disabled") {
+        const MemLayout layout = parseSource("exit.asm", "main: li $v0, 10\nsyscall");
+        std::istringstream iss;
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        Simulator simulator(IOMode::SYSCALL, streamHandle);
+        simulator.simulate(layout);
+        REQUIRE(simulator.pipelineModel() == nullptr);
+        REQUIRE_THROWS_AS(simulator.pipelineReport(), std::runtime_error);
+    }
+
+    SECTION("Test Load-Use Stalls") {
+        const std::string program = ".data\n"
+                                    "value: .word 41\n"
+                                    ".text\n"
+                                    "main: la $t0, value\n"
+                                    "lw $t1, 0($t0)\n"
+                                    "addi $t2, $REG, 1\n"
+                                    "li $v0, 10\n"
+                                    "syscall";
+        std::string dependent = program;
+        dependent.replace(dependent.find("$REG"), 4, "$t1");
+        std::string independent = program;
+        independent.replace(independent.find("$REG"), 4, "$t3");
+
+        const PipelineReport stalled = timeProgram(dependent);
+        const PipelineReport free = timeProgram(independent);
+        REQUIRE(stallsOf(stalled, StallReason::LOAD_USE) == 1);
+        REQUIRE(stallsOf(free, StallReason::LOAD_USE) == 0);
+        REQUIRE(stalled.cycles == free.cycles + 1);
+        REQUIRE(findLine(stalled, 6).cycles == 2);
+        REQUIRE(findLine(free, 6).cycles == 1);
+        REQUIRE(findLine(stalled, 6).cpi() == 2.0);
+
+        // A longer load latency stalls the dependent instruction for longer
+        PipelineConfig slowLoads;
+        slowLoads.loadLatency = 4;
+        REQUIRE(stallsOf(timeProgram(dependent, slowLoads), StallReason::LOAD_USE) == 3);
+    }
+
+    SECTION("Test Multiply and Divide Latency") {
+        const std::string program = "main: li $t0, 6\n"
+                                    "li $t1, 7\n"
+                                    "mult $t0, $t1\n"
+                                    "mflo $t2\n"
+                                    "div $t2, $t1\n"
+                                    "mflo $t3\n"
+                                    "li $v0, 10\n"
+                                    "syscall";
+        const PipelineReport report = timeProgram(program);
+        REQUIRE(stallsOf(report, StallReason::MULTIPLY_DIVIDE) == 4 + 34);
+        REQUIRE(findLine(report, 4).cycles == 5);
+        REQUIRE(findLine(report, 6).cycles == 35);
+
+        PipelineConfig config;
+        config.multiplyLatency = 2;
+        config.divideLatency = 1;
+        REQUIRE(stallsOf(timeProgram(program, config), StallReason::MULTIPLY_DIVIDE) == 1);
+    }
+
+    SECTION("Test Floating-Point Latency") {
+        const PipelineReport report = timeProgram("main: mtc1 $zero, $f0\n"
+                                                  "mtc1 $zero, $f1\n"
+                                                  "add.s $f2, $f0, $f1\n"
+                                                  "mul.s $f3, $f2, $f2\n"
+                                                  "div.s $f4, $f3, $f3\n"
+                                                  "mov.s $f5, $f4\n"
+                                                  "li $v0, 10\n"
+                                                  "syscall");
+        REQUIRE(stallsOf(report, StallReason::FLOATING_POINT) == 2 + 4 + 14);
+        REQUIRE(findLine(report, 4).cycles == 3);
+        REQUIRE(findLine(report, 5).cycles == 5);
+        REQUIRE(findLine(report, 6).cycles == 15);
+    }
+
+    SECTION("Test Branch Penalties") {
+        const std::string program = "main: li $t0, 10\n"
+                                    "loop: addi $t0, $t0, -1\n"
+                                    "bnez $t0, loop\n"
+                                    "li $v0, 10\n"
+                                    "syscall";
+        for (const ExecEngine engine : {ExecEngine::INTERPRETER, ExecEngine::JIT}) {
+            const PipelineReport report = timeProgram(program, {}, engine);
+
+            // The branch is taken nine times, and is charged for each time it redirects the program
+            REQUIRE(findLine(report, 2).cycles == 10);
+            REQUIRE(findLine(report, 3).instructions == 10);
+            REQUIRE(findLine(report, 3).cycles == 10 + 9);
+            REQUIRE(report.lines.front().lineno == 3);
+            REQUIRE(stallsOf(report, StallReason::BRANCH) >= 9);
+
+            // The loop is entered nine times by its branch after falling into it the first time, so the first taken
+            // branch belongs to the block of main and the last pass falls out of the loop
+            const auto loop = std::ranges::find(report.blocks, "loop", &PipelineBlockReport::label);
+            REQUIRE(loop != report.blocks.end());
+            REQUIRE(loop->entries == 9);
+            REQUIRE(loop->instructions == 18);
+            REQUIRE(loop->cycles == 18 + 8);
+            REQUIRE(loop->end == loop->start + 4);
+            REQUIRE(loop->cpi() == 26.0 / 18.0);
+
+            uint64_t blockCycles = 0;
+            for (const PipelineBlockReport& block : report.blocks)
+                blockCycles += block.cycles;
+            REQUIRE(blockCycles + 4 == report.cycles);
+
+            const std::string table = formatPipelineReport(report, 1);
+            REQUIRE(table.find("CPI") != std::string::npos);
+            REQUIRE(table.find("timed.asm:3  bne $t0, $zero, loop") != std::string::npos);
+            REQUIRE(table.find("timed.asm:2  addi") == std::string::npos);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <masm/assembler/memory.hpp>
+#include <masm/simulator/profiler.hpp>
+#include <masm/simulator/simulator.hpp>
+
+#include "shared/fileio.hpp"
+#include "tests/testing_utilities.hpp"
+
+
+/**
+ * Finds the profile of a source line
+ * @param report The report to search
+ * @param lineno The line number of the line
+ * @return The count of the line, or zero if it was never executed
+ */
+uint64_t lineCount(const ProfileReport& report, const size_t lineno) {
+    const auto it = std::ranges::find(report.lines, lineno, &ProfileLine::lineno);
+    return it != report.lines.end() ? it->count : 0;
+}
+
+
+TEST_CASE("Test Profiler") {
+    const MemLayout layout = parseSource("loops.asm", readFile("tests/fixtures/loops/loops.asm"));
+
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(IOMode::SYSCALL, streamHandle);
+
+    SECTION("Test Disabled") {
+        simulator.simulate(layout);
+        REQUIRE(simulator.executionProfile() == nullptr);
+        REQUIRE_THROWS_AS(simulator.profileReport(), std::runtime_error);
+    }
+
+    SECTION("Test Line Counts") {
+        for (const ExecEngine engine : {ExecEngine::INTERPRETER, ExecEngine::JIT}) {
+            simulator.setEngine(engine);
+            simulator.setProfiling(true);
+            REQUIRE(simulator.simulate(layout) == 0);
+
+            const ProfileReport report = simulator.profileReport();
+            REQUIRE(report.total == simulator.instructionCount());
+            REQUIRE(simulator.executionProfile()->total() == report.total);
+            REQUIRE(report.unattributed == 0);
+
+            // The loop body runs once for each value from -1 to 24, and its pseudo-branch expands to two instructions
+            REQUIRE(lineCount(report, 2) == 1);
+            REQUIRE(lineCount(report, 5) == 26);
+            REQUIRE(lineCount(report, 15) == 52);
+            REQUIRE(lineCount(report, 16) == 25);
+            REQUIRE(lineCount(report, 18) == 1);
+            REQUIRE(report.lines.front().lineno == 15);
+
+            uint64_t labelled = 0;
+            for (const ProfileLabel& label : report.labels)
+                labelled += label.count;
+            REQUIRE(labelled + report.unattributed == report.total);
+            REQUIRE(report.labels.front().label == "loop");
+            REQUIRE(report.labels.front().count == 26 * 9 + 25);
+        }
+    }
+
+    SECTION("Test Counts Reset") {
+        simulator.setProfiling(true);
+        simulator.simulate(layout);
+        const uint64_t first = simulator.executionProfile()->total();
+        simulator.simulate(layout);
+        REQUIRE(simulator.executionProfile()->total() == first);
+
+        // Restoring a snapshot, as the debugger does to restart a program, also starts the counts over
+        const SimulatorSnapshot start = simulator.snapshot();
+        simulator.restore(start);
+        REQUIRE(simulator.executionProfile()->total() == 0);
+
+        simulator.setProfiling(false);
+        REQUIRE(simulator.executionProfile() == nullptr);
+    }
+
+    SECTION("Test Formats") {
+        simulator.setProfiling(true);
+        simulator.simulate(layout);
+        const ProfileReport report = simulator.profileReport();
+
+        const std::string table = formatProfileReport(report, 2);
+        REQUIRE(table.starts_with(std::to_string(report.total) + " instructions executed\n"));
+        REQUIRE(table.find("loops.asm:15") != std::string::npos);
+        REQUIRE(table.find("loops.asm:5") != std::string::npos);
+        REQUIRE(table.find("loops.asm:16") == std::string::npos);
+
+        const std::string callgrind = formatCallgrind(report);
+        REQUIRE(callgrind.starts_with("# callgrind format\n"));
+        REQUIRE(callgrind.find("fl=loops.asm\nfn=loop\n5 26\n") != std::string::npos);
+        REQUIRE(callgrind.ends_with("totals: " + std::to_string(report.total) + "\n"));
+    }
+
+    SECTION("Test Addresses Outside Code") {
+        // Code run from kernel data or MMIO is counted on its own, without stretching the ktext counters to reach it
+        const uint32_t text = memSectionOffset(MemSection::TEXT);
+        const uint32_t kdata = memSectionOffset(MemSection::KDATA) + 0x100;
+        const uint32_t mmio = memSectionOffset(MemSection::MMIO);
+        ExecutionProfile profile;
+        profile.record(text);
+        profile.record(kdata);
+        profile.record(mmio);
+        profile.record(mmio);
+
+        REQUIRE(profile.count(kdata) == 1);
+        REQUIRE(profile.count(mmio) == 2);
+        REQUIRE(profile.count(mmio + 4) == 0);
+        REQUIRE(profile.total() == 4);
+        const std::vector<std::pair<uint32_t, uint64_t>> expected = {{text, 1}, {kdata, 1}, {mmio, 2}};
+        REQUIRE(profile.counts() == expected);
+
+        profile.clear();
+        REQUIRE(profile.total() == 0);
+        REQUIRE(profile.counts().empty());
+    }
+}
@@ -0,0 +1,247 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <masm/exceptions.hpp>
+#include <masm/simulator/replay.hpp>
+#include <masm/simulator/simulator.hpp>
+
+#include "shared/fileio.hpp"
+#include "tests/testing_utilities.hpp"
+
+
+/**
+ * Simulates a program with its inputs passing through a journal
+ * @param layout The program to simulate
+ * @param ioMode The I/O mode to simulate the program with
+ * @param input The text given to the program as input
+ * @param journal The journal to record or replay the inputs of the program with
+ * @return The output of the program
+ */
+std::string runJournaled(const MemLayout& layout, const IOMode ioMode, const std::string& input,
+                         InputJournal& journal) {
+    std::istringstream iss(input);
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    JournalStreamHandle journalHandle(streamHandle, journal);
+    Simulator simulator(ioMode, journalHandle);
+    simulator.setInputJournal(&journal);
+    simulator.simulate(layout);
+    return oss.str();
+}
+
+
+/**
+ * A stream handle that refuses to be read from, so that a replayed run which waits on its input fails
+ */
+class UnreadableStreamHandle final : public StreamHandle {
+public:
+    using StreamHandle::StreamHandle;
+
+    bool hasChar() override { throw std::logic_error("Replay polled the input stream"); }
+    char getChar() override { throw std::logic_error("Replay read the input stream"); }
+    char getCharBlocking() override { throw std::logic_error("Replay waited on the input stream"); }
+};
+
+
+/**
+ * Replays the inputs of a program from a journal, without any input stream to fall back on
+ * @param layout The program to simulate
+ * @param ioMode The I/O mode to simulate the program with
+ * @param journal The journal to replay the inputs of the program from
+ * @return The output of the program
+ */
+std::string runReplayed(const MemLayout& layout, const IOMode ioMode, InputJournal& journal) {
+    std::istringstream iss;
+    std::ostringstream oss;
+    UnreadableStreamHandle streamHandle(iss, oss);
+    JournalStreamHandle journalHandle(streamHandle, journal);
+    Simulator simulator(ioMode, journalHandle);
+    simulator.setInputJournal(&journal);
+    simulator.simulate(layout);
+    return oss.str();
+}
+
+
+TEST_CASE("Test Record Replay") {
+    // Prints an input number, the clock, an unseeded random number and an input character, sleeping in between
+    const MemLayout layout = parseSource("replay.asm", "main: li $v0, 5\n"
+                                                       "syscall\n"
+                                                       "move $a0, $v0\n"
+                                                       "li $v0, 1\n"
+                                                       "syscall\n"
+                                                       "li $v0, 30\n"
+                                                       "syscall\n"
+                                                       "li $v0, 1\n"
+                                                       "syscall\n"
+                                                       "li $a0, 300\n"
+                                                       "li $v0, 32\n"
+                                                       "syscall\n"
+                                                       "li $a0, 7\n"
+                                                       "li $v0, 41\n"
+                                                       "syscall\n"
+                                                       "li $v0, 36\n"
+                                                       "syscall\n"
+                                                       "li $v0, 12\n"
+                                                       "syscall\n"
+                                                       "move $a0, $v0\n"
+                                                       "li $v0, 11\n"
+                                                       "syscall\n"
+                                                       "li $v0, 10\n"
+                                                       "syscall");
+
+    SECTION("Test Syscall Inputs") {
+        InputJournal recording;
+        const std::string recorded = runJournaled(layout, IOMode::SYSCALL, "42\nx", recording);
+        REQUIRE(recorded.starts_with("42"));
+        REQUIRE(recorded.ends_with("x\n"));
+
+        // The number takes three characters, then the clock, the seed and the final character are each logged once
+        const std::vector<InputEvent>& events = recording.events();
+        REQUIRE(events.size() == 6);
+        REQUIRE(events[0].kind == InputEventKind::CHAR);
+        REQUIRE(events[0].instruction == 3);
+        REQUIRE(events[3].kind == InputEventKind::TIME);
+        REQUIRE(events[4].kind == InputEventKind::SEED);
+        REQUIRE(events[5].value == 'x');
+
+        std::stringstream log;
+        recording.save(log);
+        REQUIRE(log.str().size() < 40);
+
+        // Replaying never touches the input stream, yet reproduces the clock and random number
+        InputJournal replaying = InputJournal::load(log);
+        REQUIRE(replaying.mode() == JournalMode::REPLAY);
+        REQUIRE(runReplayed(layout, IOMode::SYSCALL, replaying) == recorded);
+        REQUIRE(replaying.finished());
+    }
+
+    SECTION("Test Replay Divergence") {
+        InputJournal recording;
+        runJournaled(layout, IOMode::SYSCALL, "42\nx", recording);
+
+        // A program that reads the clock at another instruction no longer matches the log
+        const MemLayout other = parseSource("replay.asm", "main: li $v0, 5\nsyscall\nnop\nli $v0, 30\nsyscall");
+        InputJournal replaying(recording.events());
+        REQUIRE_THROWS_AS(runJournaled(other, IOMode::SYSCALL, "", replaying), MasmRuntimeError);
+
+        // A log that ends early cannot supply the remaining input
+        std::vector<InputEvent> truncated = recording.events();
+        truncated.pop_back();
+        InputJournal shortReplay(truncated);
+        REQUIRE_THROWS_AS(runJournaled(layout, IOMode::SYSCALL, "", shortReplay), MasmRuntimeError);
+    }
+
+    SECTION("Test MMIO Inputs") {
+        const MemLayout echo = parseSource("replay.asm", readFile("tests/fixtures/echointer/echointer.asm"));
+        const std::string input = std::string(50, '\0') + "Hello there!q";
+
+        InputJournal recording;
+        const std::string recorded = runJournaled(echo, IOMode::MMIO, input, recording);
+        REQUIRE(recorded == readFile("tests/fixtures/echointer/echointer.txt") + "\n");
+
+        InputJournal replaying(recording.events());
+        REQUIRE(runReplayed(echo, IOMode::MMIO, replaying) == recorded);
+        REQUIRE(replaying.finished());
+    }
+
+    SECTION("Test Invalid Logs") {
+        std::istringstream badMagic("MRPX");
+        REQUIRE_THROWS_AS(InputJournal::load(badMagic), std::runtime_error);
+
+        InputJournal recording;
+        runJournaled(layout, IOMode::SYSCALL, "42\nx", recording);
+        std::ostringstream log;
+        recording.save(log);
+        std::istringstream truncated(log.str().substr(0, log.str().size() - 2));
+        REQUIRE_THROWS_AS(InputJournal::load(truncated), std::runtime_error);
+    }
+}
+
+
+TEST_CASE("Test Replay File Syscalls") {
+    // Reads a file and prints it, then writes part of it to another file and prints the number of bytes written
+    const MemLayout layout = parseSource("files.asm", ".data\n"
+                                                      "inName: .asciiz \"in.txt\"\n"
+                                                      "outName: .asciiz \"out.txt\"\n"
+                                                      "buffer: .space 64\n"
+                                                      ".text\n"
+                                                      "main: la $a0, inName\n"
+                                                      "li $a1, 0\n"
+                                                      "li $v0, 13\n"
+                                                      "syscall\n"
+                                                      "move $a0, $v0\n"
+                                                      "la $a1, buffer\n"
+                                                      "li $a2, 63\n"
+                                                      "li $v0, 14\n"
+                                                      "syscall\n"
+                                                      "la $a0, buffer\n"
+                                                      "li $v0, 4\n"
+                                                      "syscall\n"
+                                                      "la $a0, outName\n"
+                                                      "li $a1, 1\n"
+                                                      "li $v0, 13\n"
+                                                      "syscall\n"
+                                                      "move $a0, $v0\n"
+                                                      "la $a1, buffer\n"
+                                                      "li $a2, 4\n"
+                                                      "li $v0, 15\n"
+                                                      "syscall\n"
+                                                      "move $a0, $v0\n"
+                                                      "li $v0, 1\n"
+                                                      "syscall\n"
+                                                      "li $v0, 10\n"
+                                                      "syscall");
+
+    const std::filesystem::path root =
+            std::filesystem::temp_directory_path() /
+            ("masm_replay_files_" + std::to_string(getpid()) + "_" + std::to_string(std::random_device{}()));
+    std::filesystem::create_directories(root);
+    std::ofstream(root / "in.txt") << "file contents";
+
+    InputJournal recording;
+    std::string recorded;
+    {
+        std::istringstream iss;
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        JournalStreamHandle journalHandle(streamHandle, recording);
+        Simulator simulator(IOMode::SYSCALL, journalHandle);
+        simulator.setInputJournal(&recording);
+        simulator.setFileSandbox(root);
+        simulator.simulate(layout);
+        recorded = oss.str();
+    }
+    REQUIRE(recorded == "file contents4\n");
+    REQUIRE(std::filesystem::file_size(root / "out.txt") == 4);
+
+    // Both opens, the read with its thirteen bytes packed into two events and the write are logged
+    const std::vector<InputEvent>& events = recording.events();
+    REQUIRE(events.size() == 6);
+    REQUIRE(events[0].kind == InputEventKind::FILE_OPEN);
+    REQUIRE(events[1].kind == InputEventKind::FILE_READ);
+    REQUIRE(events[1].value == 13);
+    REQUIRE(events[2].kind == InputEventKind::FILE_DATA);
+    REQUIRE(events[3].kind == InputEventKind::FILE_DATA);
+    REQUIRE(events[5].kind == InputEventKind::FILE_WRITE);
+
+    // The replay reproduces the file contents without a sandbox, and without the files existing at all
+    std::filesystem::remove_all(root);
+    std::stringstream log;
+    recording.save(log);
+    InputJournal replaying = InputJournal::load(log);
+    REQUIRE(runReplayed(layout, IOMode::SYSCALL, replaying) == recorded);
+    REQUIRE(replaying.finished());
+    REQUIRE_FALSE(std::filesystem::exists(root));
+}
@@ -6,17 +6,24 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers.hpp>
 #include <catch2/matchers/catch_matchers_exception.hpp>
+#include <filesystem>
+#include <random>
+#include <set>
 #include <string>
+#include <unistd.h>
 #include <vector>
 
 #include <masm/assembler/parser.hpp>
 #include <masm/assembler/tokenizer.hpp>
 #include <masm/exceptions.hpp>
+#include <masm/simulator/block_cache.hpp>
+#include <masm/simulator/jit.hpp>
 #include <masm/simulator/simulator.hpp>
 
 #include "mdb/debug_simulator.hpp"
 #include "shared/fileio.hpp"
 #include "shared/load_layout.hpp"
+#include "tests/testing_utilities.hpp"
 
 
 /**
@@ -88,6 +95,625 @@ TEST_CASE("Test Runtime Error") {
 }
 
 
+TEST_CASE("Test Self Modifying Code") {
+    std::vector<SourceFile> sourceFiles = {{"test.asm", "main:\n"
+                                                        "target: addi $a0, $zero, 1\n"
+                                                        "li $v0, 1\n"
+                                                        "syscall\n"
+                                                        "bne $s0, $zero, done\n"
+                                                        "li $s0, 1\n"
+                                                        "la $t0, donor\n"
+                                                        "lw $t1, 0($t0)\n"
+                                                        "la $t2, target\n"
+                                                        "sw $t1, 0($t2)\n"
+                                                        "j target\n"
+                                                        "done: li $v0, 10\n"
+                                                        "syscall\n"
+                                                        "donor: addi $a0, $zero, 2"}};
+    const std::vector<LineTokens> program = Tokenizer::tokenize(sourceFiles);
+
+    Parser parser{};
+    const MemLayout layout = parser.parse(program);
+
+    std::istringstream iss;
+    std::ostringstream oss;
+
+    StreamHandle streamHandle(iss, oss);
+    DebugSimulator simulator(IOMode::SYSCALL, streamHandle);
+
+    // The patched instruction must be re-decoded after the store overwrites it
+    REQUIRE(simulator.simulate(layout) == 0);
+    REQUIRE(oss.str() == "12");
+}
+
+
+TEST_CASE("Test Run Loop") {
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(IOMode::SYSCALL, streamHandle);
+
+    SECTION("Test Step Limit") {
+        simulator.initProgram(parseSource("test.asm", "main:\nloop: addi $t0, $t0, 1\nj loop"));
+        const RunResult result = simulator.run(100);
+        REQUIRE(result.status == RunStatus::STEP_LIMIT);
+        REQUIRE(result.steps == 100);
+    }
+
+    SECTION("Test Exit") {
+        simulator.initProgram(parseSource("test.asm", "main:\nli $a0, 3\nli $v0, 17\nsyscall"));
+        const RunResult result = simulator.run(100);
+        REQUIRE(result.status == RunStatus::EXITED);
+        // Includes the jump to main
+        REQUIRE(result.steps == 4);
+        REQUIRE(result.exitCode == 3);
+    }
+
+    SECTION("Test Break") {
+        simulator.initProgram(parseSource("test.asm", "main:\nbreak 5"));
+        const RunResult result = simulator.run(100);
+        REQUIRE(result.status == RunStatus::BREAK);
+        REQUIRE(result.exitCode == 5);
+        REQUIRE(result.message == "Break instruction executed");
+    }
+
+    SECTION("Test Fault") {
+        simulator.initProgram(parseSource("test.asm", "main:\nnop"));
+        const RunResult result = simulator.run(100);
+        REQUIRE(result.status == RunStatus::FAULT);
+        // The jump to main and the nop run, but the fault at the end of the text is not an instruction
+        REQUIRE(result.steps == 2);
+        REQUIRE(result.exitCode == 139);
+    }
+
+    SECTION("Test Trap Handled") {
+        simulator.initProgram(parseSource("test.asm", ".text\n"
+                                                      "main: lui $t0, 0x7fff\n"
+                                                      "ori $t0, $t0, 0xffff\n"
+                                                      "addi $t0, $t0, 1\n"
+                                                      "lw $t1, 2($zero)\n"
+                                                      "move $a0, $s0\n"
+                                                      "li $v0, 17\n"
+                                                      "syscall\n"
+                                                      ".ktext\n"
+                                                      "addi $s0, $s0, 1\n"
+                                                      "mfc0 $k0, $14\n"
+                                                      "addi $k0, $k0, 4\n"
+                                                      "mtc0 $k0, $14\n"
+                                                      "eret"));
+        const RunResult result = simulator.run(1000);
+        REQUIRE(result.status == RunStatus::EXITED);
+        REQUIRE(result.exitCode == 2);
+    }
+}
+
+
+TEST_CASE("Test Block Translation") {
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+
+    SECTION("Test Fused Idioms") {
+        // Sums the array with la, a load through $at and a blt loop, then checks against a stepped run
+        const MemLayout layout = parseSource("test.asm", ".data\n"
+                                                         "values: .word 3, -4, 5, 6, 7\n"
+                                                         ".text\n"
+                                                         "main: la $t0, values\n"
+                                                         "li $t1, 0\n"
+                                                         "li $t2, 5\n"
+                                                         "li $a0, 0\n"
+                                                         "loop: lw $t3, 0($t0)\n"
+                                                         "add $a0, $a0, $t3\n"
+                                                         "addi $t0, $t0, 4\n"
+                                                         "addi $t1, $t1, 1\n"
+                                                         "blt $t1, $t2, loop\n"
+                                                         "bgt $a0, $zero, positive\n"
+                                                         "li $a0, -1\n"
+                                                         "positive: li $v0, 1\n"
+                                                         "syscall\n"
+                                                         "li $v0, 10\n"
+                                                         "syscall");
+
+        Simulator simulator(IOMode::SYSCALL, streamHandle);
+        REQUIRE(simulator.simulate(layout) == 0);
+        REQUIRE(oss.str() == "17\n");
+
+        std::ostringstream stepOss;
+        StreamHandle stepStreamHandle(iss, stepOss);
+        DebugSimulator stepSimulator(IOMode::SYSCALL, stepStreamHandle);
+        REQUIRE(stepSimulator.simulate(layout) == 0);
+        REQUIRE(stepOss.str() == "17");
+
+        // The la and the blt are each translated into a single fused operation
+        Memory& memory = stepSimulator.getState().memory;
+        DecodeCache decodeCache;
+        BlockCache blockCache;
+        std::set<BlockOpKind> kinds;
+        const uint32_t textStart = memSectionOffset(MemSection::TEXT);
+        const uint32_t textEnd = textStart + static_cast<uint32_t>(layout.data.at(MemSection::TEXT).size());
+        for (uint32_t address = textStart; address < textEnd; address += 4) {
+            if (const TranslatedBlock* block = blockCache.lookup(memory, decodeCache, address))
+                for (const BlockOp& op : block->ops)
+                    kinds.insert(op.kind);
+        }
+        REQUIRE(kinds.contains(BlockOpKind::LOAD_CONST));
+        REQUIRE(kinds.contains(BlockOpKind::SLT_BRANCH));
+    }
+
+    SECTION("Test Store Into Current Block") {
+        // The store patches the instruction directly after it, within the same block
+        const MemLayout layout = parseSource("test.asm", "main: la $t0, donor\n"
+                                                         "lw $t1, 0($t0)\n"
+                                                         "la $t2, target\n"
+                                                         "sw $t1, 0($t2)\n"
+                                                         "target: addi $a0, $zero, 1\n"
+                                                         "li $v0, 1\n"
+                                                         "syscall\n"
+                                                         "li $v0, 10\n"
+                                                         "syscall\n"
+                                                         "donor: addi $a0, $zero, 2");
+
+        Simulator simulator(IOMode::SYSCALL, streamHandle);
+        REQUIRE(simulator.simulate(layout) == 0);
+        REQUIRE(oss.str() == "2\n");
+    }
+}
+
+
+TEST_CASE("Test JIT Engine") {
+    // Mixes compiled operations with loads and stores, MMIO reads, multiplies, overflow traps and self-modifying code
+    // that all fall back to the interpreter partway through hot blocks
+    const MemLayout layout = parseSource("test.asm", ".data\n"
+                                                     "buf: .space 64\n"
+                                                     ".text\n"
+                                                     "main: li $s0, 0\n"
+                                                     "la $s2, buf\n"
+                                                     "loop: andi $t0, $s0, 15\n"
+                                                     "sll $t1, $t0, 2\n"
+                                                     "addu $t1, $s2, $t1\n"
+                                                     "sw $s0, 0($t1)\n"
+                                                     "sb $s0, 1($t1)\n"
+                                                     "sh $s0, 2($t1)\n"
+                                                     "lw $t2, 0($t1)\n"
+                                                     "lb $t3, 1($t1)\n"
+                                                     "lbu $t4, 1($t1)\n"
+                                                     "lh $t5, 2($t1)\n"
+                                                     "lhu $t6, 2($t1)\n"
+                                                     "addu $s1, $s1, $t2\n"
+                                                     "xor $s1, $s1, $t3\n"
+                                                     "subu $s1, $s1, $t4\n"
+                                                     "addu $s1, $s1, $t5\n"
+                                                     "nor $t7, $t6, $zero\n"
+                                                     "xor $s1, $s1, $t7\n"
+                                                     "srl $t7, $s1, 3\n"
+                                                     "sra $t8, $s1, 5\n"
+                                                     "sllv $t9, $t7, $t0\n"
+                                                     "srlv $t9, $t9, $t0\n"
+                                                     "sltu $t7, $s1, $t9\n"
+                                                     "slt $t8, $s1, $t8\n"
+                                                     "addu $s1, $s1, $t7\n"
+                                                     "addu $s1, $s1, $t8\n"
+                                                     "mult $s1, $t0\n"
+                                                     "mflo $t7\n"
+                                                     "addu $s1, $s1, $t7\n"
+                                                     "lui $t7, 0xffff\n"
+                                                     "lw $t7, 8($t7)\n"
+                                                     "addu $s1, $s1, $t7\n"
+                                                     "lui $t7, 0x7fff\n"
+                                                     "ori $t7, $t7, 0xffff\n"
+                                                     "add $t7, $t7, $s0\n"
+                                                     "jal helper\n"
+                                                     "addiu $s0, $s0, 1\n"
+                                                     "li $t9, 200\n"
+                                                     "blt $s0, $t9, loop\n"
+                                                     "li $s5, 0\n"
+                                                     "la $t0, donor\n"
+                                                     "lw $t1, 0($t0)\n"
+                                                     "la $t2, target\n"
+                                                     "li $t3, 100\n"
+                                                     "patch: bne $s5, $t3, target\n"
+                                                     "sw $t1, 0($t2)\n"
+                                                     "target: addi $a0, $zero, 1\n"
+                                                     "addu $s4, $s4, $a0\n"
+                                                     "addiu $s5, $s5, 1\n"
+                                                     "li $t9, 200\n"
+                                                     "blt $s5, $t9, patch\n"
+                                                     "move $a0, $s1\n"
+                                                     "li $v0, 1\n"
+                                                     "syscall\n"
+                                                     "li $a0, 32\n"
+                                                     "li $v0, 11\n"
+                                                     "syscall\n"
+                                                     "move $a0, $s3\n"
+                                                     "li $v0, 1\n"
+                                                     "syscall\n"
+                                                     "li $a0, 32\n"
+                                                     "li $v0, 11\n"
+                                                     "syscall\n"
+                                                     "move $a0, $s4\n"
+                                                     "li $v0, 1\n"
+                                                     "syscall\n"
+                                                     "move $a0, $s6\n"
+                                                     "li $v0, 17\n"
+                                                     "syscall\n"
+                                                     "helper: xori $v1, $s1, 0x5a5a\n"
+                                                     "slti $v1, $v1, 100\n"
+                                                     "sltiu $v1, $v1, -1\n"
+                                                     "addu $s6, $s6, $v1\n"
+                                                     "andi $s6, $s6, 0xff\n"
+                                                     "jr $ra\n"
+                                                     "donor: addi $a0, $zero, 2\n"
+                                                     ".ktext\n"
+                                                     "addi $s3, $s3, 1\n"
+                                                     "mfc0 $k0, $14\n"
+                                                     "addi $k0, $k0, 4\n"
+                                                     "mtc0 $k0, $14\n"
+                                                     "eret");
+
+    std::istringstream iss;
+    std::ostringstream interpOss;
+    StreamHandle interpStreamHandle(iss, interpOss);
+    Simulator interpSimulator(IOMode::SYSCALL, interpStreamHandle);
+    const int interpExitCode = interpSimulator.simulate(layout);
+
+    std::ostringstream jitOss;
+    StreamHandle jitStreamHandle(iss, jitOss);
+    Simulator jitSimulator(IOMode::SYSCALL, jitStreamHandle);
+    jitSimulator.setEngine(ExecEngine::JIT);
+    const int jitExitCode = jitSimulator.simulate(layout);
+
+    REQUIRE(jitExitCode == interpExitCode);
+    REQUIRE(jitOss.str() == interpOss.str());
+    REQUIRE(interpOss.str().ends_with(" 199 300\n"));
+}
+
+
+TEST_CASE("Test JIT Code Cache Flush") {
+    // Without native compilation every lookup falls back to the interpreter, leaving nothing to flush
+    if (!JitCompiler::isAvailable())
+        return;
+
+    // Far more hot blocks than fit in the code cache, so that it fills and is flushed several times over
+    constexpr uint32_t blockCount = 256;
+    std::string source = "main: ";
+    for (uint32_t i = 0; i < blockCount; i++)
+        source += "addi $t0, $t0, 1\nj block" + std::to_string(i) + "\nblock" + std::to_string(i) + ": ";
+    source += "li $v0, 10\nsyscall";
+    const MemLayout layout = parseSource("test.asm", source);
+
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    DebugSimulator simulator(IOMode::SYSCALL, streamHandle);
+    REQUIRE(simulator.simulate(layout) == 0);
+    State& state = simulator.getState();
+    REQUIRE(state.registers[Register::T0] == blockCount);
+
+    DecodeCache decodeCache;
+    BlockCache blockCache;
+    JitCompiler jit(0x1000);
+    JitContext context{&state.memory, &blockCache};
+    // Each block is an addi and a jump, after the jump to main at the start of the text section
+    const uint32_t mainStart = memSectionOffset(MemSection::TEXT) + 4;
+    for (uint32_t round = 0; round < 2; round++) {
+        for (uint32_t i = 0; i < blockCount; i++) {
+            const uint32_t address = mainStart + i * 8;
+            const TranslatedBlock* block = blockCache.lookup(state.memory, decodeCache, address);
+            REQUIRE(block != nullptr);
+
+            CompiledBlock code = nullptr;
+            for (uint32_t hit = 0; hit < JIT_HOT_THRESHOLD && code == nullptr; hit++)
+                code = jit.lookup(*block, address);
+            REQUIRE(code != nullptr);
+
+            state.registers[Register::PC] = static_cast<int32_t>(address);
+            state.registers[Register::T0] = 0;
+            const uint32_t executed = code(state.registers.data(), &context);
+            REQUIRE(executed >= 1);
+            REQUIRE(state.registers[Register::T0] == 1);
+            REQUIRE(state.registers[Register::PC] == static_cast<int32_t>(address + executed * 4));
+        }
+    }
+}
+
+
+TEST_CASE("Test Jump And Link Register") {
+    // Calls through jalr with $t1 as the link register, which leaves $ra untouched
+    const MemLayout layout = parseSource("test.asm", "main: la $t9, helper\n"
+                                                     "li $s1, 200\n"
+                                                     "loop: jalr $t1, $t9\n"
+                                                     "addi $s1, $s1, -1\n"
+                                                     "bne $s1, $zero, loop\n"
+                                                     "move $a0, $s0\n"
+                                                     "li $v0, 1\n"
+                                                     "syscall\n"
+                                                     "li $a0, 32\n"
+                                                     "li $v0, 11\n"
+                                                     "syscall\n"
+                                                     "move $a0, $ra\n"
+                                                     "li $v0, 1\n"
+                                                     "syscall\n"
+                                                     "li $v0, 10\n"
+                                                     "syscall\n"
+                                                     "helper: addi $s0, $s0, 1\n"
+                                                     "jr $t1");
+
+    for (const ExecEngine engine : {ExecEngine::INTERPRETER, ExecEngine::JIT}) {
+        std::istringstream iss;
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        Simulator simulator(IOMode::SYSCALL, streamHandle);
+        simulator.setEngine(engine);
+        REQUIRE(simulator.simulate(layout) == 0);
+        REQUIRE(oss.str() == "200 0\n");
+    }
+}
+
+
+/**
+ * A stand-in for a translated block at the start of text, which counts its runs in $a0 and then continues at main
+ */
+uint32_t countingNativeBlock(int32_t* registers, JitContext*) {
+    registers[static_cast<uint32_t>(Register::A0)] += 10;
+    registers[static_cast<uint32_t>(Register::PC)] = static_cast<int32_t>(memSectionOffset(MemSection::TEXT)) + 4;
+    return 1;
+}
+
+
+TEST_CASE("Test Native Blocks") {
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(IOMode::SYSCALL, streamHandle);
+    const NativeBlock blocks[] = {{memSectionOffset(MemSection::TEXT), 1, &countingNativeBlock}};
+    simulator.setNativeBlocks(blocks);
+
+    SECTION("Test Dispatch") {
+        // Jumps back to the start of text through a register, so the native block runs twice
+        const MemLayout layout = parseSource("test.asm", "main: addi $s0, $s0, 1\n"
+                                                         "li $t0, 2\n"
+                                                         "beq $s0, $t0, done\n"
+                                                         "lui $t1, 0x40\n"
+                                                         "jr $t1\n"
+                                                         "done: li $v0, 1\n"
+                                                         "syscall\n"
+                                                         "li $v0, 10\n"
+                                                         "syscall");
+        REQUIRE(simulator.simulate(layout) == 0);
+        REQUIRE(oss.str() == "20\n");
+    }
+
+    SECTION("Test Modified Text") {
+        // Rewrites its own text before jumping back, so the second pass is interpreted
+        const MemLayout layout = parseSource("test.asm", "main: addi $s0, $s0, 1\n"
+                                                         "li $t0, 2\n"
+                                                         "beq $s0, $t0, done\n"
+                                                         "la $t2, main\n"
+                                                         "lw $t3, 0($t2)\n"
+                                                         "sw $t3, 0($t2)\n"
+                                                         "lui $t1, 0x40\n"
+                                                         "jr $t1\n"
+                                                         "done: li $v0, 1\n"
+                                                         "syscall\n"
+                                                         "li $v0, 10\n"
+                                                         "syscall");
+        REQUIRE(simulator.simulate(layout) == 0);
+        REQUIRE(oss.str() == "10\n");
+    }
+
+    SECTION("Test Call Graph") {
+        // Recording calls leaves the native block in use
+        simulator.setCallGraphProfiling(true);
+        const MemLayout layout = parseSource("test.asm", "main: addi $s0, $s0, 1\n"
+                                                         "li $t0, 2\n"
+                                                         "beq $s0, $t0, done\n"
+                                                         "lui $t1, 0x40\n"
+                                                         "jr $t1\n"
+                                                         "done: li $v0, 1\n"
+                                                         "syscall\n"
+                                                         "li $v0, 10\n"
+                                                         "syscall");
+        REQUIRE(simulator.simulate(layout) == 0);
+        REQUIRE(oss.str() == "20\n");
+    }
+}
+
+
+TEST_CASE("Test Execution Limits") {
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(IOMode::SYSCALL, streamHandle);
+    const MemLayout infiniteLoop = parseSource("test.asm", "main:\nloop: addi $t0, $t0, 1\nj loop");
+
+    SECTION("Test Instruction Limit") {
+        simulator.setInstructionLimit(100001);
+        REQUIRE(simulator.simulate(infiniteLoop) == INSTRUCTION_LIMIT_EXIT_CODE);
+        REQUIRE(simulator.instructionCount() == 100001);
+        REQUIRE(oss.str() == "Execution terminated (Instruction limit reached after 100001 instructions)\n");
+    }
+
+    SECTION("Test Timeout") {
+        simulator.setTimeout(std::chrono::milliseconds(20));
+        REQUIRE(simulator.simulate(infiniteLoop) == TIMEOUT_EXIT_CODE);
+        REQUIRE(simulator.instructionCount() > 0);
+        REQUIRE(oss.str().starts_with("Execution terminated (Timed out after "));
+    }
+
+    SECTION("Test Within Limits") {
+        simulator.setInstructionLimit(4);
+        simulator.setTimeout(std::chrono::seconds(60));
+        REQUIRE(simulator.simulate(parseSource("test.asm", "main:\nli $a0, 3\nli $v0, 17\nsyscall")) == 3);
+        REQUIRE(simulator.instructionCount() == 4);
+    }
+}
+
+
+TEST_CASE("Test Simulator Snapshots") {
+    // Prints a counter that it also stores in memory, then patches its own text before exiting
+    const MemLayout layout = parseSource("test.asm", "main: la $t0, count\n"
+                                                     "lw $a0, 0($t0)\n"
+                                                     "li $t2, 5\n"
+                                                     "loop: addi $a0, $a0, 1\n"
+                                                     "sw $a0, 0($t0)\n"
+                                                     "li $v0, 1\n"
+                                                     "syscall\n"
+                                                     "blt $a0, $t2, loop\n"
+                                                     "la $t1, main\n"
+                                                     "sw $zero, 0($t1)\n"
+                                                     "li $v0, 10\n"
+                                                     "syscall\n"
+                                                     ".data\n"
+                                                     "count: .word 0");
+
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(IOMode::SYSCALL, streamHandle);
+    simulator.initProgram(layout);
+    REQUIRE(simulator.run(12).status == RunStatus::STEP_LIMIT);
+    const SimulatorSnapshot snapshot = simulator.snapshot();
+    const std::string before = oss.str();
+
+    REQUIRE(simulator.run(1000).status == RunStatus::EXITED);
+    const std::string after = oss.str().substr(before.size());
+    REQUIRE(before + after == "12345");
+
+    SECTION("Test Restore") {
+        // The restored text must be decoded again, as the program patched it before exiting
+        for (int i = 0; i < 3; i++) {
+            simulator.restore(snapshot);
+            oss.str("");
+            REQUIRE(simulator.run(1000).status == RunStatus::EXITED);
+            REQUIRE(oss.str() == after);
+        }
+    }
+
+    SECTION("Test Fork") {
+        std::ostringstream forkOss;
+        StreamHandle forkHandle(iss, forkOss);
+        Simulator fork(IOMode::SYSCALL, forkHandle);
+        fork.setEngine(ExecEngine::JIT);
+        fork.restore(snapshot);
+        REQUIRE(fork.run(1000).status == RunStatus::EXITED);
+        REQUIRE(forkOss.str() == after);
+    }
+
+    SECTION("Test Open Files") {
+        // Files are not part of a snapshot, so restoring one closes every file opened since
+        const std::filesystem::path root =
+                std::filesystem::temp_directory_path() /
+                ("masm_snapshot_files_" + std::to_string(getpid()) + "_" + std::to_string(std::random_device{}()));
+        std::filesystem::create_directories(root);
+        const MemLayout fileLayout = parseSource("test.asm", "main: la $a0, name\n"
+                                                             "li $a1, 1\n"
+                                                             "li $v0, 13\n"
+                                                             "syscall\n"
+                                                             "li $v0, 10\n"
+                                                             "syscall\n"
+                                                             ".data\n"
+                                                             "name: .asciiz \"out.txt\"");
+
+        Simulator fileSimulator(IOMode::SYSCALL, streamHandle);
+        fileSimulator.setFileSandbox(root);
+        fileSimulator.initProgram(fileLayout);
+        const SimulatorSnapshot start = fileSimulator.snapshot();
+        REQUIRE(fileSimulator.run(1000).status == RunStatus::EXITED);
+        REQUIRE(fileSimulator.fileTable().openCount() == 1);
+        fileSimulator.restore(start);
+        REQUIRE(fileSimulator.fileTable().openCount() == 0);
+        std::filesystem::remove_all(root);
+    }
+}
+
+
+TEST_CASE("Test Program Image") {
+    // Increments a counter in the data section, then divides by zero to report its source location
+    const ProgramImage image(parseSource("test.asm", "main: la $t0, count\n"
+                                                     "lw $a0, 0($t0)\n"
+                                                     "addi $a0, $a0, 1\n"
+                                                     "sw $a0, 0($t0)\n"
+                                                     "li $v0, 1\n"
+                                                     "syscall\n"
+                                                     "div $a0, $zero\n"
+                                                     ".data\n"
+                                                     "count: .word 41"));
+
+    for (int i = 0; i < 3; i++) {
+        // Each simulator writes to its own copy of the data page, leaving the image untouched
+        std::istringstream iss;
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        Simulator simulator(IOMode::SYSCALL, streamHandle);
+        REQUIRE_THROWS_MATCHES(simulator.simulate(image), MasmRuntimeError,
+                               Catch::Matchers::Message("Runtime error at 0x00400020 (test.asm:7) -> Division by "
+                                                        "zero: Division by zero in DIV instruction (unhandled)"));
+        REQUIRE(oss.str() == "42");
+    }
+}
+
+
+TEST_CASE("Test MMIO Poll Interval") {
+    // Busy-waits on the input ready bit, then echoes the character back to the display
+    const MemLayout layout = parseSource("test.asm", "main: lui $t0, 0xffff\n"
+                                                     "wait: lw $t1, 0($t0)\n"
+                                                     "beq $t1, $zero, wait\n"
+                                                     "lw $t2, 4($t0)\n"
+                                                     "sw $t2, 12($t0)\n"
+                                                     "nop\n"
+                                                     "li $v0, 10\n"
+                                                     "syscall");
+
+    for (const uint32_t interval : {1u, 7u, DEFAULT_INPUT_POLL_INTERVAL}) {
+        std::istringstream iss("x");
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        Simulator simulator(IOMode::MMIO, streamHandle);
+        simulator.setInputPollInterval(interval);
+        simulator.initProgram(layout);
+
+        RunResult result = simulator.run(1000);
+        REQUIRE(result.status == RunStatus::EXITED);
+        REQUIRE(oss.str() == "x");
+    }
+
+    SECTION("Test Poll Deferred By Display Interrupt") {
+        // The store makes output pending on the same step that input is due, and the display interrupt comes first.
+        // The input is still read as soon as the handler returns, so the wait loop runs once
+        const MemLayout interrupted = parseSource("test.asm", "main: li $t0, 0x0201\n"
+                                                              "mtc0 $t0, $12\n"
+                                                              "lui $t1, 0xffff\n"
+                                                              "li $t2, 97\n"
+                                                              "sw $t2, 12($t1)\n"
+                                                              "wait: addi $s0, $s0, 1\n"
+                                                              "lw $t3, 0($t1)\n"
+                                                              "beq $t3, $zero, wait\n"
+                                                              "move $a0, $s0\n"
+                                                              "li $v0, 17\n"
+                                                              "syscall\n"
+                                                              ".ktext\n"
+                                                              "eret");
+        std::istringstream iss("x");
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        Simulator simulator(IOMode::MMIO, streamHandle);
+        simulator.setInputPollInterval(7);
+        simulator.initProgram(interrupted);
+
+        const RunResult result = simulator.run(1000);
+        REQUIRE(result.status == RunStatus::EXITED);
+        REQUIRE(oss.str() == "a");
+        REQUIRE(result.exitCode == 1);
+    }
+
+    std::istringstream iss;
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(IOMode::MMIO, streamHandle);
+    REQUIRE_THROWS_AS(simulator.setInputPollInterval(0), std::invalid_argument);
+}
+
+
 TEST_CASE("Test Execute Hello World") {
     const std::string test_case = "hello_world";
     validateOutput(IOMode::SYSCALL, {"tests/fixtures/" + test_case + "/" + test_case + ".asm"},
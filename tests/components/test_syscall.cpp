@@ -2,6 +2,13 @@
 // Created by matthew on 5/18/25.
 //
 
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <unistd.h>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers.hpp>
 #include <catch2/matchers/catch_matchers_exception.hpp>
@@ -28,6 +35,7 @@ TEST_CASE("Test Print Int Syscall") {
     std::stringstream ostream;
     StreamHandle streamHandle{std::cin, ostream};
     sysHandle.printInt(state, streamHandle);
+    streamHandle.flush();
 
     REQUIRE(expected == ostream.str());
 }
@@ -41,6 +49,7 @@ TEST_CASE("Test Print Float Syscall") {
     std::stringstream ostream;
     StreamHandle streamHandle{std::cin, ostream};
     sysHandle.printFloat(state, streamHandle);
+    streamHandle.flush();
 
     REQUIRE(expected == ostream.str());
 }
@@ -54,11 +63,54 @@ TEST_CASE("Test Print Double Syscall") {
     std::stringstream ostream;
     StreamHandle streamHandle{std::cin, ostream};
     sysHandle.printDouble(state, streamHandle);
+    streamHandle.flush();
 
     REQUIRE(expected == ostream.str());
 }
 
 
+TEST_CASE("Test Numeric Output Formats") {
+    SystemHandle sysHandle;
+    State state;
+    std::stringstream ostream;
+    StreamHandle streamHandle{std::cin, ostream};
+
+    // Every number is printed exactly as an ostream with the syscall's settings would print it
+    const std::vector<double> values = {0.0,      -0.0,    1.0,       -2.5,     1e-7,   123456.0,      1234567.0,
+                                        1e100,    -1e-300, 0.1,       1.0 / 3,  5e-324, std::nan(""), -INFINITY,
+                                        INFINITY, 999999.5, 0.0001234, 65536.25, -1e6,   3.4028235e38, 1.17549e-38};
+    for (const double value : values) {
+        std::ostringstream expected;
+        expected << std::setprecision(6) << static_cast<float>(value) << " " << value;
+
+        ostream.str("");
+        state.cp1.setFloat(Coproc1Register::F12, static_cast<float>(value));
+        sysHandle.printFloat(state, streamHandle);
+        streamHandle.putChar(' ');
+        state.cp1.setDouble(Coproc1Register::F12, value);
+        sysHandle.printDouble(state, streamHandle);
+        streamHandle.flush();
+        REQUIRE(ostream.str() == expected.str());
+    }
+
+    for (const int32_t value : {0, 1, -1, 69, 255, 65536, INT32_MAX, INT32_MIN}) {
+        std::ostringstream expected;
+        expected << value << " " << static_cast<uint32_t>(value) << " " << std::hex << std::setw(8)
+                 << std::setfill('0') << value;
+
+        ostream.str("");
+        state.registers[Register::A0] = value;
+        sysHandle.printInt(state, streamHandle);
+        streamHandle.putChar(' ');
+        sysHandle.printUInt(state, streamHandle);
+        streamHandle.putChar(' ');
+        sysHandle.printIntHex(state, streamHandle);
+        streamHandle.flush();
+        REQUIRE(ostream.str() == expected.str());
+    }
+}
+
+
 TEST_CASE("Test Print String Syscall") {
     SystemHandle sysHandle;
     const std::string expected = "Hello, world!";
@@ -68,6 +120,7 @@ TEST_CASE("Test Print String Syscall") {
     std::stringstream ostream;
     StreamHandle streamHandle{std::cin, ostream};
     sysHandle.printString(state, streamHandle);
+    streamHandle.flush();
 
     REQUIRE(expected == ostream.str());
 }
@@ -104,6 +157,20 @@ TEST_CASE("Test Read Int Syscall") {
                                Catch::Matchers::Message("Input out of range: 99999999999999999999"));
     }
 
+    SECTION("Lenient Input") {
+        // Whitespace and a plus sign before the number and anything after it are ignored, as with std::stoi
+        std::istringstream istream(" \t+17\n-8 apples\n2147483647\n+-3\n");
+        StreamHandle streamHandle{istream, std::cout};
+        sysHandle.readInt(state, streamHandle);
+        REQUIRE(state.registers[Register::V0] == 17);
+        sysHandle.readInt(state, streamHandle);
+        REQUIRE(state.registers[Register::V0] == -8);
+        sysHandle.readInt(state, streamHandle);
+        REQUIRE(state.registers[Register::V0] == INT32_MAX);
+        REQUIRE_THROWS_MATCHES(sysHandle.readInt(state, streamHandle), ExecExcept,
+                               Catch::Matchers::Message("Invalid input: +-3"));
+    }
+
     SECTION("Edited Input") {
         const std::string input = "42\b4\n";
         std::istringstream istream(input);
@@ -145,6 +212,17 @@ TEST_CASE("Test Read Float Syscall") {
         REQUIRE_THROWS_MATCHES(sysHandle.readFloat(state, streamHandle), ExecExcept,
                                Catch::Matchers::Message("Float input out of range: 1e40"));
     }
+
+    SECTION("Lenient Input") {
+        std::istringstream istream("  +2.5e3x\n-0x1.8p1\ninf\n");
+        StreamHandle streamHandle{istream, std::cout};
+        sysHandle.readFloat(state, streamHandle);
+        REQUIRE(state.cp1.getFloat(Coproc1Register::F0) == 2500.0f);
+        sysHandle.readFloat(state, streamHandle);
+        REQUIRE(state.cp1.getFloat(Coproc1Register::F0) == -3.0f);
+        sysHandle.readFloat(state, streamHandle);
+        REQUIRE(std::isinf(state.cp1.getFloat(Coproc1Register::F0)));
+    }
 }
 
 
@@ -250,6 +328,149 @@ TEST_CASE("Test Heap Allocation Syscall") {
         REQUIRE_THROWS_MATCHES(sysHandle.heapAlloc(state), ExecExcept,
                                Catch::Matchers::Message("Cannot allocate zero bytes"));
     }
+
+    SECTION("Test Heap Free") {
+        const uint32_t a = state.heapAllocator.allocate(16);
+        const uint32_t b = state.heapAllocator.allocate(32);
+        const uint32_t c = state.heapAllocator.allocate(16);
+
+        state.registers[Register::A0] = static_cast<int32_t>(b);
+        sysHandle.heapFree(state);
+        REQUIRE(state.heapAllocator.allocated() == 32);
+        REQUIRE(state.heapAllocator.top() == heapBaseAddr + 64);
+
+        // The smallest free block that fits is reused before the heap grows
+        REQUIRE(state.heapAllocator.allocate(8) == b);
+        REQUIRE(state.heapAllocator.allocate(24) == b + 8);
+        REQUIRE(state.heapAllocator.allocate(4) == heapBaseAddr + 64);
+
+        // Freeing the blocks at the top of the heap lowers it, merging with the free blocks below them
+        state.heapAllocator.free(heapBaseAddr + 64);
+        state.heapAllocator.free(c);
+        state.heapAllocator.free(b + 8);
+        REQUIRE(state.heapAllocator.top() == b + 8);
+        state.heapAllocator.free(b);
+        state.heapAllocator.free(a);
+        REQUIRE(state.heapAllocator.top() == heapBaseAddr);
+        REQUIRE(state.heapAllocator.allocated() == 0);
+        REQUIRE(state.heapAllocator.blocks().empty());
+
+        state.registers[Register::A0] = 0;
+        REQUIRE_NOTHROW(sysHandle.heapFree(state));
+        state.registers[Register::A0] = static_cast<int32_t>(a);
+        REQUIRE_THROWS_MATCHES(sysHandle.heapFree(state), ExecExcept,
+                               Catch::Matchers::Message("Cannot free unallocated address"));
+    }
+
+    SECTION("Test Heap Realloc") {
+        // A zero address allocates a new block
+        state.registers[Register::A0] = 0;
+        state.registers[Register::A1] = 8;
+        sysHandle.heapRealloc(state);
+        const uint32_t a = state.registers[Register::V0];
+        REQUIRE(a == heapBaseAddr);
+        state.memory.wordTo(a, 0x12345678);
+        state.memory.wordTo(a + 4, 0x0abcdef0);
+
+        // The block at the top of the heap grows in place
+        state.registers[Register::A0] = static_cast<int32_t>(a);
+        state.registers[Register::A1] = 16;
+        sysHandle.heapRealloc(state);
+        REQUIRE(static_cast<uint32_t>(state.registers[Register::V0]) == a);
+        REQUIRE(state.heapAllocator.top() == heapBaseAddr + 16);
+
+        // A block with no room after it moves, taking its contents along
+        const uint32_t b = state.heapAllocator.allocate(4);
+        state.registers[Register::A0] = static_cast<int32_t>(a);
+        state.registers[Register::A1] = 32;
+        sysHandle.heapRealloc(state);
+        const uint32_t moved = state.registers[Register::V0];
+        REQUIRE(moved == b + 4);
+        REQUIRE(state.memory.wordAt(moved) == 0x12345678);
+        REQUIRE(state.memory.wordAt(moved + 4) == 0x0abcdef0);
+        REQUIRE(state.heapAllocator.sizeOf(a) == 0);
+        REQUIRE(state.heapAllocator.sizeOf(moved) == 32);
+        REQUIRE(state.heapAllocator.allocated() == 36);
+
+        // Shrinking frees the tail of the block, and a zero size frees the whole block
+        state.registers[Register::A0] = static_cast<int32_t>(moved);
+        state.registers[Register::A1] = 8;
+        sysHandle.heapRealloc(state);
+        REQUIRE(static_cast<uint32_t>(state.registers[Register::V0]) == moved);
+        REQUIRE(state.heapAllocator.top() == moved + 8);
+        state.registers[Register::A1] = 0;
+        sysHandle.heapRealloc(state);
+        REQUIRE(state.registers[Register::V0] == 0);
+        REQUIRE(state.heapAllocator.allocated() == 4);
+        REQUIRE(state.heapAllocator.top() == b + 4);
+
+        // A block grows in place into the free block after it, leaving the rest of that block free
+        const uint32_t d = state.heapAllocator.allocate(20);
+        REQUIRE(d == b + 4);
+        // The smallest free block is the one freed by the move, which is split to hold the block after it
+        REQUIRE(state.heapAllocator.allocate(4) == a);
+        state.heapAllocator.free(d);
+        REQUIRE(state.heapAllocator.reallocate(b, 12) == b);
+        REQUIRE(state.heapAllocator.sizeOf(b) == 12);
+        REQUIRE(state.heapAllocator.allocate(12) == a + 4);
+        REQUIRE(state.heapAllocator.allocate(12) == b + 12);
+
+        state.registers[Register::A0] = static_cast<int32_t>(b + 1);
+        state.registers[Register::A1] = 4;
+        REQUIRE_THROWS_MATCHES(sysHandle.heapRealloc(state), ExecExcept,
+                               Catch::Matchers::Message("Cannot reallocate unallocated address"));
+    }
+
+    SECTION("Test Heap Realloc Out of Memory") {
+        // A resize that would reach past the stack fails without moving, growing or freeing the block
+        const uint32_t a = state.heapAllocator.allocate(8);
+        const uint32_t b = state.heapAllocator.allocate(4);
+        state.memory.wordTo(a, 0x12345678);
+        state.registers[Register::SP] = static_cast<int32_t>(heapBaseAddr + 64);
+        for (const uint32_t address : {a, b}) {
+            state.registers[Register::A0] = static_cast<int32_t>(address);
+            state.registers[Register::A1] = 64;
+            REQUIRE_THROWS_MATCHES(sysHandle.heapRealloc(state), ExecExcept, Catch::Matchers::Message("Out of Memory"));
+        }
+        REQUIRE(state.heapAllocator.sizeOf(a) == 8);
+        REQUIRE(state.heapAllocator.sizeOf(b) == 4);
+        REQUIRE(state.heapAllocator.allocated() == 12);
+        REQUIRE(state.heapAllocator.top() == heapBaseAddr + 12);
+        REQUIRE(state.memory.wordAt(a) == 0x12345678);
+    }
+
+    SECTION("Test Heap Restore") {
+        std::vector<uint32_t> addresses;
+        for (uint32_t i = 1; i <= 8; i++)
+            addresses.push_back(state.heapAllocator.allocate(i * 4));
+        for (size_t i = 0; i < addresses.size(); i += 2)
+            state.heapAllocator.free(addresses[i]);
+
+        // The gaps between the blocks of a restored heap are free again
+        HeapAllocator restored(state.heapAllocator.blocks(), state.heapAllocator.top());
+        REQUIRE(restored.allocated() == state.heapAllocator.allocated());
+        REQUIRE(restored.top() == state.heapAllocator.top());
+        for (const uint32_t size : {20u, 4u, 12u, 28u})
+            REQUIRE(restored.allocate(size) == state.heapAllocator.allocate(size));
+    }
+
+    SECTION("Test Many Heap Blocks") {
+        std::vector<uint32_t> addresses;
+        for (uint32_t i = 0; i < 50000; i++)
+            addresses.push_back(state.heapAllocator.allocate(i % 64 + 1));
+        for (size_t i = 0; i < addresses.size(); i += 2)
+            state.heapAllocator.free(addresses[i]);
+        const size_t allocated = state.heapAllocator.allocated();
+        const uint32_t top = state.heapAllocator.top();
+
+        // Every freed block is reused before the heap grows again
+        uint32_t highest = 0;
+        for (size_t i = 0; i < addresses.size(); i += 2)
+            highest = std::max(highest, state.heapAllocator.allocate(i % 64 + 1));
+        REQUIRE(highest < top);
+        REQUIRE(state.heapAllocator.top() == top);
+        REQUIRE(state.heapAllocator.allocated() > allocated);
+    }
 }
 
 
@@ -270,11 +491,47 @@ TEST_CASE("Test Print Char Syscall") {
     std::stringstream ostream;
     StreamHandle streamHandle{std::cin, ostream};
     sysHandle.printChar(state, streamHandle);
+    streamHandle.flush();
 
     REQUIRE(expected == ostream.str()[0]);
 }
 
 
+TEST_CASE("Test Buffered Output") {
+    SystemHandle sysHandle;
+    State state;
+    const uint32_t strAddr = writeStringToMem(state, "Name? ");
+    std::stringstream istream("masm\n");
+    std::stringstream ostream;
+    StreamHandle streamHandle{istream, ostream};
+
+    // Output is held back until the program asks for input
+    state.registers[Register::A0] = static_cast<int32_t>(strAddr);
+    sysHandle.printString(state, streamHandle);
+    streamHandle.putChar('>');
+    REQUIRE(ostream.str().empty());
+    REQUIRE(streamHandle.getLine() == "masm");
+    REQUIRE(ostream.str() == "Name? >");
+
+    // Exec flushes before sleeping, so that output written before a pause is shown during it
+    state.registers[Register::A0] = 42;
+    sysHandle.printInt(state, streamHandle);
+    state.registers[Register::V0] = static_cast<int32_t>(Syscall::SLEEP);
+    state.registers[Register::A0] = 1;
+    sysHandle.exec(IOMode::SYSCALL, state, streamHandle);
+    REQUIRE(ostream.str() == "Name? >42");
+
+    // Writes larger than the buffer pass straight through in order
+    const std::string large(20000, 'x');
+    streamHandle.putChar('<');
+    streamHandle.putStr(large);
+    REQUIRE(ostream.str() == "Name? >42<" + large);
+    streamHandle.putChar('!');
+    streamHandle.flush();
+    REQUIRE(ostream.str() == "Name? >42<" + large + "!");
+}
+
+
 TEST_CASE("Test Read Char Syscall") {
     SystemHandle sysHandle;
     const std::string input = "A";
@@ -351,6 +608,7 @@ TEST_CASE("Test Print Int Hex Syscall") {
     std::stringstream ostream;
     StreamHandle streamHandle{std::cin, ostream};
     sysHandle.printIntHex(state, streamHandle);
+    streamHandle.flush();
 
     REQUIRE(expected == ostream.str());
 }
@@ -364,6 +622,7 @@ TEST_CASE("Test Print Int Bin Syscall") {
     std::stringstream ostream;
     StreamHandle streamHandle{std::cin, ostream};
     sysHandle.printIntBin(state, streamHandle);
+    streamHandle.flush();
 
     REQUIRE(expected == ostream.str());
 }
@@ -377,6 +636,7 @@ TEST_CASE("Test Print UInt Syscall") {
     std::stringstream ostream;
     StreamHandle streamHandle{std::cin, ostream};
     sysHandle.printUInt(state, streamHandle);
+    streamHandle.flush();
 
     REQUIRE(expected == ostream.str());
 }
@@ -444,3 +704,135 @@ TEST_CASE("Test Random Double Syscall") {
 
     REQUIRE(state.cp1.getDouble(Coproc1Register::F0) == expected);
 }
+
+
+/**
+ * Runs a syscall through the system handle with the given argument registers
+ * @param sysHandle The system handle to run the syscall with
+ * @param state The state to run the syscall on
+ * @param streamHandle The console of the syscall
+ * @param syscall The syscall to run
+ * @param a0 The value of $a0
+ * @param a1 The value of $a1
+ * @param a2 The value of $a2
+ * @return The value of $v0 after the syscall
+ */
+int32_t fileSyscall(SystemHandle& sysHandle, State& state, StreamHandle& streamHandle, const Syscall syscall,
+                    const int32_t a0, const int32_t a1 = 0, const int32_t a2 = 0) {
+    state.registers[Register::V0] = static_cast<int32_t>(syscall);
+    state.registers[Register::A0] = a0;
+    state.registers[Register::A1] = a1;
+    state.registers[Register::A2] = a2;
+    sysHandle.exec(IOMode::SYSCALL, state, streamHandle);
+    return state.registers[Register::V0];
+}
+
+
+TEST_CASE("Test File Syscalls") {
+    // A directory of its own keeps concurrent test runs from deleting each other's files
+    const std::filesystem::path root =
+            std::filesystem::temp_directory_path() /
+            ("masm_file_syscalls_" + std::to_string(getpid()) + "_" + std::to_string(std::random_device{}()));
+    std::filesystem::create_directories(root / "sandbox");
+    std::ofstream(root / "secret.txt") << "secret";
+
+    SystemHandle sysHandle;
+    FileTable files;
+    files.setSandbox(root / "sandbox");
+    sysHandle.setFileTable(&files);
+    State state;
+    std::stringstream istream("typed line\nrest");
+    std::stringstream ostream;
+    StreamHandle streamHandle{istream, ostream};
+    const uint32_t bufferAddr = memSectionOffset(MemSection::HEAP);
+
+    SECTION("Test Write Then Read") {
+        // Write a buffer larger than a page, starting partway through one
+        std::vector<std::byte> data(6000);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = static_cast<std::byte>('a' + i % 26);
+        state.memory.bytesTo(bufferAddr + 100, data);
+
+        const uint32_t nameAddr = writeStringToMem(state, "out.txt");
+        const int32_t writeFd = fileSyscall(sysHandle, state, streamHandle, Syscall::OPEN_FILE, nameAddr, 1);
+        REQUIRE(writeFd == 3);
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::WRITE_FILE, writeFd, bufferAddr + 100, 6000) ==
+                6000);
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::READ_FILE, writeFd, bufferAddr, 1) == -1);
+        fileSyscall(sysHandle, state, streamHandle, Syscall::CLOSE_FILE, writeFd);
+        REQUIRE(files.openCount() == 0);
+        REQUIRE(std::filesystem::file_size(root / "sandbox" / "out.txt") == 6000);
+
+        // Append to the file, then read all of it back into a fresh buffer
+        const int32_t appendFd = fileSyscall(sysHandle, state, streamHandle, Syscall::OPEN_FILE, nameAddr, 9);
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::WRITE_FILE, appendFd, bufferAddr + 100, 10) == 10);
+        const int32_t readFd = fileSyscall(sysHandle, state, streamHandle, Syscall::OPEN_FILE, nameAddr, 0);
+        REQUIRE(readFd == 4);
+        fileSyscall(sysHandle, state, streamHandle, Syscall::CLOSE_FILE, appendFd);
+
+        const uint32_t readAddr = bufferAddr + 0x10000;
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::READ_FILE, readFd, readAddr, 8000) == 6010);
+        std::vector<std::byte> read(6010);
+        state.memory.bytesAt(readAddr, read);
+        REQUIRE(std::equal(data.begin(), data.end(), read.begin()));
+        REQUIRE(std::equal(data.begin(), data.begin() + 10, read.begin() + 6000));
+        REQUIRE_FALSE(state.memory.isValid(readAddr + 6010));
+
+        // Reads at the end of the file return zero bytes
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::READ_FILE, readFd, readAddr, 10) == 0);
+        fileSyscall(sysHandle, state, streamHandle, Syscall::CLOSE_FILE, readFd);
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::READ_FILE, readFd, readAddr, 10) == -1);
+    }
+
+    SECTION("Test Sandbox") {
+        for (const std::string name : {"../secret.txt", "missing.txt", "", "sub/../../secret.txt"}) {
+            const uint32_t nameAddr = writeStringToMem(state, name);
+            REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::OPEN_FILE, nameAddr, 0) == -1);
+        }
+        const uint32_t absoluteAddr = writeStringToMem(state, (root / "secret.txt").string());
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::OPEN_FILE, absoluteAddr, 0) == -1);
+
+        const uint32_t nameAddr = writeStringToMem(state, "./inside.txt");
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::OPEN_FILE, nameAddr, 2) == -1);
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::OPEN_FILE, nameAddr, 1) == 3);
+
+        // Symbolic links are never followed, whether or not their targets exist
+        std::filesystem::create_symlink(root / "secret.txt", root / "sandbox" / "existing");
+        std::filesystem::create_symlink(root / "evil.txt", root / "sandbox" / "dangling");
+        std::filesystem::create_directory_symlink(root, root / "sandbox" / "escape");
+        for (const std::string name : {"existing", "dangling", "escape/secret.txt", "escape/evil.txt"}) {
+            const uint32_t linkAddr = writeStringToMem(state, name);
+            for (const int32_t flags : {0, 1, 9})
+                REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::OPEN_FILE, linkAddr, flags) == -1);
+        }
+        REQUIRE_FALSE(std::filesystem::exists(root / "evil.txt"));
+        REQUIRE(std::filesystem::file_size(root / "secret.txt") == 6);
+
+        // Without a sandbox, no file can be opened
+        files.setSandbox(std::nullopt);
+        REQUIRE(files.openCount() == 0);
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::OPEN_FILE, nameAddr, 0) == -1);
+        REQUIRE_THROWS_AS(files.setSandbox(root / "missing"), std::runtime_error);
+    }
+
+    SECTION("Test Console Descriptors") {
+        const uint32_t textAddr = writeStringToMem(state, "to the console");
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::WRITE_FILE, 1, textAddr, 6) == 6);
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::WRITE_FILE, 2, textAddr + 6, 8) == 8);
+        streamHandle.flush();
+        REQUIRE(ostream.str() == "to the console");
+
+        // Console reads stop at the end of a line
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::READ_FILE, 0, bufferAddr, 100) == 11);
+        REQUIRE(state.memory.byteAt(bufferAddr + 10) == '\n');
+        REQUIRE(fileSyscall(sysHandle, state, streamHandle, Syscall::READ_FILE, 0, bufferAddr, 2) == 2);
+        REQUIRE(state.memory.byteAt(bufferAddr + 1) == 'e');
+
+        state.registers[Register::V0] = static_cast<int32_t>(Syscall::WRITE_FILE);
+        state.registers[Register::A0] = 1;
+        REQUIRE_THROWS_AS(sysHandle.exec(IOMode::MMIO, state, streamHandle), ExecExcept);
+    }
+
+    files.closeAll();
+    std::filesystem::remove_all(root);
+}
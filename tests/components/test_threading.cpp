@@ -0,0 +1,195 @@
+//
+// Created by matthew on 10/16/26.
+//
+
+
+#include <array>
+#include <chrono>
+#include <catch2/catch_test_macros.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <masm/io/pipeio.hpp>
+#include <masm/simulator/cpu.hpp>
+#include <masm/simulator/program_image.hpp>
+#include <masm/simulator/simulator.hpp>
+
+#include "shared/fileio.hpp"
+#include "tests/testing_utilities.hpp"
+
+
+/**
+ * A fixture program along with the input to give it
+ */
+struct ThreadedProgram {
+    std::string name;
+    std::string input;
+};
+
+
+/**
+ * Assembles and simulates a fixture program from scratch
+ * @param program The fixture to run
+ * @param engine The engine to execute the program with
+ * @return The output of the program
+ */
+std::string assembleAndRun(const ThreadedProgram& program, const ExecEngine engine) {
+    const std::string fileName = "tests/fixtures/" + program.name + "/" + program.name + ".asm";
+    const MemLayout layout = parseSource(program.name + ".asm", readFile(fileName));
+
+    std::istringstream iss(program.input);
+    std::ostringstream oss;
+    StreamHandle streamHandle(iss, oss);
+    Simulator simulator(IOMode::SYSCALL, streamHandle);
+    simulator.setEngine(engine);
+    simulator.simulate(layout);
+    return oss.str();
+}
+
+
+TEST_CASE("Test Concurrent Instances") {
+    const std::vector<ThreadedProgram> programs = {
+            {"arithmetic", ""}, {"hello_world", ""}, {"input_output", "5\n"}, {"loops", ""}};
+    constexpr size_t threadCount = 8;
+    constexpr size_t iterations = 4;
+
+    // The outputs of a single thread are the reference for every concurrent run
+    std::vector<std::string> expected;
+    for (const ThreadedProgram& program : programs)
+        expected.push_back(assembleAndRun(program, ExecEngine::INTERPRETER));
+
+    // Each thread writes only to its own slot, so the results can be checked once every thread has joined
+    std::vector<std::vector<std::string>> outputs(threadCount);
+    std::vector<std::string> errors(threadCount);
+    {
+        std::vector<std::jthread> threads;
+        for (size_t t = 0; t < threadCount; t++) {
+            threads.emplace_back([&, t] {
+                try {
+                    const ExecEngine engine = t % 2 == 0 ? ExecEngine::INTERPRETER : ExecEngine::JIT;
+                    for (size_t i = 0; i < iterations; i++) {
+                        for (const ThreadedProgram& program : programs)
+                            outputs[t].push_back(assembleAndRun(program, engine));
+                        // Shared name tables are read alongside the parsers of other threads
+                        for (uint32_t reg = 0; reg < 32; reg++)
+                            if (RegisterFile::indexFromName(RegisterFile::nameFromIndex(reg)) != static_cast<int>(reg))
+                                throw std::runtime_error("Register name lookup mismatch");
+                    }
+                } catch (const std::exception& e) {
+                    errors[t] = e.what();
+                }
+            });
+        }
+    }
+
+    for (size_t t = 0; t < threadCount; t++) {
+        REQUIRE(errors[t].empty());
+        REQUIRE(outputs[t].size() == iterations * programs.size());
+        for (size_t i = 0; i < outputs[t].size(); i++)
+            REQUIRE(outputs[t][i] == expected[i % programs.size()]);
+    }
+}
+
+
+TEST_CASE("Test Shared Program Image") {
+    const ProgramImage image(parseSource("input_output.asm", readFile("tests/fixtures/input_output/input_output.asm")));
+    constexpr size_t threadCount = 8;
+
+    // Every thread maps the same image and writes to the data and stack pages that it shares
+    std::vector<std::string> outputs(threadCount);
+    std::vector<std::string> errors(threadCount);
+    {
+        std::vector<std::jthread> threads;
+        for (size_t t = 0; t < threadCount; t++) {
+            threads.emplace_back([&, t] {
+                try {
+                    std::istringstream iss(std::to_string(t + 1) + "\n");
+                    std::ostringstream oss;
+                    StreamHandle streamHandle(iss, oss);
+                    Simulator simulator(IOMode::SYSCALL, streamHandle);
+                    simulator.setEngine(t % 2 == 0 ? ExecEngine::INTERPRETER : ExecEngine::JIT);
+                    simulator.simulate(image);
+                    outputs[t] = oss.str();
+                } catch (const std::exception& e) {
+                    errors[t] = e.what();
+                }
+            });
+        }
+    }
+
+    constexpr std::array<int, threadCount> factorials = {1, 2, 6, 24, 120, 720, 5040, 40320};
+    for (size_t t = 0; t < threadCount; t++) {
+        REQUIRE(errors[t].empty());
+        REQUIRE(outputs[t].ends_with("The factorial is: " + std::to_string(factorials[t]) + "\n"));
+    }
+}
+
+
+TEST_CASE("Test Pipe Input") {
+    const MemLayout layout = parseSource("input_output.asm", readFile("tests/fixtures/input_output/input_output.asm"));
+
+    SECTION("Test Input Fed While Running") {
+        std::ostringstream oss;
+        PipeStreamHandle pipe(oss);
+        std::string error;
+        int exitCode = -1;
+        {
+            // The simulator blocks on its read until the input is fed from this thread
+            std::jthread runner([&] {
+                try {
+                    Simulator simulator(IOMode::SYSCALL, pipe);
+                    exitCode = simulator.simulate(layout);
+                } catch (const std::exception& e) {
+                    error = e.what();
+                }
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            pipe.feed("");
+            pipe.feed("5");
+            pipe.feed("\n");
+        }
+
+        REQUIRE(error.empty());
+        REQUIRE(exitCode == 0);
+        REQUIRE(oss.str().ends_with("The factorial is: 120\n"));
+    }
+
+    SECTION("Test Closed Pipe") {
+        std::ostringstream oss;
+        PipeStreamHandle pipe(oss);
+        pipe.feed("ab");
+        REQUIRE(pipe.hasChar());
+        REQUIRE(pipe.getChar() == 'a');
+
+        // Closing wakes a blocked read, which fails once the fed input runs out
+        char second = 0;
+        std::string error;
+        {
+            std::jthread reader([&] {
+                try {
+                    second = pipe.getCharBlocking();
+                    pipe.getCharBlocking();
+                } catch (const std::runtime_error& e) {
+                    error = e.what();
+                }
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            pipe.close();
+        }
+        REQUIRE(second == 'b');
+        REQUIRE(error == "End of input stream reached");
+        REQUIRE_FALSE(pipe.hasChar());
+        REQUIRE_THROWS_AS(pipe.feed("c"), std::runtime_error);
+    }
+
+    SECTION("Test Ended Stream") {
+        // A plain stream that has ended fails a blocking read instead of waiting forever
+        std::istringstream iss("x");
+        std::ostringstream oss;
+        StreamHandle streamHandle(iss, oss);
+        REQUIRE(streamHandle.getCharBlocking() == 'x');
+        REQUIRE_THROWS_AS(streamHandle.getCharBlocking(), std::runtime_error);
+    }
+}
@@ -124,6 +124,38 @@ TEST_CASE("Test jalr Instruction") {
 }
 
 
+TEST_CASE("Test jalr Instruction With Link Register") {
+    const SourceFile rawFile = makeRawFile({"jalr $t1, $t0"});
+    const std::vector<LineTokens> actualTokens = Tokenizer::tokenizeFile({rawFile});
+    SECTION("Test Tokenize") {
+        const std::vector<std::vector<Token>> expectedTokens = {{{TokenCategory::INSTRUCTION, "jalr"},
+                                                                 {TokenCategory::REGISTER, "t1"},
+                                                                 {TokenCategory::SEPERATOR, ","},
+                                                                 {TokenCategory::REGISTER, "t0"}}};
+        REQUIRE_NOTHROW(validateTokenLines(expectedTokens, actualTokens));
+    }
+
+    Parser parser{};
+    const MemLayout actualLayout = parser.parse(actualTokens, true);
+    SECTION("Test Parse") {
+        const std::vector<std::byte> expectedBytes = iV2bV({0x01, 0x00, 0x48, 0x09});
+        const std::vector<std::byte> actualBytes = actualLayout.data.at(MemSection::TEXT);
+        REQUIRE(expectedBytes == actualBytes);
+    }
+
+    StreamHandle streamHandle(std::cin, std::cout);
+    DebugSimulator simulator(IOMode::SYSCALL, streamHandle);
+
+    simulator.getState().registers[Register::T0] = 0x00400010;
+    simulator.simulate(actualLayout);
+    SECTION("Test Execute") {
+        REQUIRE(simulator.getState().registers[Register::PC] == 0x00400010);
+        REQUIRE(simulator.getState().registers[Register::T1] == 0x00400004);
+        REQUIRE(simulator.getState().registers[Register::RA] == 0);
+    }
+}
+
+
 TEST_CASE("Test beq Instruction") {
     const SourceFile rawFile = makeRawFile({"beq $t0, $t1, label"});
     const std::vector<LineTokens> actualTokens = Tokenizer::tokenizeFile({rawFile});
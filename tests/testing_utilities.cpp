@@ -35,6 +35,13 @@ SourceFile makeRawFile(const std::vector<std::string>& lines) {
 }
 
 
+MemLayout parseSource(const std::string& name, const std::string& source) {
+    const std::vector<LineTokens> tokens = Tokenizer::tokenize({{name, source}});
+    Parser parser{};
+    return parser.parse(tokens);
+}
+
+
 void validateTokenLines(const std::vector<std::vector<Token>>& expectedTokens,
                         const std::vector<LineTokens>& actualTokens) {
     if (expectedTokens.size() != actualTokens.size())
@@ -35,6 +35,15 @@ std::vector<uint8_t> bV2iV(const std::vector<std::byte>& byteVec);
 SourceFile makeRawFile(const std::vector<std::string>& lines);
 
 
+/**
+ * Tokenizes and parses a single source file into a memory layout
+ * @param name The name of the source file
+ * @param source The assembly source to parse
+ * @return The parsed memory layout
+ */
+MemLayout parseSource(const std::string& name, const std::string& source);
+
+
 /**
  * Validates the token lines of a file against the expected tokens, fails if the tokens do not match
  * @param expectedTokens The expected tokens to compare against